@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+class PythonProcessor;
+
+struct BatchOptions {
+    std::size_t workers = 4;                        // files processed at once
+    std::string outputSuffix = ".result.json";      // data.json -> data.result.json
+};
+
+struct BatchProgress {
+    std::size_t total = 0;
+    std::size_t completed = 0;                      // including failed files
+    std::size_t failed = 0;
+    std::uint64_t inputBytes = 0;                   // read so far
+    std::chrono::duration<double> elapsed{0};
+
+    double filesPerSecond() const;
+    double megabytesPerSecond() const;
+};
+
+struct BatchFailure {
+    std::filesystem::path input;
+    std::string error;
+};
+
+struct BatchSummary {
+    BatchProgress progress;
+    std::vector<BatchFailure> failures;             // in completion order
+    bool cancelled = false;
+};
+
+// *.json files directly inside directory, sorted by name, leaving out the
+// results of earlier runs
+std::vector<std::filesystem::path> findBatchInputs(const std::filesystem::path& directory, const BatchOptions& options = {});
+
+// Where the result for input goes: next to it, with the output suffix
+std::filesystem::path batchOutputPath(const std::filesystem::path& input, const BatchOptions& options = {});
+
+// Processes every input on a fixed pool of options.workers threads and writes
+// each response next to its input. Documents that are not valid JSON objects
+// are rejected before they reach the processor. Failed files get an error
+// response as their result and are listed in the summary; files that cannot
+// be read get no result. progress is called from the worker threads, one call
+// at a time, after every file. Stopping lets files in flight finish and skips
+// the rest.
+BatchSummary runBatch(PythonProcessor& processor, const std::vector<std::filesystem::path>& inputs,
+    const BatchOptions& options = {}, const std::function<void(const BatchProgress&)>& progress = {},
+    std::stop_token stop = {});
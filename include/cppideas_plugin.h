@@ -0,0 +1,75 @@
+/*
+ * C ABI for native request handler plugins.
+ *
+ * A plugin is a shared object placed in the plugin directory (CPPIDEAS_PLUGIN_DIR,
+ * or ./plugins when unset). At startup PythonProcessor loads every plugin in it
+ * and calls its init function, which registers handlers for (type, operation)
+ * pairs. Requests matching a plugin handler are passed to it as JSON text
+ * before the built-in native handlers and Python see them, without holding the
+ * GIL. A handler can defer, which hands the request on to the built-in handler
+ * or to processor.py.
+ *
+ * Only C types cross the boundary, so plugins can be built with any compiler
+ * or language. Plugins must export:
+ *
+ *     uint32_t cppideas_plugin_abi_version(void);   returns CPPIDEAS_PLUGIN_ABI_VERSION
+ *     int cppideas_plugin_init(const cppideas_host* host);   returns 0 on success
+ *
+ * The host structure passed to init only lives for that call; keep a copy of
+ * its append function for the handlers. Plugins stay loaded until the
+ * processor is destroyed.
+ */
+#ifndef CPPIDEAS_PLUGIN_H
+#define CPPIDEAS_PLUGIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever a type or function below changes incompatibly */
+#define CPPIDEAS_PLUGIN_ABI_VERSION 1u
+
+typedef enum cppideas_status {
+    CPPIDEAS_HANDLED = 0,   /* the response holds the JSON response document */
+    CPPIDEAS_DEFER = 1,     /* let the built-in handler or Python process the request */
+    CPPIDEAS_FAILED = 2     /* the response holds an error message */
+} cppideas_status;
+
+/* Output buffer owned by the host; write to it with cppideas_host.append */
+typedef struct cppideas_response cppideas_response;
+
+/*
+ * Processes one request, given as UTF-8 JSON text that is not necessarily
+ * NUL-terminated. Called from any number of threads at once.
+ */
+typedef cppideas_status (*cppideas_handler)(void* user_data, const char* request, size_t request_size,
+                                            cppideas_response* response);
+
+typedef struct cppideas_host {
+    uint32_t abi_version;
+    void* context;          /* pass to register_handler */
+
+    /*
+     * Registers handler for requests with the given "type" and "operation"
+     * (an empty operation matches requests without one). user_data is passed
+     * back on every call. Returns 0 on success, nonzero if the pair is taken
+     * by another plugin. Only valid during cppideas_plugin_init.
+     */
+    int (*register_handler)(void* context, const char* type, const char* operation, cppideas_handler handler,
+                            void* user_data);
+
+    /* Appends bytes to a response; valid only during the handler call */
+    void (*append)(cppideas_response* response, const char* data, size_t size);
+} cppideas_host;
+
+typedef uint32_t (*cppideas_plugin_abi_version_fn)(void);
+typedef int (*cppideas_plugin_init_fn)(const cppideas_host* host);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CPPIDEAS_PLUGIN_H */
@@ -0,0 +1,49 @@
+#ifndef CPP_IDEAS_JSON_EDITOR_H
+#define CPP_IDEAS_JSON_EDITOR_H
+
+#include "json_validation.h"
+
+#include <QFutureWatcher>
+#include <QPlainTextEdit>
+#include <memory>
+#include <stop_token>
+
+class QTimer;
+
+// Plain-text editor for request documents. Unlike QTextEdit it keeps no rich
+// text layout, so multi-megabyte documents stay responsive. The text is
+// validated on a worker thread once typing pauses; validation resumes from
+// the first edited position and a newer edit cancels a run in progress. The
+// first error is underlined in place, with the message as its tooltip.
+class JsonEditor : public QPlainTextEdit {
+public:
+    explicit JsonEditor(QWidget* parent = nullptr);
+    ~JsonEditor() override;
+
+    // Result for the current text, waiting for or running validation if the
+    // background result is out of date
+    JsonValidation validateNow();
+
+protected:
+    bool viewportEvent(QEvent* event) override;
+
+private:
+    void contentsChanged(int position, int removed, int added);
+    void startValidation();
+    void validationFinished();
+    void collectResult();
+    void showResult();
+
+    QTimer* debounce;
+    QFutureWatcher<JsonValidation>* watcher;
+    std::shared_ptr<IncrementalJsonValidator> validator; // used by one run at a time
+    std::stop_source stopSource;
+
+    int changedFrom = 0;        // first position edited since the last snapshot
+    int revision = 0;           // bumped on every edit
+    int runningRevision = -1;   // revision being validated in the background
+    int resultRevision = -1;    // revision `result` describes
+    JsonValidation result;
+};
+
+#endif // CPP_IDEAS_JSON_EDITOR_H
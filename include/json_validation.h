@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Outcome of checking a request document without parsing it into a DOM
+struct JsonValidation {
+    enum class Status { Valid, Invalid, Cancelled };
+
+    Status status = Status::Valid;
+    bool object = false;        // the top-level value is an object
+    // Where the first error is; line and column are 1-based, the column counts characters
+    std::size_t offset = 0;
+    std::size_t line = 0;
+    std::size_t column = 0;
+    std::string message;        // worded like Python's json module, e.g. "Expecting ',' delimiter"
+};
+
+// Single-pass JSON syntax checker accepting exactly what Python's json.loads
+// does (including NaN, Infinity and lone surrogate escapes), so a document it
+// accepts never fails in processor.py's json.loads.
+//
+// Scanner state is saved at token boundaries every kCheckpointBytes. When the
+// caller knows that only text from some offset on changed since the previous
+// call, validation resumes from the last checkpoint before that offset instead
+// of rescanning the whole document. Calls must not overlap.
+class IncrementalJsonValidator {
+public:
+    static constexpr std::size_t kCheckpointBytes = 64 * 1024;
+
+    // unchangedPrefix: number of leading bytes identical to the text of the
+    // previous call (0 to rescan everything). Cancellation is checked once per
+    // checkpoint interval.
+    JsonValidation validate(std::string_view text, std::size_t unchangedPrefix = 0, std::stop_token stop = {});
+
+    // Bytes actually scanned by the last call
+    std::size_t lastScannedBytes() const { return scannedBytes; }
+
+private:
+    enum class Expect : unsigned char { Value, ValueOrEnd, Key, KeyOrEnd, Colon, CommaOrEnd, Done };
+
+    struct Checkpoint {
+        std::size_t offset;
+        Expect expect;
+        bool object;
+        std::string stack;      // open containers, '{' or '['
+    };
+
+    std::vector<Checkpoint> checkpoints;
+    std::size_t scannedBytes = 0;
+};
+
+// Convenience for a one-off full check
+JsonValidation validateJson(std::string_view text);
@@ -1,8 +1,11 @@
 #ifndef CPP_IDEAS_MAINWINDOW_H
 #define CPP_IDEAS_MAINWINDOW_H
 
+#include <QFuture>
 #include <QMainWindow>
 #include <memory>
+#include <stop_token>
+#include <string>
 
 class PythonProcessor;
 class QTextEdit;
@@ -11,12 +14,18 @@ class QLabel;
 class QProgressBar;
 class QPushButton;
 class QGroupBox;
+class QAction;
+class PerformanceTab;
+class JsonEditor;
+struct BatchProgress;
+struct BatchSummary;
 
 class CppIdeasMainWindow : public QMainWindow {
     Q_OBJECT
 
 public:
     CppIdeasMainWindow(QWidget* parent = nullptr);
+    ~CppIdeasMainWindow() override;
 
 private:
     Q_SLOT void processJson();
@@ -24,6 +33,11 @@ private:
     Q_SLOT void generateSampleJson();
     Q_SLOT void loadJsonFile();
     Q_SLOT void saveJsonFile();
+    Q_SLOT void toggleTraceRecording();
+    Q_SLOT void processDirectory();
+
+    void showBatchProgress(const BatchProgress& progress);
+    void batchFinished(const BatchSummary& summary);
 
     void setupUI();
     void setupMainTab(QWidget* parent);
@@ -32,13 +46,24 @@ private:
     void setupStatusBar();
 
     std::unique_ptr<PythonProcessor> pythonProcessor;
+
+    // Last result exactly as the processor returned it, shared with a save in progress
+    std::shared_ptr<const std::string> rawResult;
+    QFuture<void> saveJob;
+    std::stop_source saveStop;
+    QFuture<void> batchJob;
+    std::stop_source batchStop;
     
     // UI components
-    QTextEdit* inputText;
+    JsonEditor* inputText;
     QTextEdit* resultText;
     QComboBox* sampleCombo;
     QLabel* statusLabel;
     QProgressBar* progressBar;
+    QAction* recordTraceAction;
+    QAction* batchAction;
+    QPushButton* batchButton;
+    PerformanceTab* performanceTab;
 };
 
 #endif // CPP_IDEAS_MAINWINDOW_H
\ No newline at end of file
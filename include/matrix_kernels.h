@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// Dense linear algebra over row-major double buffers. Inner loops run two
+// doubles at a time with SSE2 where available, multiplication is tiled so the
+// working set of each tile stays in cache, and large products are split by
+// rows across threads.
+namespace matrix {
+
+struct Matrix {
+    std::size_t rows = 0;
+    std::size_t cols = 0;
+    std::vector<double> values;     // rows * cols, row after row
+
+    Matrix() = default;
+    Matrix(std::size_t rows, std::size_t cols) : rows(rows), cols(cols), values(rows * cols) {}
+
+    double& at(std::size_t row, std::size_t col) { return values[row * cols + col]; }
+    double at(std::size_t row, std::size_t col) const { return values[row * cols + col]; }
+    std::span<const double> row(std::size_t index) const { return {values.data() + index * cols, cols}; }
+};
+
+// a * b; a.cols must equal b.rows. threads caps the worker threads (0 uses
+// the hardware concurrency); products too small to pay for a thread run on
+// the calling one. Concurrent products share one budget of helper threads, so
+// each may get fewer than it asks for.
+Matrix multiply(const Matrix& a, const Matrix& b, std::size_t threads = 0);
+
+Matrix transpose(const Matrix& m);
+
+// Sum of a[i] * b[i]; the spans must have the same length
+double dot(std::span<const double> a, std::span<const double> b);
+
+enum class Axis { Rows, Columns };
+enum class Reduction { Sum, Mean, Min, Max };
+
+// One value per row (Axis::Rows) or per column (Axis::Columns); m must have
+// at least one row and one column
+std::vector<double> reduce(const Matrix& m, Axis axis, Reduction reduction);
+
+} // namespace matrix
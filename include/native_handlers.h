@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include <nlohmann/json.hpp>
+
+class KllSketch;
+class RunningStats;
+
+// Request handlers implemented in C++. PythonProcessor looks a request's
+// (type, operation) up here first and only calls into Python when no native
+// handler is registered, so these run without taking the GIL.
+namespace native {
+
+// Insertion-ordered so that responses keep the key order processor.py uses
+using json = nlohmann::ordered_json;
+
+// Timestamp stamped on every response, matching processor.py
+inline constexpr std::string_view kTimestamp = "2025-06-14T00:00:00";
+
+// Receives the parsed request and returns the serialized response, or nothing
+// to hand the request on to Python. Must be safe to call from several threads
+// at once.
+using Handler = std::function<std::optional<std::string>(const json& request)>;
+
+class HandlerRegistry {
+public:
+    void add(std::string type, std::string operation, Handler handler);
+
+    // Returns nullptr when the request should go to Python
+    const Handler* find(std::string_view type, std::string_view operation) const;
+
+private:
+    std::map<std::string, std::map<std::string, Handler, std::less<>>, std::less<>> handlers;
+};
+
+// Registers every handler that ships with python_processor_lib
+void registerBuiltinHandlers(HandlerRegistry& registry);
+
+void registerDataHandlers(HandlerRegistry& registry);
+void registerMatrixHandlers(HandlerRegistry& registry);
+void registerPipelineHandlers(HandlerRegistry& registry);
+void registerSessionHandlers(HandlerRegistry& registry);
+void registerTextHandlers(HandlerRegistry& registry);
+
+// Serializes like Python's json.dumps with its default settings, so native and
+// Python responses are interchangeable byte for byte
+std::string dumpPythonStyle(const json& value);
+
+// {"success": false, "error": <message>, "timestamp": ...}
+std::string errorResponse(std::string_view message);
+
+// Bytes the heap holds for value: its containers, their slots and strings too
+// long for the small-string buffer, as for memory accounting
+std::size_t heapBytes(const json& value);
+
+// Python's isinstance(x, (int, float)); bool counts since it subclasses int
+bool isNumber(const json& value);
+
+// Numeric value of an entry accepted by isNumber
+double asDouble(const json& value);
+
+// Integral inputs come back as integers, as they would from Python
+json numberValue(double value, bool integral);
+
+// The extended_stats result for a summarized dataset
+json describeStats(const RunningStats& stats, const KllSketch& sketch, bool integral);
+
+// Computes the "result" of a data operation from the request and its dataset;
+// throws to report "Data operation failed: <what>"
+using DataOperation = std::function<json(const json& request, const json& dataset)>;
+
+// Wraps a data operation with processor.py's dataset validation and response format
+Handler dataHandler(std::string operation, DataOperation compute);
+
+// A dataset held as pointers into a parsed request, so pipeline stages can
+// filter and reorder it without copying values
+using DatasetView = std::span<const json* const>;
+
+// Result of the native-only data operation (extended_stats, quantiles or
+// histogram) over a view, reading its options from options as the data
+// handler reads them from the request. Nothing for any other operation;
+// throws like a DataOperation.
+std::optional<json> computeDataOperation(std::string_view operation, const json& options, DatasetView dataset);
+
+// Reads an optional integer member, throwing std::invalid_argument when it is
+// not an integer in [lowest, highest]
+std::size_t integerOption(const json& request, const char* name, std::size_t fallback, std::size_t lowest, std::size_t highest);
+
+} // namespace native
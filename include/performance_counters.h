@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Latency histogram buckets: exact microseconds below 16, then 8 buckets per
+// power of two (at most 12.5% relative error)
+inline constexpr std::size_t kLatencyBuckets = 16 + 8 * 32;
+
+// Cumulative counters at one point in time. Rates and percentiles come from
+// the difference between two samples (see PerformanceInterval).
+struct PerformanceSample {
+    std::chrono::steady_clock::time_point time;
+    std::uint64_t requests = 0;
+    std::uint64_t errors = 0;                   // ProcessErrors and "success": false responses
+    std::chrono::nanoseconds gilWait{0};        // total time spent waiting to acquire the GIL
+    std::uint64_t pythonHeapBlocks = 0;         // sys.getallocatedblocks() as of the last Python request
+    std::uint64_t gcCollections = 0;            // Python garbage collections
+    std::chrono::nanoseconds gcPause{0};        // total time spent in them
+    std::array<std::uint64_t, kLatencyBuckets> latencyBuckets{};
+};
+
+// What happened between two samples
+struct PerformanceInterval {
+    double seconds = 0;
+    double requestsPerSecond = 0;
+    double errorsPerSecond = 0;
+    double p50Ms = 0;
+    double p90Ms = 0;
+    double p99Ms = 0;
+    double gilWaitFraction = 0;                 // GIL wait per second of wall time (can exceed 1 with many threads)
+    double gcCollectionsPerSecond = 0;
+    double gcPauseFraction = 0;                 // GC pause per second of wall time
+    std::uint64_t pythonHeapBlocks = 0;
+};
+
+PerformanceInterval performanceBetween(const PerformanceSample& earlier, const PerformanceSample& later);
+
+// Updated by PythonProcessor on every request with relaxed atomic adds, so
+// recording never takes a lock and sampling never blocks processing
+class PerformanceCounters {
+public:
+    void recordRequest(std::chrono::nanoseconds latency, bool failed);
+    void recordGilWait(std::chrono::nanoseconds wait);
+    void setPythonHeapBlocks(std::uint64_t blocks);
+    void recordGcPause(std::chrono::nanoseconds pause);
+
+    PerformanceSample sample() const;
+
+    static std::size_t bucketFor(std::uint64_t micros);
+    // Midpoint of a bucket, in microseconds
+    static double bucketValue(std::size_t bucket);
+
+private:
+    std::atomic<std::uint64_t> requests{0};
+    std::atomic<std::uint64_t> errors{0};
+    std::atomic<std::int64_t> gilWaitNanos{0};
+    std::atomic<std::uint64_t> pythonHeapBlocks{0};
+    std::atomic<std::uint64_t> gcCollections{0};
+    std::atomic<std::int64_t> gcPauseNanos{0};
+    std::array<std::atomic<std::uint64_t>, kLatencyBuckets> latencyBuckets{};
+};
@@ -0,0 +1,69 @@
+#ifndef CPP_IDEAS_PERFORMANCE_TAB_H
+#define CPP_IDEAS_PERFORMANCE_TAB_H
+
+#include "performance_counters.h"
+
+#include <QColor>
+#include <QString>
+#include <QWidget>
+#include <deque>
+#include <optional>
+#include <vector>
+
+class PythonProcessor;
+class QLabel;
+class QTimer;
+
+// Line chart of the most recent values of one or more series, drawn with
+// QPainter; the y axis starts at zero and scales to the largest visible value
+class TimeSeriesChart : public QWidget {
+public:
+    TimeSeriesChart(const QString& title, const QString& unit, QWidget* parent = nullptr);
+
+    void addSeries(const QString& name, const QColor& color);
+
+    // One value per series, in the order they were added
+    void append(const std::vector<double>& values);
+
+    QSize minimumSizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+
+private:
+    struct Series {
+        QString name;
+        QColor color;
+        std::deque<double> values;
+    };
+
+    QString title;
+    QString unit;
+    std::vector<Series> series;
+};
+
+// Charts requests per second, latency percentiles, GIL wait, GC pauses and Python heap
+// size. Samples PythonProcessor's counters on a fixed timer, which only reads
+// atomics, so an open dashboard does not slow processing down.
+class PerformanceTab : public QWidget {
+public:
+    explicit PerformanceTab(QWidget* parent = nullptr);
+
+    // Starts sampling; the processor must outlive the tab
+    void setProcessor(const PythonProcessor* processor);
+
+private:
+    void sample();
+
+    const PythonProcessor* processor = nullptr;
+    std::optional<PerformanceSample> previous;
+    QTimer* timer;
+
+    TimeSeriesChart* throughputChart;
+    TimeSeriesChart* latencyChart;
+    TimeSeriesChart* gilChart;
+    TimeSeriesChart* heapChart;
+    QLabel* summaryLabel;
+};
+
+#endif // CPP_IDEAS_PERFORMANCE_TAB_H
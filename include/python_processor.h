@@ -1,8 +1,19 @@
 #pragma once
 
+#include "performance_counters.h"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <map>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <stdexcept>
+#include <vector>
 
 namespace py {
     class Exception : public std::runtime_error {
@@ -11,20 +22,284 @@ namespace py {
     };
 }
 
+// Memory attributed to one request type by the optional memory accounting.
+// Python figures come from tracemalloc, raw figures from the blocks Python's
+// raw allocator (C buffers of the interpreter and extension modules) handed
+// out on the calling thread while the request ran; tracemalloc traces those
+// too, so they are a part of the Python figures. C++ figures are the buffers
+// python_processor_lib builds itself: a native handler's parsed request and
+// every response body. Native handlers' temporaries are not counted.
+struct RequestMemoryStats {
+    std::uint64_t requests = 0;
+    std::size_t pythonPeakBytes = 0;        // largest Python heap peak of a single request
+    std::int64_t pythonRetainedBytes = 0;   // Python heap growth left behind, summed over requests
+    std::size_t rawPeakBytes = 0;           // largest raw allocator peak of a single request
+    std::int64_t rawRetainedBytes = 0;      // raw allocations left behind, summed over requests
+    std::size_t cppPeakBytes = 0;           // largest C++ buffer total of a single request
+};
+
+// The response document for a request. Requests that processor.py rejects
+// (unknown type, invalid input, ...) still get one, with "success": false.
+struct Response {
+    std::string body;
+    bool native = false;    // produced without Python: by a native handler or from the result cache
+};
+
+// A response whose body may still live in the Python str processor.py
+// returned, so it can be read without copying. The handle keeps that object
+// alive; dropping it then takes the GIL briefly.
+class ResponseHandle {
+public:
+    // Releases whatever keeps a borrowed body alive
+    using Owner = std::unique_ptr<void, void (*)(void*)>;
+
+    ResponseHandle() = default;
+    // Body stored in the handle
+    ResponseHandle(std::string body, bool native) : owned(std::move(body)), native(native) {}
+    // Body owned elsewhere and valid as long as owner is
+    ResponseHandle(std::string_view body, Owner owner, bool native)
+        : borrowed(body), owner(std::move(owner)), native(native) {}
+
+    std::string_view body() const { return owner ? borrowed : std::string_view(owned); }
+    bool isNative() const { return native; }
+
+    // Moves a stored body out, copies a borrowed one
+    Response toResponse() &&;
+
+private:
+    std::string owned;
+    std::string_view borrowed;
+    Owner owner{nullptr, nullptr};
+    bool native = false;
+};
+
+// Why a request got no response document at all
+enum class ProcessErrorCode {
+    NotInitialized,         // the Python environment failed to start
+    PythonException,        // an exception escaped processor.py
+    NativeHandlerFailed,    // a native handler threw
+    InternalError,          // any other C++ exception
+};
+
+struct ProcessError {
+    ProcessErrorCode code;
+    std::string message;
+};
+
+// Short description of an error code, e.g. "Python execution error"
+std::string_view describe(ProcessErrorCode code);
+
+// Startup-optimized mode for short-lived runs. Each part is independent.
+struct StartupOptions {
+    // Import processor.py and the stdlib modules it needs from the bytecode
+    // compiled into the library rather than from source. The embedded copy is
+    // the processor.py of the last build.
+    bool frozenModules = false;
+
+    // Reuse the sys.path entries resolved by an earlier start in the same
+    // working directory instead of probing the filesystem
+    bool cachedPaths = false;
+
+    // Skip the site module (site-packages discovery, .pth files) when this
+    // processor initializes Python; the venv site-packages is still added
+    bool skipSite = false;
+
+    // Answer requests that fail processor.py's REQUEST_SCHEMAS checks (bad
+    // JSON, unknown type or operation, missing fields) in C++ without taking
+    // the GIL. The responses are the same either way.
+    bool validateRequests = true;
+
+    // Latency mode, against cyclic GC pauses landing in the middle of requests.
+    // freezeGc collects once after processor.py is imported and then moves
+    // everything alive into the permanent generation (gc.freeze), so later
+    // collections never traverse the module and startup objects.
+    bool freezeGc = false;
+
+    // Turn automatic collection off and run full collections on a background
+    // thread once no Python request has run for gcIdleDelay. When the
+    // processor never goes idle, young-generation collections still run at
+    // most gcMaxDeferral apart.
+    bool deferGc = false;
+    std::chrono::milliseconds gcIdleDelay{20};
+    std::chrono::milliseconds gcMaxDeferral{1000};
+
+    // Keep the successful responses processor.py gives to math and data
+    // requests in a memory-mapped file at this path (see result_cache.h), so
+    // repeats are answered without Python, including after a restart, until
+    // processor.py changes. Requests that differ only in layout or member
+    // order share a response. Empty for no cache; streamed requests bypass it.
+    std::string resultCachePath{};
+    std::size_t resultCacheMaxBytes = std::size_t{64} << 20;
+
+    static StartupOptions fast() { return {true, true, true}; }
+
+    // fast() plus freezeGc and deferGc
+    static StartupOptions lowLatency() {
+        StartupOptions options = fast();
+        options.freezeGc = true;
+        options.deferGc = true;
+        return options;
+    }
+};
+
+// Where the time went while the processor started
+struct StartupTiming {
+    std::chrono::microseconds handlers{0};      // registering native handlers
+    std::chrono::microseconds interpreter{0};   // Py_InitializeFromConfig, zero if Python was already running
+    std::chrono::microseconds paths{0};         // resolving and appending sys.path entries
+    std::chrono::microseconds import{0};        // importing processor and its dependencies
+    std::chrono::microseconds total{0};
+    bool frozenImport = false;                  // processor came from the embedded bytecode
+    bool cachedPaths = false;                   // sys.path entries came from the cache
+};
+
+// Cyclic garbage collections in the embedded interpreter since the processor
+// started, whoever triggered them. Pauses are timed through gc.callbacks.
+struct GcStats {
+    std::array<std::uint64_t, 3> collections{};     // by generation
+    std::chrono::nanoseconds totalPause{0};
+    std::chrono::nanoseconds maxPause{0};
+    std::chrono::nanoseconds lastPause{0};
+    std::uint64_t idleCollections = 0;              // full collections run while idle (deferGc)
+    std::uint64_t overdueCollections = 0;           // young collections run under load after gcMaxDeferral
+    std::size_t frozenObjects = 0;                  // moved to the permanent generation at startup
+    bool deferred = false;                          // automatic collection is off
+
+    std::uint64_t totalCollections() const { return collections[0] + collections[1] + collections[2]; }
+};
+
+// When a processor recycles its Python state to shed memory that handler code
+// and fragmentation pile up in a long-running process. Recycling imports a
+// fresh processor.py, drops the old module with everything its handlers
+// cached, runs a full collection and hands freed heap back to the OS. The
+// interpreter itself stays up: it may be shared with other processors and
+// the embedding application, and boost::python cannot outlive Py_Finalize.
+// A threshold of zero is off; they are checked after each Python request,
+// the memory ones at most every 100 ms.
+struct RecyclePolicy {
+    std::size_t maxResidentBytes = 0;           // resident set size of the process
+    std::uint64_t maxHeapBlocks = 0;            // sys.getallocatedblocks()
+    std::uint64_t maxRequests = 0;              // Python requests since the last recycle
+    // Least time between automatic recycles, so a threshold that recycling
+    // cannot get the process under does not recycle on every request
+    std::chrono::milliseconds minInterval{1000};
+
+    bool enabled() const { return maxResidentBytes != 0 || maxHeapBlocks != 0 || maxRequests != 0; }
+};
+
+struct RecycleStats {
+    std::uint64_t recycles = 0;
+    std::uint64_t failures = 0;                 // processor.py failed to import again; the old module stayed
+    std::uint64_t requestsSinceRecycle = 0;     // Python requests
+    std::string lastReason;                     // "resident", "heap", "requests" or "manual"
+    std::chrono::microseconds lastDuration{0};
+    std::size_t residentBytesBefore = 0;        // around the last recycle, 0 where RSS is unknown
+    std::size_t residentBytesAfter = 0;
+};
+
+class RequestTraceWriter;
+
+// Receives a streamed response one chunk at a time; returning false stops the
+// stream early
+using ChunkSink = std::function<bool(std::string_view chunk)>;
+
 class PythonProcessor {
 public:
-    PythonProcessor();
+    explicit PythonProcessor(const StartupOptions& options = {});
     ~PythonProcessor();
     
-    // Process JSON string through Python script and return result
+    // Process a JSON request. Safe to call from any number of threads at once:
+    // Python requests are serialized on the GIL, native ones run in parallel.
+    std::expected<Response, ProcessError> process(std::string_view jsonInput);
+
+    // Same as process(), without copying the response: the body is read in
+    // place from the Python result. Worth it for large responses; for small
+    // ones process() is cheaper, since it copies while still holding the GIL.
+    std::expected<ResponseHandle, ProcessError> processView(std::string_view jsonInput);
+
+    // Same as process(), handing the response to sink in chunks of about
+    // chunkSize bytes instead of returning it whole. processor.py encodes a
+    // large result a slice at a time as the chunks are consumed, so neither
+    // side holds the full response; native responses are built whole and then
+    // chunked. The sink runs on the calling thread without the GIL. An error
+    // after the first chunk leaves the streamed response incomplete. Streamed
+    // requests are not covered by memory accounting.
+    std::expected<void, ProcessError> processStream(std::string_view jsonInput, const ChunkSink& sink,
+        std::size_t chunkSize = 64 * 1024);
+
+    // Process JSON string through Python script and return result; errors are
+    // returned as {"success": false, "error": ...} documents
     std::string processJson(const std::string& jsonInput);
     
     // Check if Python environment is properly initialized
     bool isInitialized() const;
     
-    // Get last error message
+    // Get the error that prevented initialization (empty when initialized)
     std::string getLastError() const;
 
+    // Cold-start breakdown of this instance
+    StartupTiming getStartupTiming() const;
+
+    // File names of the native handler plugins loaded at startup
+    // (see cppideas_plugin.h)
+    std::vector<std::string> getLoadedPlugins() const;
+
+    // Cumulative request counters for dashboards. Lock-free and cheap enough
+    // to call at any rate; diff two samples with performanceBetween().
+    PerformanceSample samplePerformance() const;
+
+    // Garbage collector activity and pause times
+    GcStats getGcStats() const;
+
+    // Enable or disable per-request memory accounting (off by default, since
+    // tracemalloc slows every Python allocation down while it is running).
+    // tracemalloc runs while any processor in the process accounts, and
+    // accounted requests take turns calling into Python so each peak is their
+    // own; Python that other requests run meanwhile (streamed ones, which are
+    // never accounted) can still land in a peak.
+    void setMemoryAccountingEnabled(bool enabled);
+    bool isMemoryAccountingEnabled() const;
+
+    // Accounted memory keyed by request "type"
+    std::map<std::string, RequestMemoryStats> getMemoryStats() const;
+
+    // Largest combined Python + C++ peak seen for a single request
+    std::size_t getMemoryHighWaterMark() const;
+
+    // Clear the accounted statistics and the high-water mark
+    void resetMemoryStats();
+
+    // Recycle the Python state automatically once a threshold of policy is
+    // crossed. The request that crosses it recycles after its own response
+    // is ready; requests already running finish on the old module, which
+    // goes once the last of them lets go, and requests arriving meanwhile
+    // wait for the GIL as usual. None of them fail.
+    void setRecyclePolicy(const RecyclePolicy& policy);
+    RecyclePolicy getRecyclePolicy() const;
+
+    // Recycle now, whatever the policy. Returns false when processor.py could
+    // not be imported again (the old module keeps serving), when another
+    // recycle is under way or when Python is not running.
+    bool recycle();
+
+    RecycleStats getRecycleStats() const;
+
+    // Record every request passed to processJson into a trace file that the
+    // load_generator tool can replay. Returns false if the file cannot be opened.
+    bool startTraceRecording(const std::string& path);
+    void stopTraceRecording();
+    bool isTraceRecording() const;
+
+    // Write a span for every stage of each request to a Chrome trace file
+    // (chrome://tracing, Perfetto): the native handler or schema check, GIL
+    // wait, the Python call with processor.py's json.loads, handler and
+    // json.dumps inside it, and reading the response back. Spans of one
+    // request share its request_id. The file is complete once tracing stops.
+    // Returns false if the file cannot be opened or Python is not running.
+    bool startSpanTracing(const std::string& path);
+    void stopSpanTracing();
+    bool isSpanTracing() const;
+
 private:
     class Impl;
     std::unique_ptr<Impl> pImpl;
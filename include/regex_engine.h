@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Regular expressions matched in time linear in the text. A pattern compiles
+// to a program for a Pike VM, which advances every way the pattern can match
+// in step over the text instead of backtracking, so no pattern can take
+// exponential time: a search costs at most text length x program size.
+//
+// Finding every match is not linear, though: each search resumes at the end
+// of the previous match, and a search may have scanned far beyond that end
+// for a preferred longer match that never came (a(?:.*b)? over "aaaa..."),
+// so that stretch is scanned again by the next search. findAll, countMatches
+// and replace therefore give up with std::runtime_error once they have spent
+// kMaxPasses scans of the text's worth of steps.
+//
+// The syntax is Python's re without backreferences, lookaround or inline
+// flags, and matches are the ones re finds (leftmost, earlier alternatives
+// and greedier repeats first). \d, \w, \s, \b and ignoring case cover ASCII
+// only, as with re.ASCII. Text is UTF-8; . and classes match code points and
+// positions are byte offsets.
+namespace regex {
+
+struct Flags {
+    bool ignoreCase = false;    // re.IGNORECASE
+    bool multiline = false;     // re.MULTILINE: ^ and $ also match at line breaks
+    bool dotAll = false;        // re.DOTALL: . also matches \n
+};
+
+// Byte range of a match, then of each group; groups that did not take part
+// are {npos, npos}
+struct Match {
+    std::vector<std::pair<std::size_t, std::size_t>> groups;
+
+    std::size_t begin() const { return groups[0].first; }
+    std::size_t end() const { return groups[0].second; }
+};
+
+class Pattern {
+public:
+    // Throws std::invalid_argument for malformed or unsupported patterns
+    Pattern(std::string_view pattern, Flags flags);
+
+    // Capturing groups, not counting the whole match
+    std::size_t groupCount() const { return groups; }
+
+    // First match starting at pos or later, as re's search(text, pos) finds
+    // it. notEmptyAtPos rules out an empty match at pos, which is how the
+    // match after an empty one is found.
+    std::optional<Match> search(std::string_view text, std::size_t pos = 0, bool notEmptyAtPos = false) const;
+
+    // Steps findAll, countMatches and replace may take, in scans of the text
+    static constexpr std::size_t kMaxPasses = 16;
+    // Budget for short texts, which never run out in practice
+    static constexpr std::size_t kMinStepBudget = std::size_t{1} << 20;
+
+    // Every non-overlapping match, as re.finditer yields them, up to limit
+    std::vector<Match> findAll(std::string_view text, std::size_t limit = SIZE_MAX) const;
+    std::size_t countMatches(std::string_view text) const;
+
+    // re.sub: replaces the first count matches (all of them for 0) with
+    // replacement, where \1, \g<1> and \g<name> insert groups and Python's
+    // string escapes apply. Throws std::invalid_argument for a bad template.
+    std::string replace(std::string_view text, std::string_view replacement, std::size_t count = 0) const;
+
+private:
+    enum class Op : std::uint8_t { Char, Any, AnyButNewline, Class, Split, Jump, Save, Assert, Match };
+    enum class Assertion : std::uint8_t { LineStart, LineEnd, TextStart, TextEnd, WordBoundary, NotWordBoundary };
+
+    // Split continues at x before y; Save stores the position in slot x
+    struct Instruction {
+        Op op;
+        Assertion assertion = Assertion::TextStart;
+        char32_t c = 0;
+        std::uint32_t x = 0;
+        std::uint32_t y = 0;
+    };
+
+    // Sorted, disjoint, inclusive code point ranges
+    struct CharClass {
+        std::vector<std::pair<char32_t, char32_t>> ranges;
+        bool contains(char32_t c) const;
+    };
+
+    class Parser;
+    class Vm;
+
+    bool holds(Assertion assertion, std::string_view text, std::size_t pos) const;
+    std::size_t stepBudget(std::string_view text) const;
+
+    Flags flags;
+    std::vector<Instruction> program;
+    std::vector<CharClass> classes;
+    std::size_t groups = 0;
+    std::map<std::string, std::size_t, std::less<>> groupNames;
+    // Byte every match starts with, when there is one, to skip ahead to
+    std::optional<char> firstByte;
+};
+
+// Compiled patterns keyed by pattern and flags, shared by every thread; the
+// least recently used one is dropped when the cache is full
+class PatternCache {
+public:
+    explicit PatternCache(std::size_t capacity = 256) : capacity(capacity) {}
+
+    // The compiled pattern, compiling it on a miss; throws like Pattern's
+    // constructor, without caching the failure
+    std::shared_ptr<const Pattern> get(std::string_view pattern, Flags flags);
+
+    std::size_t size() const;
+    std::uint64_t hits() const;
+    std::uint64_t misses() const;
+
+private:
+    using Entry = std::pair<std::string, std::shared_ptr<const Pattern>>;
+
+    std::size_t capacity;
+    mutable std::mutex mutex;
+    std::list<Entry> entries;       // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    std::uint64_t hitCount = 0;
+    std::uint64_t missCount = 0;
+};
+
+} // namespace regex
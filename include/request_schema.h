@@ -0,0 +1,47 @@
+#pragma once
+
+#include "native_handlers.h"
+
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The checks processor.py makes before any real work, compiled from its
+// REQUEST_SCHEMAS table: the document must be valid JSON and an object, the
+// type must be known, the type's required member must have the right JSON type
+// and the operation must be one of the type's operations. PythonProcessor runs
+// requests through this before taking the GIL and answers the ones failing a
+// check itself, with the response processor.py would have given.
+class RequestValidator {
+public:
+    // Rejects nothing
+    RequestValidator() = default;
+
+    // Compiles REQUEST_SCHEMAS as converted to JSON; throws
+    // std::invalid_argument when the table is malformed
+    static RequestValidator compile(const native::json& schemas);
+
+    // processor.py's error response for request, or nothing when the request
+    // passes or its outcome is left to Python (non-string types and
+    // operations, text that is not valid UTF-8)
+    std::optional<std::string> reject(std::string_view request) const;
+
+    bool empty() const { return schemas.empty(); }
+
+private:
+    enum class Kind { Any, Array, NonEmptyArray, String };
+
+    struct Schema {
+        std::string field;
+        Kind kind = Kind::Any;
+        std::string error;
+        bool checksOperation = false;
+        std::vector<std::string> operations;
+        native::json operationList;
+    };
+
+    std::map<std::string, Schema, std::less<>> schemas;
+    native::json availableTypes;
+};
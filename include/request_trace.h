@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One recorded request and when it arrived, relative to the start of the trace
+struct TraceRecord {
+    std::chrono::microseconds offset{0};
+    std::string request;
+};
+
+// Appends requests to a JSON-lines trace file: {"t_us": <offset>, "request": "<json>"}
+class RequestTraceWriter {
+public:
+    // Throws std::runtime_error if the file cannot be opened
+    explicit RequestTraceWriter(const std::string& path);
+
+    // Thread-safe; the offset is taken from the time of the call. Invalid
+    // UTF-8 in the request is written as U+FFFD.
+    void record(std::string_view request);
+
+private:
+    std::mutex mutex;
+    std::ofstream out;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Reads a trace written by RequestTraceWriter. Throws std::runtime_error if the
+// file cannot be opened or a line is malformed.
+std::vector<TraceRecord> loadRequestTrace(const std::string& path);
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Responses kept on disk across restarts (StartupOptions::resultCachePath).
+// The file is memory-mapped and append-only: a header with the version of the
+// processor.py that produced the responses and the end of the committed
+// records, then one record per key. An entry is committed by moving the end
+// past it once it is written, so a crash mid-append loses only that entry.
+// Opening the file for another version starts it afresh.
+//
+// The file never grows past the size cap. An insert that would overflow it
+// compacts first: the newest entries that fit in half the cap move to the
+// front and the rest are dropped. Compaction moves records in place with the
+// end reset meanwhile, so a crash during it leaves an empty cache, not a
+// corrupt one.
+//
+// A file is used by one process at a time (flock); any number of threads may
+// share a cache.
+class ResultCache {
+public:
+    static constexpr std::size_t kDefaultMaxBytes = std::size_t{64} << 20;
+    static constexpr std::size_t kMinMaxBytes = std::size_t{64} << 10;
+
+    // Opens or creates the cache at path. Throws std::runtime_error if the
+    // file cannot be opened or mapped, or another process holds it.
+    ResultCache(const std::string& path, std::uint64_t version, std::size_t maxBytes = kDefaultMaxBytes);
+    ~ResultCache();
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    std::optional<std::string> find(std::string_view key) const;
+
+    // Keeps value for key unless key is already cached, the entry would take
+    // more than a quarter of the cap or the cache moved on from version (the
+    // one current when the value was computed) meanwhile
+    void insert(std::string_view key, std::string_view value, std::uint64_t version);
+
+    std::uint64_t version() const;
+
+    // Drops every entry and stamps the file with version
+    void reset(std::uint64_t version);
+
+    std::size_t size() const;
+    // Bytes in use, header included; at most the cap
+    std::size_t bytes() const;
+    std::uint64_t hits() const { return hitCount.load(); }
+    std::uint64_t misses() const { return missCount.load(); }
+    std::uint64_t compactions() const;
+
+private:
+    void map(std::size_t length);
+    void unmap();
+    // Indexes the committed records, cutting the end back to the last whole one
+    void loadIndex();
+    // Keeps the newest entries that fit in limit bytes, records included
+    void compact(std::size_t limit);
+    void setEnd(std::size_t end);
+
+    std::size_t maxBytes;
+    std::uint64_t currentVersion;
+    int fd = -1;
+    char* data = nullptr;
+    std::size_t mapped = 0;
+    std::size_t end = 0;
+
+    mutable std::shared_mutex mutex;
+    // Keys point into the mapping
+    std::unordered_map<std::string_view, std::size_t> index;
+    std::uint64_t compactionCount = 0;
+    mutable std::atomic<std::uint64_t> hitCount{0};
+    mutable std::atomic<std::uint64_t> missCount{0};
+};
+
+// The cache key for a request document: its members in their own order and no
+// whitespace, so requests differing only in layout share a response. Member
+// order is kept because responses echo the request (input_dataset, echo).
+// Nothing for malformed JSON, for anything but an object and for integers too
+// long to survive the round trip through a double.
+std::optional<std::string> canonicalRequest(std::string_view json);
+
+// 64-bit FNV-1a, stable across runs and builds, for version stamps
+std::uint64_t fingerprint(std::string_view bytes, std::uint64_t seed = 0xcbf29ce484222325ULL);
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <stop_token>
+#include <string>
+#include <string_view>
+
+enum class ResultCompression { None, Zlib, Gzip };
+
+// Picks the compression from the file name: ".gz" for gzip, ".zz" for a raw
+// zlib stream, anything else uncompressed
+ResultCompression compressionForPath(const std::filesystem::path& path);
+
+struct SaveStats {
+    std::size_t inputBytes = 0;
+    std::size_t outputBytes = 0;    // on disk, after compression
+};
+
+// Receives the number of input bytes written so far and the total
+using SaveProgress = std::function<void(std::size_t done, std::size_t total)>;
+
+// Writes data to path in fixed-size chunks, compressing each chunk as it is
+// written, so a save needs one chunk of memory on top of the data itself.
+// The output goes to a sibling ".part" file that is renamed into place at the
+// end; a failed or cancelled save removes it and leaves any existing file
+// untouched. Progress is reported once per chunk from the calling thread.
+std::expected<SaveStats, std::string> saveResult(std::string_view data, const std::filesystem::path& path,
+    ResultCompression compression, const SaveProgress& progress = {}, std::stop_token stop = {});
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+// Writes timed spans as Chrome trace events in the JSON array format, which
+// chrome://tracing, Perfetto and speedscope open directly. Each span is a
+// complete ("X") event on the thread that recorded it, tagged with the ID of
+// the request it belongs to.
+class SpanTraceWriter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Throws std::runtime_error if the file cannot be opened
+    explicit SpanTraceWriter(const std::string& path);
+    // Closes the event array
+    ~SpanTraceWriter();
+
+    SpanTraceWriter(const SpanTraceWriter&) = delete;
+    SpanTraceWriter& operator=(const SpanTraceWriter&) = delete;
+
+    // Thread-safe; times are written relative to the creation of the writer
+    void write(std::string_view name, std::string_view category, Clock::time_point start, Clock::time_point end,
+        std::uint64_t requestId);
+
+private:
+    std::mutex mutex;
+    std::ofstream out;
+    Clock::time_point origin;
+    bool first = true;
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Single-pass statistics that use constant memory regardless of input size,
+// and sliding-window ones that use memory proportional to the window.
+
+// Count, sum, extremes and Welford's running mean/variance
+class RunningStats {
+public:
+    void add(double value);
+    void merge(const RunningStats& other);
+
+    std::uint64_t count() const { return n; }
+    double sum() const { return total; }
+    double mean() const { return n ? runningMean : 0.0; }
+    double min() const { return minimum; }
+    double max() const { return maximum; }
+
+    // Population variance (divides by n)
+    double variance() const;
+    // Sample variance (divides by n - 1)
+    double sampleVariance() const;
+    double stddev() const;
+
+private:
+    std::uint64_t n = 0;
+    double total = 0.0;
+    double runningMean = 0.0;
+    double m2 = 0.0;
+    double minimum = std::numeric_limits<double>::infinity();
+    double maximum = -std::numeric_limits<double>::infinity();
+};
+
+// KLL quantile sketch (Karnin, Lang, Liberty 2016). Keeps O(k) items; rank
+// error is roughly 1.7 / k, so the default k = 200 gives about 1% error.
+// Results are exact until more than k values have been added.
+class KllSketch {
+public:
+    explicit KllSketch(std::size_t k = 200);
+
+    void add(double value);
+    void merge(const KllSketch& other);
+
+    std::uint64_t count() const { return n; }
+    bool empty() const { return n == 0; }
+
+    // Approximate value at the given quantile in [0, 1]
+    double quantile(double q) const;
+
+    // Approximate number of values <= value
+    double rank(double value) const;
+
+    // Number of items currently retained
+    std::size_t retained() const;
+
+private:
+    std::size_t capacity(std::size_t level) const;
+    void updateCapacity();
+    void compress();
+    std::vector<std::pair<double, std::uint64_t>> weightedItems() const;
+
+    std::size_t k;
+    std::uint64_t n = 0;
+    std::vector<std::vector<double>> levels;
+    std::size_t retainedItems = 0;
+    std::size_t maxItems = 0;
+    // Fixed seed so that results are reproducible run to run
+    std::minstd_rand coin{0x5eed};
+};
+
+// Equal-width histogram over a fixed range with under/overflow counters
+class FixedHistogram {
+public:
+    FixedHistogram(double lower, double upper, std::size_t bins);
+
+    void add(double value);
+
+    double lower() const { return lo; }
+    double upper() const { return hi; }
+    const std::vector<std::uint64_t>& counts() const { return binCounts; }
+    std::uint64_t underflow() const { return below; }
+    std::uint64_t overflow() const { return above; }
+
+private:
+    double lo;
+    double hi;
+    std::vector<std::uint64_t> binCounts;
+    std::uint64_t below = 0;
+    std::uint64_t above = 0;
+};
+
+// Approximates an equal-width histogram over [lower, upper] from a sketch, for
+// when the range is not known before the data has been seen
+std::vector<std::uint64_t> approximateHistogram(const KllSketch& sketch, double lower, double upper, std::size_t bins);
+
+// Mean and variance of the last `window` values. Each value updates Welford's
+// sums in O(1): it is added, and once the window is full the value it pushes
+// out is removed in the same step. The ring grows with the values added, so a
+// window longer than the data costs only what the data does.
+class RollingStats {
+public:
+    explicit RollingStats(std::size_t window);
+
+    void add(double value);
+
+    std::size_t window() const { return windowSize; }
+    // Values currently in the window
+    std::size_t count() const { return ring.size(); }
+    bool full() const { return ring.size() == windowSize; }
+
+    double mean() const { return runningMean; }
+    // Population variance (divides by count())
+    double variance() const;
+    // Sample variance (divides by count() - 1)
+    double sampleVariance() const;
+
+private:
+    std::size_t windowSize;
+    std::vector<double> ring;
+    // Oldest value once the ring is full
+    std::size_t next = 0;
+    double runningMean = 0.0;
+    double m2 = 0.0;
+};
+
+// Minimum and maximum of the last `window` values, each kept in a monotonic
+// deque of the values that can still become the extreme of a later window.
+// Amortized O(1) per value; empty windows report +/-infinity.
+class RollingExtremes {
+public:
+    explicit RollingExtremes(std::size_t window);
+
+    void add(double value);
+
+    double min() const;
+    double max() const;
+
+private:
+    std::size_t window;
+    std::uint64_t added = 0;
+    // (position, value); minima increase and maxima decrease front to back
+    std::deque<std::pair<std::uint64_t, double>> minima;
+    std::deque<std::pair<std::uint64_t, double>> maxima;
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Single-pass term frequencies in bounded memory. Terms are counted exactly
+// in an open-addressing hash table while it fits the memory budget; once the
+// vocabulary outgrows it, the counts move into a count-min sketch and only
+// the heavy hitters are kept by name: a fixed set of candidates, each with
+// the sketch's estimate, where a term whose estimate passes the smallest
+// candidate's takes its place. Estimates never undercount and overcount by
+// at most about e / width of the total with high probability.
+class TermCounter {
+public:
+    static constexpr std::size_t kDefaultMemoryBudget = std::size_t{64} << 20;
+    static constexpr std::size_t kMinMemoryBudget = std::size_t{64} << 10;
+
+    // memoryBudget bounds the bytes used for counting (at least
+    // kMinMemoryBudget); trackedTerms is the number of heavy hitters kept
+    // once counting is approximate
+    explicit TermCounter(std::size_t memoryBudget = kDefaultMemoryBudget, std::size_t trackedTerms = 1000);
+
+    void add(std::string_view term);
+
+    // Terms added, counting repeats
+    std::uint64_t total() const { return added; }
+
+    // True once the vocabulary outgrew the budget and counts are estimates
+    bool approximate() const { return sketching; }
+
+    // The k most frequent terms, most frequent first and ties in the order
+    // they first appeared, as Python's Counter.most_common(k) orders them.
+    // Once approximate, only tracked terms are reported.
+    std::vector<std::pair<std::string, std::uint64_t>> top(std::size_t k) const;
+
+private:
+    struct Slot {
+        std::uint64_t hash = 0;
+        std::uint64_t count = 0;            // 0: empty
+        std::uint64_t first = 0;            // position of the first occurrence
+        std::size_t offset = 0;             // into arena
+        std::uint32_t length = 0;
+    };
+
+    struct TermHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view term) const;
+    };
+
+    struct Candidate {
+        std::uint64_t count;
+        std::uint64_t first;
+    };
+
+    bool insertExact(std::string_view term, std::uint64_t hash, std::uint64_t position);
+    void grow();
+    std::size_t exactBytes(std::size_t slotCount, std::size_t arenaSize) const;
+    void startSketching();
+    void addSketched(std::string_view term, std::uint64_t hash, std::uint64_t count, std::uint64_t first);
+
+    std::size_t memoryBudget;
+    std::size_t trackedTerms;
+    std::uint64_t added = 0;
+    bool sketching = false;
+
+    // Exact counting: linear probing over a power-of-two table, with the
+    // term bytes in one arena
+    std::vector<Slot> slots;
+    std::size_t used = 0;
+    std::string arena;
+
+    // Approximate counting
+    static constexpr std::size_t kSketchDepth = 4;
+    std::vector<std::uint64_t> sketch;      // kSketchDepth rows of sketchWidth
+    std::size_t sketchWidth = 0;
+    std::unordered_map<std::string, Candidate, TermHash, std::equal_to<>> candidates;
+    // (count, newest first, term) so the candidate to evict comes first
+    std::set<std::tuple<std::uint64_t, std::uint64_t, std::string_view>> byCount;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Text kernels that work directly on UTF-8 bytes. Runs of ASCII are handled 16
+// bytes at a time with SSE2 where available; multibyte sequences are decoded.
+// Inputs are expected to be valid UTF-8 (as produced by a JSON parser).
+namespace utf8 {
+
+// True if every byte is below 0x80
+bool isAscii(std::string_view text);
+
+// ASCII case mapping. Returns nothing for text containing non-ASCII characters,
+// whose case mapping needs the full Unicode tables (the caller falls back to Python).
+std::optional<std::string> toUpperAscii(std::string_view text);
+std::optional<std::string> toLowerAscii(std::string_view text);
+
+// Well-formed UTF-8 as Python's strict decoder accepts it: no overlong forms,
+// encoded surrogates or code points past U+10FFFF
+bool isValid(std::string_view text);
+
+// Number of code points, i.e. Python's len(str)
+std::size_t countCodePoints(std::string_view text);
+
+// Number of words as Python's len(str.split()) counts them, splitting on
+// every character str.isspace() accepts
+std::size_t countWords(std::string_view text);
+
+// The first word of text at or after pos, splitting as Python's str.split()
+// does; pos moves past it. Empty once no words are left.
+std::string_view nextWord(std::string_view text, std::size_t& pos);
+
+// Reverses the order of user-perceived characters, on a subset of UAX #29's
+// extended grapheme clusters: CR LF, Hangul jamo and syllables (GB6-GB8),
+// regional-indicator pairs, and ZWJ sequences stay together, and Extend marks
+// stay on their base. Extend is a table of the common blocks (combining
+// diacritics, Cyrillic, Hebrew, Arabic, Devanagari, Thai, variation selectors,
+// emoji modifiers, tags), not the full property; SpacingMark is only covered
+// for Devanagari, and Prepend and the Control breaks (GB4, GB5) are not
+// applied. processor.py reverses with this too, so both paths agree.
+std::string reverseGraphemes(std::string_view text);
+
+} // namespace utf8
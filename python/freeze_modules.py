@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""
+Build step: compile processor.py and the pure-Python stdlib modules it imports
+into a C++ source holding a PyImport_FrozenModules table, so the embedded
+interpreter can import them without touching the filesystem.
+
+Usage: freeze_modules.py <output.cpp> <processor.py>
+"""
+
+import json
+import marshal
+import os
+import subprocess
+import sys
+
+# Run in a clean interpreter (-S: no site, -I: isolated) to list what importing
+# the processor actually pulls in on top of a bare startup
+LIST_IMPORTS = """
+import sys
+before = set(sys.modules)
+sys.path.insert(0, sys.argv[1])
+import processor
+found = []
+for name in sorted(set(sys.modules) - before):
+    spec = getattr(sys.modules[name], "__spec__", None)
+    if spec and spec.origin and spec.origin.endswith(".py"):
+        found.append([name, spec.origin, spec.submodule_search_locations is not None])
+print(__import__("json").dumps(found))
+"""
+
+
+def imported_modules(processor_path):
+    directory = os.path.dirname(os.path.abspath(processor_path))
+    output = subprocess.run(
+        [sys.executable, "-S", "-I", "-B", "-c", LIST_IMPORTS, directory],
+        check=True, capture_output=True, text=True,
+    ).stdout
+    return json.loads(output)
+
+
+def compile_module(name, path):
+    with open(path, "rb") as source:
+        code = compile(source.read(), f"<frozen {name}>", "exec", dont_inherit=True, optimize=0)
+    return marshal.dumps(code)
+
+
+def c_identifier(name):
+    return "module_" + name.replace(".", "_")
+
+
+def render(modules):
+    lines = [
+        "// Generated by python/freeze_modules.py -- do not edit",
+        "#include \"frozen_modules.h\"",
+        "",
+        "#include <Python.h>",
+        "",
+        "namespace {",
+        "",
+    ]
+    for name, _, code in modules:
+        lines.append(f"// {name}")
+        lines.append(f"const unsigned char {c_identifier(name)}[] = {{")
+        for offset in range(0, len(code), 24):
+            chunk = code[offset:offset + 24]
+            lines.append("    " + ", ".join(str(byte) for byte in chunk) + ",")
+        lines.append("};")
+        lines.append("")
+
+    lines.append("const _frozen kModules[] = {")
+    # Python 3.11 has an extra get_code member
+    extra = ", .get_code = nullptr" if sys.version_info < (3, 12) else ""
+    for name, is_package, code in modules:
+        lines.append(
+            f"    {{.name = \"{name}\", .code = {c_identifier(name)}, "
+            f".size = {len(code)}, .is_package = {int(is_package)}{extra}}},"
+        )
+    lines.append("    {},")
+    lines.append("};")
+    lines.append("")
+    lines.append("} // namespace")
+    lines.append("")
+    lines.append("namespace frozen {")
+    lines.append("")
+    lines.append("const _frozen* modules() {")
+    lines.append("    return kModules;")
+    lines.append("}")
+    lines.append("")
+    lines.append("std::size_t moduleCount() {")
+    lines.append(f"    return {len(modules)};")
+    lines.append("}")
+    lines.append("")
+    lines.append("unsigned long pythonVersion() {")
+    lines.append(f"    return 0x{sys.hexversion:08X}UL;")
+    lines.append("}")
+    lines.append("")
+    lines.append("} // namespace frozen")
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    output_path, processor_path = sys.argv[1], sys.argv[2]
+
+    modules = [("processor", False, compile_module("processor", processor_path))]
+    for name, origin, is_package in imported_modules(processor_path):
+        if name != "processor":
+            modules.append((name, is_package, compile_module(name, origin)))
+
+    content = render(modules)
+    # Leave the file alone when nothing changed so dependents are not rebuilt
+    if os.path.exists(output_path):
+        with open(output_path, encoding="utf-8") as existing:
+            if existing.read() == content:
+                return
+    with open(output_path, "w", encoding="utf-8") as output:
+        output.write(content)
+
+
+if __name__ == "__main__":
+    main()
@@ -6,71 +6,223 @@ This script demonstrates various JSON processing operations.
 
 import json
 import math
+import re
+import time
+from collections import Counter
+from collections.abc import Iterator
+from functools import lru_cache
+from itertools import islice
 
+# What each request type requires before its handler does any work: the member
+# it reads ("field"), what that member must be ("kind": "array",
+# "non_empty_array" or "string", where a missing member counts as an empty
+# one) with the error given otherwise, and the operations it knows.
+# python_processor_lib compiles this table at startup and answers requests
+# failing these checks itself, without taking the GIL, so the handlers below
+# take their messages from here.
+REQUEST_SCHEMAS = {
+    "math": {
+        "field": "numbers",
+        "kind": "non_empty_array",
+        "error": "Numbers array is required for math operations",
+        "operations": ["add", "multiply", "mean", "sqrt", "power"],
+    },
+    "text": {
+        "field": "text",
+        "kind": "string",
+        "error": "Text field is required for text operations",
+        "operations": [
+            "uppercase",
+            "lowercase",
+            "reverse",
+            "word_count",
+            "char_count",
+            "capitalize",
+            "find_all",
+            "count_matches",
+            "replace",
+            "word_frequency",
+            "top_k_terms",
+        ],
+    },
+    "data": {
+        "field": "dataset",
+        "kind": "array",
+        "error": "Dataset array is required for data operations",
+        "operations": [
+            "stats",
+            "sort",
+            "unique",
+            "filter_numbers",
+            # Served by native handlers in python_processor_lib
+            "extended_stats",
+            "quantiles",
+            "histogram",
+            "session_open",
+            "session_append",
+            "session_finalize",
+            "moving_average",
+            "rolling_min",
+            "rolling_max",
+            "rolling_variance",
+            "exponential_smoothing",
+        ],
+    },
+    "echo": {},
+    # Served by native handlers in python_processor_lib
+    "pipeline": {
+        "field": "stages",
+        "kind": "non_empty_array",
+        "error": "Stages array is required for pipeline requests",
+    },
+    "matrix": {
+        "operations": ["multiply", "transpose", "dot", "reduce"],
+    },
+}
 
-def process_json(json_string: str) -> str:
+
+# List items encoded per call while streaming a response
+STREAM_BATCH = 4096
+
+
+def _materialize(value):
+    """Encodes iterators in responses as lists; see process_json_stream."""
+    if isinstance(value, Iterator):
+        return list(value)
+    raise TypeError(f"Object of type {type(value).__name__} is not JSON serializable")
+
+
+# json.dumps with its default settings, plus iterators
+_encoder = json.JSONEncoder(default=_materialize)
+
+
+def process_json(json_string: str, spans=None) -> str:
     """
     Process JSON input and return a result based on the request type.
     
     Args:
         json_string: JSON string containing the request
+        spans: for python_processor_lib's span tracing, a list of this
+            request's own that gets (stage, start_ns, end_ns) tuples taken
+            from time.perf_counter_ns()
         
     Returns:
         JSON string containing the result
     """
+    if spans is None:
+        return _encoder.encode(process_request(json_string))
+
+    response = process_request(json_string, spans)
+    start = time.perf_counter_ns()
+    result = _encoder.encode(response)
+    spans.append(("json.dumps", start, time.perf_counter_ns()))
+    return result
+
+
+def process_json_stream(json_string: str, chunk_size: int = 65536, spans=None):
+    """
+    Like process_json, but yields the response as str chunks of roughly
+    chunk_size characters that join to exactly what process_json returns.
+    Lists are encoded STREAM_BATCH items at a time, and a handler can put an
+    iterator (e.g. a generator) in its response to produce a large result
+    while it is being sent, so the response never exists as one string.
+    spans is as for process_json.
+    """
+    pending = []
+    size = 0
+    for piece in _iterencode(process_request(json_string, spans)):
+        pending.append(piece)
+        size += len(piece)
+        if size >= chunk_size:
+            yield "".join(pending)
+            pending.clear()
+            size = 0
+    if pending:
+        yield "".join(pending)
+
+
+def _iterencode(value):
+    """Yields the JSON text of value in pieces, as _encoder would encode it."""
+    if isinstance(value, dict):
+        yield "{"
+        for index, (key, item) in enumerate(value.items()):
+            # Keys are converted as json.dumps converts them
+            yield (", " if index else "") + _encoder.encode({key: 0})[1:-4] + ": "
+            yield from _iterencode(item)
+        yield "}"
+    elif isinstance(value, (list, tuple)):
+        yield "["
+        for start in range(0, len(value), STREAM_BATCH):
+            yield (", " if start else "") + _encoder.encode(value[start:start + STREAM_BATCH])[1:-1]
+        yield "]"
+    elif isinstance(value, Iterator):
+        yield "["
+        first = True
+        while batch := list(islice(value, STREAM_BATCH)):
+            yield ("" if first else ", ") + _encoder.encode(batch)[1:-1]
+            first = False
+        yield "]"
+    else:
+        yield _encoder.encode(value)
+
+
+def process_request(json_string: str, spans=None) -> dict:
+    """Decode the request and run its handler; returns the response object."""
     try:
+        start = time.perf_counter_ns() if spans is not None else 0
         data = json.loads(json_string)
+        if spans is not None:
+            spans.append(("json.loads", start, time.perf_counter_ns()))
 
         if not isinstance(data, dict):
-            return json.dumps({
+            return {
                 "success": False,
                 "error": "Input must be a JSON object",
                 "timestamp": "2025-06-14T00:00:00"
-            })
+            }
 
         request_type = data.get("type", "unknown")
-        
-        if request_type == "math":
-            return handle_math_request(data)
-        elif request_type == "text":
-            return handle_text_request(data)
-        elif request_type == "data":
-            return handle_data_request(data)
-        elif request_type == "echo":
-            return handle_echo_request(data)
-        else:
-            return json.dumps({
+        handler = REQUEST_HANDLERS.get(request_type)
+        if handler is None:
+            return {
                 "success": False,
                 "error": f"Unknown request type: {request_type}",
-                "available_types": ["math", "text", "data", "echo"],
+                "available_types": list(REQUEST_SCHEMAS),
                 "timestamp": "2025-06-14T00:00:00"
-            })
+            }
+        if spans is None:
+            return handler(data)
+
+        start = time.perf_counter_ns()
+        response = handler(data)
+        spans.append(("handler", start, time.perf_counter_ns()))
+        return response
             
     except json.JSONDecodeError as e:
-        return json.dumps({
+        return {
             "success": False,
             "error": f"Invalid JSON: {str(e)}",
             "timestamp": "2025-06-14T00:00:00"
-        })
+        }
     except Exception as e:
-        return json.dumps({
+        return {
             "success": False,
             "error": f"Processing error: {str(e)}",
             "timestamp": "2025-06-14T00:00:00"
-        })
+        }
 
 
-def handle_math_request(data) -> str:
+def handle_math_request(data) -> dict:
     """Handle mathematical operations."""
     operation = data.get("operation", "")
     numbers = data.get("numbers", [])
     
     if not isinstance(numbers, list) or not numbers:
-        return json.dumps({
+        return {
             "success": False,
-            "error": "Numbers array is required for math operations",
+            "error": REQUEST_SCHEMAS["math"]["error"],
             "timestamp": "2025-06-14T00:00:00"
-        })
+        }
 
     try:
         
@@ -91,92 +243,207 @@ def handle_math_request(data) -> str:
                 raise ValueError("power operation requires exactly two numbers")
             result = math.pow(numbers[0], numbers[1])
         else:
-            return json.dumps({
+            return {
                 "success": False,
                 "error": f"Unknown math operation: {operation}",
-                "available_operations": ["add", "multiply", "mean", "sqrt", "power"],
+                "available_operations": REQUEST_SCHEMAS["math"]["operations"],
                 "timestamp": "2025-06-14T00:00:00"
-            })
+            }
         
         fact = math.factorial(5)
 
-        return json.dumps({
+        return {
             "success": True,
             "result": result,
             "operation": operation,
             "input_numbers": numbers,
             "timestamp": "2025-06-14T00:00:00",
             "path": "/workspaces/cpp-ideas"
-        })
+        }
         
     except Exception as e:
-        return json.dumps({
+        return {
             "success": False,
             "error": f"Math operation failed: {str(e)}",
             "timestamp": "2025-06-14T00:00:00"
-        })
+        }
+
+
+REGEX_FLAGS = {"i": re.IGNORECASE, "m": re.MULTILINE, "s": re.DOTALL}
+REGEX_OPERATIONS = ("find_all", "count_matches", "replace")
+
+
+@lru_cache(maxsize=256)
+def compile_pattern(pattern: str, flags: str) -> re.Pattern:
+    """re.compile for a pattern and its REGEX_FLAGS letters, compiled once."""
+    value = 0
+    for flag in flags:
+        if flag not in REGEX_FLAGS:
+            raise ValueError(f"Unknown regex flag: {flag}")
+        value |= REGEX_FLAGS[flag]
+    return re.compile(pattern, value)
+
+
+def regex_operation(operation, text, data):
+    """
+    find_all, count_matches or replace with the request's "pattern" and
+    "flags". The default "backtracking" engine is re; "engine": "linear" runs
+    on python_processor_lib's linear-time engine, which serves it natively and
+    lends it to this module as cppideas_native, and never falls back to re.
+    """
+    pattern = data.get("pattern")
+    flags = data.get("flags", "")
+    engine = data.get("engine", "backtracking")
+    if not isinstance(pattern, str):
+        raise ValueError("pattern must be a string")
+    if not isinstance(flags, str):
+        raise ValueError("flags must be a string of i, m and s")
+    if engine not in ("backtracking", "linear"):
+        raise ValueError('engine must be "backtracking" or "linear"')
+
+    if operation == "replace":
+        replacement = data.get("replacement")
+        count = data.get("count", 0)
+        if not isinstance(replacement, str):
+            raise ValueError("replacement must be a string")
+        if not isinstance(count, int) or isinstance(count, bool) or not 0 <= count <= 1 << 30:
+            raise ValueError("count must be an integer between 0 and 1073741824")
 
+    if engine == "linear":
+        try:
+            import cppideas_native
+        except ImportError:
+            raise ValueError('engine "linear" needs python_processor_lib\'s cppideas_native module') from None
+        if operation == "find_all":
+            return cppideas_native.regex_find_all(pattern, flags, text)
+        if operation == "count_matches":
+            return cppideas_native.regex_count_matches(pattern, flags, text)
+        return cppideas_native.regex_replace(pattern, flags, text, replacement, count)
 
-def handle_text_request(data) -> str:
+    compiled = compile_pattern(pattern, flags)
+    if operation == "find_all":
+        return [match.group() for match in compiled.finditer(text)]
+    if operation == "count_matches":
+        return sum(1 for _ in compiled.finditer(text))
+    return compiled.sub(replacement, text, count)
+
+
+# A lone surrogate, as json.loads decodes an unpaired \ud800 escape
+SURROGATE = re.compile("([\ud800-\udfff])")
+
+
+def reverse_graphemes(text):
+    """
+    text reversed by grapheme cluster, with the cluster rules python_processor_lib
+    serves reverse with natively, lent to this module as cppideas_native.
+    """
+    try:
+        import cppideas_native
+    except ImportError:
+        raise ValueError("reverse needs python_processor_lib's cppideas_native module") from None
+    # Lone surrogates cannot be encoded for it; as controls they are clusters
+    # of their own, so the text between them is reversed piece by piece
+    pieces = SURROGATE.split(text)
+    return "".join(
+        piece if SURROGATE.fullmatch(piece) else cppideas_native.reverse_graphemes(piece)
+        for piece in reversed(pieces)
+    )
+
+
+TERM_OPERATIONS = ("word_frequency", "top_k_terms")
+
+
+def term_frequencies(operation, text, data) -> dict:
+    """
+    word_frequency (every word, or the k most common) and top_k_terms (the k
+    most common, 10 by default), most common first. python_processor_lib
+    serves these natively within "memory_budget" bytes, estimating the
+    counts once the vocabulary outgrows it; here they are always exact.
+    """
+    k = data.get("k", 10 if operation == "top_k_terms" else None)
+    budget = data.get("memory_budget", 64 << 20)
+    if k is not None and (not isinstance(k, int) or isinstance(k, bool) or not 1 <= k <= 100000):
+        raise ValueError("k must be an integer between 1 and 100000")
+    if not isinstance(budget, int) or isinstance(budget, bool) or not 65536 <= budget <= 1 << 40:
+        raise ValueError("memory_budget must be an integer between 65536 and 1099511627776")
+
+    words = text.split()
+    common = Counter(words).most_common(k)
+    return {
+        "success": True,
+        "result": dict(common) if operation == "word_frequency" else [[term, count] for term, count in common],
+        "operation": operation,
+        "total_words": len(words),
+        "approximate": False,
+        "timestamp": "2025-06-14T00:00:00"
+    }
+
+
+def handle_text_request(data) -> dict:
     """Handle text processing operations."""
     operation = data.get("operation", "")
     text = data.get("text", "")
     
     if not isinstance(text, str):
-        return json.dumps({
+        return {
             "success": False,
-            "error": "Text field is required for text operations",
+            "error": REQUEST_SCHEMAS["text"]["error"],
             "timestamp": "2025-06-14T00:00:00"
-        })
+        }
     
     try:
+        if operation in TERM_OPERATIONS:
+            # The text is not echoed back; it can be a whole corpus
+            return term_frequencies(operation, text, data)
         if operation == "uppercase":
             result = text.upper()
         elif operation == "lowercase":
             result = text.lower()
         elif operation == "reverse":
-            result = text[::-1]
+            result = reverse_graphemes(text)
         elif operation == "word_count":
             result = len(text.split())
         elif operation == "char_count":
             result = len(text)
         elif operation == "capitalize":
             result = text.capitalize()
+        elif operation in REGEX_OPERATIONS:
+            result = regex_operation(operation, text, data)
         else:
-            return json.dumps({
+            return {
                 "success": False,
                 "error": f"Unknown text operation: {operation}",
-                "available_operations": ["uppercase", "lowercase", "reverse", "word_count", "char_count", "capitalize"],
+                "available_operations": REQUEST_SCHEMAS["text"]["operations"],
                 "timestamp": "2025-06-14T00:00:00"
-            })
+            }
         
-        return json.dumps({
+        return {
             "success": True,
             "result": result,
             "operation": operation,
             "input_text": text,
             "timestamp": "2025-06-14T00:00:00"
-        })
+        }
         
     except Exception as e:
-        return json.dumps({
+        return {
             "success": False,
             "error": f"Text operation failed: {str(e)}",
             "timestamp": "2025-06-14T00:00:00"
-        })
+        }
 
 
-def handle_data_request(data) -> str:
+def handle_data_request(data) -> dict:
     """Handle data analysis operations."""
     operation = data.get("operation", "")
     dataset = data.get("dataset", [])
     
     if not isinstance(dataset, list):
-        return json.dumps({
+        return {
             "success": False,
-            "error": "Dataset array is required for data operations",
+            "error": REQUEST_SCHEMAS["data"]["error"],
             "timestamp": "2025-06-14T00:00:00"
-        })
+        }
     
     try:
         if operation == "stats":
@@ -195,45 +462,91 @@ def handle_data_request(data) -> str:
                 "max": max(numeric_data),
                 "range": max(numeric_data) - min(numeric_data)
             }
+        # Results are iterators where no list is needed, so process_json_stream
+        # encodes them as they are produced; sorted() has to build its list
         elif operation == "sort":
             result = sorted(dataset)
         elif operation == "unique":
-            result = list(set(dataset))
+            result = iter(set(dataset))
         elif operation == "filter_numbers":
-            result = [x for x in dataset if isinstance(x, (int, float))]
+            result = (x for x in dataset if isinstance(x, (int, float)))
+        elif operation in REQUEST_SCHEMAS["data"]["operations"]:
+            raise ValueError(native_only_error(operation))
         else:
-            return json.dumps({
+            return {
                 "success": False,
                 "error": f"Unknown data operation: {operation}",
-                "available_operations": ["stats", "sort", "unique", "filter_numbers"],
+                "available_operations": REQUEST_SCHEMAS["data"]["operations"],
                 "timestamp": "2025-06-14T00:00:00"
-            })
+            }
         
-        return json.dumps({
+        return {
             "success": True,
             "result": result,
             "operation": operation,
             "input_dataset": dataset,
             "timestamp": "2025-06-14T00:00:00"
-        })
+        }
         
     except Exception as e:
-        return json.dumps({
+        return {
             "success": False,
             "error": f"Data operation failed: {str(e)}",
             "timestamp": "2025-06-14T00:00:00"
-        })
+        }
+
+
+def native_only_error(name) -> str:
+    """
+    The native handlers serve these requests and only hand them on when the
+    document is JSON that json.loads accepts but the standard does not (NaN,
+    Infinity, unpaired surrogates).
+    """
+    return f"{name} requires standard JSON: NaN, Infinity and unpaired surrogates are not supported"
 
 
-def handle_echo_request(data) -> str:
+def handle_native_only_request(data) -> dict:
+    """Pipeline and matrix requests that reached Python; see native_only_error."""
+    request_type = data["type"]
+    schema = REQUEST_SCHEMAS[request_type]
+    field = schema.get("field")
+    if field is not None and not (isinstance(data.get(field), list) and data[field]):
+        error = schema["error"]
+    elif "operations" in schema and data.get("operation", "") not in schema["operations"]:
+        return {
+            "success": False,
+            "error": f"Unknown {request_type} operation: {data.get('operation', '')}",
+            "available_operations": schema["operations"],
+            "timestamp": "2025-06-14T00:00:00"
+        }
+    else:
+        error = native_only_error(request_type)
+    return {
+        "success": False,
+        "error": error,
+        "timestamp": "2025-06-14T00:00:00"
+    }
+
+
+def handle_echo_request(data) -> dict:
     """Echo the input data back with timestamp."""
-    return json.dumps({
+    return {
         "success": True,
         "result": "Echo successful",
         "echoed_data": data,
         "timestamp": "2025-06-14T00:00:00"
-    })
+    }
+
+
 
+REQUEST_HANDLERS = {
+    "math": handle_math_request,
+    "text": handle_text_request,
+    "data": handle_data_request,
+    "echo": handle_echo_request,
+    "pipeline": handle_native_only_request,
+    "matrix": handle_native_only_request,
+}
 
 if __name__ == "__main__":
     # Test the processor with sample data
@@ -0,0 +1,140 @@
+#include "allocation_tracker.h"
+
+#include <Python.h>
+#include <algorithm>
+#include <unordered_map>
+
+namespace {
+
+struct ThreadAllocations {
+    int activeScopes = 0;
+    std::int64_t liveBytes = 0;
+    std::int64_t peakBytes = 0;
+    std::size_t libraryBytes = 0;
+    // Blocks allocated inside a scope, so frees know what to take off. A block
+    // freed on another thread stays counted as retained.
+    std::unordered_map<void*, std::size_t> sizes;
+};
+
+thread_local ThreadAllocations threadAllocations;
+
+PyMemAllocatorEx previousRaw{};
+PyMemAllocatorEx countingRaw{};
+int hookUsers = 0;
+
+void countAllocation(void* ptr, std::size_t size) {
+    if (ptr && threadAllocations.activeScopes > 0) {
+        threadAllocations.sizes[ptr] = size;
+        threadAllocations.liveBytes += static_cast<std::int64_t>(size);
+        threadAllocations.peakBytes = std::max(threadAllocations.peakBytes, threadAllocations.liveBytes);
+    }
+}
+
+void countFree(void* ptr) {
+    if (!ptr || threadAllocations.sizes.empty()) {
+        return;
+    }
+    auto it = threadAllocations.sizes.find(ptr);
+    if (it != threadAllocations.sizes.end()) {
+        threadAllocations.liveBytes -= static_cast<std::int64_t>(it->second);
+        threadAllocations.sizes.erase(it);
+    }
+}
+
+void* countingMalloc(void*, std::size_t size) {
+    void* ptr = previousRaw.malloc(previousRaw.ctx, size);
+    countAllocation(ptr, size);
+    return ptr;
+}
+
+void* countingCalloc(void*, std::size_t count, std::size_t size) {
+    void* ptr = previousRaw.calloc(previousRaw.ctx, count, size);
+    countAllocation(ptr, count * size);
+    return ptr;
+}
+
+void* countingRealloc(void*, void* old, std::size_t size) {
+    void* ptr = previousRaw.realloc(previousRaw.ctx, old, size);
+    if (ptr) {
+        countFree(old);
+        countAllocation(ptr, size);
+    }
+    return ptr;
+}
+
+void countingFree(void*, void* ptr) {
+    countFree(ptr);
+    previousRaw.free(previousRaw.ctx, ptr);
+}
+
+bool hookIsCurrent() {
+    PyMemAllocatorEx current{};
+    PyMem_GetAllocator(PYMEM_DOMAIN_RAW, &current);
+    return current.malloc == countingMalloc;
+}
+
+} // namespace
+
+void installRawAllocationHook() {
+    if (hookUsers++ > 0) {
+        return;
+    }
+    PyMem_GetAllocator(PYMEM_DOMAIN_RAW, &previousRaw);
+    countingRaw = {nullptr, countingMalloc, countingCalloc, countingRealloc, countingFree};
+    PyMem_SetAllocator(PYMEM_DOMAIN_RAW, &countingRaw);
+}
+
+void removeRawAllocationHook() {
+    if (hookUsers == 0 || --hookUsers > 0) {
+        return;
+    }
+    // Another hook chained in front of ours still calls into it; leave it in
+    // place rather than cut that hook's chain
+    if (hookIsCurrent()) {
+        PyMem_SetAllocator(PYMEM_DOMAIN_RAW, &previousRaw);
+    } else {
+        ++hookUsers;
+    }
+}
+
+void countLibraryAllocation(std::size_t bytes) {
+    if (threadAllocations.activeScopes > 0) {
+        threadAllocations.libraryBytes += bytes;
+    }
+}
+
+AllocationScope::AllocationScope()
+    : baseline(threadAllocations.liveBytes)
+    , outerPeak(threadAllocations.peakBytes)
+    , libraryBaseline(threadAllocations.libraryBytes) {
+    threadAllocations.peakBytes = threadAllocations.liveBytes;
+    ++threadAllocations.activeScopes;
+}
+
+AllocationScope::~AllocationScope() {
+    --threadAllocations.activeScopes;
+    threadAllocations.peakBytes = std::max(outerPeak, threadAllocations.peakBytes);
+    if (threadAllocations.activeScopes == 0) {
+        // Whatever outlived the request is already counted as retained
+        threadAllocations.sizes.clear();
+        threadAllocations.liveBytes = 0;
+        threadAllocations.peakBytes = 0;
+        threadAllocations.libraryBytes = 0;
+    }
+}
+
+std::size_t AllocationScope::peakBytes() const {
+    return static_cast<std::size_t>(std::max<std::int64_t>(0, threadAllocations.peakBytes - baseline));
+}
+
+std::int64_t AllocationScope::retainedBytes() const {
+    return threadAllocations.liveBytes - baseline;
+}
+
+std::size_t AllocationScope::libraryBytes() const {
+    return threadAllocations.libraryBytes - libraryBaseline;
+}
+
+bool AllocationScope::active() {
+    return threadAllocations.activeScopes > 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Counts the allocations Python's raw allocator (PyMem_RawMalloc: the
+// interpreter's C buffers and those of extension modules) makes on the current
+// thread while a scope is active, and the buffers python_processor_lib reports
+// allocating itself through countLibraryAllocation.
+//
+// The counting hook is chained in front of the raw allocator with
+// PyMem_SetAllocator by installRawAllocationHook and taken out again by
+// removeRawAllocationHook, so it only costs anything while memory accounting
+// is on. Both need the GIL and nest.
+void installRawAllocationHook();
+void removeRawAllocationHook();
+
+// Counts a buffer python_processor_lib allocated on this thread while a scope
+// is active: the native handlers' request document and the response bodies
+// built in C++. Those go back to the caller with the response, so they are
+// only ever added up.
+void countLibraryAllocation(std::size_t bytes);
+
+class AllocationScope {
+public:
+    AllocationScope();
+    ~AllocationScope();
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+    // Highest number of live bytes allocated since the scope was opened
+    std::size_t peakBytes() const;
+
+    // Bytes allocated and not yet freed since the scope was opened (may be negative)
+    std::int64_t retainedBytes() const;
+
+    // Library buffers counted since the scope was opened
+    std::size_t libraryBytes() const;
+
+    // Whether a scope is open on this thread, so callers can skip sizing
+    // buffers nobody counts
+    static bool active();
+
+private:
+    std::int64_t baseline;
+    std::int64_t outerPeak;
+    std::size_t libraryBaseline;
+};
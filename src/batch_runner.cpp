@@ -0,0 +1,174 @@
+#include "batch_runner.h"
+#include "json_validation.h"
+#include "native_handlers.h"
+#include "python_processor.h"
+#include "result_writer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fmt/format.h>
+#include <fstream>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct FileOutcome {
+    std::uint64_t bytes = 0;
+    std::optional<std::string> error;
+};
+
+std::optional<std::string> readFile(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) {
+        return std::nullopt;
+    }
+    std::string content(static_cast<std::size_t>(in.tellg()), '\0');
+    in.seekg(0);
+    in.read(content.data(), static_cast<std::streamsize>(content.size()));
+    if (!in) {
+        return std::nullopt;
+    }
+    return content;
+}
+
+// The "error" of a response whose "success" member is not true, read without
+// building the document; members after one the strict parser rejects (such
+// as a NaN Python wrote) are not needed
+std::optional<std::string> responseError(const std::string& response) {
+    std::string key;
+    bool success = false;
+    std::optional<std::string> error;
+    nlohmann::json::parser_callback_t callback = [&](int depth, nlohmann::json::parse_event_t event, nlohmann::json& parsed) {
+        if (depth == 1 && event == nlohmann::json::parse_event_t::key) {
+            key = parsed.get<std::string>();
+        } else if (depth == 1 && event == nlohmann::json::parse_event_t::value) {
+            if (key == "success") {
+                success = parsed == true;
+            } else if (key == "error" && parsed.is_string()) {
+                error = parsed.get<std::string>();
+            }
+        }
+        return depth == 0;
+    };
+    // Only the members above are kept; the callback discards the rest
+    nlohmann::json discarded = nlohmann::json::parse(response, callback, false);
+    if (success) {
+        return std::nullopt;
+    }
+    return error.value_or("Request failed");
+}
+
+FileOutcome processFile(PythonProcessor& processor, const fs::path& input, const BatchOptions& options) {
+    FileOutcome outcome;
+    std::optional<std::string> request = readFile(input);
+    if (!request) {
+        outcome.error = "Could not read " + input.string();
+        return outcome;
+    }
+    outcome.bytes = request->size();
+
+    std::string response;
+    JsonValidation validation = validateJson(*request);
+    if (validation.status == JsonValidation::Status::Invalid) {
+        outcome.error = fmt::format("Invalid JSON at line {}, column {}: {}", validation.line, validation.column, validation.message);
+        response = native::errorResponse(*outcome.error);
+    } else if (!validation.object) {
+        outcome.error = "Request must be a JSON object";
+        response = native::errorResponse(*outcome.error);
+    } else if (auto result = processor.process(*request); !result) {
+        outcome.error = fmt::format("{}: {}", describe(result.error().code), result.error().message);
+        response = native::errorResponse(*outcome.error);
+    } else {
+        response = std::move(result->body);
+        outcome.error = responseError(response);
+    }
+
+    auto saved = saveResult(response, batchOutputPath(input, options), ResultCompression::None);
+    if (!saved) {
+        outcome.error = saved.error();
+    }
+    return outcome;
+}
+
+} // namespace
+
+double BatchProgress::filesPerSecond() const {
+    return elapsed.count() > 0 ? static_cast<double>(completed) / elapsed.count() : 0.0;
+}
+
+double BatchProgress::megabytesPerSecond() const {
+    return elapsed.count() > 0 ? static_cast<double>(inputBytes) / 1e6 / elapsed.count() : 0.0;
+}
+
+std::vector<fs::path> findBatchInputs(const fs::path& directory, const BatchOptions& options) {
+    std::vector<fs::path> inputs;
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(directory, error)) {
+        std::string name = entry.path().filename().string();
+        if (entry.is_regular_file(error) && name.ends_with(".json") && !name.ends_with(options.outputSuffix)) {
+            inputs.push_back(entry.path());
+        }
+    }
+    std::sort(inputs.begin(), inputs.end());
+    return inputs;
+}
+
+fs::path batchOutputPath(const fs::path& input, const BatchOptions& options) {
+    return input.parent_path() / (input.stem().string() + options.outputSuffix);
+}
+
+BatchSummary runBatch(PythonProcessor& processor, const std::vector<fs::path>& inputs,
+    const BatchOptions& options, const std::function<void(const BatchProgress&)>& progress, std::stop_token stop) {
+    BatchSummary summary;
+    summary.progress.total = inputs.size();
+    const auto start = std::chrono::steady_clock::now();
+
+    std::atomic<std::size_t> next{0};
+    std::mutex mutex;
+    auto work = [&] {
+        while (!stop.stop_requested()) {
+            std::size_t index = next.fetch_add(1, std::memory_order_relaxed);
+            if (index >= inputs.size()) {
+                return;
+            }
+            FileOutcome outcome;
+            try {
+                outcome = processFile(processor, inputs[index], options);
+            } catch (const std::exception& e) {
+                outcome.error = e.what();
+            }
+
+            std::lock_guard lock(mutex);
+            BatchProgress& current = summary.progress;
+            ++current.completed;
+            current.inputBytes += outcome.bytes;
+            current.elapsed = std::chrono::steady_clock::now() - start;
+            if (outcome.error) {
+                ++current.failed;
+                summary.failures.push_back({inputs[index], std::move(*outcome.error)});
+            }
+            if (progress) {
+                progress(current);
+            }
+        }
+    };
+
+    {
+        // Python requests still take turns on the GIL; the pool overlaps file
+        // I/O, validation and native handlers with them
+        std::size_t workers = std::clamp<std::size_t>(options.workers, 1, std::max<std::size_t>(inputs.size(), 1));
+        std::vector<std::jthread> pool;
+        for (std::size_t i = 0; i < workers; ++i) {
+            pool.emplace_back(work);
+        }
+    }
+
+    summary.progress.elapsed = std::chrono::steady_clock::now() - start;
+    summary.cancelled = summary.progress.completed < summary.progress.total;
+    return summary;
+}
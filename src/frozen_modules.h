@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+
+struct _frozen;
+
+// processor.py and the pure-Python stdlib modules it imports, compiled to
+// bytecode at build time by python/freeze_modules.py (frozen_modules.cpp is
+// generated into the build directory).
+namespace frozen {
+
+// Table for PyImport_FrozenModules, terminated by an empty entry
+const _frozen* modules();
+
+std::size_t moduleCount();
+
+// sys.hexversion of the interpreter that compiled the bytecode. Marshalled
+// code only loads into the same major.minor version.
+unsigned long pythonVersion();
+
+} // namespace frozen
@@ -0,0 +1,221 @@
+#include "gc_monitor.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <loguru/loguru.hpp>
+
+namespace {
+
+PyObject* gcCallback(PyObject* self, PyObject* args) {
+    auto* monitor = static_cast<GcMonitor*>(PyCapsule_GetPointer(self, "cppideas.GcMonitor"));
+    const char* phase = nullptr;
+    PyObject* info = nullptr;
+    if (!monitor || !PyArg_ParseTuple(args, "sO", &phase, &info)) {
+        return nullptr;
+    }
+    long generation = 0;
+    if (PyObject* value = PyDict_Check(info) ? PyDict_GetItemString(info, "generation") : nullptr) {
+        generation = PyLong_AsLong(value);
+        if (generation == -1 && PyErr_Occurred()) {
+            return nullptr;
+        }
+    }
+    monitor->onCollection(phase, static_cast<int>(generation));
+    Py_RETURN_NONE;
+}
+
+PyMethodDef gcCallbackDefinition = {"cppideas_gc_callback", gcCallback, METH_VARARGS, "Times collections for PythonProcessor"};
+
+// gc.<name>(*args); returns a new reference or nullptr with the error set
+PyObject* callGc(PyObject* gc, const char* name, PyObject* argument = nullptr) {
+    PyObject* function = PyObject_GetAttrString(gc, name);
+    if (!function) {
+        return nullptr;
+    }
+    PyObject* result = argument ? PyObject_CallOneArg(function, argument) : PyObject_CallNoArgs(function);
+    Py_DECREF(function);
+    return result;
+}
+
+} // namespace
+
+GcMonitor::~GcMonitor() {
+    // shutdown() normally did this already; the Python references are left
+    // alone since the GIL cannot be taken here safely
+    collector.request_stop();
+    if (collector.joinable()) {
+        collector.join();
+    }
+}
+
+bool GcMonitor::install(const StartupOptions& options) {
+    PyObject* gc = PyImport_ImportModule("gc");
+    if (!gc) {
+        return false;
+    }
+    auto fail = [&] {
+        Py_DECREF(gc);
+        return false;
+    };
+
+    PyObject* capsule = PyCapsule_New(this, "cppideas.GcMonitor", nullptr);
+    if (!capsule) {
+        return fail();
+    }
+    callback = PyCFunction_New(&gcCallbackDefinition, capsule);
+    Py_DECREF(capsule);
+    PyObject* callbacks = callback ? PyObject_GetAttrString(gc, "callbacks") : nullptr;
+    if (!callbacks) {
+        return fail();
+    }
+    int appended = PyList_Append(callbacks, callback);
+    Py_DECREF(callbacks);
+    if (appended != 0) {
+        return fail();
+    }
+
+    if (options.freezeGc) {
+        // Collect first so that only live objects are frozen
+        PyObject* collected = callGc(gc, "collect");
+        PyObject* frozen = collected ? callGc(gc, "freeze") : nullptr;
+        PyObject* count = frozen ? callGc(gc, "get_freeze_count") : nullptr;
+        Py_XDECREF(collected);
+        Py_XDECREF(frozen);
+        if (!count) {
+            return fail();
+        }
+        std::lock_guard lock(statsMutex);
+        current.frozenObjects = PyLong_AsSize_t(count);
+        Py_DECREF(count);
+        LOG_F(INFO, "Froze %zu objects into the permanent generation", current.frozenObjects);
+    }
+
+    if (options.deferGc) {
+        collectFunction = PyObject_GetAttrString(gc, "collect");
+        PyObject* enabled = collectFunction ? callGc(gc, "isenabled") : nullptr;
+        PyObject* disabled = enabled ? callGc(gc, "disable") : nullptr;
+        if (!disabled) {
+            Py_XDECREF(enabled);
+            return fail();
+        }
+        disabledAutomatic = enabled == Py_True;
+        Py_DECREF(enabled);
+        Py_DECREF(disabled);
+
+        idleDelay = options.gcIdleDelay;
+        maxDeferral = options.gcMaxDeferral;
+        lastFinished.store(Clock::now().time_since_epoch().count());
+        {
+            std::lock_guard lock(statsMutex);
+            current.deferred = true;
+        }
+        collector = std::jthread([this](std::stop_token stop) { runCollector(stop); });
+        LOG_F(INFO, "Automatic garbage collection deferred to idle periods");
+    }
+    Py_DECREF(gc);
+    return true;
+}
+
+void GcMonitor::shutdown() {
+    collector.request_stop();
+    if (collector.joinable()) {
+        collector.join();
+    }
+    if (!callback || !Py_IsInitialized()) {
+        return;
+    }
+
+    PyGILState_STATE state = PyGILState_Ensure();
+    if (PyObject* gc = PyImport_ImportModule("gc")) {
+        if (PyObject* callbacks = PyObject_GetAttrString(gc, "callbacks")) {
+            if (PyObject* removed = PyObject_CallMethod(callbacks, "remove", "O", callback)) {
+                Py_DECREF(removed);
+            }
+            Py_DECREF(callbacks);
+        }
+        if (disabledAutomatic) {
+            Py_XDECREF(callGc(gc, "enable"));
+        }
+        Py_DECREF(gc);
+    }
+    PyErr_Clear();
+    Py_CLEAR(callback);
+    Py_CLEAR(collectFunction);
+    PyGILState_Release(state);
+}
+
+GcStats GcMonitor::stats() const {
+    std::lock_guard lock(statsMutex);
+    return current;
+}
+
+void GcMonitor::onCollection(std::string_view phase, int generation) {
+    auto now = Clock::now();
+    if (phase == "start") {
+        collectionStarted = now;
+        return;
+    }
+    auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(now - collectionStarted);
+    counters.recordGcPause(pause);
+
+    std::lock_guard lock(statsMutex);
+    ++current.collections[static_cast<std::size_t>(std::clamp(generation, 0, 2))];
+    current.totalPause += pause;
+    current.maxPause = std::max(current.maxPause, pause);
+    current.lastPause = pause;
+}
+
+void GcMonitor::requestFinished() {
+    lastFinished.store(Clock::now().time_since_epoch().count());
+    finishedRequests.fetch_add(1);
+    inFlight.fetch_sub(1);
+}
+
+void GcMonitor::runCollector(std::stop_token stop) {
+    std::mutex mutex;
+    std::condition_variable_any wake;
+    std::uint64_t collectedFull = finishedRequests.load();
+    std::uint64_t collectedYoung = collectedFull;
+    auto lastCollection = Clock::now();
+
+    while (true) {
+        {
+            std::unique_lock lock(mutex);
+            wake.wait_for(lock, stop, idleDelay, [] { return false; });
+        }
+        if (stop.stop_requested()) {
+            return;
+        }
+
+        auto now = Clock::now();
+        std::uint64_t finished = finishedRequests.load();
+        bool idle = inFlight.load() == 0 && now - Clock::time_point(Clock::duration(lastFinished.load())) >= idleDelay;
+        if (idle && finished != collectedFull) {
+            collect(2);
+            collectedFull = collectedYoung = finished;
+            lastCollection = now;
+            std::lock_guard lock(statsMutex);
+            ++current.idleCollections;
+        } else if (!idle && finished != collectedYoung && now - lastCollection >= maxDeferral) {
+            collect(0);
+            collectedYoung = finished;
+            lastCollection = now;
+            std::lock_guard lock(statsMutex);
+            ++current.overdueCollections;
+        }
+    }
+}
+
+void GcMonitor::collect(int generation) {
+    PyGILState_STATE state = PyGILState_Ensure();
+    PyObject* argument = PyLong_FromLong(generation);
+    PyObject* result = argument ? PyObject_CallOneArg(collectFunction, argument) : nullptr;
+    Py_XDECREF(argument);
+    if (result) {
+        Py_DECREF(result);
+    } else {
+        LOG_F(ERROR, "Deferred garbage collection failed");
+        PyErr_Clear();
+    }
+    PyGILState_Release(state);
+}
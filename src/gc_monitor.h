@@ -0,0 +1,79 @@
+#pragma once
+
+#include "performance_counters.h"
+#include "python_processor.h"
+
+#include <Python.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+
+// Times the embedded interpreter's garbage collections through gc.callbacks
+// and, in latency mode, freezes the startup heap and moves collections off
+// the request path (see StartupOptions::freezeGc and deferGc).
+class GcMonitor {
+public:
+    explicit GcMonitor(PerformanceCounters& counters) : counters(counters) {}
+    ~GcMonitor();
+
+    GcMonitor(const GcMonitor&) = delete;
+    GcMonitor& operator=(const GcMonitor&) = delete;
+
+    // Hooks gc.callbacks and applies the options; call once, with the GIL
+    // held, after processor.py has been imported. Returns false with a Python
+    // error set if the gc module misbehaves.
+    bool install(const StartupOptions& options);
+
+    // Stops the idle collector, then takes the GIL to remove the hook and turn
+    // automatic collection back on. Call without holding the GIL.
+    void shutdown();
+
+    // Marks a Python request for as long as it lives, including the wait for
+    // the GIL, so idle collections stay out of its way
+    class RequestScope {
+    public:
+        explicit RequestScope(GcMonitor& monitor) : monitor(monitor) { monitor.inFlight.fetch_add(1); }
+        ~RequestScope() { monitor.requestFinished(); }
+
+        RequestScope(const RequestScope&) = delete;
+        RequestScope& operator=(const RequestScope&) = delete;
+
+    private:
+        GcMonitor& monitor;
+    };
+
+    GcStats stats() const;
+
+    // Called by the gc.callbacks hook with the GIL held
+    void onCollection(std::string_view phase, int generation);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void requestFinished();
+    void runCollector(std::stop_token stop);
+    // Runs gc.collect(generation); takes the GIL
+    void collect(int generation);
+
+    PerformanceCounters& counters;
+    PyObject* callback = nullptr;
+    PyObject* collectFunction = nullptr;
+    bool disabledAutomatic = false;
+
+    // Guarded by the GIL
+    Clock::time_point collectionStarted;
+
+    mutable std::mutex statsMutex;
+    GcStats current;
+
+    std::chrono::milliseconds idleDelay{0};
+    std::chrono::milliseconds maxDeferral{0};
+    std::atomic<int> inFlight{0};
+    std::atomic<std::uint64_t> finishedRequests{0};
+    std::atomic<Clock::rep> lastFinished{0};
+    std::jthread collector;
+};
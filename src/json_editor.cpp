@@ -0,0 +1,167 @@
+#include "json_editor.h"
+
+#include <QColor>
+#include <QHelpEvent>
+#include <QTextBlock>
+#include <QTimer>
+#include <QToolTip>
+#include <QtConcurrent>
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace {
+
+constexpr int kDebounceMs = 300;
+constexpr int kNothingChanged = std::numeric_limits<int>::max();
+
+// Bytes the text takes once converted to UTF-8
+std::size_t utf8Length(QStringView text) {
+    std::size_t length = 0;
+    for (QChar c : text) {
+        char16_t unit = c.unicode();
+        length += unit < 0x80 ? 1u : (unit < 0x800 || c.isSurrogate()) ? 2u : 3u;
+    }
+    return length;
+}
+
+// Runs on the worker thread, or on the GUI thread from validateNow()
+JsonValidation validateText(IncrementalJsonValidator& validator, const QString& text, int changedFrom, std::stop_token stop) {
+    QByteArray utf8 = text.toUtf8();
+    std::size_t unchanged = utf8Length(QStringView(text).left(std::min<qsizetype>(changedFrom, text.size())));
+    return validator.validate(std::string_view(utf8.constData(), static_cast<std::size_t>(utf8.size())), unchanged, stop);
+}
+
+} // namespace
+
+JsonEditor::JsonEditor(QWidget* parent)
+    : QPlainTextEdit(parent),
+      debounce(new QTimer(this)),
+      watcher(new QFutureWatcher<JsonValidation>(this)),
+      validator(std::make_shared<IncrementalJsonValidator>()) {
+    // Wrapping makes every edit relayout the rest of the paragraph
+    setLineWrapMode(QPlainTextEdit::NoWrap);
+
+    debounce->setSingleShot(true);
+    debounce->setInterval(kDebounceMs);
+    connect(debounce, &QTimer::timeout, this, &JsonEditor::startValidation);
+    connect(watcher, &QFutureWatcher<JsonValidation>::finished, this, &JsonEditor::validationFinished);
+    connect(document(), &QTextDocument::contentsChange, this, &JsonEditor::contentsChanged);
+}
+
+JsonEditor::~JsonEditor() {
+    stopSource.request_stop();
+    watcher->waitForFinished();
+}
+
+JsonValidation JsonEditor::validateNow() {
+    debounce->stop();
+    if (runningRevision >= 0) {
+        if (runningRevision != revision) {
+            stopSource.request_stop();
+        }
+        watcher->waitForFinished();
+        collectResult();
+    }
+    if (resultRevision != revision) {
+        // Resumes like a background run, so usually only the edited tail is scanned
+        result = validateText(*validator, toPlainText(), std::exchange(changedFrom, kNothingChanged), {});
+        resultRevision = revision;
+    }
+    showResult();
+    return result;
+}
+
+bool JsonEditor::viewportEvent(QEvent* event) {
+    if (event->type() == QEvent::ToolTip) {
+        auto* help = static_cast<QHelpEvent*>(event);
+        if (resultRevision == revision && result.status == JsonValidation::Status::Invalid
+            && cursorForPosition(help->pos()).blockNumber() + 1 == static_cast<int>(result.line)) {
+            QToolTip::showText(help->globalPos(), QString::fromStdString(result.message), viewport());
+        } else {
+            QToolTip::hideText();
+        }
+        return true;
+    }
+    return QPlainTextEdit::viewportEvent(event);
+}
+
+void JsonEditor::contentsChanged(int position, int, int) {
+    changedFrom = std::min(changedFrom, position);
+    ++revision;
+    // The running snapshot is already stale; its checkpoints are kept
+    if (runningRevision >= 0) {
+        stopSource.request_stop();
+    }
+    debounce->start();
+}
+
+void JsonEditor::startValidation() {
+    // validationFinished() comes back here once the current run stops
+    if (runningRevision >= 0 || resultRevision == revision) {
+        return;
+    }
+    runningRevision = revision;
+    stopSource = std::stop_source();
+    watcher->setFuture(QtConcurrent::run(
+        [validator = validator, text = toPlainText(), from = std::exchange(changedFrom, kNothingChanged),
+         stop = stopSource.get_token()] {
+            return validateText(*validator, text, from, stop);
+        }));
+}
+
+void JsonEditor::validationFinished() {
+    collectResult();
+    showResult();
+    if (resultRevision != revision && !debounce->isActive()) {
+        startValidation();
+    }
+}
+
+void JsonEditor::collectResult() {
+    if (runningRevision < 0) {
+        return;
+    }
+    JsonValidation finished = watcher->result();
+    if (finished.status != JsonValidation::Status::Cancelled) {
+        result = std::move(finished);
+        resultRevision = runningRevision;
+    }
+    runningRevision = -1;
+}
+
+void JsonEditor::showResult() {
+    // Marks of an older result stay until the current text has been checked
+    if (resultRevision != revision) {
+        return;
+    }
+
+    QList<QTextEdit::ExtraSelection> selections;
+    if (result.status == JsonValidation::Status::Invalid) {
+        QTextBlock block = document()->findBlockByNumber(static_cast<int>(result.line) - 1);
+
+        QTextEdit::ExtraSelection line;
+        line.cursor = QTextCursor(block);
+        line.format.setBackground(QColor(255, 235, 238));
+        line.format.setProperty(QTextFormat::FullWidthSelection, true);
+        selections.append(line);
+
+        // Columns count characters, cursor positions count UTF-16 units
+        QString text = block.text();
+        int offset = 0;
+        for (std::size_t column = 1; column < result.column && offset < text.size(); ++column) {
+            offset += text[offset].isHighSurrogate() ? 2 : 1;
+        }
+
+        QTextEdit::ExtraSelection error;
+        error.cursor = QTextCursor(block);
+        error.cursor.setPosition(block.position() + offset);
+        // At the end of the line (e.g. an unterminated document) mark the last character
+        error.cursor.movePosition(offset < text.size() ? QTextCursor::NextCharacter : QTextCursor::PreviousCharacter,
+            QTextCursor::KeepAnchor);
+        error.format.setUnderlineStyle(QTextCharFormat::WaveUnderline);
+        error.format.setUnderlineColor(QColor(229, 57, 53));
+        selections.append(error);
+    }
+    setExtraSelections(selections);
+}
@@ -0,0 +1,271 @@
+#include "json_validation.h"
+
+#include <algorithm>
+
+namespace {
+
+bool isWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool isHexDigit(char c) {
+    return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+// Result of scanning one token: the position after it, or the error
+struct Scan {
+    std::size_t end;
+    const char* error = nullptr;
+    std::size_t errorOffset = 0;
+};
+
+Scan scanString(std::string_view text, std::size_t start) {
+    std::size_t i = start + 1;
+    while (i < text.size()) {
+        char c = text[i];
+        if (c == '"') {
+            return {i + 1};
+        }
+        if (c == '\\') {
+            if (i + 1 >= text.size()) {
+                break;
+            }
+            char escape = text[i + 1];
+            if (escape == 'u') {
+                for (std::size_t j = i + 2; j < i + 6; ++j) {
+                    if (j >= text.size() || !isHexDigit(text[j])) {
+                        return {0, "Invalid \\uXXXX escape", i + 1};
+                    }
+                }
+                i += 6;
+                continue;
+            }
+            if (std::string_view("\"\\/bfnrt").find(escape) == std::string_view::npos) {
+                return {0, "Invalid \\escape", i};
+            }
+            i += 2;
+            continue;
+        }
+        if (static_cast<unsigned char>(c) < 0x20) {
+            return {0, "Invalid control character at", i};
+        }
+        ++i;
+    }
+    return {0, "Unterminated string starting at", start};
+}
+
+// Numbers as matched by json.scanner's NUMBER_RE, plus the constants Python accepts
+Scan scanScalar(std::string_view text, std::size_t start) {
+    std::string_view rest = text.substr(start);
+    for (std::string_view literal : {"true", "false", "null", "NaN", "Infinity", "-Infinity"}) {
+        if (rest.starts_with(literal)) {
+            return {start + literal.size()};
+        }
+    }
+
+    std::size_t i = start;
+    if (i < text.size() && text[i] == '-') {
+        ++i;
+    }
+    if (i >= text.size() || !isDigit(text[i])) {
+        return {0, "Expecting value", start};
+    }
+    if (text[i] == '0') {
+        ++i;
+    } else {
+        while (i < text.size() && isDigit(text[i])) {
+            ++i;
+        }
+    }
+    if (i + 1 < text.size() && text[i] == '.' && isDigit(text[i + 1])) {
+        i += 2;
+        while (i < text.size() && isDigit(text[i])) {
+            ++i;
+        }
+    }
+    if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+        std::size_t exponent = i + 1;
+        if (exponent < text.size() && (text[exponent] == '+' || text[exponent] == '-')) {
+            ++exponent;
+        }
+        if (exponent < text.size() && isDigit(text[exponent])) {
+            i = exponent;
+            while (i < text.size() && isDigit(text[i])) {
+                ++i;
+            }
+        }
+    }
+    return {i};
+}
+
+void locate(std::string_view text, JsonValidation& result) {
+    std::string_view before = text.substr(0, result.offset);
+    std::size_t lineStart = before.rfind('\n');
+    lineStart = lineStart == std::string_view::npos ? 0 : lineStart + 1;
+    result.line = 1 + static_cast<std::size_t>(std::count(before.begin(), before.end(), '\n'));
+    // Characters, not bytes: skip UTF-8 continuation bytes
+    result.column = 1 + static_cast<std::size_t>(std::count_if(before.begin() + static_cast<std::ptrdiff_t>(lineStart), before.end(),
+        [](char c) { return (static_cast<unsigned char>(c) & 0xC0) != 0x80; }));
+}
+
+} // namespace
+
+JsonValidation IncrementalJsonValidator::validate(std::string_view text, std::size_t unchangedPrefix, std::stop_token stop) {
+    // Checkpoints are only taken right after structural characters, so one at
+    // offset o depends on nothing past o
+    unchangedPrefix = std::min(unchangedPrefix, text.size());
+    while (!checkpoints.empty() && checkpoints.back().offset > unchangedPrefix) {
+        checkpoints.pop_back();
+    }
+
+    Checkpoint state = checkpoints.empty() ? Checkpoint{0, Expect::Value, false, {}} : checkpoints.back();
+    const std::size_t start = state.offset;
+    std::size_t pos = start;
+    std::size_t nextCheckpoint = pos + kCheckpointBytes;
+
+    JsonValidation result;
+    auto finish = [&](JsonValidation::Status status, std::size_t offset, const char* message) {
+        scannedBytes = std::max(offset, start) - start;
+        result.status = status;
+        result.object = state.object;
+        if (status == JsonValidation::Status::Invalid) {
+            result.offset = offset;
+            result.message = message;
+            locate(text, result);
+        }
+        return result;
+    };
+
+    // Called after consuming a structural character; false when cancelled
+    auto reachedBoundary = [&] {
+        if (pos < nextCheckpoint) {
+            return true;
+        }
+        if (stop.stop_requested()) {
+            return false;
+        }
+        state.offset = pos;
+        checkpoints.push_back(state);
+        nextCheckpoint = pos + kCheckpointBytes;
+        return true;
+    };
+    auto closeContainer = [&] {
+        ++pos;
+        state.stack.pop_back();
+        state.expect = state.stack.empty() ? Expect::Done : Expect::CommaOrEnd;
+    };
+
+    // json.loads refuses a leading byte order mark before looking at anything else
+    if (start == 0 && text.starts_with("\xEF\xBB\xBF")) {
+        return finish(JsonValidation::Status::Invalid, 0, "Unexpected UTF-8 BOM (decode using utf-8-sig)");
+    }
+
+    while (true) {
+        while (pos < text.size() && isWhitespace(text[pos])) {
+            ++pos;
+        }
+        if (pos == text.size()) {
+            switch (state.expect) {
+                case Expect::Done:
+                    return finish(JsonValidation::Status::Valid, pos, nullptr);
+                case Expect::Key:
+                case Expect::KeyOrEnd:
+                    return finish(JsonValidation::Status::Invalid, pos, "Expecting property name enclosed in double quotes");
+                case Expect::Colon:
+                    return finish(JsonValidation::Status::Invalid, pos, "Expecting ':' delimiter");
+                case Expect::CommaOrEnd:
+                    return finish(JsonValidation::Status::Invalid, pos, "Expecting ',' delimiter");
+                default:
+                    return finish(JsonValidation::Status::Invalid, pos, "Expecting value");
+            }
+        }
+
+        char c = text[pos];
+        switch (state.expect) {
+            case Expect::Done:
+                return finish(JsonValidation::Status::Invalid, pos, "Extra data");
+
+            case Expect::Colon:
+                if (c != ':') {
+                    return finish(JsonValidation::Status::Invalid, pos, "Expecting ':' delimiter");
+                }
+                ++pos;
+                state.expect = Expect::Value;
+                if (!reachedBoundary()) {
+                    return finish(JsonValidation::Status::Cancelled, pos, nullptr);
+                }
+                continue;
+
+            case Expect::CommaOrEnd:
+                if (c == ',') {
+                    ++pos;
+                    state.expect = state.stack.back() == '{' ? Expect::Key : Expect::Value;
+                    if (!reachedBoundary()) {
+                        return finish(JsonValidation::Status::Cancelled, pos, nullptr);
+                    }
+                    continue;
+                }
+                if ((c == '}' && state.stack.back() == '{') || (c == ']' && state.stack.back() == '[')) {
+                    closeContainer();
+                    continue;
+                }
+                return finish(JsonValidation::Status::Invalid, pos, "Expecting ',' delimiter");
+
+            case Expect::KeyOrEnd:
+                if (c == '}') {
+                    closeContainer();
+                    continue;
+                }
+                [[fallthrough]];
+            case Expect::Key: {
+                if (c != '"') {
+                    return finish(JsonValidation::Status::Invalid, pos, "Expecting property name enclosed in double quotes");
+                }
+                Scan key = scanString(text, pos);
+                if (key.error) {
+                    return finish(JsonValidation::Status::Invalid, key.errorOffset, key.error);
+                }
+                pos = key.end;
+                state.expect = Expect::Colon;
+                continue;
+            }
+
+            case Expect::ValueOrEnd:
+                if (c == ']') {
+                    closeContainer();
+                    continue;
+                }
+                [[fallthrough]];
+            case Expect::Value: {
+                if (state.stack.empty()) {
+                    state.object = c == '{';
+                }
+                if (c == '{' || c == '[') {
+                    state.stack.push_back(c);
+                    ++pos;
+                    state.expect = c == '{' ? Expect::KeyOrEnd : Expect::ValueOrEnd;
+                    if (!reachedBoundary()) {
+                        return finish(JsonValidation::Status::Cancelled, pos, nullptr);
+                    }
+                    continue;
+                }
+                Scan value = c == '"' ? scanString(text, pos) : scanScalar(text, pos);
+                if (value.error) {
+                    return finish(JsonValidation::Status::Invalid, value.errorOffset, value.error);
+                }
+                pos = value.end;
+                state.expect = state.stack.empty() ? Expect::Done : Expect::CommaOrEnd;
+                continue;
+            }
+        }
+    }
+}
+
+JsonValidation validateJson(std::string_view text) {
+    IncrementalJsonValidator validator;
+    return validator.validate(text);
+}
@@ -0,0 +1,262 @@
+// Replays a recorded request trace against PythonProcessor at a target rate.
+//
+// Scheduling is open-loop: request i is due at start + i / qps regardless of
+// how long earlier requests took, and its latency is measured from that due
+// time rather than from when a worker got round to sending it. A stalled
+// processor therefore shows up as queueing delay in the percentiles instead
+// of silently lowering the offered load (coordinated omission).
+
+#include "python_processor.h"
+#include "request_trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <fmt/format.h>
+#include <loguru/loguru.hpp>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct LatencySummary {
+    std::size_t count = 0;
+    double p50 = 0;
+    double p90 = 0;
+    double p99 = 0;
+    double p999 = 0;
+    double max = 0;
+};
+
+// Latencies are in microseconds; sorts the input in place
+LatencySummary summarize(std::vector<double>& latencies) {
+    LatencySummary summary;
+    summary.count = latencies.size();
+    if (latencies.empty()) {
+        return summary;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto at = [&](double quantile) {
+        auto index = static_cast<std::size_t>(quantile * static_cast<double>(latencies.size() - 1));
+        return latencies[index];
+    };
+    summary.p50 = at(0.50);
+    summary.p90 = at(0.90);
+    summary.p99 = at(0.99);
+    summary.p999 = at(0.999);
+    summary.max = latencies.back();
+    return summary;
+}
+
+void printHeader() {
+    fmt::print("{:>8} {:>10} {:>8} {:>10} {:>10} {:>10} {:>10} {:>10}\n",
+        "time(s)", "req/s", "errors", "p50(ms)", "p90(ms)", "p99(ms)", "p99.9(ms)", "max(ms)");
+}
+
+void printRow(const std::string& label, double seconds, std::size_t errors, LatencySummary summary) {
+    double rate = seconds > 0 ? static_cast<double>(summary.count) / seconds : 0.0;
+    fmt::print("{:>8} {:>10.1f} {:>8} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.3f}\n",
+        label, rate, errors, summary.p50 / 1000.0, summary.p90 / 1000.0,
+        summary.p99 / 1000.0, summary.p999 / 1000.0, summary.max / 1000.0);
+}
+
+// Latencies collected since the last report, shared by all workers
+struct LatencyLog {
+    std::mutex mutex;
+    std::vector<double> interval;
+    std::vector<double> total;
+    std::size_t intervalErrors = 0;
+    std::size_t totalErrors = 0;
+
+    void add(double latencyUs, bool failed) {
+        std::lock_guard<std::mutex> lock(mutex);
+        interval.push_back(latencyUs);
+        intervalErrors += failed ? 1 : 0;
+    }
+
+    std::pair<std::vector<double>, std::size_t> takeInterval() {
+        std::lock_guard<std::mutex> lock(mutex);
+        total.insert(total.end(), interval.begin(), interval.end());
+        totalErrors += intervalErrors;
+        std::pair<std::vector<double>, std::size_t> taken{std::move(interval), intervalErrors};
+        interval.clear();
+        intervalErrors = 0;
+        return taken;
+    }
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    argparse::ArgumentParser program("load_generator");
+    program.add_description("Replay a request trace against PythonProcessor at a target rate.");
+    program.add_argument("trace")
+        .help("trace file recorded with PythonProcessor::startTraceRecording");
+    program.add_argument("--qps")
+        .help("target requests per second; 0 replays at the recorded arrival times")
+        .default_value(100.0)
+        .scan<'g', double>();
+    program.add_argument("--concurrency")
+        .help("number of worker threads sending requests")
+        .default_value(4)
+        .scan<'i', int>();
+    program.add_argument("--duration")
+        .help("seconds to run for, looping over the trace; 0 plays the trace once")
+        .default_value(0.0)
+        .scan<'g', double>();
+    program.add_argument("--interval")
+        .help("seconds between latency reports")
+        .default_value(1.0)
+        .scan<'g', double>();
+    program.add_argument("--fast-start")
+        .help("start the processor from the embedded bytecode and cached paths")
+        .default_value(false)
+        .implicit_value(true);
+    program.add_argument("--low-latency")
+        .help("like --fast-start, and freeze the startup heap and defer garbage collection to idle periods")
+        .default_value(false)
+        .implicit_value(true);
+    program.add_argument("--span-trace")
+        .help("write per-stage request spans to this Chrome trace file (chrome://tracing, Perfetto)");
+
+    try {
+        program.parse_args(argc, argv);
+    } catch (const std::exception& e) {
+        fmt::print(stderr, "{}\n{}", e.what(), program.help().str());
+        return 1;
+    }
+
+    loguru::g_stderr_verbosity = loguru::Verbosity_WARNING;
+    loguru::init(argc, argv);
+
+    std::vector<TraceRecord> trace;
+    try {
+        trace = loadRequestTrace(program.get<std::string>("trace"));
+    } catch (const std::exception& e) {
+        fmt::print(stderr, "Error: {}\n", e.what());
+        return 1;
+    }
+    if (trace.empty()) {
+        fmt::print(stderr, "Error: trace is empty\n");
+        return 1;
+    }
+
+    const double qps = program.get<double>("--qps");
+    const int concurrency = std::max(1, program.get<int>("--concurrency"));
+    const double duration = program.get<double>("--duration");
+    const auto reportInterval = std::chrono::duration<double>(std::max(0.1, program.get<double>("--interval")));
+
+    StartupOptions options;
+    if (program.get<bool>("--low-latency")) {
+        options = StartupOptions::lowLatency();
+    } else if (program.get<bool>("--fast-start")) {
+        options = StartupOptions::fast();
+    }
+    PythonProcessor processor(options);
+    if (!processor.isInitialized()) {
+        fmt::print(stderr, "Error: Python processor failed to initialize: {}\n", processor.getLastError());
+        return 1;
+    }
+    auto startup = processor.getStartupTiming();
+    fmt::print("Startup {:.1f} ms: interpreter {:.1f}, paths {:.1f} ({}), import {:.1f} ({})\n",
+        static_cast<double>(startup.total.count()) / 1000.0, static_cast<double>(startup.interpreter.count()) / 1000.0,
+        static_cast<double>(startup.paths.count()) / 1000.0, startup.cachedPaths ? "cached" : "probed",
+        static_cast<double>(startup.import.count()) / 1000.0, startup.frozenImport ? "frozen" : "source");
+
+    auto spanTrace = program.present<std::string>("--span-trace");
+    if (spanTrace && !processor.startSpanTracing(*spanTrace)) {
+        fmt::print(stderr, "Error: could not write span trace {}\n", *spanTrace);
+        return 1;
+    }
+
+    // Due time of the i-th request relative to the start of the run
+    const auto traceSpan = trace.back().offset + std::chrono::microseconds(1);
+    auto dueOffset = [&](std::uint64_t index) -> Clock::duration {
+        if (qps > 0) {
+            return std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(static_cast<double>(index) / qps));
+        }
+        std::uint64_t loop = index / trace.size();
+        const TraceRecord& record = trace[index % trace.size()];
+        return std::chrono::duration_cast<Clock::duration>(traceSpan * static_cast<std::int64_t>(loop) + record.offset);
+    };
+
+    const std::uint64_t totalRequests = duration > 0
+        ? std::numeric_limits<std::uint64_t>::max()
+        : static_cast<std::uint64_t>(trace.size());
+    const auto deadline = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(duration));
+
+    fmt::print("Replaying {} recorded requests, target {} req/s, {} workers\n",
+        trace.size(), qps > 0 ? fmt::format("{:.1f}", qps) : std::string("recorded"), concurrency);
+    printHeader();
+
+    LatencyLog log;
+    std::atomic<std::uint64_t> nextRequest{0};
+    std::atomic<int> activeWorkers{concurrency};
+    const auto start = Clock::now();
+
+    std::vector<std::jthread> workers;
+    workers.reserve(static_cast<std::size_t>(concurrency));
+    for (int w = 0; w < concurrency; ++w) {
+        workers.emplace_back([&] {
+            while (true) {
+                std::uint64_t index = nextRequest.fetch_add(1);
+                if (index >= totalRequests) {
+                    break;
+                }
+                auto offset = dueOffset(index);
+                if (duration > 0 && offset >= deadline) {
+                    break;
+                }
+                auto due = start + offset;
+                std::this_thread::sleep_until(due);
+
+                auto result = processor.process(trace[index % trace.size()].request);
+                auto latency = std::chrono::duration<double, std::micro>(Clock::now() - due).count();
+                log.add(latency, !result || !result->body.starts_with(R"({"success": true)"));
+            }
+            --activeWorkers;
+        });
+    }
+
+    auto lastReport = start;
+    while (activeWorkers.load() > 0) {
+        std::this_thread::sleep_for(std::chrono::duration_cast<Clock::duration>(reportInterval));
+        auto now = Clock::now();
+        auto [latencies, errors] = log.takeInterval();
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        double span = std::chrono::duration<double>(now - lastReport).count();
+        printRow(fmt::format("{:.1f}", elapsed), span, errors, summarize(latencies));
+        lastReport = now;
+    }
+    workers.clear();
+    if (spanTrace) {
+        processor.stopSpanTracing();
+        fmt::print("Request spans written to {}\n", *spanTrace);
+    }
+
+    log.takeInterval();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    fmt::print("\n");
+    printHeader();
+    printRow("total", elapsed, log.totalErrors, summarize(log.total));
+
+    GcStats gc = processor.getGcStats();
+    fmt::print("GC: {} collections ({}/{}/{} by generation), pauses {:.2f} ms total, {:.2f} ms max",
+        gc.totalCollections(), gc.collections[0], gc.collections[1], gc.collections[2],
+        std::chrono::duration<double, std::milli>(gc.totalPause).count(),
+        std::chrono::duration<double, std::milli>(gc.maxPause).count());
+    if (gc.deferred) {
+        fmt::print("; {} idle, {} overdue", gc.idleCollections, gc.overdueCollections);
+    }
+    fmt::print("\n");
+    return 0;
+}
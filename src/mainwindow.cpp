@@ -1,5 +1,9 @@
 #include "mainwindow.h"
+#include "batch_runner.h"
+#include "json_editor.h"
+#include "performance_tab.h"
 #include "python_processor.h"
+#include "result_writer.h"
 
 #include <QApplication>
 #include <QMainWindow>
@@ -27,6 +31,9 @@
 #include <QStatusBar>
 #include <QProgressBar>
 #include <QTimer>
+#include <QtConcurrent>
+#include <algorithm>
+#include <thread>
 #include <loguru/loguru.hpp>
 #include <nlohmann/json.hpp>
 #include <loguru/loguru.hpp>
@@ -58,10 +65,20 @@ CppIdeasMainWindow::CppIdeasMainWindow(QWidget* parent) : QMainWindow(parent) {
         LOG_F(INFO, "Python processor initialized successfully");
         statusLabel->setText("Python processor ready");
         statusLabel->setStyleSheet("color: green;");
+        performanceTab->setProcessor(pythonProcessor.get());
     }
     
     LOG_F(INFO, "CppIdeasMainWindow constructor completed");
 }
+
+CppIdeasMainWindow::~CppIdeasMainWindow() {
+    // A cancelled save removes its partial file; a batch finishes the files in flight
+    saveStop.request_stop();
+    batchStop.request_stop();
+    saveJob.waitForFinished();
+    batchJob.waitForFinished();
+}
+
 void CppIdeasMainWindow::processJson() {
     if (!pythonProcessor || !pythonProcessor->isInitialized()) {
         resultText->setPlainText("Error: Python processor not initialized");
@@ -73,6 +90,20 @@ void CppIdeasMainWindow::processJson() {
         resultText->setPlainText("Error: Please enter JSON input");
         return;
     }
+
+    // Invalid requests never reach Python; the editor already marks the error
+    JsonValidation validation = inputText->validateNow();
+    if (validation.status == JsonValidation::Status::Invalid) {
+        statusLabel->setText(QString("Invalid JSON at line %1, column %2: %3")
+            .arg(validation.line).arg(validation.column).arg(QString::fromStdString(validation.message)));
+        statusLabel->setStyleSheet("color: red;");
+        return;
+    }
+    if (!validation.object) {
+        statusLabel->setText("Request must be a JSON object");
+        statusLabel->setStyleSheet("color: red;");
+        return;
+    }
     
     // Show progress
     progressBar->setVisible(true);
@@ -82,15 +113,15 @@ void CppIdeasMainWindow::processJson() {
     // Process in a timer to avoid blocking UI
     QTimer::singleShot(10, [this, jsonInput]() {
         try {
-            std::string result = pythonProcessor->processJson(jsonInput.toStdString());
+            rawResult = std::make_shared<const std::string>(pythonProcessor->processJson(jsonInput.toStdString()));
             
             // Format the JSON result for better readability
-            auto jsonDoc = QJsonDocument::fromJson(QByteArray::fromStdString(result));
+            auto jsonDoc = QJsonDocument::fromJson(QByteArray::fromStdString(*rawResult));
             if (!jsonDoc.isNull()) {
                 QString formattedResult = jsonDoc.toJson(QJsonDocument::Indented);
                 resultText->setPlainText(formattedResult);
             } else {
-                resultText->setPlainText(QString::fromStdString(result));
+                resultText->setPlainText(QString::fromStdString(*rawResult));
             }
             
             statusLabel->setText("Processing completed");
@@ -109,6 +140,7 @@ void CppIdeasMainWindow::processJson() {
 void CppIdeasMainWindow::clearAll() {
     inputText->clear();
     resultText->clear();
+    rawResult.reset();
     statusLabel->setText("Ready");
     statusLabel->setStyleSheet("color: black;");
 }
@@ -164,24 +196,173 @@ void CppIdeasMainWindow::loadJsonFile() {
 }
 
 void CppIdeasMainWindow::saveJsonFile() {
-    QString content = resultText->toPlainText();
-    if (content.isEmpty()) {
+    if (!rawResult) {
         QMessageBox::information(this, "Info", "No result to save");
         return;
     }
+    if (saveJob.isRunning()) {
+        QMessageBox::information(this, "Info", "The previous result is still being saved");
+        return;
+    }
     
+    QString selectedFilter;
     QString fileName = QFileDialog::getSaveFileName(this, 
-        "Save Result", "", "JSON Files (*.json);;Text Files (*.txt);;All Files (*)");
+        "Save Result", "",
+        "JSON Files (*.json);;Gzip Compressed JSON (*.json.gz);;Zlib Compressed JSON (*.json.zz);;"
+        "Text Files (*.txt);;All Files (*)",
+        &selectedFilter);
+    
+    if (fileName.isEmpty()) {
+        return;
+    }
+    // The compressed filters imply their extension, which selects the compression
+    if (selectedFilter.contains("*.json.gz") && !fileName.endsWith(".gz")) {
+        fileName += ".gz";
+    } else if (selectedFilter.contains("*.json.zz") && !fileName.endsWith(".zz")) {
+        fileName += ".zz";
+    }
+    std::string path = fileName.toStdString();
+    ResultCompression compression = compressionForPath(path);
     
+    progressBar->setVisible(true);
+    progressBar->setRange(0, 100);
+    progressBar->setValue(0);
+    statusLabel->setText("Saving result...");
+    
+    // Writes the bytes the processor returned, not the indented display copy,
+    // without copying them; the job keeps its own reference to the result
+    saveStop = std::stop_source();
+    saveJob = QtConcurrent::run([this, data = rawResult, path, compression, stop = saveStop.get_token(),
+                                 name = QFileInfo(fileName).fileName()] {
+        int shownPercent = -1;
+        auto saved = saveResult(*data, path, compression, [this, &shownPercent](std::size_t done, std::size_t total) {
+            int percent = total ? static_cast<int>(done * 100 / total) : 100;
+            if (percent == shownPercent) {
+                return;
+            }
+            shownPercent = percent;
+            QMetaObject::invokeMethod(this, [this, percent]() {
+                progressBar->setValue(percent);
+                statusLabel->setText(QString("Saving result... %1%").arg(percent));
+            }, Qt::QueuedConnection);
+        }, stop);
+        
+        QMetaObject::invokeMethod(this, [this, saved, name]() {
+            progressBar->setVisible(false);
+            if (saved) {
+                statusLabel->setText(QString("Result saved: %1 (%2 bytes)").arg(name).arg(saved->outputBytes));
+                statusLabel->setStyleSheet("color: green;");
+            } else {
+                statusLabel->setText("Saving failed");
+                statusLabel->setStyleSheet("color: red;");
+                QMessageBox::warning(this, "Error", QString::fromStdString(saved.error()));
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void CppIdeasMainWindow::toggleTraceRecording() {
+    if (pythonProcessor->isTraceRecording()) {
+        pythonProcessor->stopTraceRecording();
+        recordTraceAction->setText("Start Request Recording...");
+        statusLabel->setText("Request recording stopped");
+        return;
+    }
+
+    QString fileName = QFileDialog::getSaveFileName(this,
+        "Record Requests", "requests.trace.jsonl", "Request Traces (*.jsonl);;All Files (*)");
+
     if (!fileName.isEmpty()) {
-        QFile file(fileName);
-        if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-            QTextStream out(&file);
-            out << content;
-            statusLabel->setText("Result saved: " + QFileInfo(fileName).fileName());
+        if (pythonProcessor->startTraceRecording(fileName.toStdString())) {
+            recordTraceAction->setText("Stop Request Recording");
+            statusLabel->setText("Recording requests to: " + QFileInfo(fileName).fileName());
         } else {
-            QMessageBox::warning(this, "Error", "Could not save file: " + fileName);
+            QMessageBox::warning(this, "Error", "Could not record to file: " + fileName);
+        }
+    }
+}
+
+void CppIdeasMainWindow::processDirectory() {
+    // The same action cancels a running batch
+    if (batchJob.isRunning()) {
+        batchStop.request_stop();
+        statusLabel->setText("Cancelling batch...");
+        return;
+    }
+    if (!pythonProcessor || !pythonProcessor->isInitialized()) {
+        QMessageBox::warning(this, "Error", "Python processor not initialized");
+        return;
+    }
+    
+    QString directory = QFileDialog::getExistingDirectory(this, "Process Directory");
+    if (directory.isEmpty()) {
+        return;
+    }
+    
+    BatchOptions options;
+    options.workers = std::clamp(std::thread::hardware_concurrency(), 2u, 8u);
+    std::vector<std::filesystem::path> inputs = findBatchInputs(directory.toStdString(), options);
+    if (inputs.empty()) {
+        QMessageBox::information(this, "Info", "No JSON files in " + directory);
+        return;
+    }
+    
+    progressBar->setVisible(true);
+    progressBar->setRange(0, static_cast<int>(inputs.size()));
+    progressBar->setValue(0);
+    statusLabel->setText(QString("Batch: 0/%1 files").arg(inputs.size()));
+    statusLabel->setStyleSheet("color: black;");
+    batchAction->setText("Cancel Batch Processing");
+    batchButton->setText("Cancel Batch");
+    
+    batchStop = std::stop_source();
+    batchJob = QtConcurrent::run([this, inputs = std::move(inputs), options, stop = batchStop.get_token()] {
+        // Progress arrives once per file; the status bar only needs ~10 updates a second
+        std::chrono::steady_clock::time_point lastUpdate;
+        auto progress = [this, &lastUpdate](const BatchProgress& current) {
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastUpdate < std::chrono::milliseconds(100) && current.completed < current.total) {
+                return;
+            }
+            lastUpdate = now;
+            QMetaObject::invokeMethod(this, [this, current]() { showBatchProgress(current); }, Qt::QueuedConnection);
+        };
+        BatchSummary summary = runBatch(*pythonProcessor, inputs, options, progress, stop);
+        QMetaObject::invokeMethod(this, [this, summary]() { batchFinished(summary); }, Qt::QueuedConnection);
+    });
+}
+
+void CppIdeasMainWindow::showBatchProgress(const BatchProgress& progress) {
+    progressBar->setValue(static_cast<int>(progress.completed));
+    statusLabel->setText(QString("Batch: %1/%2 files, %3 failed, %4 files/s, %5 MB/s")
+        .arg(progress.completed).arg(progress.total).arg(progress.failed)
+        .arg(progress.filesPerSecond(), 0, 'f', 1).arg(progress.megabytesPerSecond(), 0, 'f', 1));
+}
+
+void CppIdeasMainWindow::batchFinished(const BatchSummary& summary) {
+    const BatchProgress& progress = summary.progress;
+    progressBar->setVisible(false);
+    batchAction->setText("Process Directory...");
+    batchButton->setText("Process Directory");
+    
+    statusLabel->setText(QString("Batch %1: %2/%3 files in %4 s (%5 files/s), %6 failed")
+        .arg(summary.cancelled ? "cancelled" : "finished")
+        .arg(progress.completed).arg(progress.total)
+        .arg(progress.elapsed.count(), 0, 'f', 1).arg(progress.filesPerSecond(), 0, 'f', 1)
+        .arg(progress.failed));
+    statusLabel->setStyleSheet(summary.failures.empty() && !summary.cancelled ? "color: green;" : "color: red;");
+    
+    if (!summary.failures.empty()) {
+        constexpr std::size_t kListed = 10;
+        QString details;
+        for (std::size_t i = 0; i < summary.failures.size() && i < kListed; ++i) {
+            details += QString::fromStdString(summary.failures[i].input.filename().string()) + ": "
+                + QString::fromStdString(summary.failures[i].error) + "\n";
         }
+        if (summary.failures.size() > kListed) {
+            details += QString("...and %1 more").arg(summary.failures.size() - kListed);
+        }
+        QMessageBox::warning(this, "Batch Processing", details);
     }
 }
 
@@ -203,6 +384,10 @@ void CppIdeasMainWindow::setupUI() {
     tabWidget->addTab(mainTab, "JSON Processor");
     setupMainTab(mainTab);
     
+    // Live request metrics
+    performanceTab = new PerformanceTab;
+    tabWidget->addTab(performanceTab, "Performance");
+    
     // Help tab
     auto* helpTab = new QWidget;
     tabWidget->addTab(helpTab, "Help & Examples");
@@ -228,6 +413,10 @@ void CppIdeasMainWindow::setupMainTab(QWidget* parent) {
     
     controlsLayout->addStretch();
     
+    batchButton = new QPushButton("Process Directory");
+    connect(batchButton, &QPushButton::clicked, this, &CppIdeasMainWindow::processDirectory);
+    controlsLayout->addWidget(batchButton);
+    
     auto* loadBtn = new QPushButton("Load JSON File");
     connect(loadBtn, &QPushButton::clicked, this, &CppIdeasMainWindow::loadJsonFile);
     controlsLayout->addWidget(loadBtn);
@@ -246,7 +435,7 @@ void CppIdeasMainWindow::setupMainTab(QWidget* parent) {
     auto* inputGroup = new QGroupBox("JSON Input");
     auto* inputLayout = new QVBoxLayout(inputGroup);
     
-    inputText = new QTextEdit;
+    inputText = new JsonEditor;
     inputText->setFont(QFont("Consolas", 10));
     inputText->setPlaceholderText("Enter your JSON request here...");
     inputLayout->addWidget(inputText);
@@ -325,6 +514,8 @@ void CppIdeasMainWindow::setupHelpTab(QWidget* parent) {
     auto* dataLabel = new QLabel(
         "<b>Data Operations:</b><br>"
         "• stats, sort, unique, filter_numbers<br>"
+        "• extended_stats, quantiles (\"quantiles\": [0.5, 0.99]), histogram (\"bins\", optional \"range\")<br>"
+        "• session_open, session_append, session_finalize: aggregate a dataset sent in chunks<br>"
         "• Example: {\"type\": \"data\", \"operation\": \"stats\", \"dataset\": [1,2,3,4,5]}"
     );
     dataLabel->setWordWrap(true);
@@ -347,10 +538,12 @@ void CppIdeasMainWindow::setupHelpTab(QWidget* parent) {
     auto* instructions = new QLabel(
         "1. Select a sample JSON from the dropdown or create your own<br>"
         "2. Click 'Generate Sample' to populate the input area<br>"
-        "3. Modify the JSON as needed<br>"
+        "3. Modify the JSON as needed; syntax errors are underlined as you type<br>"
         "4. Click 'Process JSON' to send to Python script<br>"
         "5. View the result in the output area<br>"
-        "6. Save the result to a file if needed"
+        "6. Save the result to a file if needed<br>"
+        "7. 'Process Directory' runs every .json file in a folder and writes each "
+        "result next to its input as &lt;name&gt;.result.json"
     );
     instructions->setWordWrap(true);
     usageLayout->addWidget(instructions);
@@ -373,6 +566,14 @@ void CppIdeasMainWindow::setupMenuBar() {
     auto* saveAction = fileMenu->addAction("Save Result");
     connect(saveAction, &QAction::triggered, this, &CppIdeasMainWindow::saveJsonFile);
     
+    batchAction = fileMenu->addAction("Process Directory...");
+    connect(batchAction, &QAction::triggered, this, &CppIdeasMainWindow::processDirectory);
+    
+    fileMenu->addSeparator();
+
+    recordTraceAction = fileMenu->addAction("Start Request Recording...");
+    connect(recordTraceAction, &QAction::triggered, this, &CppIdeasMainWindow::toggleTraceRecording);
+    
     fileMenu->addSeparator();
     
     auto* exitAction = fileMenu->addAction("Exit");
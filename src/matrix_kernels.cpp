@@ -0,0 +1,235 @@
+#include "matrix_kernels.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MATRIX_KERNELS_SSE2 1
+#endif
+
+namespace matrix {
+
+namespace {
+
+// A tile of b (kDepthTile x kColTile doubles, 256 KiB) stays in L2 while each
+// row of a's tile streams over it; the kColTile-wide run of a row of c being
+// accumulated stays in L1
+constexpr std::size_t kRowTile = 64;
+constexpr std::size_t kDepthTile = 128;
+constexpr std::size_t kColTile = 256;
+constexpr std::size_t kTransposeTile = 32;
+
+// Multiply-adds below which starting threads costs more than it saves
+constexpr std::size_t kMinParallelWork = std::size_t{1} << 21;
+constexpr std::size_t kMinRowsPerThread = 16;
+
+// Helper threads running across all concurrent products. Together with the
+// callers' own threads they stay within the hardware concurrency, however
+// many requests multiply at once.
+std::atomic<std::size_t> helpersRunning{0};
+
+std::size_t helperLimit() {
+    static const std::size_t limit = std::max<std::size_t>(std::thread::hardware_concurrency(), 1) - 1;
+    return limit;
+}
+
+// Claims up to wanted helpers from what the other products leave free
+class HelperReservation {
+public:
+    explicit HelperReservation(std::size_t wanted) {
+        std::size_t running = helpersRunning.load(std::memory_order_relaxed);
+        do {
+            granted = std::min(wanted, helperLimit() - std::min(running, helperLimit()));
+        } while (granted > 0 && !helpersRunning.compare_exchange_weak(running, running + granted, std::memory_order_relaxed));
+    }
+
+    ~HelperReservation() {
+        helpersRunning.fetch_sub(granted, std::memory_order_relaxed);
+    }
+
+    HelperReservation(const HelperReservation&) = delete;
+    HelperReservation& operator=(const HelperReservation&) = delete;
+
+    std::size_t count() const { return granted; }
+
+private:
+    std::size_t granted = 0;
+};
+
+// y[0, n) += alpha * x[0, n)
+void axpy(double* y, const double* x, double alpha, std::size_t n) {
+    std::size_t i = 0;
+#ifdef MATRIX_KERNELS_SSE2
+    __m128d scale = _mm_set1_pd(alpha);
+    for (; i + 4 <= n; i += 4) {
+        __m128d low = _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(scale, _mm_loadu_pd(x + i)));
+        __m128d high = _mm_add_pd(_mm_loadu_pd(y + i + 2), _mm_mul_pd(scale, _mm_loadu_pd(x + i + 2)));
+        _mm_storeu_pd(y + i, low);
+        _mm_storeu_pd(y + i + 2, high);
+    }
+#endif
+    for (; i < n; ++i) {
+        y[i] += alpha * x[i];
+    }
+}
+
+double sum(const double* x, std::size_t n) {
+    std::size_t i = 0;
+    double total = 0.0;
+#ifdef MATRIX_KERNELS_SSE2
+    __m128d low = _mm_setzero_pd();
+    __m128d high = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        low = _mm_add_pd(low, _mm_loadu_pd(x + i));
+        high = _mm_add_pd(high, _mm_loadu_pd(x + i + 2));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(low, high));
+    total = lanes[0] + lanes[1];
+#endif
+    for (; i < n; ++i) {
+        total += x[i];
+    }
+    return total;
+}
+
+// acc[j] = combine(acc[j], x[j]) for a sum, min or max; min and max keep
+// std::min/std::max semantics, so a NaN in x never replaces acc
+void accumulate(double* acc, const double* x, std::size_t n, Reduction reduction) {
+    std::size_t i = 0;
+#ifdef MATRIX_KERNELS_SSE2
+    for (; i + 2 <= n; i += 2) {
+        __m128d current = _mm_loadu_pd(acc + i);
+        __m128d value = _mm_loadu_pd(x + i);
+        switch (reduction) {
+            case Reduction::Min: current = _mm_min_pd(value, current); break;
+            case Reduction::Max: current = _mm_max_pd(value, current); break;
+            default: current = _mm_add_pd(current, value); break;
+        }
+        _mm_storeu_pd(acc + i, current);
+    }
+#endif
+    for (; i < n; ++i) {
+        switch (reduction) {
+            case Reduction::Min: acc[i] = std::min(acc[i], x[i]); break;
+            case Reduction::Max: acc[i] = std::max(acc[i], x[i]); break;
+            default: acc[i] += x[i]; break;
+        }
+    }
+}
+
+double reduceRow(std::span<const double> row, Reduction reduction) {
+    switch (reduction) {
+        case Reduction::Min: return *std::min_element(row.begin(), row.end());
+        case Reduction::Max: return *std::max_element(row.begin(), row.end());
+        case Reduction::Mean: return sum(row.data(), row.size()) / static_cast<double>(row.size());
+        default: return sum(row.data(), row.size());
+    }
+}
+
+// c[begin, end) = a[begin, end) * b, tile by tile
+void multiplyRows(const Matrix& a, const Matrix& b, Matrix& c, std::size_t begin, std::size_t end) {
+    for (std::size_t i0 = begin; i0 < end; i0 += kRowTile) {
+        std::size_t i1 = std::min(i0 + kRowTile, end);
+        for (std::size_t k0 = 0; k0 < a.cols; k0 += kDepthTile) {
+            std::size_t k1 = std::min(k0 + kDepthTile, a.cols);
+            for (std::size_t j0 = 0; j0 < b.cols; j0 += kColTile) {
+                std::size_t width = std::min(j0 + kColTile, b.cols) - j0;
+                for (std::size_t i = i0; i < i1; ++i) {
+                    double* out = c.values.data() + i * c.cols + j0;
+                    for (std::size_t k = k0; k < k1; ++k) {
+                        axpy(out, b.values.data() + k * b.cols + j0, a.at(i, k), width);
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+Matrix multiply(const Matrix& a, const Matrix& b, std::size_t threads) {
+    Matrix c(a.rows, b.cols);
+    std::size_t workers = threads ? threads : helperLimit() + 1;
+    workers = std::min(workers, std::max<std::size_t>(a.rows / kMinRowsPerThread, 1));
+    HelperReservation helpers(a.rows * a.cols * b.cols < kMinParallelWork ? 0 : workers - 1);
+    workers = helpers.count() + 1;
+    if (workers == 1) {
+        multiplyRows(a, b, c, 0, a.rows);
+        return c;
+    }
+
+    // Contiguous bands of rows, the last one on the calling thread
+    std::size_t band = (a.rows + workers - 1) / workers;
+    {
+        std::vector<std::jthread> pool;
+        for (std::size_t begin = 0; begin + band < a.rows; begin += band) {
+            pool.emplace_back([&, begin] { multiplyRows(a, b, c, begin, begin + band); });
+        }
+        multiplyRows(a, b, c, (a.rows - 1) / band * band, a.rows);
+    }
+    return c;
+}
+
+Matrix transpose(const Matrix& m) {
+    Matrix t(m.cols, m.rows);
+    for (std::size_t i0 = 0; i0 < m.rows; i0 += kTransposeTile) {
+        std::size_t i1 = std::min(i0 + kTransposeTile, m.rows);
+        for (std::size_t j0 = 0; j0 < m.cols; j0 += kTransposeTile) {
+            std::size_t j1 = std::min(j0 + kTransposeTile, m.cols);
+            for (std::size_t i = i0; i < i1; ++i) {
+                for (std::size_t j = j0; j < j1; ++j) {
+                    t.at(j, i) = m.at(i, j);
+                }
+            }
+        }
+    }
+    return t;
+}
+
+double dot(std::span<const double> a, std::span<const double> b) {
+    std::size_t n = std::min(a.size(), b.size());
+    std::size_t i = 0;
+    double total = 0.0;
+#ifdef MATRIX_KERNELS_SSE2
+    __m128d low = _mm_setzero_pd();
+    __m128d high = _mm_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        low = _mm_add_pd(low, _mm_mul_pd(_mm_loadu_pd(a.data() + i), _mm_loadu_pd(b.data() + i)));
+        high = _mm_add_pd(high, _mm_mul_pd(_mm_loadu_pd(a.data() + i + 2), _mm_loadu_pd(b.data() + i + 2)));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(low, high));
+    total = lanes[0] + lanes[1];
+#endif
+    for (; i < n; ++i) {
+        total += a[i] * b[i];
+    }
+    return total;
+}
+
+std::vector<double> reduce(const Matrix& m, Axis axis, Reduction reduction) {
+    if (axis == Axis::Rows) {
+        std::vector<double> result(m.rows);
+        for (std::size_t i = 0; i < m.rows; ++i) {
+            result[i] = reduceRow(m.row(i), reduction);
+        }
+        return result;
+    }
+
+    // Columns: fold whole rows into one accumulator row, reading memory in order
+    std::vector<double> result(m.row(0).begin(), m.row(0).end());
+    for (std::size_t i = 1; i < m.rows; ++i) {
+        accumulate(result.data(), m.row(i).data(), m.cols, reduction);
+    }
+    if (reduction == Reduction::Mean) {
+        for (double& value : result) {
+            value /= static_cast<double>(m.rows);
+        }
+    }
+    return result;
+}
+
+} // namespace matrix
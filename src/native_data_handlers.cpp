@@ -0,0 +1,337 @@
+#include "native_handlers.h"
+#include "streaming_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fmt/format.h>
+#include <stdexcept>
+#include <vector>
+
+namespace native {
+
+namespace {
+
+constexpr std::size_t kDefaultSketchK = 200;
+constexpr std::size_t kMaxHistogramBins = 10000;
+constexpr std::size_t kDefaultWindow = 3;
+constexpr std::size_t kMaxWindow = std::size_t{1} << 24;
+
+// Accumulates the numeric values of a dataset in a single pass. Non-numeric
+// entries are skipped, as in processor.py's stats operation.
+struct DatasetSummary {
+    RunningStats stats;
+    KllSketch sketch;
+    bool integral = true;
+
+    explicit DatasetSummary(std::size_t k) : sketch(k) {}
+
+    void add(const json& value) {
+        if (!isNumber(value)) {
+            return;
+        }
+        integral = integral && !value.is_number_float();
+        double number = asDouble(value);
+        stats.add(number);
+        sketch.add(number);
+    }
+};
+
+// Datasets are either the request's array or a pipeline stage's DatasetView
+const json& entry(const json& value) {
+    return value;
+}
+
+const json& entry(const json* value) {
+    return *value;
+}
+
+// Rounded so that 0.07 is p7 rather than p7.000000000000001
+std::string quantileLabel(double q) {
+    return fmt::format("p{:.10g}", q * 100.0);
+}
+
+std::size_t sketchSize(const json& request) {
+    return integerOption(request, "k", kDefaultSketchK, 8, 65536);
+}
+
+template <typename Dataset>
+DatasetSummary summarize(const Dataset& dataset, std::size_t k) {
+    if (dataset.empty()) {
+        throw std::invalid_argument("Dataset cannot be empty");
+    }
+    DatasetSummary summary(k);
+    for (const auto& value : dataset) {
+        summary.add(entry(value));
+    }
+    if (summary.stats.count() == 0) {
+        throw std::invalid_argument("Dataset must contain numeric values");
+    }
+    return summary;
+}
+
+template <typename Dataset>
+json extendedStats(const json& request, const Dataset& dataset) {
+    DatasetSummary summary = summarize(dataset, sketchSize(request));
+    return describeStats(summary.stats, summary.sketch, summary.integral);
+}
+
+template <typename Dataset>
+json quantiles(const json& request, const Dataset& dataset) {
+    std::vector<double> requested = {0.5, 0.9, 0.99};
+    if (request.contains("quantiles")) {
+        const auto& values = request["quantiles"];
+        if (!values.is_array() || values.empty()) {
+            throw std::invalid_argument("quantiles must be a non-empty array");
+        }
+        requested.clear();
+        for (const auto& value : values) {
+            if (!value.is_number() || value.get<double>() < 0.0 || value.get<double>() > 1.0) {
+                throw std::invalid_argument("quantiles must be numbers between 0 and 1");
+            }
+            requested.push_back(value.get<double>());
+        }
+    }
+
+    DatasetSummary summary = summarize(dataset, sketchSize(request));
+    json values = json::object();
+    for (double q : requested) {
+        values[quantileLabel(q)] = numberValue(summary.sketch.quantile(q), summary.integral);
+    }
+    return {
+        {"count", summary.stats.count()},
+        {"quantiles", values},
+        {"approximate", summary.sketch.retained() < summary.sketch.count()}
+    };
+}
+
+template <typename Dataset>
+json histogram(const json& request, const Dataset& dataset) {
+    std::size_t binCount = integerOption(request, "bins", 10, 1, kMaxHistogramBins);
+
+    auto edges = [binCount](double lower, double upper) {
+        json result = json::array();
+        double width = (upper - lower) / static_cast<double>(binCount);
+        for (std::size_t i = 0; i <= binCount; ++i) {
+            result.push_back(i == binCount ? upper : lower + width * static_cast<double>(i));
+        }
+        return result;
+    };
+
+    if (request.contains("range")) {
+        // Known range: exact counts in one pass
+        const auto& range = request["range"];
+        if (!range.is_array() || range.size() != 2 || !range[0].is_number() || !range[1].is_number()) {
+            throw std::invalid_argument("range must be an array of two numbers");
+        }
+        if (dataset.empty()) {
+            throw std::invalid_argument("Dataset cannot be empty");
+        }
+        FixedHistogram hist(range[0].get<double>(), range[1].get<double>(), binCount);
+        std::uint64_t count = 0;
+        for (const auto& value : dataset) {
+            if (isNumber(entry(value))) {
+                hist.add(asDouble(entry(value)));
+                ++count;
+            }
+        }
+        if (count == 0) {
+            throw std::invalid_argument("Dataset must contain numeric values");
+        }
+        return {
+            {"count", count},
+            {"edges", edges(hist.lower(), hist.upper())},
+            {"counts", hist.counts()},
+            {"underflow", hist.underflow()},
+            {"overflow", hist.overflow()},
+            {"approximate", false}
+        };
+    }
+
+    // Unknown range: bin [min, max] using the sketch's rank estimates
+    DatasetSummary summary = summarize(dataset, sketchSize(request));
+    double lower = summary.stats.min();
+    double upper = summary.stats.max();
+    return {
+        {"count", summary.stats.count()},
+        {"edges", edges(lower, upper)},
+        {"counts", approximateHistogram(summary.sketch, lower, upper, binCount)},
+        {"approximate", summary.sketch.retained() < summary.sketch.count()}
+    };
+}
+
+// Time-series operations run over the numeric entries in order, skipping the
+// rest as stats does. The rolling ones report one value per full window, the
+// window ending at each entry from the window-th on, and are computed in one
+// pass with O(1) amortized work per entry.
+enum class Rolling { Average, Min, Max, Variance };
+
+template <Rolling kind>
+json rolling(const json& request, const json& dataset) {
+    std::size_t window = integerOption(request, "window", kDefaultWindow, 1, kMaxWindow);
+    bool sample = false;
+    if (kind == Rolling::Variance && request.contains("sample")) {
+        if (!request["sample"].is_boolean()) {
+            throw std::invalid_argument("sample must be true or false");
+        }
+        sample = request["sample"].get<bool>();
+    }
+    if (dataset.empty()) {
+        throw std::invalid_argument("Dataset cannot be empty");
+    }
+
+    RollingStats stats(kind == Rolling::Average || kind == Rolling::Variance ? window : 1);
+    RollingExtremes extremes(kind == Rolling::Min || kind == Rolling::Max ? window : 1);
+    // Extremes of integral data stay integers, as in the other operations
+    bool integral = std::none_of(dataset.begin(), dataset.end(), [](const json& value) { return value.is_number_float(); });
+    std::size_t count = 0;
+    json values = json::array();
+    for (const auto& value : dataset) {
+        if (!isNumber(value)) {
+            continue;
+        }
+        double number = asDouble(value);
+        ++count;
+        if constexpr (kind == Rolling::Min || kind == Rolling::Max) {
+            extremes.add(number);
+            if (count >= window) {
+                values.push_back(numberValue(kind == Rolling::Min ? extremes.min() : extremes.max(), integral));
+            }
+        } else {
+            stats.add(number);
+            if (stats.full()) {
+                values.push_back(kind == Rolling::Average ? stats.mean() : sample ? stats.sampleVariance() : stats.variance());
+            }
+        }
+    }
+    if (count == 0) {
+        throw std::invalid_argument("Dataset must contain numeric values");
+    }
+    return {
+        {"window", window},
+        {"values", std::move(values)}
+    };
+}
+
+// s[0] = x[0], s[i] = alpha * x[i] + (1 - alpha) * s[i - 1]
+json exponentialSmoothing(const json& request, const json& dataset) {
+    double alpha = 0.5;
+    if (request.contains("alpha")) {
+        const auto& value = request["alpha"];
+        if (!value.is_number() || !(value.get<double>() > 0.0) || value.get<double>() > 1.0) {
+            throw std::invalid_argument("alpha must be a number in (0, 1]");
+        }
+        alpha = value.get<double>();
+    }
+    if (dataset.empty()) {
+        throw std::invalid_argument("Dataset cannot be empty");
+    }
+
+    json values = json::array();
+    double smoothed = 0.0;
+    for (const auto& value : dataset) {
+        if (!isNumber(value)) {
+            continue;
+        }
+        double number = asDouble(value);
+        smoothed = values.empty() ? number : alpha * number + (1.0 - alpha) * smoothed;
+        values.push_back(smoothed);
+    }
+    if (values.empty()) {
+        throw std::invalid_argument("Dataset must contain numeric values");
+    }
+    return {
+        {"alpha", alpha},
+        {"values", std::move(values)}
+    };
+}
+
+} // namespace
+
+std::optional<json> computeDataOperation(std::string_view operation, const json& options, DatasetView dataset) {
+    if (operation == "extended_stats") {
+        return extendedStats(options, dataset);
+    }
+    if (operation == "quantiles") {
+        return quantiles(options, dataset);
+    }
+    if (operation == "histogram") {
+        return histogram(options, dataset);
+    }
+    return std::nullopt;
+}
+
+// Integers stay integers, as they would in Python
+json numberValue(double value, bool integral) {
+    if (integral && std::abs(value) < 9007199254740992.0) {
+        return static_cast<std::int64_t>(value);
+    }
+    return value;
+}
+
+json describeStats(const RunningStats& stats, const KllSketch& sketch, bool integral) {
+    return {
+        {"count", stats.count()},
+        {"sum", numberValue(stats.sum(), integral)},
+        {"mean", stats.mean()},
+        {"min", numberValue(stats.min(), integral)},
+        {"max", numberValue(stats.max(), integral)},
+        {"range", numberValue(stats.max() - stats.min(), integral)},
+        {"variance", stats.variance()},
+        {"sample_variance", stats.sampleVariance()},
+        {"stddev", stats.stddev()},
+        {"p50", numberValue(sketch.quantile(0.50), integral)},
+        {"p90", numberValue(sketch.quantile(0.90), integral)},
+        {"p99", numberValue(sketch.quantile(0.99), integral)},
+        {"approximate", sketch.retained() < sketch.count()}
+    };
+}
+
+std::size_t integerOption(const json& request, const char* name, std::size_t fallback, std::size_t lowest, std::size_t highest) {
+    if (!request.contains(name)) {
+        return fallback;
+    }
+    const auto& value = request[name];
+    if (!value.is_number_integer() || value.get<std::int64_t>() < static_cast<std::int64_t>(lowest)
+        || value.get<std::int64_t>() > static_cast<std::int64_t>(highest)) {
+        throw std::invalid_argument(fmt::format("{} must be an integer between {} and {}", name, lowest, highest));
+    }
+    return value.get<std::size_t>();
+}
+
+Handler dataHandler(std::string operation, DataOperation compute) {
+    return [operation = std::move(operation), compute](const json& request) {
+        const json empty = json::array();
+        const json& dataset = request.contains("dataset") ? request["dataset"] : empty;
+        if (!dataset.is_array()) {
+            return errorResponse("Dataset array is required for data operations");
+        }
+
+        try {
+            // The dataset is deliberately not echoed back: these operations are
+            // meant for inputs too large to want a second copy of
+            json response = {
+                {"success", true},
+                {"result", compute(request, dataset)},
+                {"operation", operation},
+                {"timestamp", kTimestamp}
+            };
+            return dumpPythonStyle(response);
+        } catch (const std::exception& e) {
+            return errorResponse(std::string("Data operation failed: ") + e.what());
+        }
+    };
+}
+
+void registerDataHandlers(HandlerRegistry& registry) {
+    registry.add("data", "extended_stats", dataHandler("extended_stats", extendedStats<json>));
+    registry.add("data", "quantiles", dataHandler("quantiles", quantiles<json>));
+    registry.add("data", "histogram", dataHandler("histogram", histogram<json>));
+    registry.add("data", "moving_average", dataHandler("moving_average", rolling<Rolling::Average>));
+    registry.add("data", "rolling_min", dataHandler("rolling_min", rolling<Rolling::Min>));
+    registry.add("data", "rolling_max", dataHandler("rolling_max", rolling<Rolling::Max>));
+    registry.add("data", "rolling_variance", dataHandler("rolling_variance", rolling<Rolling::Variance>));
+    registry.add("data", "exponential_smoothing", dataHandler("exponential_smoothing", exponentialSmoothing));
+}
+
+} // namespace native
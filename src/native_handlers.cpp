@@ -0,0 +1,268 @@
+#include "native_handlers.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace native {
+
+namespace {
+
+void appendEscapedString(std::string& out, const std::string& value) {
+    static constexpr char hex[] = "0123456789abcdef";
+    auto appendUnit = [&](std::uint32_t unit) {
+        out += "\\u";
+        out += hex[(unit >> 12) & 0xF];
+        out += hex[(unit >> 8) & 0xF];
+        out += hex[(unit >> 4) & 0xF];
+        out += hex[unit & 0xF];
+    };
+
+    out.reserve(out.size() + value.size() + 2);
+    out += '"';
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        // Copy runs of characters that need no escaping in one go
+        std::size_t run = i;
+        while (run < value.size() && value[run] >= 0x20 && value[run] < 0x7F && value[run] != '"' && value[run] != '\\') {
+            ++run;
+        }
+        if (run > i) {
+            out.append(value, i, run - i);
+            i = run;
+            if (i == value.size()) {
+                break;
+            }
+        }
+
+        auto byte = static_cast<unsigned char>(value[i]);
+        switch (byte) {
+            case '"': out += "\\\""; continue;
+            case '\\': out += "\\\\"; continue;
+            case '\n': out += "\\n"; continue;
+            case '\r': out += "\\r"; continue;
+            case '\t': out += "\\t"; continue;
+            case '\b': out += "\\b"; continue;
+            case '\f': out += "\\f"; continue;
+            default: break;
+        }
+        if (byte >= 0x20 && byte < 0x7F) {
+            out += static_cast<char>(byte);
+            continue;
+        }
+        if (byte < 0x80) {
+            appendUnit(byte);
+            continue;
+        }
+
+        // ensure_ascii: decode the UTF-8 sequence and emit \u escapes
+        std::size_t length = byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : 2;
+        std::uint32_t codePoint = byte & (0x3F >> (length - 1));
+        for (std::size_t j = 1; j < length && i + j < value.size(); ++j) {
+            codePoint = (codePoint << 6) | (static_cast<unsigned char>(value[i + j]) & 0x3F);
+        }
+        i += length - 1;
+        if (codePoint >= 0x10000) {
+            codePoint -= 0x10000;
+            appendUnit(0xD800 + (codePoint >> 10));
+            appendUnit(0xDC00 + (codePoint & 0x3FF));
+        } else {
+            appendUnit(codePoint);
+        }
+    }
+    out += '"';
+}
+
+// Python's repr(float): the shortest digits that round-trip, positional while
+// the decimal point falls within -4 < exponent <= 16 (with ".0" for whole
+// numbers), scientific with a signed two-digit exponent otherwise
+void appendPythonFloat(std::string& out, double number) {
+    char buffer[32];
+    char* end = std::to_chars(buffer, buffer + sizeof(buffer), number, std::chars_format::scientific).ptr;
+    std::string_view text(buffer, static_cast<std::size_t>(end - buffer));
+    if (text.front() == '-') {
+        out += '-';
+        text.remove_prefix(1);
+    }
+    std::size_t e = text.find('e');
+    std::string digits;
+    for (char c : text.substr(0, e)) {
+        if (c != '.') {
+            digits += c;
+        }
+    }
+    int exponent = 0;
+    std::string_view exponentText = text.substr(e + 1);
+    if (exponentText.front() == '+') {
+        exponentText.remove_prefix(1);
+    }
+    std::from_chars(exponentText.data(), exponentText.data() + exponentText.size(), exponent);
+
+    // Digits before the decimal point
+    int point = exponent + 1;
+    auto length = static_cast<int>(digits.size());
+    if (point > -4 && point <= 16) {
+        if (point <= 0) {
+            out += "0.";
+            out.append(static_cast<std::size_t>(-point), '0');
+            out += digits;
+        } else if (point >= length) {
+            out += digits;
+            out.append(static_cast<std::size_t>(point - length), '0');
+            out += ".0";
+        } else {
+            out.append(digits, 0, static_cast<std::size_t>(point));
+            out += '.';
+            out.append(digits, static_cast<std::size_t>(point));
+        }
+        return;
+    }
+    out += digits[0];
+    if (length > 1) {
+        out += '.';
+        out.append(digits, 1);
+    }
+    out += exponent < 0 ? "e-" : "e+";
+    int magnitude = std::abs(exponent);
+    if (magnitude < 10) {
+        out += '0';
+    }
+    out += std::to_string(magnitude);
+}
+
+void appendPythonStyle(std::string& out, const json& value) {
+    switch (value.type()) {
+        case json::value_t::object: {
+            out += '{';
+            bool first = true;
+            for (const auto& [key, item] : value.items()) {
+                if (!first) {
+                    out += ", ";
+                }
+                first = false;
+                appendEscapedString(out, key);
+                out += ": ";
+                appendPythonStyle(out, item);
+            }
+            out += '}';
+            break;
+        }
+        case json::value_t::array: {
+            out += '[';
+            bool first = true;
+            for (const auto& item : value) {
+                if (!first) {
+                    out += ", ";
+                }
+                first = false;
+                appendPythonStyle(out, item);
+            }
+            out += ']';
+            break;
+        }
+        case json::value_t::string:
+            appendEscapedString(out, value.get_ref<const std::string&>());
+            break;
+        case json::value_t::number_float: {
+            double number = value.get<double>();
+            if (std::isnan(number)) {
+                out += "NaN";
+            } else if (std::isinf(number)) {
+                out += number > 0 ? "Infinity" : "-Infinity";
+            } else {
+                appendPythonFloat(out, number);
+            }
+            break;
+        }
+        default:
+            out += value.dump();
+            break;
+    }
+}
+
+} // namespace
+
+void HandlerRegistry::add(std::string type, std::string operation, Handler handler) {
+    handlers[std::move(type)][std::move(operation)] = std::move(handler);
+}
+
+const Handler* HandlerRegistry::find(std::string_view type, std::string_view operation) const {
+    auto byType = handlers.find(type);
+    if (byType == handlers.end()) {
+        return nullptr;
+    }
+    auto byOperation = byType->second.find(operation);
+    if (byOperation == byType->second.end()) {
+        return nullptr;
+    }
+    return &byOperation->second;
+}
+
+void registerBuiltinHandlers(HandlerRegistry& registry) {
+    registerDataHandlers(registry);
+    registerMatrixHandlers(registry);
+    registerPipelineHandlers(registry);
+    registerSessionHandlers(registry);
+    registerTextHandlers(registry);
+}
+
+std::string dumpPythonStyle(const json& value) {
+    std::string out;
+    appendPythonStyle(out, value);
+    return out;
+}
+
+std::string errorResponse(std::string_view message) {
+    json response = {
+        {"success", false},
+        {"error", message},
+        {"timestamp", kTimestamp}
+    };
+    return dumpPythonStyle(response);
+}
+
+std::size_t heapBytes(const json& value) {
+    static const std::size_t inlineCapacity = std::string().capacity();
+    auto stringBytes = [](const std::string& text) {
+        return text.capacity() > inlineCapacity ? text.capacity() + 1 : 0;
+    };
+    // Walked with a stack of its own, since documents can nest deeper than the call stack allows
+    std::size_t bytes = 0;
+    std::vector<const json*> pending{&value};
+    while (!pending.empty()) {
+        const json* current = pending.back();
+        pending.pop_back();
+        if (current->is_object()) {
+            const auto& object = current->get_ref<const json::object_t&>();
+            bytes += sizeof(json::object_t) + object.capacity() * sizeof(json::object_t::value_type);
+            for (const auto& [key, member] : object) {
+                bytes += stringBytes(key);
+                pending.push_back(&member);
+            }
+        } else if (current->is_array()) {
+            const auto& array = current->get_ref<const json::array_t&>();
+            bytes += sizeof(json::array_t) + array.capacity() * sizeof(json);
+            for (const auto& item : array) {
+                pending.push_back(&item);
+            }
+        } else if (current->is_string()) {
+            bytes += sizeof(json::string_t) + stringBytes(current->get_ref<const json::string_t&>());
+        } else if (current->is_binary()) {
+            bytes += sizeof(json::binary_t) + current->get_binary().capacity();
+        }
+    }
+    return bytes;
+}
+
+bool isNumber(const json& value) {
+    return value.is_number() || value.is_boolean();
+}
+
+double asDouble(const json& value) {
+    if (value.is_boolean()) {
+        return value.get<bool>() ? 1.0 : 0.0;
+    }
+    return value.get<double>();
+}
+
+} // namespace native
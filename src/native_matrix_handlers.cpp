@@ -0,0 +1,194 @@
+#include "native_handlers.h"
+#include "matrix_kernels.h"
+
+#include <fmt/format.h>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The "matrix" request type, served only natively. Matrices are arrays of
+// equal-length numeric rows, e.g.
+//
+//     {"type": "matrix", "operation": "multiply", "a": [[1, 2], [3, 4]], "b": [[5], [6]]}
+//
+//   multiply    "a" times "b"
+//   transpose   "matrix" transposed
+//   dot         dot product of the vectors "a" and "b"
+//   reduce      "reduction" (sum, mean, min or max, default sum) of each row
+//               of "matrix", or of each column with "axis": "columns"
+//
+// Responses follow the data handlers: the inputs are not echoed back and
+// results of integral inputs stay integers. Matrix results add their "shape".
+
+namespace native {
+
+namespace {
+
+// The request's matrix converted to doubles, and whether every entry was integral
+struct Operand {
+    matrix::Matrix values;
+    bool integral = true;
+};
+
+Operand readMatrix(const json& request, const char* name) {
+    auto invalid = [name] {
+        return std::invalid_argument(fmt::format("{} must be a non-empty array of equal-length numeric rows", name));
+    };
+    if (!request.contains(name) || !request[name].is_array() || request[name].empty()) {
+        throw invalid();
+    }
+    const json& rows = request[name];
+    if (!rows[0].is_array() || rows[0].empty()) {
+        throw invalid();
+    }
+
+    Operand operand{matrix::Matrix(rows.size(), rows[0].size())};
+    double* out = operand.values.values.data();
+    for (const auto& row : rows) {
+        if (!row.is_array() || row.size() != operand.values.cols) {
+            throw invalid();
+        }
+        for (const auto& value : row) {
+            if (!isNumber(value)) {
+                throw invalid();
+            }
+            operand.integral = operand.integral && !value.is_number_float();
+            *out++ = asDouble(value);
+        }
+    }
+    return operand;
+}
+
+Operand readVector(const json& request, const char* name) {
+    if (!request.contains(name) || !request[name].is_array() || request[name].empty()) {
+        throw std::invalid_argument(fmt::format("{} must be a non-empty array of numbers", name));
+    }
+    const json& values = request[name];
+    Operand operand{matrix::Matrix(1, values.size())};
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        if (!isNumber(values[i])) {
+            throw std::invalid_argument(fmt::format("{} must be a non-empty array of numbers", name));
+        }
+        operand.integral = operand.integral && !values[i].is_number_float();
+        operand.values.values[i] = asDouble(values[i]);
+    }
+    return operand;
+}
+
+// An optional string member; anything but a string reads as ""
+std::string stringOption(const json& request, const char* name, const char* fallback) {
+    if (!request.contains(name)) {
+        return fallback;
+    }
+    return request[name].is_string() ? request[name].get<std::string>() : std::string();
+}
+
+json matrixValue(const matrix::Matrix& m, bool integral) {
+    json rows = json::array();
+    for (std::size_t i = 0; i < m.rows; ++i) {
+        json row = json::array();
+        for (double value : m.row(i)) {
+            row.push_back(numberValue(value, integral));
+        }
+        rows.push_back(std::move(row));
+    }
+    return rows;
+}
+
+// The "result" of an operation and, for matrix results, their shape
+struct MatrixResult {
+    json result;
+    std::optional<std::pair<std::size_t, std::size_t>> shape;
+};
+
+MatrixResult matrixResult(const matrix::Matrix& m, bool integral) {
+    return {matrixValue(m, integral), std::pair(m.rows, m.cols)};
+}
+
+MatrixResult multiply(const json& request) {
+    Operand a = readMatrix(request, "a");
+    Operand b = readMatrix(request, "b");
+    if (a.values.cols != b.values.rows) {
+        throw std::invalid_argument(fmt::format("Cannot multiply a {}x{} matrix by a {}x{} matrix",
+            a.values.rows, a.values.cols, b.values.rows, b.values.cols));
+    }
+    return matrixResult(matrix::multiply(a.values, b.values), a.integral && b.integral);
+}
+
+MatrixResult transpose(const json& request) {
+    Operand m = readMatrix(request, "matrix");
+    return matrixResult(matrix::transpose(m.values), m.integral);
+}
+
+MatrixResult dot(const json& request) {
+    Operand a = readVector(request, "a");
+    Operand b = readVector(request, "b");
+    if (a.values.cols != b.values.cols) {
+        throw std::invalid_argument(fmt::format("Vectors differ in length: {} and {}", a.values.cols, b.values.cols));
+    }
+    return {numberValue(matrix::dot(a.values.row(0), b.values.row(0)), a.integral && b.integral), std::nullopt};
+}
+
+MatrixResult reduce(const json& request) {
+    Operand m = readMatrix(request, "matrix");
+
+    std::string axis = stringOption(request, "axis", "rows");
+    if (axis != "rows" && axis != "columns") {
+        throw std::invalid_argument("axis must be \"rows\" or \"columns\"");
+    }
+    std::string name = stringOption(request, "reduction", "sum");
+    matrix::Reduction reduction;
+    if (name == "sum") {
+        reduction = matrix::Reduction::Sum;
+    } else if (name == "mean") {
+        reduction = matrix::Reduction::Mean;
+    } else if (name == "min") {
+        reduction = matrix::Reduction::Min;
+    } else if (name == "max") {
+        reduction = matrix::Reduction::Max;
+    } else {
+        throw std::invalid_argument("reduction must be one of sum, mean, min, max");
+    }
+
+    bool integral = m.integral && reduction != matrix::Reduction::Mean;
+    json result = json::array();
+    for (double value : matrix::reduce(m.values, axis == "rows" ? matrix::Axis::Rows : matrix::Axis::Columns, reduction)) {
+        result.push_back(numberValue(value, integral));
+    }
+    return {std::move(result), std::nullopt};
+}
+
+using MatrixOperation = MatrixResult (*)(const json& request);
+
+Handler matrixHandler(std::string operation, MatrixOperation compute) {
+    return [operation = std::move(operation), compute](const json& request) {
+        try {
+            MatrixResult computed = compute(request);
+            json response = {
+                {"success", true},
+                {"result", std::move(computed.result)},
+                {"operation", operation}
+            };
+            if (computed.shape) {
+                response["shape"] = {computed.shape->first, computed.shape->second};
+            }
+            response["timestamp"] = kTimestamp;
+            return dumpPythonStyle(response);
+        } catch (const std::exception& e) {
+            return errorResponse(std::string("Matrix operation failed: ") + e.what());
+        }
+    };
+}
+
+} // namespace
+
+void registerMatrixHandlers(HandlerRegistry& registry) {
+    registry.add("matrix", "multiply", matrixHandler("multiply", multiply));
+    registry.add("matrix", "transpose", matrixHandler("transpose", transpose));
+    registry.add("matrix", "dot", matrixHandler("dot", dot));
+    registry.add("matrix", "reduce", matrixHandler("reduce", reduce));
+}
+
+} // namespace native
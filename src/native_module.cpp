@@ -0,0 +1,288 @@
+#include "native_module.h"
+#include "matrix_kernels.h"
+#include "regex_engine.h"
+#include "text_kernels.h"
+
+#include <boost/python.hpp>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace bp = boost::python;
+
+namespace {
+
+// Lets other threads run Python for the lifetime of the guard; the arguments
+// being worked on stay alive through the caller's references
+class GilRelease {
+public:
+    GilRelease() : state(PyEval_SaveThread()) {}
+    ~GilRelease() { PyEval_RestoreThread(state); }
+
+    GilRelease(const GilRelease&) = delete;
+    GilRelease& operator=(const GilRelease&) = delete;
+
+private:
+    PyThreadState* state;
+};
+
+[[noreturn]] void throwPythonError(PyObject* type, const char* message) {
+    PyErr_SetString(type, message);
+    throw bp::error_already_set();
+}
+
+std::string sequenceMessage(const char* name) {
+    return std::string(name) + " must be a sequence of numbers";
+}
+
+// values as a list or tuple; other iterables are consumed into a new list, so
+// this must only be done once per argument
+bp::handle<> fastSequence(const bp::object& values, const std::string& message) {
+    return bp::handle<>(PySequence_Fast(values.ptr(), message.c_str()));
+}
+
+// A fast sequence of int, float or bool as a one-row matrix
+matrix::Matrix toRow(const bp::handle<>& fast, const std::string& message) {
+    auto size = static_cast<std::size_t>(PySequence_Fast_GET_SIZE(fast.get()));
+    PyObject** items = PySequence_Fast_ITEMS(fast.get());
+    matrix::Matrix row(1, size);
+    for (std::size_t i = 0; i < size; ++i) {
+        if (!PyFloat_Check(items[i]) && !PyLong_Check(items[i])) {
+            throwPythonError(PyExc_TypeError, message.c_str());
+        }
+        row.values[i] = PyFloat_AsDouble(items[i]);
+        if (row.values[i] == -1.0 && PyErr_Occurred()) {
+            bp::throw_error_already_set();
+        }
+    }
+    return row;
+}
+
+matrix::Matrix toRow(const bp::object& values, const char* name) {
+    std::string message = sequenceMessage(name);
+    return toRow(fastSequence(values, message), message);
+}
+
+double reduceValues(const bp::object& values, matrix::Reduction reduction, const char* emptyMessage) {
+    matrix::Matrix row = toRow(values, "values");
+    if (row.cols == 0) {
+        if (!emptyMessage) {
+            return 0.0;
+        }
+        throwPythonError(PyExc_ValueError, emptyMessage);
+    }
+    GilRelease unlocked;
+    return matrix::reduce(row, matrix::Axis::Rows, reduction)[0];
+}
+
+double sum(const bp::object& values) {
+    return reduceValues(values, matrix::Reduction::Sum, nullptr);
+}
+
+double mean(const bp::object& values) {
+    return reduceValues(values, matrix::Reduction::Mean, "mean of an empty sequence");
+}
+
+double minimum(const bp::object& values) {
+    return reduceValues(values, matrix::Reduction::Min, "min of an empty sequence");
+}
+
+double maximum(const bp::object& values) {
+    return reduceValues(values, matrix::Reduction::Max, "max of an empty sequence");
+}
+
+double dot(const bp::object& a, const bp::object& b) {
+    matrix::Matrix left = toRow(a, "a");
+    matrix::Matrix right = toRow(b, "b");
+    if (left.cols != right.cols) {
+        throwPythonError(PyExc_ValueError, "a and b differ in length");
+    }
+    GilRelease unlocked;
+    return matrix::dot(left.row(0), right.row(0));
+}
+
+// The same objects in ascending order, compared as doubles. Stable, with NaNs last.
+bp::list sort(const bp::object& values) {
+    std::string message = sequenceMessage("values");
+    bp::handle<> fast = fastSequence(values, message);
+    matrix::Matrix keys = toRow(fast, message);
+    std::vector<std::size_t> order(keys.cols);
+    {
+        GilRelease unlocked;
+        for (std::size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            double x = keys.values[a], y = keys.values[b];
+            return std::isnan(x) ? false : std::isnan(y) || x < y;
+        });
+    }
+
+    PyObject** items = PySequence_Fast_ITEMS(fast.get());
+    bp::list sorted;
+    for (std::size_t index : order) {
+        sorted.append(bp::object(bp::handle<>(bp::borrowed(items[index]))));
+    }
+    return sorted;
+}
+
+std::string_view utf8View(const bp::object& text) {
+    if (!PyUnicode_Check(text.ptr())) {
+        throwPythonError(PyExc_TypeError, "text must be a str");
+    }
+    Py_ssize_t size = 0;
+    const char* data = PyUnicode_AsUTF8AndSize(text.ptr(), &size);
+    if (!data) {
+        bp::throw_error_already_set();
+    }
+    return {data, static_cast<std::size_t>(size)};
+}
+
+bp::object toStr(const std::string& text) {
+    return bp::object(bp::handle<>(PyUnicode_FromStringAndSize(text.data(), static_cast<Py_ssize_t>(text.size()))));
+}
+
+// ASCII text is mapped natively, anything else by str's own method
+bp::object mapCase(const bp::object& text, bool upper) {
+    std::string_view view = utf8View(text);
+    std::optional<std::string> mapped;
+    {
+        GilRelease unlocked;
+        mapped = upper ? utf8::toUpperAscii(view) : utf8::toLowerAscii(view);
+    }
+    if (!mapped) {
+        return text.attr(upper ? "upper" : "lower")();
+    }
+    return toStr(*mapped);
+}
+
+bp::object upper(const bp::object& text) {
+    return mapCase(text, true);
+}
+
+bp::object lower(const bp::object& text) {
+    return mapCase(text, false);
+}
+
+std::size_t wordCount(const bp::object& text) {
+    std::string_view view = utf8View(text);
+    GilRelease unlocked;
+    return utf8::countWords(view);
+}
+
+bp::object reverseGraphemes(const bp::object& text) {
+    std::string_view view = utf8View(text);
+    std::string reversed;
+    {
+        GilRelease unlocked;
+        reversed = utf8::reverseGraphemes(view);
+    }
+    return toStr(reversed);
+}
+
+// The linear-time regex engine for processor.py's "engine": "linear", so that
+// option never falls back to re. Malformed patterns raise ValueError, searches
+// that run out of steps RuntimeError, with the messages the native handlers use.
+regex::PatternCache& patternCache() {
+    static regex::PatternCache cache;
+    return cache;
+}
+
+std::shared_ptr<const regex::Pattern> compileLinear(const bp::object& pattern, const bp::object& flags) {
+    regex::Flags parsed;
+    for (char flag : utf8View(flags)) {
+        switch (flag) {
+            case 'i': parsed.ignoreCase = true; break;
+            case 'm': parsed.multiline = true; break;
+            case 's': parsed.dotAll = true; break;
+            default: throw std::invalid_argument(std::string("Unknown regex flag: ") + flag);
+        }
+    }
+    std::string_view source = utf8View(pattern);
+    GilRelease unlocked;
+    return patternCache().get(source, parsed);
+}
+
+bp::list regexFindAll(const bp::object& pattern, const bp::object& flags, const bp::object& text) {
+    auto compiled = compileLinear(pattern, flags);
+    std::string_view view = utf8View(text);
+    std::vector<regex::Match> matches;
+    {
+        GilRelease unlocked;
+        matches = compiled->findAll(view);
+    }
+    bp::list found;
+    for (const auto& match : matches) {
+        found.append(toStr(std::string(view.substr(match.begin(), match.end() - match.begin()))));
+    }
+    return found;
+}
+
+std::size_t regexCountMatches(const bp::object& pattern, const bp::object& flags, const bp::object& text) {
+    auto compiled = compileLinear(pattern, flags);
+    std::string_view view = utf8View(text);
+    GilRelease unlocked;
+    return compiled->countMatches(view);
+}
+
+bp::object regexReplace(const bp::object& pattern, const bp::object& flags, const bp::object& text,
+    const bp::object& replacement, std::size_t count) {
+    auto compiled = compileLinear(pattern, flags);
+    std::string_view view = utf8View(text);
+    std::string_view with = utf8View(replacement);
+    std::string replaced;
+    {
+        GilRelease unlocked;
+        replaced = compiled->replace(view, with, count);
+    }
+    return toStr(replaced);
+}
+
+} // namespace
+
+BOOST_PYTHON_MODULE(cppideas_native)
+{
+    bp::scope().attr("__doc__") = "Native kernels from python_processor_lib. The GIL is released while they run.";
+
+    bp::def("sum", sum, bp::arg("values"), "Sum of a sequence of numbers, as a float (SIMD)");
+    bp::def("mean", mean, bp::arg("values"), "Arithmetic mean of a non-empty sequence of numbers (SIMD)");
+    bp::def("min", minimum, bp::arg("values"), "Smallest number in a non-empty sequence, as a float");
+    bp::def("max", maximum, bp::arg("values"), "Largest number in a non-empty sequence, as a float");
+    bp::def("dot", dot, (bp::arg("a"), bp::arg("b")), "Dot product of two sequences of numbers of equal length (SIMD)");
+    bp::def("sort", sort, bp::arg("values"),
+        "New list of the numbers in ascending order, compared as floats; stable, with NaNs last");
+
+    bp::def("upper", upper, bp::arg("text"), "str.upper(), mapped natively for ASCII text");
+    bp::def("lower", lower, bp::arg("text"), "str.lower(), mapped natively for ASCII text");
+    bp::def("word_count", wordCount, bp::arg("text"), "len(text.split())");
+    bp::def("reverse_graphemes", reverseGraphemes, bp::arg("text"),
+        "text reversed by user-perceived characters, keeping combining marks and emoji sequences intact");
+
+    bp::def("regex_find_all", regexFindAll, (bp::arg("pattern"), bp::arg("flags"), bp::arg("text")),
+        "Every non-overlapping match of pattern, as re.findall without groups, matched in linear time");
+    bp::def("regex_count_matches", regexCountMatches, (bp::arg("pattern"), bp::arg("flags"), bp::arg("text")),
+        "Number of non-overlapping matches of pattern, matched in linear time");
+    bp::def("regex_replace", regexReplace,
+        (bp::arg("pattern"), bp::arg("flags"), bp::arg("text"), bp::arg("replacement"), bp::arg("count")),
+        "re.sub(pattern, replacement, text, count), matched in linear time");
+}
+
+bool installNativeModule() {
+    PyObject* modules = PyImport_GetModuleDict();
+    if (PyDict_GetItemString(modules, "cppideas_native")) {
+        return true;
+    }
+    PyObject* module = PyInit_cppideas_native();
+    if (!module) {
+        return false;
+    }
+    int stored = PyDict_SetItemString(modules, "cppideas_native", module);
+    Py_DECREF(module);
+    return stored == 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <Python.h>
+
+// The cppideas_native extension module: matrix_kernels and text_kernels for
+// Python code (processor.py handlers, or any script once the module is built
+// as an extension). Its functions convert their arguments with the GIL held
+// and release it while the kernel runs.
+
+// Module init function generated by BOOST_PYTHON_MODULE
+extern "C" PyObject* PyInit_cppideas_native();
+
+// Makes "import cppideas_native" work in this interpreter without the
+// extension module on sys.path. Returns false with a Python error set on
+// failure; the GIL must be held.
+bool installNativeModule();
@@ -0,0 +1,404 @@
+#include "native_handlers.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fmt/format.h>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+// The "pipeline" request type: a dataset run through a list of data stages in
+// one call, e.g.
+//
+//     {"type": "pipeline", "dataset": [...], "stages": ["filter_numbers", "sort", "stats"]}
+//
+// Stages are operation names or objects such as {"operation": "quantiles",
+// "quantiles": [0.5]} carrying that operation's options. Intermediate results
+// are pointers into the parsed request rather than JSON arrays. Adjacent
+// stages that can share a pass run as one step:
+//
+//   filter_numbers + sort     sorts without checking types
+//   sort + unique             drops neighbouring duplicates instead of hashing
+//   filter_numbers + unique   filters and deduplicates in one pass
+//   filter_numbers + a summary (stats, extended_stats, quantiles, histogram)
+//                             summarizes the unfiltered input, which skips
+//                             non-numeric entries anyway
+//   a repeated filter_numbers, sort or unique is a no-op
+//
+// The response lists the steps with the stages each covered and its time.
+// Unlike processor.py's unique, which returns set order, unique keeps first
+// occurrences in order; sort orders numbers or strings.
+
+namespace native {
+
+namespace {
+
+using Items = std::vector<const json*>;
+
+enum class Stage { FilterNumbers, Sort, Unique, Stats, ExtendedStats, Quantiles, Histogram };
+
+constexpr std::array<const char*, 7> kStageNames = {
+    "filter_numbers", "sort", "unique", "stats", "extended_stats", "quantiles", "histogram"};
+
+bool isSummary(Stage stage) {
+    return stage >= Stage::Stats;
+}
+
+struct StageRequest {
+    Stage stage;
+    const json* options;        // the stage object, or the whole request for a bare name
+};
+
+// Stages that run together in one pass
+struct Step {
+    bool filter = false;
+    bool sort = false;
+    bool unique = false;
+    std::optional<StageRequest> summary;
+    std::vector<std::size_t> stages;    // indices into the request's stages
+};
+
+const char* pythonTypeName(const json& value) {
+    switch (value.type()) {
+        case json::value_t::boolean: return "bool";
+        case json::value_t::number_integer:
+        case json::value_t::number_unsigned: return "int";
+        case json::value_t::number_float: return "float";
+        case json::value_t::string: return "str";
+        case json::value_t::array: return "list";
+        case json::value_t::object: return "dict";
+        default: return "NoneType";
+    }
+}
+
+std::vector<StageRequest> parseStages(const json& request, const json& stages) {
+    std::vector<StageRequest> parsed;
+    for (const auto& stage : stages) {
+        const json* options = &request;
+        const json* name = &stage;
+        if (stage.is_object()) {
+            options = &stage;
+            name = stage.contains("operation") ? &stage["operation"] : nullptr;
+        }
+        if (!name || !name->is_string()) {
+            throw std::invalid_argument("Pipeline stages must be operation names or objects with an \"operation\"");
+        }
+        const auto& operation = name->get_ref<const std::string&>();
+        auto found = std::find(kStageNames.begin(), kStageNames.end(), operation);
+        if (found == kStageNames.end()) {
+            throw std::invalid_argument("Unknown pipeline stage: " + operation);
+        }
+        if (!parsed.empty() && isSummary(parsed.back().stage)) {
+            throw std::invalid_argument(fmt::format("{} must be the last stage", kStageNames[static_cast<std::size_t>(parsed.back().stage)]));
+        }
+        parsed.push_back({static_cast<Stage>(found - kStageNames.begin()), options});
+    }
+    return parsed;
+}
+
+// Greedily merges each stage into the current step when the two can share a pass
+std::vector<Step> fuse(const std::vector<StageRequest>& stages) {
+    std::vector<Step> steps;
+    for (std::size_t i = 0; i < stages.size(); ++i) {
+        Stage stage = stages[i].stage;
+        Step* current = steps.empty() ? nullptr : &steps.back();
+        bool joins = false;
+        if (current && !current->summary) {
+            bool onlyFilter = current->filter && !current->sort && !current->unique;
+            switch (stage) {
+                case Stage::FilterNumbers: joins = current->filter && !current->sort && !current->unique; break;
+                case Stage::Sort: joins = (current->filter || current->sort) && !current->unique; break;
+                case Stage::Unique: joins = true; break;
+                default: joins = onlyFilter; break;
+            }
+        }
+        if (!joins) {
+            steps.emplace_back();
+            current = &steps.back();
+        }
+        switch (stage) {
+            case Stage::FilterNumbers: current->filter = true; break;
+            case Stage::Sort: current->sort = true; break;
+            case Stage::Unique: current->unique = true; break;
+            default: current->summary = stages[i]; break;
+        }
+        current->stages.push_back(i);
+    }
+    return steps;
+}
+
+// bool counts as an integer, as in Python
+bool isInteger(const json& value) {
+    return value.is_boolean() || value.is_number_integer();
+}
+
+bool isNegative(const json& value) {
+    return value.is_number_integer() && !value.is_number_unsigned() && value.get<std::int64_t>() < 0;
+}
+
+// Exact comparison of two integers across nlohmann's signed and unsigned storage
+int compareIntegers(const json& a, const json& b) {
+    bool aNegative = isNegative(a);
+    if (aNegative != isNegative(b)) {
+        return aNegative ? -1 : 1;
+    }
+    if (aNegative) {
+        auto x = a.get<std::int64_t>(), y = b.get<std::int64_t>();
+        return (x > y) - (x < y);
+    }
+    auto magnitude = [](const json& v) { return v.is_boolean() ? std::uint64_t{v.get<bool>()} : v.get<std::uint64_t>(); };
+    auto x = magnitude(a), y = magnitude(b);
+    return (x > y) - (x < y);
+}
+
+// Python's == for the values unique accepts: numbers by value (1 == 1.0 == True)
+bool sameValue(const json* a, const json* b) {
+    if (isNumber(*a) && isNumber(*b)) {
+        if (isInteger(*a) && isInteger(*b)) {
+            return compareIntegers(*a, *b) == 0;
+        }
+        return asDouble(*a) == asDouble(*b);
+    }
+    return a->type() == b->type() && *a == *b;
+}
+
+struct ValueHash {
+    std::size_t operator()(const json* value) const {
+        if (isNumber(*value)) {
+            double number = asDouble(*value);
+            return std::hash<double>{}(number == 0.0 ? 0.0 : number);
+        }
+        if (value->is_string()) {
+            return std::hash<std::string>{}(value->get_ref<const std::string&>());
+        }
+        return 0;
+    }
+};
+
+struct ValueEqual {
+    bool operator()(const json* a, const json* b) const { return sameValue(a, b); }
+};
+
+void requireHashable(const json& value) {
+    if (value.is_array() || value.is_object()) {
+        throw std::invalid_argument(fmt::format("unhashable type: '{}'", pythonTypeName(value)));
+    }
+}
+
+Items uniqueInOrder(const Items& items, bool numbersOnly) {
+    std::unordered_set<const json*, ValueHash, ValueEqual> seen;
+    seen.reserve(items.size());
+    Items kept;
+    for (const json* item : items) {
+        if (numbersOnly && !isNumber(*item)) {
+            continue;
+        }
+        requireHashable(*item);
+        if (seen.insert(item).second) {
+            kept.push_back(item);
+        }
+    }
+    return kept;
+}
+
+// Orders numbers by value, exactly between integers
+bool numberLess(const json* a, const json* b) {
+    if (isInteger(*a) && isInteger(*b)) {
+        return compareIntegers(*a, *b) < 0;
+    }
+    return asDouble(*a) < asDouble(*b);
+}
+
+void sortItems(Items& items, bool numeric) {
+    if (!numeric) {
+        bool strings = !items.empty() && items.front()->is_string();
+        for (const json* item : items) {
+            if (strings ? item->is_string() : isNumber(*item)) {
+                continue;
+            }
+            if (item->is_string() || isNumber(*item)) {
+                throw std::invalid_argument(fmt::format("'<' not supported between instances of '{}' and '{}'",
+                    pythonTypeName(*item), pythonTypeName(*items.front())));
+            }
+            throw std::invalid_argument(fmt::format("sort only orders numbers or strings, not '{}'", pythonTypeName(*item)));
+        }
+        if (strings) {
+            // UTF-8 byte order is code point order, as Python compares str
+            std::stable_sort(items.begin(), items.end(), [](const json* a, const json* b) {
+                return a->get_ref<const std::string&>() < b->get_ref<const std::string&>();
+            });
+            return;
+        }
+    }
+    std::stable_sort(items.begin(), items.end(), numberLess);
+}
+
+// processor.py's stats result; min and max are the original entries
+json stats(const Items& items, bool fusedFilter) {
+    if (items.empty()) {
+        throw std::invalid_argument("Dataset cannot be empty");
+    }
+    std::size_t count = 0;
+    bool integral = true;
+    std::int64_t integerSum = 0;
+    double sum = 0.0;
+    const json* lowest = nullptr;
+    const json* highest = nullptr;
+    for (const json* item : items) {
+        if (!isNumber(*item)) {
+            continue;
+        }
+        ++count;
+        sum += asDouble(*item);
+        // Integer sums stay exact until they leave the int64 range
+        bool fits = item->is_boolean() || isNegative(*item)
+            || (item->is_number_integer() && item->get<std::uint64_t>() <= INT64_MAX);
+        if (integral && fits) {
+            std::int64_t value = item->is_boolean() ? std::int64_t{item->get<bool>()} : item->get<std::int64_t>();
+            integral = value > 0 ? integerSum <= INT64_MAX - value : integerSum >= INT64_MIN - value;
+            integerSum += integral ? value : 0;
+        } else {
+            integral = false;
+        }
+        if (!lowest || numberLess(item, lowest)) {
+            lowest = item;
+        }
+        if (!highest || numberLess(highest, item)) {
+            highest = item;
+        }
+    }
+    if (count == 0) {
+        // Filtered first, the stage would have seen an empty dataset
+        throw std::invalid_argument(fusedFilter ? "Dataset cannot be empty" : "Dataset must contain numeric values");
+    }
+
+    bool integralRange = !lowest->is_number_float() && !highest->is_number_float();
+    return {
+        {"count", count},
+        {"sum", integral ? json(integerSum) : json(sum)},
+        {"mean", (integral ? static_cast<double>(integerSum) : sum) / static_cast<double>(count)},
+        {"min", *lowest},
+        {"max", *highest},
+        {"range", numberValue(asDouble(*highest) - asDouble(*lowest), integralRange)}
+    };
+}
+
+json summarize(const StageRequest& summary, const Items& items, bool fusedFilter) {
+    if (summary.stage == Stage::Stats) {
+        return stats(items, fusedFilter);
+    }
+    if (fusedFilter && !items.empty() && std::none_of(items.begin(), items.end(), [](const json* item) { return isNumber(*item); })) {
+        throw std::invalid_argument("Dataset cannot be empty");
+    }
+    return *computeDataOperation(kStageNames[static_cast<std::size_t>(summary.stage)], *summary.options, items);
+}
+
+// Runs a step over items in place, or returns its summary. running tracks the
+// stage being worked on, for error messages.
+std::optional<json> runStep(const Step& step, Items& items, Stage& running) {
+    if (step.summary) {
+        // A summary only ever shares its step with filter_numbers
+        running = step.summary->stage;
+        return summarize(*step.summary, items, step.filter);
+    }
+    if (step.filter && step.unique && !step.sort) {
+        running = Stage::Unique;
+        items = uniqueInOrder(items, true);
+        return std::nullopt;
+    }
+    if (step.filter) {
+        running = Stage::FilterNumbers;
+        std::erase_if(items, [](const json* item) { return !isNumber(*item); });
+    }
+    if (step.sort) {
+        running = Stage::Sort;
+        sortItems(items, step.filter);
+        if (step.unique) {
+            running = Stage::Unique;
+            for (const json* item : items) {
+                requireHashable(*item);
+            }
+            items.erase(std::unique(items.begin(), items.end(), sameValue), items.end());
+        }
+    } else if (step.unique) {
+        running = Stage::Unique;
+        items = uniqueInOrder(items, false);
+    }
+    return std::nullopt;
+}
+
+std::optional<std::string> pipeline(const json& request) {
+    const json empty = json::array();
+    const json& dataset = request.contains("dataset") ? request["dataset"] : empty;
+    if (!dataset.is_array()) {
+        return errorResponse("Dataset array is required for pipeline requests");
+    }
+    if (!request.contains("stages") || !request["stages"].is_array() || request["stages"].empty()) {
+        return errorResponse("Stages array is required for pipeline requests");
+    }
+    const json& stageList = request["stages"];
+
+    std::vector<StageRequest> stages;
+    try {
+        stages = parseStages(request, stageList);
+    } catch (const std::exception& e) {
+        return errorResponse(e.what());
+    }
+
+    Items items;
+    items.reserve(dataset.size());
+    for (const auto& value : dataset) {
+        items.push_back(&value);
+    }
+
+    json timings = json::array();
+    std::optional<json> result;
+    for (const Step& step : fuse(stages)) {
+        json names = json::array();
+        for (std::size_t index : step.stages) {
+            names.push_back(kStageNames[static_cast<std::size_t>(stages[index].stage)]);
+        }
+        auto start = std::chrono::steady_clock::now();
+        Stage running = stages[step.stages.front()].stage;
+        try {
+            result = runStep(step, items, running);
+        } catch (const std::exception& e) {
+            auto failed = std::find_if(step.stages.begin(), step.stages.end(),
+                [&](std::size_t index) { return stages[index].stage == running; });
+            return errorResponse(fmt::format("Pipeline stage {} ({}) failed: {}", *failed + 1,
+                kStageNames[static_cast<std::size_t>(running)], e.what()));
+        }
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        json timing = {{"stages", std::move(names)}, {"microseconds", elapsed.count()}};
+        if (!step.summary) {
+            timing["count"] = items.size();
+        }
+        timings.push_back(std::move(timing));
+    }
+
+    if (!result) {
+        result = json::array();
+        for (const json* item : items) {
+            result->push_back(*item);
+        }
+    }
+    json response = {
+        {"success", true},
+        {"result", std::move(*result)},
+        {"operation", "pipeline"},
+        {"stages", stageList},
+        {"timings", std::move(timings)},
+        {"timestamp", kTimestamp}
+    };
+    return dumpPythonStyle(response);
+}
+
+} // namespace
+
+void registerPipelineHandlers(HandlerRegistry& registry) {
+    registry.add("pipeline", "", pipeline);
+}
+
+} // namespace native
@@ -0,0 +1,288 @@
+#include "native_handlers.h"
+#include "streaming_stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fmt/format.h>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Incremental aggregation sessions. Instead of sending one huge dataset, a
+// client opens a session, appends the dataset in chunks with successive
+// requests and finalizes it to get the results:
+//
+//   {"type": "data", "operation": "session_open", "track": ["stats", "unique", "sort"]}
+//   {"type": "data", "operation": "session_append", "session_id": "...", "dataset": [...]}
+//   {"type": "data", "operation": "session_finalize", "session_id": "..."}
+//
+// Between calls only what the tracked results need is kept, in native form:
+// the running statistics and a quantile sketch for "stats", a hash set for
+// "unique" and flat value arrays for "sort". What those keep is capped per
+// session, and sessions left idle are dropped on the next request to any.
+
+namespace native {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t kMaxSessions = 64;
+constexpr auto kSessionIdleTimeout = std::chrono::minutes(10);
+// Values kept for "unique" and "sort", counted generously (no deduplication)
+constexpr std::size_t kMaxSessionBytes = std::size_t{256} << 20;
+
+struct AggregationSession {
+    std::mutex mutex;
+    bool trackStats = false;
+    bool trackUnique = false;
+    bool trackSort = false;
+    Clock::time_point lastUsed = Clock::now();
+    // Set once finalize has taken the values; requests that found the session
+    // before it was removed must not see it
+    bool finalized = false;
+
+    std::uint64_t values = 0;
+    std::size_t storedBytes = 0;
+    bool integral = true;
+    RunningStats stats;
+    KllSketch sketch;
+    std::unordered_set<double> uniqueNumbers;
+    std::unordered_set<std::string> uniqueStrings;
+    std::vector<double> numbers;
+    std::vector<std::string> strings;
+
+    // Entries unknown to the tracked results are rejected for sort/unique and
+    // skipped for stats, mirroring the one-shot operations
+    void append(const json& dataset) {
+        std::size_t copies = std::size_t{trackUnique} + std::size_t{trackSort};
+        std::size_t addedBytes = 0;
+        for (const auto& value : dataset) {
+            if (copies == 0) {
+                break;
+            }
+            if (value.is_string()) {
+                addedBytes += copies * (sizeof(std::string) + value.get_ref<const std::string&>().size());
+            } else if (isNumber(value)) {
+                addedBytes += copies * sizeof(double);
+            } else {
+                throw std::invalid_argument("Session datasets may only contain numbers and strings");
+            }
+        }
+        if (addedBytes > kMaxSessionBytes - storedBytes) {
+            throw std::invalid_argument(fmt::format("Session would exceed its size limit of {} bytes", kMaxSessionBytes));
+        }
+        storedBytes += addedBytes;
+        lastUsed = Clock::now();
+
+        for (const auto& value : dataset) {
+            ++values;
+            if (value.is_string()) {
+                const auto& text = value.get_ref<const std::string&>();
+                if (trackUnique) {
+                    uniqueStrings.insert(text);
+                }
+                if (trackSort) {
+                    strings.push_back(text);
+                }
+                continue;
+            }
+            if (!isNumber(value)) {
+                continue;
+            }
+            double number = asDouble(value);
+            integral = integral && !value.is_number_float();
+            if (trackStats) {
+                stats.add(number);
+                sketch.add(number);
+            }
+            if (trackUnique) {
+                uniqueNumbers.insert(number);
+            }
+            if (trackSort) {
+                numbers.push_back(number);
+            }
+        }
+    }
+
+    // Throws for a session finalize cannot answer, before anything is taken
+    void validate() const {
+        if (trackStats && stats.count() == 0) {
+            throw std::invalid_argument("Dataset must contain numeric values");
+        }
+        if (trackSort && !numbers.empty() && !strings.empty()) {
+            throw std::invalid_argument("'<' not supported between numbers and strings");
+        }
+    }
+
+    // Moves the stored values into the result; call validate first
+    json finalize() {
+        finalized = true;
+        json result = json::object();
+        result["count"] = values;
+        if (trackStats) {
+            result["stats"] = describeStats(stats, sketch, integral);
+        }
+        if (trackUnique) {
+            std::vector<double> sortedNumbers(uniqueNumbers.begin(), uniqueNumbers.end());
+            std::sort(sortedNumbers.begin(), sortedNumbers.end());
+            std::set<std::string> sortedStrings(uniqueStrings.begin(), uniqueStrings.end());
+            json unique = json::array();
+            for (double number : sortedNumbers) {
+                unique.push_back(numberValue(number, integral));
+            }
+            for (const auto& text : sortedStrings) {
+                unique.push_back(text);
+            }
+            result["unique"] = std::move(unique);
+        }
+        if (trackSort) {
+            // Numbers are kept as doubles, so they come back as integers only
+            // when every number appended to the session was an integer
+            std::sort(numbers.begin(), numbers.end());
+            std::sort(strings.begin(), strings.end());
+            json sorted = json::array();
+            for (double number : numbers) {
+                sorted.push_back(numberValue(number, integral));
+            }
+            for (auto& text : strings) {
+                sorted.push_back(std::move(text));
+            }
+            result["sort"] = std::move(sorted);
+        }
+        return result;
+    }
+};
+
+class SessionStore {
+public:
+    std::string open(bool stats, bool unique, bool sort) {
+        std::lock_guard<std::mutex> lock(mutex);
+        evictIdle();
+        if (sessions.size() >= kMaxSessions) {
+            throw std::runtime_error(fmt::format("Too many open sessions (limit {})", kMaxSessions));
+        }
+
+        auto session = std::make_shared<AggregationSession>();
+        session->trackStats = stats;
+        session->trackUnique = unique;
+        session->trackSort = sort;
+
+        std::string id = fmt::format("{:016x}", idGenerator());
+        sessions.emplace(id, std::move(session));
+        return id;
+    }
+
+    std::shared_ptr<AggregationSession> get(const std::string& id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        evictIdle();
+        auto it = sessions.find(id);
+        if (it == sessions.end()) {
+            throw std::invalid_argument("Unknown session: " + id);
+        }
+        return it->second;
+    }
+
+    // Drops the session; its lock may be held, eviction never waits for it
+    void remove(const std::string& id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        sessions.erase(id);
+    }
+
+private:
+    // Runs on every access, so idle sessions go even when no new ones are opened
+    void evictIdle() {
+        auto now = Clock::now();
+        std::erase_if(sessions, [&](const auto& entry) {
+            std::unique_lock<std::mutex> sessionLock(entry.second->mutex, std::try_to_lock);
+            return sessionLock.owns_lock() && now - entry.second->lastUsed > kSessionIdleTimeout;
+        });
+    }
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<AggregationSession>> sessions;
+    std::mt19937_64 idGenerator{std::random_device{}()};
+};
+
+void requireOpen(const AggregationSession& session, const std::string& id) {
+    if (session.finalized) {
+        throw std::invalid_argument("Unknown session: " + id);
+    }
+}
+
+std::string sessionId(const json& request) {
+    if (!request.contains("session_id") || !request["session_id"].is_string()) {
+        throw std::invalid_argument("session_id is required");
+    }
+    return request["session_id"].get<std::string>();
+}
+
+} // namespace
+
+void registerSessionHandlers(HandlerRegistry& registry) {
+    auto store = std::make_shared<SessionStore>();
+
+    registry.add("data", "session_open", dataHandler("session_open", [store](const json& request, const json& dataset) {
+        bool stats = false, unique = false, sort = false;
+        const json defaultTrack = json::array({"stats"});
+        const json& track = request.contains("track") ? request["track"] : defaultTrack;
+        if (!track.is_array() || track.empty()) {
+            throw std::invalid_argument("track must be a non-empty array");
+        }
+        for (const auto& item : track) {
+            if (item == "stats") {
+                stats = true;
+            } else if (item == "unique") {
+                unique = true;
+            } else if (item == "sort") {
+                sort = true;
+            } else {
+                throw std::invalid_argument("Unknown session result: " + item.dump() + " (expected stats, unique or sort)");
+            }
+        }
+
+        std::string id = store->open(stats, unique, sort);
+        if (!dataset.empty()) {
+            auto session = store->get(id);
+            std::lock_guard<std::mutex> lock(session->mutex);
+            try {
+                session->append(dataset);
+            } catch (...) {
+                store->remove(id);
+                throw;
+            }
+        }
+        return json{{"session_id", id}, {"count", dataset.size()}};
+    }));
+
+    registry.add("data", "session_append", dataHandler("session_append", [store](const json& request, const json& dataset) {
+        std::string id = sessionId(request);
+        auto session = store->get(id);
+        std::lock_guard<std::mutex> lock(session->mutex);
+        requireOpen(*session, id);
+        session->append(dataset);
+        return json{{"session_id", id}, {"appended", dataset.size()}, {"count", session->values}};
+    }));
+
+    registry.add("data", "session_finalize", dataHandler("session_finalize", [store](const json& request, const json&) {
+        std::string id = sessionId(request);
+        auto session = store->get(id);
+        std::lock_guard<std::mutex> lock(session->mutex);
+        requireOpen(*session, id);
+        // A session that cannot be finalized stays open, so the client can fix it
+        session->validate();
+        store->remove(id);
+        json result = session->finalize();
+        result["session_id"] = id;
+        return result;
+    }));
+}
+
+} // namespace native
@@ -0,0 +1,216 @@
+#include "native_handlers.h"
+#include "regex_engine.h"
+#include "term_counter.h"
+#include "text_kernels.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+// Text operations on the UTF-8 kernels in text_kernels.cpp. Responses have the
+// shape processor.py's handle_text_request produces. Case mapping is only done
+// natively for ASCII text; anything else goes to Python's str.upper/lower.
+// reverse keeps grapheme clusters together, for the subset of UAX #29 that
+// utf8::reverseGraphemes documents.
+//
+// The regex operations (find_all, count_matches, replace) are served here
+// for "engine": "linear", on regex_engine.h's patterns kept compiled in a
+// cache shared by every thread. The default backtracking engine is Python's
+// re, so those requests go on to processor.py.
+//
+// word_frequency and top_k_terms count words in one pass over the text with
+// a TermCounter, so their memory stays within "memory_budget" however large
+// the vocabulary; past it the counts are estimates and "approximate" is true.
+
+namespace native {
+
+namespace {
+
+using TextOperation = std::function<std::optional<json>(std::string_view text)>;
+
+Handler textHandler(std::string operation, TextOperation compute) {
+    return [operation = std::move(operation), compute](const json& request) -> std::optional<std::string> {
+        const json empty = "";
+        const json& text = request.contains("text") ? request["text"] : empty;
+        if (!text.is_string()) {
+            return errorResponse("Text field is required for text operations");
+        }
+
+        const auto& value = text.get_ref<const std::string&>();
+        std::optional<json> result = compute(value);
+        if (!result) {
+            return std::nullopt;
+        }
+        json response = {
+            {"success", true},
+            {"result", std::move(*result)},
+            {"operation", operation},
+            {"input_text", value},
+            {"timestamp", kTimestamp}
+        };
+        return dumpPythonStyle(response);
+    };
+}
+
+// Largest "count" accepted by replace, as in processor.py
+constexpr std::size_t kMaxReplaceCount = std::size_t{1} << 30;
+
+regex::Flags regexFlags(const json& request) {
+    regex::Flags flags;
+    if (!request.contains("flags")) {
+        return flags;
+    }
+    if (!request["flags"].is_string()) {
+        throw std::invalid_argument("flags must be a string of i, m and s");
+    }
+    for (char flag : request["flags"].get_ref<const std::string&>()) {
+        switch (flag) {
+            case 'i': flags.ignoreCase = true; break;
+            case 'm': flags.multiline = true; break;
+            case 's': flags.dotAll = true; break;
+            default: throw std::invalid_argument(std::string("Unknown regex flag: ") + flag);
+        }
+    }
+    return flags;
+}
+
+const std::string& stringMember(const json& request, const char* name) {
+    if (!request.contains(name) || !request[name].is_string()) {
+        throw std::invalid_argument(std::string(name) + " must be a string");
+    }
+    return request[name].get_ref<const std::string&>();
+}
+
+Handler regexHandler(std::string operation, std::shared_ptr<regex::PatternCache> patterns) {
+    return [operation = std::move(operation), patterns](const json& request) -> std::optional<std::string> {
+        if (!request.contains("engine") || request["engine"] != "linear") {
+            return std::nullopt;
+        }
+        const json empty = "";
+        const json& text = request.contains("text") ? request["text"] : empty;
+        if (!text.is_string()) {
+            return errorResponse("Text field is required for text operations");
+        }
+
+        const auto& value = text.get_ref<const std::string&>();
+        json result;
+        try {
+            const std::string& source = stringMember(request, "pattern");
+            std::shared_ptr<const regex::Pattern> pattern = patterns->get(source, regexFlags(request));
+            if (operation == "find_all") {
+                result = json::array();
+                for (const auto& match : pattern->findAll(value)) {
+                    result.push_back(value.substr(match.begin(), match.end() - match.begin()));
+                }
+            } else if (operation == "count_matches") {
+                result = pattern->countMatches(value);
+            } else {
+                const std::string& replacement = stringMember(request, "replacement");
+                result = pattern->replace(value, replacement, integerOption(request, "count", 0, 0, kMaxReplaceCount));
+            }
+        } catch (const std::exception& e) {
+            return errorResponse(std::string("Text operation failed: ") + e.what());
+        }
+        json response = {
+            {"success", true},
+            {"result", std::move(result)},
+            {"operation", operation},
+            {"input_text", value},
+            {"timestamp", kTimestamp}
+        };
+        return dumpPythonStyle(response);
+    };
+}
+
+// Largest "k" for the term frequency operations, as in processor.py
+constexpr std::size_t kMaxTopTerms = 100000;
+// Heavy hitters tracked once counting is approximate, unless k asks for more
+constexpr std::size_t kTrackedTerms = 1000;
+constexpr std::size_t kMaxMemoryBudget = std::size_t{1} << 40;
+
+Handler termFrequencyHandler(std::string operation) {
+    return [operation = std::move(operation)](const json& request) -> std::optional<std::string> {
+        const json empty = "";
+        const json& text = request.contains("text") ? request["text"] : empty;
+        if (!text.is_string()) {
+            return errorResponse("Text field is required for text operations");
+        }
+
+        // The text is deliberately not echoed back: these operations are
+        // meant for corpora too large to want twice in a response
+        const auto& value = text.get_ref<const std::string&>();
+        json result;
+        std::uint64_t total = 0;
+        bool approximate = false;
+        try {
+            // word_frequency reports every term unless given k
+            std::size_t fallback = operation == "top_k_terms" ? 10 : SIZE_MAX;
+            std::size_t k = integerOption(request, "k", fallback, 1, kMaxTopTerms);
+            std::size_t budget = integerOption(request, "memory_budget", TermCounter::kDefaultMemoryBudget,
+                                               TermCounter::kMinMemoryBudget, kMaxMemoryBudget);
+
+            TermCounter counter(budget, k == SIZE_MAX ? kTrackedTerms : std::max(k, kTrackedTerms));
+            std::size_t pos = 0;
+            for (std::string_view word = utf8::nextWord(value, pos); !word.empty(); word = utf8::nextWord(value, pos)) {
+                counter.add(word);
+            }
+            total = counter.total();
+            approximate = counter.approximate();
+
+            result = operation == "top_k_terms" ? json::array() : json::object();
+            for (auto& [term, count] : counter.top(k)) {
+                if (operation == "top_k_terms") {
+                    result.push_back(json::array({std::move(term), count}));
+                } else {
+                    result[std::move(term)] = count;
+                }
+            }
+        } catch (const std::exception& e) {
+            return errorResponse(std::string("Text operation failed: ") + e.what());
+        }
+        json response = {
+            {"success", true},
+            {"result", std::move(result)},
+            {"operation", operation},
+            {"total_words", total},
+            {"approximate", approximate},
+            {"timestamp", kTimestamp}
+        };
+        return dumpPythonStyle(response);
+    };
+}
+
+} // namespace
+
+void registerTextHandlers(HandlerRegistry& registry) {
+    registry.add("text", "uppercase", textHandler("uppercase", [](std::string_view text) -> std::optional<json> {
+        return utf8::toUpperAscii(text);
+    }));
+    registry.add("text", "lowercase", textHandler("lowercase", [](std::string_view text) -> std::optional<json> {
+        return utf8::toLowerAscii(text);
+    }));
+    registry.add("text", "reverse", textHandler("reverse", [](std::string_view text) -> std::optional<json> {
+        return utf8::reverseGraphemes(text);
+    }));
+    registry.add("text", "word_count", textHandler("word_count", [](std::string_view text) -> std::optional<json> {
+        return utf8::countWords(text);
+    }));
+    registry.add("text", "char_count", textHandler("char_count", [](std::string_view text) -> std::optional<json> {
+        return utf8::countCodePoints(text);
+    }));
+
+    auto patterns = std::make_shared<regex::PatternCache>();
+    for (const char* operation : {"find_all", "count_matches", "replace"}) {
+        registry.add("text", operation, regexHandler(operation, patterns));
+    }
+    for (const char* operation : {"word_frequency", "top_k_terms"}) {
+        registry.add("text", operation, termFrequencyHandler(operation));
+    }
+}
+
+} // namespace native
@@ -0,0 +1,109 @@
+#include "performance_counters.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace {
+
+double percentile(const std::array<std::uint64_t, kLatencyBuckets>& counts, std::uint64_t total, double q) {
+    if (total == 0) {
+        return 0.0;
+    }
+    // Nearest rank
+    auto rank = static_cast<std::uint64_t>(q * static_cast<double>(total - 1)) + 1;
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < counts.size(); ++bucket) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            return PerformanceCounters::bucketValue(bucket);
+        }
+    }
+    return PerformanceCounters::bucketValue(counts.size() - 1);
+}
+
+} // namespace
+
+std::size_t PerformanceCounters::bucketFor(std::uint64_t micros) {
+    if (micros < 16) {
+        return static_cast<std::size_t>(micros);
+    }
+    auto exponent = static_cast<std::size_t>(std::bit_width(micros) - 1);
+    auto sub = static_cast<std::size_t>((micros >> (exponent - 3)) & 7);
+    return std::min<std::size_t>(16 + (exponent - 4) * 8 + sub, kLatencyBuckets - 1);
+}
+
+double PerformanceCounters::bucketValue(std::size_t bucket) {
+    if (bucket < 16) {
+        return static_cast<double>(bucket);
+    }
+    std::size_t exponent = (bucket - 16) / 8 + 4;
+    std::size_t sub = (bucket - 16) % 8;
+    double width = static_cast<double>(std::uint64_t{1} << (exponent - 3));
+    return static_cast<double>(std::uint64_t{1} << exponent) + width * (static_cast<double>(sub) + 0.5);
+}
+
+void PerformanceCounters::recordRequest(std::chrono::nanoseconds latency, bool failed) {
+    auto micros = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+    latencyBuckets[bucketFor(micros)].fetch_add(1, std::memory_order_relaxed);
+    if (failed) {
+        errors.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Last and with release, paired with the acquire in sample(), so a sample
+    // never counts a request whose latency or error it misses
+    requests.fetch_add(1, std::memory_order_release);
+}
+
+void PerformanceCounters::recordGilWait(std::chrono::nanoseconds wait) {
+    gilWaitNanos.fetch_add(wait.count(), std::memory_order_relaxed);
+}
+
+void PerformanceCounters::setPythonHeapBlocks(std::uint64_t blocks) {
+    pythonHeapBlocks.store(blocks, std::memory_order_relaxed);
+}
+
+void PerformanceCounters::recordGcPause(std::chrono::nanoseconds pause) {
+    gcPauseNanos.fetch_add(pause.count(), std::memory_order_relaxed);
+    gcCollections.fetch_add(1, std::memory_order_relaxed);
+}
+
+PerformanceSample PerformanceCounters::sample() const {
+    PerformanceSample result;
+    result.time = std::chrono::steady_clock::now();
+    // First: everything recorded before the requests it counts is visible below
+    result.requests = requests.load(std::memory_order_acquire);
+    result.errors = errors.load(std::memory_order_relaxed);
+    result.gilWait = std::chrono::nanoseconds(gilWaitNanos.load(std::memory_order_relaxed));
+    result.pythonHeapBlocks = pythonHeapBlocks.load(std::memory_order_relaxed);
+    result.gcCollections = gcCollections.load(std::memory_order_relaxed);
+    result.gcPause = std::chrono::nanoseconds(gcPauseNanos.load(std::memory_order_relaxed));
+    for (std::size_t i = 0; i < kLatencyBuckets; ++i) {
+        result.latencyBuckets[i] = latencyBuckets[i].load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+PerformanceInterval performanceBetween(const PerformanceSample& earlier, const PerformanceSample& later) {
+    PerformanceInterval interval;
+    interval.seconds = std::chrono::duration<double>(later.time - earlier.time).count();
+    interval.pythonHeapBlocks = later.pythonHeapBlocks;
+    if (interval.seconds <= 0) {
+        return interval;
+    }
+
+    std::array<std::uint64_t, kLatencyBuckets> counts{};
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < kLatencyBuckets; ++i) {
+        counts[i] = later.latencyBuckets[i] - earlier.latencyBuckets[i];
+        total += counts[i];
+    }
+
+    interval.requestsPerSecond = static_cast<double>(later.requests - earlier.requests) / interval.seconds;
+    interval.errorsPerSecond = static_cast<double>(later.errors - earlier.errors) / interval.seconds;
+    interval.p50Ms = percentile(counts, total, 0.50) / 1000.0;
+    interval.p90Ms = percentile(counts, total, 0.90) / 1000.0;
+    interval.p99Ms = percentile(counts, total, 0.99) / 1000.0;
+    interval.gilWaitFraction = std::chrono::duration<double>(later.gilWait - earlier.gilWait).count() / interval.seconds;
+    interval.gcCollectionsPerSecond = static_cast<double>(later.gcCollections - earlier.gcCollections) / interval.seconds;
+    interval.gcPauseFraction = std::chrono::duration<double>(later.gcPause - earlier.gcPause).count() / interval.seconds;
+    return interval;
+}
@@ -0,0 +1,172 @@
+#include "performance_tab.h"
+#include "python_processor.h"
+
+#include <QFontMetrics>
+#include <QGridLayout>
+#include <QLabel>
+#include <QPainter>
+#include <QPainterPath>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <algorithm>
+
+namespace {
+
+constexpr int kSampleIntervalMs = 500;
+constexpr std::size_t kHistory = 120; // one minute at the sample interval
+
+QString formatValue(double value) {
+    if (value >= 1e6) {
+        return QString::number(value / 1e6, 'f', 1) + "M";
+    }
+    if (value >= 1e4) {
+        return QString::number(value / 1e3, 'f', 1) + "k";
+    }
+    return QString::number(value, 'g', 3);
+}
+
+} // namespace
+
+TimeSeriesChart::TimeSeriesChart(const QString& title, const QString& unit, QWidget* parent)
+    : QWidget(parent), title(title), unit(unit) {
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+}
+
+void TimeSeriesChart::addSeries(const QString& name, const QColor& color) {
+    series.push_back({name, color, {}});
+}
+
+void TimeSeriesChart::append(const std::vector<double>& values) {
+    for (std::size_t i = 0; i < series.size() && i < values.size(); ++i) {
+        series[i].values.push_back(values[i]);
+        if (series[i].values.size() > kHistory) {
+            series[i].values.pop_front();
+        }
+    }
+    update();
+}
+
+QSize TimeSeriesChart::minimumSizeHint() const {
+    return {260, 160};
+}
+
+void TimeSeriesChart::paintEvent(QPaintEvent*) {
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.fillRect(rect(), palette().base());
+
+    QFontMetrics metrics(font());
+    const int margin = 6;
+    const int header = metrics.height() + margin;
+    const int axisWidth = metrics.horizontalAdvance("000.0k") + margin;
+    QRectF plot(axisWidth, header + margin, width() - axisWidth - margin, height() - header - 2 * margin);
+
+    // Title and the latest value of each series
+    painter.setPen(palette().text().color());
+    painter.drawText(margin, metrics.ascent() + margin / 2, title + " (" + unit + ")");
+    int legendX = width() - margin;
+    for (auto it = series.rbegin(); it != series.rend(); ++it) {
+        QString label = it->name + ": " + (it->values.empty() ? QString("-") : formatValue(it->values.back()));
+        legendX -= metrics.horizontalAdvance(label) + 2 * margin;
+        painter.setPen(it->color);
+        painter.drawText(legendX, metrics.ascent() + margin / 2, label);
+    }
+
+    double maximum = 0;
+    for (const auto& s : series) {
+        for (double value : s.values) {
+            maximum = std::max(maximum, value);
+        }
+    }
+    maximum = maximum > 0 ? maximum * 1.1 : 1.0;
+
+    // Grid with labels at quarters of the range
+    painter.setPen(QPen(palette().mid().color(), 0, Qt::DotLine));
+    for (int i = 0; i <= 4; ++i) {
+        double y = plot.bottom() - plot.height() * i / 4.0;
+        painter.drawLine(QPointF(plot.left(), y), QPointF(plot.right(), y));
+        painter.drawText(QRectF(0, y - metrics.height() / 2.0, axisWidth - margin, metrics.height()),
+            Qt::AlignRight | Qt::AlignVCenter, formatValue(maximum * i / 4.0));
+    }
+
+    const double step = plot.width() / static_cast<double>(kHistory - 1);
+    for (const auto& s : series) {
+        if (s.values.size() < 2) {
+            continue;
+        }
+        QPainterPath path;
+        // Newest value at the right edge
+        double x = plot.right() - step * static_cast<double>(s.values.size() - 1);
+        for (std::size_t i = 0; i < s.values.size(); ++i, x += step) {
+            QPointF point(x, plot.bottom() - plot.height() * s.values[i] / maximum);
+            if (i == 0) {
+                path.moveTo(point);
+            } else {
+                path.lineTo(point);
+            }
+        }
+        painter.setPen(QPen(s.color, 1.5));
+        painter.drawPath(path);
+    }
+}
+
+PerformanceTab::PerformanceTab(QWidget* parent) : QWidget(parent), timer(new QTimer(this)) {
+    auto* layout = new QVBoxLayout(this);
+
+    summaryLabel = new QLabel("Waiting for samples...");
+    layout->addWidget(summaryLabel);
+
+    auto* grid = new QGridLayout;
+    throughputChart = new TimeSeriesChart("Throughput", "requests/s");
+    throughputChart->addSeries("requests", QColor(76, 175, 80));
+    throughputChart->addSeries("errors", QColor(229, 57, 53));
+    grid->addWidget(throughputChart, 0, 0);
+
+    latencyChart = new TimeSeriesChart("Latency", "ms");
+    latencyChart->addSeries("p50", QColor(30, 136, 229));
+    latencyChart->addSeries("p90", QColor(251, 140, 0));
+    latencyChart->addSeries("p99", QColor(229, 57, 53));
+    grid->addWidget(latencyChart, 0, 1);
+
+    gilChart = new TimeSeriesChart("GIL wait and GC pauses", "% of wall time");
+    gilChart->addSeries("GIL wait", QColor(142, 36, 170));
+    gilChart->addSeries("GC", QColor(255, 179, 0));
+    grid->addWidget(gilChart, 1, 0);
+
+    heapChart = new TimeSeriesChart("Python heap", "allocated blocks");
+    heapChart->addSeries("blocks", QColor(0, 137, 123));
+    grid->addWidget(heapChart, 1, 1);
+    layout->addLayout(grid);
+
+    timer->setInterval(kSampleIntervalMs);
+    connect(timer, &QTimer::timeout, this, &PerformanceTab::sample);
+}
+
+void PerformanceTab::setProcessor(const PythonProcessor* newProcessor) {
+    processor = newProcessor;
+    previous.reset();
+    if (processor) {
+        timer->start();
+    } else {
+        timer->stop();
+    }
+}
+
+void PerformanceTab::sample() {
+    PerformanceSample current = processor->samplePerformance();
+    if (!previous) {
+        previous = current;
+        return;
+    }
+
+    PerformanceInterval interval = performanceBetween(*previous, current);
+    previous = current;
+
+    throughputChart->append({interval.requestsPerSecond, interval.errorsPerSecond});
+    latencyChart->append({interval.p50Ms, interval.p90Ms, interval.p99Ms});
+    gilChart->append({interval.gilWaitFraction * 100.0, interval.gcPauseFraction * 100.0});
+    heapChart->append({static_cast<double>(interval.pythonHeapBlocks)});
+
+    summaryLabel->setText(QString("%1 requests, %2 errors since start; sampled every %3 ms")
+        .arg(current.requests).arg(current.errors).arg(kSampleIntervalMs));
+}
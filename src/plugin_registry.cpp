@@ -0,0 +1,159 @@
+#include "plugin_registry.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <loguru/loguru.hpp>
+#include <tuple>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+// Declared opaque in the C header
+struct cppideas_response {
+    std::string data;
+    bool overflowed = false;
+};
+
+namespace {
+
+// What a plugin registers during its init call, kept aside so a failed init leaves no trace
+struct Registration {
+    std::function<bool(std::string_view type, std::string_view operation)> taken;
+    std::vector<std::tuple<std::string, std::string, cppideas_handler, void*>> added;
+};
+
+extern "C" int registerHandler(void* context, const char* type, const char* operation, cppideas_handler handler,
+    void* userData) {
+    auto* registration = static_cast<Registration*>(context);
+    if (!type || !operation || !handler) {
+        return 1;
+    }
+    try {
+        bool duplicate = std::any_of(registration->added.begin(), registration->added.end(), [&](const auto& entry) {
+            return std::get<0>(entry) == type && std::get<1>(entry) == operation;
+        });
+        if (duplicate || registration->taken(type, operation)) {
+            return 1;
+        }
+        registration->added.emplace_back(type, operation, handler, userData);
+        return 0;
+    } catch (...) {
+        return 1;
+    }
+}
+
+extern "C" void appendResponse(cppideas_response* response, const char* data, std::size_t size) {
+    try {
+        response->data.append(data, size);
+    } catch (...) {
+        // No exceptions across the C boundary; the call is reported as failed
+        response->overflowed = true;
+    }
+}
+
+} // namespace
+
+PluginRegistry::~PluginRegistry() {
+    for (void* library : libraries) {
+        dlclose(library);
+    }
+}
+
+fs::path PluginRegistry::defaultDirectory() {
+    if (const char* directory = std::getenv("CPPIDEAS_PLUGIN_DIR"); directory && *directory) {
+        return directory;
+    }
+    return fs::current_path() / "plugins";
+}
+
+void PluginRegistry::loadDirectory(const fs::path& directory) {
+    std::error_code error;
+    if (!fs::is_directory(directory, error)) {
+        return;
+    }
+
+    std::vector<fs::path> candidates;
+    for (const auto& entry : fs::directory_iterator(directory, error)) {
+        fs::path extension = entry.path().extension();
+        if (entry.is_regular_file(error) && (extension == ".so" || extension == ".dylib")) {
+            candidates.push_back(entry.path());
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    for (const auto& candidate : candidates) {
+        if (auto loaded = load(candidate); !loaded) {
+            LOG_F(ERROR, "Skipping plugin %s: %s", candidate.c_str(), loaded.error().c_str());
+        }
+    }
+}
+
+std::expected<void, std::string> PluginRegistry::load(const fs::path& library) {
+    void* handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        const char* message = dlerror();
+        return std::unexpected(message ? message : "dlopen failed");
+    }
+    auto fail = [&](std::string message) -> std::expected<void, std::string> {
+        dlclose(handle);
+        return std::unexpected(std::move(message));
+    };
+
+    auto abiVersion = reinterpret_cast<cppideas_plugin_abi_version_fn>(dlsym(handle, "cppideas_plugin_abi_version"));
+    auto init = reinterpret_cast<cppideas_plugin_init_fn>(dlsym(handle, "cppideas_plugin_init"));
+    if (!abiVersion || !init) {
+        return fail("missing cppideas_plugin_abi_version or cppideas_plugin_init");
+    }
+    if (std::uint32_t version = abiVersion(); version != CPPIDEAS_PLUGIN_ABI_VERSION) {
+        return fail("built for plugin ABI " + std::to_string(version) + ", expected "
+            + std::to_string(CPPIDEAS_PLUGIN_ABI_VERSION));
+    }
+
+    Registration registration;
+    registration.taken = [this](std::string_view type, std::string_view operation) { return handles(type, operation); };
+    cppideas_host host{CPPIDEAS_PLUGIN_ABI_VERSION, &registration, registerHandler, appendResponse};
+    if (int status = init(&host); status != 0) {
+        return fail("cppideas_plugin_init returned " + std::to_string(status));
+    }
+
+    for (auto& [type, operation, handler, userData] : registration.added) {
+        handlers[std::move(type)][std::move(operation)] = Entry{handler, userData};
+    }
+    libraries.push_back(handle);
+    names.push_back(library.filename().string());
+    LOG_F(INFO, "Loaded plugin %s with %zu handlers", library.c_str(), registration.added.size());
+    return {};
+}
+
+bool PluginRegistry::handles(std::string_view type, std::string_view operation) const {
+    auto byType = handlers.find(type);
+    return byType != handlers.end() && byType->second.contains(operation);
+}
+
+std::optional<std::expected<std::string, std::string>> PluginRegistry::dispatch(std::string_view type,
+    std::string_view operation, std::string_view request) const {
+    auto byType = handlers.find(type);
+    if (byType == handlers.end()) {
+        return std::nullopt;
+    }
+    auto found = byType->second.find(operation);
+    if (found == byType->second.end()) {
+        return std::nullopt;
+    }
+
+    cppideas_response response;
+    cppideas_status status = found->second.handler(found->second.userData, request.data(), request.size(), &response);
+    if (response.overflowed) {
+        return std::unexpected("Plugin response could not be stored");
+    }
+    switch (status) {
+        case CPPIDEAS_HANDLED:
+            return std::move(response.data);
+        case CPPIDEAS_DEFER:
+            return std::nullopt;
+        case CPPIDEAS_FAILED:
+            return std::unexpected(response.data.empty() ? std::string("Plugin handler failed") : std::move(response.data));
+    }
+    return std::unexpected("Plugin handler returned an unknown status");
+}
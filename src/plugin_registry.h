@@ -0,0 +1,56 @@
+#pragma once
+
+#include "cppideas_plugin.h"
+
+#include <expected>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Native handler plugins loaded from shared objects, see cppideas_plugin.h.
+// Loading happens during startup only; dispatch is read-only and safe to call
+// from several threads at once.
+class PluginRegistry {
+public:
+    PluginRegistry() = default;
+    ~PluginRegistry();
+
+    PluginRegistry(const PluginRegistry&) = delete;
+    PluginRegistry& operator=(const PluginRegistry&) = delete;
+
+    // $CPPIDEAS_PLUGIN_DIR, or "plugins" in the working directory
+    static std::filesystem::path defaultDirectory();
+
+    // Loads every shared object in directory in name order, logging failures.
+    // A missing directory just means no plugins.
+    void loadDirectory(const std::filesystem::path& directory);
+
+    // Loads a single plugin; on failure it is unloaded and none of its
+    // handlers are kept
+    std::expected<void, std::string> load(const std::filesystem::path& library);
+
+    // File names of the loaded plugins
+    const std::vector<std::string>& loaded() const { return names; }
+
+    bool handles(std::string_view type, std::string_view operation) const;
+
+    // Runs the plugin handler registered for (type, operation). Returns
+    // nothing when there is none or it deferred, otherwise the response or
+    // the handler's error message.
+    std::optional<std::expected<std::string, std::string>> dispatch(std::string_view type, std::string_view operation,
+        std::string_view request) const;
+
+private:
+    struct Entry {
+        cppideas_handler handler;
+        void* userData;
+    };
+
+    std::map<std::string, std::map<std::string, Entry, std::less<>>, std::less<>> handlers;
+    std::vector<void*> libraries;
+    std::vector<std::string> names;
+};
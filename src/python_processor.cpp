@@ -1,46 +1,304 @@
 #include "python_processor.h"
+#include "allocation_tracker.h"
+#include "frozen_modules.h"
+#include "gc_monitor.h"
+#include "json_validation.h"
+#include "native_handlers.h"
+#include "native_module.h"
+#include "plugin_registry.h"
+#include "request_schema.h"
+#include "request_trace.h"
+#include "result_cache.h"
+#include "span_trace.h"
+#include "startup_paths.h"
 #include <boost/python.hpp>
-#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 #include <filesystem>
 #include <loguru/loguru.hpp>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 namespace bp = boost::python;
 
+namespace {
+
+// Holds the GIL for the lifetime of the guard
+class GilGuard {
+public:
+    GilGuard() : state(PyGILState_Ensure()) {}
+    ~GilGuard() { PyGILState_Release(state); }
+
+    GilGuard(const GilGuard&) = delete;
+    GilGuard& operator=(const GilGuard&) = delete;
+
+private:
+    PyGILState_STATE state;
+};
+
+// Releases the GIL held by this thread for the lifetime of the guard
+class GilUnlock {
+public:
+    GilUnlock() : state(PyEval_SaveThread()) {}
+    ~GilUnlock() { PyEval_RestoreThread(state); }
+
+    GilUnlock(const GilUnlock&) = delete;
+    GilUnlock& operator=(const GilUnlock&) = delete;
+
+private:
+    PyThreadState* state;
+};
+
+// How every successful response starts, native or from processor.py
+constexpr std::string_view kSuccessPrefix = R"({"success": true)";
+
+// Hands body to sink chunkSize bytes at a time until it is done or sink stops
+void deliverInChunks(std::string_view body, const ChunkSink& sink, std::size_t chunkSize) {
+    for (std::size_t pos = 0; pos < body.size(); pos += chunkSize) {
+        if (!sink(body.substr(pos, chunkSize))) {
+            return;
+        }
+    }
+}
+
+std::size_t skipWhitespace(std::string_view json, std::size_t pos) {
+    while (pos < json.size() && (json[pos] == ' ' || json[pos] == '\t' || json[pos] == '\n' || json[pos] == '\r')) {
+        ++pos;
+    }
+    return pos;
+}
+
+// Returns the position just past the closing quote of the string starting at pos
+std::size_t skipString(std::string_view json, std::size_t pos, bool& escaped) {
+    escaped = false;
+    for (++pos; pos < json.size(); ++pos) {
+        if (json[pos] == '\\') {
+            escaped = true;
+            ++pos;
+        } else if (json[pos] == '"') {
+            return pos + 1;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// Returns the position just past the value starting at pos
+std::size_t skipValue(std::string_view json, std::size_t pos) {
+    bool escaped = false;
+    if (json[pos] == '"') {
+        return skipString(json, pos, escaped);
+    }
+    if (json[pos] == '{' || json[pos] == '[') {
+        int depth = 0;
+        while (pos < json.size()) {
+            char c = json[pos];
+            if (c == '"') {
+                pos = skipString(json, pos, escaped);
+                if (pos == std::string_view::npos) {
+                    return pos;
+                }
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if ((c == '}' || c == ']') && --depth == 0) {
+                return pos + 1;
+            }
+            ++pos;
+        }
+        return std::string_view::npos;
+    }
+    while (pos < json.size() && json[pos] != ',' && json[pos] != '}' && json[pos] != ']') {
+        ++pos;
+    }
+    return pos;
+}
+
+// Reads a top-level string member of a JSON object without building a DOM.
+// Returns nothing when the member is missing, is not a plain string (escaped
+// strings are left to the real parser) or the document is malformed.
+std::optional<std::string_view> peekTopLevelString(std::string_view json, std::string_view key) {
+    std::size_t pos = skipWhitespace(json, 0);
+    if (pos >= json.size() || json[pos] != '{') {
+        return std::nullopt;
+    }
+    pos = skipWhitespace(json, pos + 1);
+    while (pos < json.size() && json[pos] == '"') {
+        bool keyEscaped = false;
+        std::size_t keyEnd = skipString(json, pos, keyEscaped);
+        if (keyEnd == std::string_view::npos) {
+            return std::nullopt;
+        }
+        std::string_view name = json.substr(pos + 1, keyEnd - pos - 2);
+        pos = skipWhitespace(json, keyEnd);
+        if (pos >= json.size() || json[pos] != ':') {
+            return std::nullopt;
+        }
+        pos = skipWhitespace(json, pos + 1);
+        if (pos >= json.size()) {
+            return std::nullopt;
+        }
+        if (!keyEscaped && name == key) {
+            bool valueEscaped = false;
+            if (json[pos] != '"') {
+                return std::nullopt;
+            }
+            std::size_t valueEnd = skipString(json, pos, valueEscaped);
+            if (valueEnd == std::string_view::npos || valueEscaped) {
+                return std::nullopt;
+            }
+            return json.substr(pos + 1, valueEnd - pos - 2);
+        }
+        pos = skipValue(json, pos);
+        if (pos == std::string_view::npos) {
+            return std::nullopt;
+        }
+        pos = skipWhitespace(json, pos);
+        if (pos >= json.size() || json[pos] != ',') {
+            return std::nullopt;
+        }
+        pos = skipWhitespace(json, pos + 1);
+    }
+    return std::nullopt;
+}
+
+using Clock = std::chrono::steady_clock;
+
+std::chrono::microseconds elapsedSince(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+}
+
+// Points the import system at the bytecode built into the library, unless the
+// embedding application installed a table of its own
+void installFrozenModules() {
+    if ((frozen::pythonVersion() >> 16) != (Py_Version >> 16)) {
+        LOG_F(WARNING, "Embedded bytecode was built for Python %lx, not %lx; importing from source",
+            frozen::pythonVersion() >> 16, Py_Version >> 16);
+        return;
+    }
+    if (PyImport_FrozenModules != nullptr && PyImport_FrozenModules != frozen::modules()) {
+        LOG_F(WARNING, "PyImport_FrozenModules is already set; importing from source");
+        return;
+    }
+    PyImport_FrozenModules = frozen::modules();
+    LOG_F(INFO, "Installed %zu frozen modules", frozen::moduleCount());
+}
+
+// The GIL must be held
+void appendToSysPath(const std::vector<std::string>& paths) {
+    bp::list path = bp::extract<bp::list>(bp::import("sys").attr("path"));
+    for (const auto& entry : paths) {
+        path.append(entry);
+    }
+}
+
+// ResponseHandle owner for a borrowed Python object; callable with or without the GIL
+void releasePythonObject(void* object) {
+    GilGuard gil;
+    Py_DECREF(static_cast<PyObject*>(object));
+}
+
+// Resident set size of the process, or 0 where it cannot be read
+std::size_t residentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    std::size_t pages = 0;
+    std::size_t resident = 0;
+    if (!(statm >> pages >> resident)) {
+        return 0;
+    }
+    return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// Python heap usage of a single request, measured with tracemalloc
+struct PythonMemorySample {
+    std::size_t peakBytes = 0;
+    std::int64_t retainedBytes = 0;
+};
+
+// Processors with memory accounting on. tracemalloc is interpreter-wide, so
+// the first of them starts it and the last stops it, unless it was tracing
+// before any of them; guarded by the GIL.
+int tracemallocUsers = 0;
+bool tracemallocStarted = false;
+
+// tracemalloc's peak is interpreter-wide too, so the Python part of accounted
+// requests runs one request at a time, across processors. Taken before the GIL.
+std::mutex accountedPythonMutex;
+
+// Where the spans of one request go; records nothing while span tracing is off
+struct RequestSpans {
+    std::shared_ptr<SpanTraceWriter> writer;
+    std::uint64_t requestId = 0;
+
+    explicit operator bool() const { return writer != nullptr; }
+
+    void record(std::string_view name, Clock::time_point start, Clock::time_point end, std::string_view category = "cpp") const {
+        if (writer) {
+            writer->write(name, category, start, end, requestId);
+        }
+    }
+};
+
+} // namespace
+
 class PythonProcessor::Impl {
 public:
-    Impl() : initialized(false) {
+    explicit Impl(const StartupOptions& options) : initialized(false) {
+        auto startupBegin = Clock::now();
         LOG_F(INFO, "Starting Python processor initialization...");
+
+        auto phase = Clock::now();
+        native::registerBuiltinHandlers(nativeHandlers);
+        plugins.loadDirectory(PluginRegistry::defaultDirectory());
+        startupTiming.handlers = elapsedSince(phase);
         
         try {
+            if (options.frozenModules) {
+                // Installed before initialization so it also serves imports made during startup
+                installFrozenModules();
+            }
+
+            bool ownsInterpreter = false;
             if (!Py_IsInitialized()) {
                 LOG_F(INFO, "Python not initialized, setting up configuration...");
                 
                 // Use PyConfig for Python 3.8+ initialization
                 PyConfig config;
                 PyConfig_InitPythonConfig(&config);
+                if (options.skipSite) {
+                    config.site_import = 0;
+                }
                 
                 // For embedded Python, we should use the system Python paths
                 // but add our venv site-packages to the path later
-                std::filesystem::path currentPath = std::filesystem::current_path();
-                std::filesystem::path venvPath = currentPath / ".venv";
-                
-                LOG_F(INFO, "Current path: %s", currentPath.c_str());
-                LOG_F(INFO, "Venv path: %s", venvPath.c_str());
-                
                 // Don't set PYTHONHOME to venv - let it use system defaults
-                // We'll add the venv site-packages directory to sys.path later
                 
                 LOG_F(INFO, "Initializing Python from config...");
                 // Initialize Python with config
+                phase = Clock::now();
                 PyStatus status = Py_InitializeFromConfig(&config);
                 PyConfig_Clear(&config);
+                startupTiming.interpreter = elapsedSince(phase);
                 
                 if (PyStatus_Exception(status)) {
                     LOG_F(ERROR, "Python initialization failed");
-                    lastError = "Failed to initialize Python from config";
+                    initError = "Failed to initialize Python from config";
                     return;
                 } else {
                     LOG_F(INFO, "Python initialized successfully");
+                    ownsInterpreter = true;
                 }
             } else {
                 LOG_F(INFO, "Python already initialized");
@@ -52,92 +310,130 @@ public:
             
             try {
                 LOG_F(INFO, "Setting up Python paths...");
-                // Add current directory to Python path
-                bp::object sys = bp::import("sys");
-                bp::list path = bp::extract<bp::list>(sys.attr("path"));
-                
-                // Add the python directory to Python path
                 std::filesystem::path currentPath = std::filesystem::current_path();
-                std::filesystem::path pythonPath = currentPath / "python";
-                
-                if (std::filesystem::exists(pythonPath)) {
-                    LOG_F(INFO, "Adding python path: %s", pythonPath.c_str());
-                    path.append(pythonPath.string());
-                } else {
-                    LOG_F(INFO, "Adding relative paths...");
-                    // Try relative path
-                    path.append("./python");
-                    path.append(".");
-                }
-                
-                // Add vcpkg Python paths for extension modules
-                std::filesystem::path vcpkgPath = currentPath / ".vcpkg" / "installed" / "x64-linux";
-                std::filesystem::path libDynload = vcpkgPath / "lib" / "python3.12" / "lib-dynload";
-                std::filesystem::path libPath = vcpkgPath / "lib" / "python3.12";
-                
-                if (std::filesystem::exists(libDynload)) {
-                    LOG_F(INFO, "Adding vcpkg lib-dynload path: %s", libDynload.c_str());
-                    path.append(libDynload.string());
+                LOG_F(INFO, "Current path: %s", currentPath.c_str());
+
+                phase = Clock::now();
+                PythonPathCache pathCache(PythonPathCache::defaultLocation());
+                std::optional<std::vector<std::string>> paths;
+                if (options.cachedPaths) {
+                    paths = pathCache.find(currentPath);
+                    startupTiming.cachedPaths = paths.has_value();
                 }
-                
-                if (std::filesystem::exists(libPath)) {
-                    LOG_F(INFO, "Adding vcpkg lib path: %s", libPath.c_str());
-                    path.append(libPath.string());
+                if (!paths) {
+                    paths = probePythonPaths(currentPath);
+                    if (options.cachedPaths) {
+                        pathCache.store(currentPath, *paths);
+                    }
                 }
-                
-                // Add venv site-packages if it exists
-                std::filesystem::path venvPath = currentPath / ".venv";
-                std::filesystem::path venvSitePackages = venvPath / "lib" / "python3.12" / "site-packages";
-                if (std::filesystem::exists(venvSitePackages)) {
-                    LOG_F(INFO, "Adding venv site-packages: %s", venvSitePackages.c_str());
-                    path.append(venvSitePackages.string());
-                } else {
-                    LOG_F(WARNING, "Venv site-packages not found: %s", venvSitePackages.c_str());
+                appendToSysPath(*paths);
+                startupTiming.paths = elapsedSince(phase);
+
+                // Before the import, so processor.py can use it at module level
+                if (!installNativeModule()) {
+                    LOG_F(WARNING, "cppideas_native is not importable: %s", fetchPythonError().c_str());
                 }
                 
                 // Import the processor module
                 LOG_F(INFO, "Importing processor module...");
                 try {
-                    processorModule = bp::import("processor");
+                    phase = Clock::now();
+                    try {
+                        processorModule = bp::import("processor");
+                    } catch (const bp::error_already_set&) {
+                        if (!startupTiming.cachedPaths) {
+                            throw;
+                        }
+                        // The cached entries may be stale; probe again and retry once
+                        PyErr_Clear();
+                        LOG_F(WARNING, "Import failed with cached Python paths, probing again");
+                        startupTiming.cachedPaths = false;
+                        paths = probePythonPaths(currentPath);
+                        pathCache.store(currentPath, *paths);
+                        appendToSysPath(*paths);
+                        processorModule = bp::import("processor");
+                    }
+                    startupTiming.import = elapsedSince(phase);
+                    bp::object origin = processorModule.attr("__spec__").attr("origin");
+                    startupTiming.frozenImport = !origin.is_none() && bp::extract<std::string>(origin)() == "frozen";
                     LOG_F(INFO, "Processor module imported successfully");
                     
                     processFunction = processorModule.attr("process_json");
+                    if (PyObject_HasAttrString(processorModule.ptr(), "process_json_stream")) {
+                        processStreamFunction = processorModule.attr("process_json_stream");
+                    }
                     LOG_F(INFO, "Process function retrieved successfully");
+                    validateRequests = options.validateRequests;
+                    if (validateRequests) {
+                        compileRequestSchemas();
+                    }
+                    if (!gcMonitor.install(options)) {
+                        LOG_F(ERROR, "Could not set up garbage collection control: %s", fetchPythonError().c_str());
+                    }
+                    getAllocatedBlocks = bp::import("sys").attr("getallocatedblocks");
+                    if (!options.resultCachePath.empty()) {
+                        openResultCache(options);
+                    }
                     
                     initialized = true;
-                    lastError.clear();
+                    initError.clear();
                     LOG_F(INFO, "Python processor initialization completed successfully");
                 } catch (const bp::error_already_set&) {
                     LOG_F(ERROR, "Failed to import processor module:");
                     PyErr_Print();
                     PyErr_Clear();
-                    lastError = "Failed to import processor module. Make sure processor.py is in the src directory.";
+                    initError = "Failed to import processor module. Make sure processor.py is in the src directory.";
                 }
                 
             } catch (const bp::error_already_set&) {
                 LOG_F(ERROR, "Failed to set up Python environment:");
                 PyErr_Print();
                 PyErr_Clear();
-                lastError = "Failed to set up Python environment";
+                initError = "Failed to set up Python environment";
             }
             
             LOG_F(INFO, "Releasing GIL...");
             PyGILState_Release(gstate);
+
+            if (ownsInterpreter) {
+                // Py_InitializeFromConfig leaves the GIL held by this thread; hand it
+                // back so that processJson can be called from any thread
+                PyEval_SaveThread();
+            }
             
         } catch (const std::exception& e) {
             LOG_F(ERROR, "Exception during Python initialization: %s", e.what());
-            lastError = "Failed to initialize Python: " + std::string(e.what());
+            initError = "Failed to initialize Python: " + std::string(e.what());
         } catch (...) {
             LOG_F(ERROR, "Unknown exception during Python initialization");
-            lastError = "Unknown error during Python initialization";
+            initError = "Unknown error during Python initialization";
         }
         
+        startupTiming.total = elapsedSince(startupBegin);
         LOG_F(INFO, "Python processor initialization finished. Initialized: %s", initialized ? "true" : "false");
+        LOG_F(INFO, "Startup took %lld us: handlers %lld, interpreter %lld, paths %lld (%s), import %lld (%s)",
+            static_cast<long long>(startupTiming.total.count()), static_cast<long long>(startupTiming.handlers.count()),
+            static_cast<long long>(startupTiming.interpreter.count()), static_cast<long long>(startupTiming.paths.count()),
+            startupTiming.cachedPaths ? "cached" : "probed", static_cast<long long>(startupTiming.import.count()),
+            startupTiming.frozenImport ? "frozen" : "source");
     }
     
     ~Impl() {
         try {
+            // Before taking the GIL: the idle collector may be waiting for it
+            gcMonitor.shutdown();
             if (Py_IsInitialized()) {
+                // Lets go of tracemalloc for the processors still accounting
+                setMemoryAccountingEnabled(false);
+                // Drop our references while holding the GIL
+                GilGuard gil;
+                processFunction = bp::object();
+                processStreamFunction = bp::object();
+                processorModule = bp::object();
+                getAllocatedBlocks = bp::object();
+                getTracedMemory = bp::object();
+                resetTracedPeak = bp::object();
+
                 // Don't finalize Python as it might be used elsewhere
                 // Py_Finalize();
             }
@@ -146,101 +442,975 @@ public:
         }
     }
     
-    std::string processJson(const std::string& jsonInput) {
-        LOG_F(INFO, "Processing JSON input: %s...", jsonInput.substr(0, 100).c_str());
+    // borrow: keep a Python result alive in the handle instead of copying it
+    std::expected<ResponseHandle, ProcessError> process(std::string_view jsonInput, bool borrow) {
+        auto start = Clock::now();
+        RequestSpans spans = beginSpans();
+        auto result = processRequest(jsonInput, borrow, spans);
+        auto end = Clock::now();
+        performance.recordRequest(end - start, !result || !result->body().starts_with(kSuccessPrefix));
+        spans.record("request", start, end);
+        recycleIfDue();
+        return result;
+    }
+
+    std::expected<void, ProcessError> processStream(std::string_view jsonInput, const ChunkSink& sink,
+        std::size_t chunkSize) {
+        auto start = Clock::now();
+        RequestSpans spans = beginSpans();
+        recordTrace(jsonInput);
+
+        // Enough of the response to count it as a success or a failure
+        std::string head;
+        ChunkSink counted = [&](std::string_view chunk) {
+            if (head.size() < kSuccessPrefix.size()) {
+                head.append(chunk.substr(0, kSuccessPrefix.size() - head.size()));
+            }
+            return sink(chunk);
+        };
+        auto result = streamProcessor(jsonInput, counted, std::max<std::size_t>(chunkSize, 1), spans);
+        auto end = Clock::now();
+        performance.recordRequest(end - start, !result || !head.starts_with(kSuccessPrefix));
+        spans.record("request", start, end);
+        recycleIfDue();
+        return result;
+    }
+
+    PerformanceSample samplePerformance() const {
+        return performance.sample();
+    }
+
+    GcStats getGcStats() const {
+        return gcMonitor.stats();
+    }
+
+    void setRecyclePolicy(const RecyclePolicy& policy) {
+        std::lock_guard<std::mutex> lock(recycleMutex);
+        recyclePolicy = policy;
+        recycleEnabled.store(policy.enabled());
+    }
+
+    RecyclePolicy getRecyclePolicy() const {
+        std::lock_guard<std::mutex> lock(recycleMutex);
+        return recyclePolicy;
+    }
+
+    RecycleStats getRecycleStats() const {
+        std::lock_guard<std::mutex> lock(recycleMutex);
+        RecycleStats stats = recycleStats;
+        stats.requestsSinceRecycle = requestsSinceRecycle.load();
+        return stats;
+    }
+
+    // Swaps in a freshly imported processor.py; call without holding the GIL
+    bool recycle(const std::string& reason) {
+        if (!initialized || recycling.exchange(true)) {
+            return false;
+        }
+        auto start = Clock::now();
+        std::size_t residentBefore = residentBytes();
+        bool recycled = false;
+        {
+            GilGuard gil;
+            try {
+                recycled = reimportProcessor();
+            } catch (const bp::error_already_set&) {
+                LOG_F(ERROR, "Recycling failed: %s", fetchPythonError().c_str());
+            }
+        }
+#ifdef __GLIBC__
+        // Python hands empty arenas back by itself; this returns the free
+        // pages left in the C heap, without holding up Python requests
+        malloc_trim(0);
+#endif
+        auto end = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(recycleMutex);
+            lastRecycle = end;
+            if (recycled) {
+                ++recycleStats.recycles;
+                recycleStats.lastReason = reason;
+                recycleStats.lastDuration = elapsedSince(start);
+                recycleStats.residentBytesBefore = residentBefore;
+                recycleStats.residentBytesAfter = residentBytes();
+                requestsSinceRecycle.store(0);
+            } else {
+                ++recycleStats.failures;
+            }
+        }
+        recycling.store(false);
+        LOG_F(INFO, "Recycle (%s) %s in %lld us", reason.c_str(), recycled ? "done" : "failed",
+            static_cast<long long>(elapsedSince(start).count()));
+        return recycled;
+    }
+
+    void recordTrace(std::string_view jsonInput) {
+        if (traceRecording.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(traceMutex);
+            if (traceWriter) {
+                // A trace is a diagnostic; it never fails the request
+                try {
+                    traceWriter->record(jsonInput);
+                } catch (const std::exception& e) {
+                    LOG_F(WARNING, "Failed to record request trace: %s", e.what());
+                }
+            }
+        }
+    }
+
+    std::expected<ResponseHandle, ProcessError> processRequest(std::string_view jsonInput, bool borrow,
+        const RequestSpans& spans) {
+        recordTrace(jsonInput);
+        if (!memoryAccounting.load(std::memory_order_relaxed)) {
+            return callProcessor(jsonInput, borrow, nullptr, spans);
+        }
+
+        std::string requestType(peekTopLevelString(jsonInput, "type").value_or("unknown"));
+        PythonMemorySample pythonSample;
+        std::expected<ResponseHandle, ProcessError> result;
+        std::size_t rawPeak = 0;
+        std::int64_t rawRetained = 0;
+        std::size_t libraryBytes = 0;
+        {
+            AllocationScope scope;
+            result = callProcessor(jsonInput, borrow, &pythonSample, spans);
+            if (result) {
+                // The response body, built or copied in C++ (accounting never borrows)
+                countLibraryAllocation(result->body().size() + 1);
+            }
+            rawPeak = scope.peakBytes();
+            rawRetained = scope.retainedBytes();
+            libraryBytes = scope.libraryBytes();
+        }
+
+        std::lock_guard<std::mutex> lock(memoryStatsMutex);
+        RequestMemoryStats& stats = memoryStats[requestType];
+        ++stats.requests;
+        stats.pythonPeakBytes = std::max(stats.pythonPeakBytes, pythonSample.peakBytes);
+        stats.pythonRetainedBytes += pythonSample.retainedBytes;
+        stats.rawPeakBytes = std::max(stats.rawPeakBytes, rawPeak);
+        stats.rawRetainedBytes += rawRetained;
+        stats.cppPeakBytes = std::max(stats.cppPeakBytes, libraryBytes);
+        // tracemalloc traces the raw domain as well, so rawPeak is part of the Python peak already
+        memoryHighWaterMark = std::max(memoryHighWaterMark, pythonSample.peakBytes + libraryBytes);
+        return result;
+    }
+    
+    bool isInitialized() const {
+        return initialized;
+    }
+
+    StartupTiming getStartupTiming() const {
+        return startupTiming;
+    }
+
+    std::vector<std::string> getLoadedPlugins() const {
+        return plugins.loaded();
+    }
+    
+    std::string getLastError() const {
+        return initError;
+    }
+
+    void setMemoryAccountingEnabled(bool enabled) {
+        if (!initialized || memoryAccounting.load() == enabled) {
+            return;
+        }
+
+        GilGuard gil;
+        try {
+            bp::object tracemalloc = bp::import("tracemalloc");
+            if (enabled) {
+                // tracemalloc chains in front of the raw hook and restores it on stop
+                installRawAllocationHook();
+                if (tracemallocUsers == 0 && !bp::extract<bool>(tracemalloc.attr("is_tracing")())) {
+                    tracemalloc.attr("start")();
+                    tracemallocStarted = true;
+                }
+                ++tracemallocUsers;
+                getTracedMemory = tracemalloc.attr("get_traced_memory");
+                resetTracedPeak = tracemalloc.attr("reset_peak");
+            } else {
+                if (--tracemallocUsers == 0 && tracemallocStarted) {
+                    tracemalloc.attr("stop")();
+                    tracemallocStarted = false;
+                }
+                removeRawAllocationHook();
+            }
+            memoryAccounting.store(enabled);
+            LOG_F(INFO, "Memory accounting %s", enabled ? "enabled" : "disabled");
+        } catch (const bp::error_already_set&) {
+            LOG_F(ERROR, "Failed to toggle tracemalloc:");
+            PyErr_Print();
+            PyErr_Clear();
+        }
+    }
+
+    bool isMemoryAccountingEnabled() const {
+        return memoryAccounting.load();
+    }
+
+    std::map<std::string, RequestMemoryStats> getMemoryStats() const {
+        std::lock_guard<std::mutex> lock(memoryStatsMutex);
+        return memoryStats;
+    }
+
+    std::size_t getMemoryHighWaterMark() const {
+        std::lock_guard<std::mutex> lock(memoryStatsMutex);
+        return memoryHighWaterMark;
+    }
+
+    void resetMemoryStats() {
+        std::lock_guard<std::mutex> lock(memoryStatsMutex);
+        memoryStats.clear();
+        memoryHighWaterMark = 0;
+    }
+
+    bool startTraceRecording(const std::string& path) {
+        try {
+            auto writer = std::make_unique<RequestTraceWriter>(path);
+            std::lock_guard<std::mutex> lock(traceMutex);
+            traceWriter = std::move(writer);
+            traceRecording.store(true);
+            LOG_F(INFO, "Recording requests to %s", path.c_str());
+            return true;
+        } catch (const std::exception& e) {
+            LOG_F(ERROR, "Failed to start trace recording: %s", e.what());
+            return false;
+        }
+    }
+
+    void stopTraceRecording() {
+        std::lock_guard<std::mutex> lock(traceMutex);
+        traceRecording.store(false);
+        traceWriter.reset();
+    }
+
+    bool isTraceRecording() const {
+        return traceRecording.load();
+    }
+
+    bool startSpanTracing(const std::string& path) {
+        if (!initialized) {
+            LOG_F(ERROR, "Cannot trace spans: Python processor not initialized");
+            return false;
+        }
+        std::shared_ptr<SpanTraceWriter> writer;
+        try {
+            writer = std::make_shared<SpanTraceWriter>(path);
+        } catch (const std::exception& e) {
+            LOG_F(ERROR, "Failed to start span tracing: %s", e.what());
+            return false;
+        }
+
+        {
+            GilGuard gil;
+            try {
+                // Map time.perf_counter_ns() readings onto the steady clock
+                bp::object pythonClock = bp::import("time").attr("perf_counter_ns");
+                auto before = Clock::now();
+                long long pythonNow = bp::extract<long long>(pythonClock());
+                auto after = Clock::now();
+                pythonClockOffset = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    (before + (after - before) / 2).time_since_epoch()) - std::chrono::nanoseconds(pythonNow);
+            } catch (const bp::error_already_set&) {
+                LOG_F(ERROR, "Failed to read processor.py's clock for span tracing: %s", fetchPythonError().c_str());
+                return false;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(spanMutex);
+        spanWriter = std::move(writer);
+        spanTracing.store(true);
+        LOG_F(INFO, "Tracing request spans to %s", path.c_str());
+        return true;
+    }
+
+    void stopSpanTracing() {
+        {
+            std::lock_guard<std::mutex> lock(spanMutex);
+            spanTracing.store(false);
+            spanWriter.reset();
+        }
+        // The file is closed once requests still in flight drop their reference
+    }
+
+    bool isSpanTracing() const {
+        return spanTracing.load();
+    }
+    
+private:
+    std::expected<ResponseHandle, ProcessError> callProcessor(std::string_view jsonInput, bool borrow,
+        PythonMemorySample* pythonSample, const RequestSpans& spans) {
+        LOG_F(INFO, "Processing JSON input: %.*s...", static_cast<int>(std::min<std::size_t>(jsonInput.size(), 100)), jsonInput.data());
         
         if (!initialized) {
-            LOG_F(ERROR, "Python processor not initialized: %s", lastError.c_str());
-            return R"({"success": false, "error": "Python processor not initialized: )" + lastError + R"("})";
+            LOG_F(ERROR, "Python processor not initialized: %s", initError.c_str());
+            return std::unexpected(ProcessError{ProcessErrorCode::NotInitialized, initError});
         }
         
+        auto phase = Clock::now();
+        if (auto response = dispatchNative(jsonInput)) {
+            spans.record("native_handler", phase, Clock::now());
+            if (!*response) {
+                return std::unexpected(std::move(response->error()));
+            }
+            return ResponseHandle(std::move((*response)->body), true);
+        }
+        
+        phase = Clock::now();
+        auto rejection = requestValidator.load()->reject(jsonInput);
+        spans.record("validate", phase, Clock::now());
+        if (rejection) {
+            LOG_F(INFO, "Request rejected by schema checks");
+            return ResponseHandle(std::move(*rejection), true);
+        }
+
+        std::optional<std::string> cacheKey = resultCacheKey(jsonInput);
+        std::uint64_t cacheVersion = 0;
+        if (cacheKey) {
+            phase = Clock::now();
+            auto cached = resultCache->find(*cacheKey);
+            spans.record("result_cache", phase, Clock::now());
+            if (cached) {
+                return ResponseHandle(std::move(*cached), true);
+            }
+            cacheVersion = resultCache->version();
+        }
+        auto result = callPython(jsonInput, borrow, pythonSample, spans);
+        if (cacheKey && result && result->body().starts_with(kSuccessPrefix)) {
+            resultCache->insert(*cacheKey, result->body(), cacheVersion);
+        }
+        return result;
+    }
+
+    // The Python part of callProcessor
+    std::expected<ResponseHandle, ProcessError> callPython(std::string_view jsonInput, bool borrow,
+        PythonMemorySample* pythonSample, const RequestSpans& spans) {
         LOG_F(INFO, "Acquiring GIL for processing...");
-        PyGILState_STATE gstate = PyGILState_Ensure();
+        GcMonitor::RequestScope gcRequest(gcMonitor);
+        auto gilRequested = Clock::now();
+        std::unique_lock<std::mutex> accounted;
+        if (pythonSample) {
+            accounted = std::unique_lock<std::mutex>(accountedPythonMutex);
+        }
+        GilGuard gil;
+        auto gilAcquired = Clock::now();
+        performance.recordGilWait(gilAcquired - gilRequested);
+        spans.record("gil_wait", gilRequested, gilAcquired);
         
         try {
+            std::size_t tracedBefore = 0;
+            if (pythonSample) {
+                resetTracedPeak();
+                tracedBefore = bp::extract<std::size_t>(getTracedMemory()[0]);
+            }
+
             LOG_F(INFO, "Calling Python function...");
-            // Call the Python function
-            bp::object result = processFunction(jsonInput);
-            
+            std::optional<ResponseHandle> response = callProcessFunction(jsonInput, borrow && !pythonSample, spans);
+            if (!response) {
+                ProcessError error{ProcessErrorCode::PythonException, fetchPythonError()};
+                LOG_F(ERROR, "Python error: %s", error.message.c_str());
+                return std::unexpected(std::move(error));
+            }
             LOG_F(INFO, "Python function completed successfully");
-            // Extract the result as a string
-            std::string resultStr = bp::extract<std::string>(result);
-            lastError.clear();
+
+            if (pythonSample) {
+                bp::object traced = getTracedMemory();
+                std::size_t tracedAfter = bp::extract<std::size_t>(traced[0]);
+                std::size_t tracedPeak = bp::extract<std::size_t>(traced[1]);
+                pythonSample->peakBytes = tracedPeak > tracedBefore ? tracedPeak - tracedBefore : 0;
+                pythonSample->retainedBytes = static_cast<std::int64_t>(tracedAfter) - static_cast<std::int64_t>(tracedBefore);
+            }
+            
+            afterPythonRequest(gilAcquired);
             
-            PyGILState_Release(gstate);
             LOG_F(INFO, "JSON processing completed successfully");
-            return resultStr;
+            return std::move(*response);
             
         } catch (const bp::error_already_set&) {
-            LOG_F(ERROR, "Python execution error occurred");
-            // Handle Python exceptions
-            std::stringstream ss;
-            ss << R"({"success": false, "error": "Python execution error: )";
-            
-            if (PyErr_Occurred()) {
-                PyObject *ptype, *pvalue, *ptraceback;
-                PyErr_Fetch(&ptype, &pvalue, &ptraceback);
-                
-                if (pvalue) {
-                    PyObject* str = PyObject_Str(pvalue);
-                    if (str) {
-                        const char* errorStr = PyUnicode_AsUTF8(str);
-                        if (errorStr) {
-                            ss << errorStr;
-                        }
-                        Py_DECREF(str);
-                    }
+            ProcessError error{ProcessErrorCode::PythonException, fetchPythonError()};
+            LOG_F(ERROR, "Python error: %s", error.message.c_str());
+            return std::unexpected(std::move(error));
+        } catch (const std::exception& e) {
+            LOG_F(ERROR, "C++ exception: %s", e.what());
+            return std::unexpected(ProcessError{ProcessErrorCode::InternalError, e.what()});
+        } catch (...) {
+            LOG_F(ERROR, "Unknown C++ exception");
+            return std::unexpected(ProcessError{ProcessErrorCode::InternalError, "unknown exception"});
+        }
+    }
+
+    // callProcessor for a streamed response, without memory accounting
+    std::expected<void, ProcessError> streamProcessor(std::string_view jsonInput, const ChunkSink& sink,
+        std::size_t chunkSize, const RequestSpans& spans) {
+        LOG_F(INFO, "Streaming JSON input: %.*s...", static_cast<int>(std::min<std::size_t>(jsonInput.size(), 100)), jsonInput.data());
+
+        if (!initialized) {
+            LOG_F(ERROR, "Python processor not initialized: %s", initError.c_str());
+            return std::unexpected(ProcessError{ProcessErrorCode::NotInitialized, initError});
+        }
+
+        auto phase = Clock::now();
+        if (auto response = dispatchNative(jsonInput)) {
+            spans.record("native_handler", phase, Clock::now());
+            if (!*response) {
+                return std::unexpected(std::move(response->error()));
+            }
+            deliverInChunks((*response)->body, sink, chunkSize);
+            return {};
+        }
+
+        phase = Clock::now();
+        auto rejection = requestValidator.load()->reject(jsonInput);
+        spans.record("validate", phase, Clock::now());
+        if (rejection) {
+            LOG_F(INFO, "Request rejected by schema checks");
+            deliverInChunks(*rejection, sink, chunkSize);
+            return {};
+        }
+
+        GcMonitor::RequestScope gcRequest(gcMonitor);
+        auto gilRequested = Clock::now();
+        GilGuard gil;
+        auto gilAcquired = Clock::now();
+        performance.recordGilWait(gilAcquired - gilRequested);
+        spans.record("gil_wait", gilRequested, gilAcquired);
+
+        try {
+            bool streamed = processStreamFunction ? callProcessStreamFunction(jsonInput, sink, chunkSize, spans) : [&] {
+                // A processor.py without process_json_stream answers in one piece
+                std::optional<ResponseHandle> response = callProcessFunction(jsonInput, true, spans);
+                if (response) {
+                    GilUnlock unlocked;
+                    deliverInChunks(response->body(), sink, chunkSize);
                 }
-                
-                if (ptype) Py_DECREF(ptype);
-                if (pvalue) Py_DECREF(pvalue);
-                if (ptraceback) Py_DECREF(ptraceback);
-            } else {
-                ss << "Unknown Python error";
+                return response.has_value();
+            }();
+            if (!streamed) {
+                ProcessError error{ProcessErrorCode::PythonException, fetchPythonError()};
+                LOG_F(ERROR, "Python error: %s", error.message.c_str());
+                return std::unexpected(std::move(error));
             }
-            
-            ss << R"("})";
-            lastError = ss.str();
-            PyErr_Clear();
-            PyGILState_Release(gstate);
-            LOG_F(ERROR, "Python error: %s", lastError.c_str());
-            return lastError;
-            
+            afterPythonRequest(gilAcquired);
+            return {};
+        } catch (const bp::error_already_set&) {
+            ProcessError error{ProcessErrorCode::PythonException, fetchPythonError()};
+            LOG_F(ERROR, "Python error: %s", error.message.c_str());
+            return std::unexpected(std::move(error));
         } catch (const std::exception& e) {
-            PyGILState_Release(gstate);
             LOG_F(ERROR, "C++ exception: %s", e.what());
-            lastError = R"({"success": false, "error": "C++ exception: )" + std::string(e.what()) + R"("})";
-            return lastError;
+            return std::unexpected(ProcessError{ProcessErrorCode::InternalError, e.what()});
         } catch (...) {
-            PyGILState_Release(gstate);
             LOG_F(ERROR, "Unknown C++ exception");
-            lastError = R"({"success": false, "error": "Unknown C++ exception"})";
-            return lastError;
+            return std::unexpected(ProcessError{ProcessErrorCode::InternalError, "unknown exception"});
         }
     }
-    
-    bool isInitialized() const {
-        return initialized;
+
+    // Key of a request in the result cache: math and data requests, which are
+    // deterministic, except the stateful sessions. Nothing when there is no
+    // cache or the request should not be cached.
+    std::optional<std::string> resultCacheKey(std::string_view jsonInput) const {
+        if (!resultCache) {
+            return std::nullopt;
+        }
+        auto type = peekTopLevelString(jsonInput, "type");
+        if (type != "math" && type != "data") {
+            return std::nullopt;
+        }
+        if (peekTopLevelString(jsonInput, "operation").value_or("").starts_with("session_")) {
+            return std::nullopt;
+        }
+        return canonicalRequest(jsonInput);
     }
-    
-    std::string getLastError() const {
-        return lastError;
+
+    // Identifies the processor.py responses came from: the bytecode it was
+    // imported from or its source, and the Python version. Nothing when the
+    // source cannot be read. The GIL must be held.
+    std::optional<std::uint64_t> processorVersion() const {
+        std::uint64_t seed = fingerprint(std::to_string(Py_Version >> 16));
+        std::string origin = bp::extract<std::string>(bp::str(processorModule.attr("__spec__").attr("origin")));
+        if (origin == "frozen") {
+            for (const _frozen* entry = PyImport_FrozenModules; entry && entry->name; ++entry) {
+                if (std::string_view(entry->name) == "processor" && entry->code) {
+                    return fingerprint(std::string_view(reinterpret_cast<const char*>(entry->code),
+                        static_cast<std::size_t>(std::abs(entry->size))), seed);
+                }
+            }
+            return std::nullopt;
+        }
+        std::ifstream source(origin, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+        if (!source || bytes.empty()) {
+            return std::nullopt;
+        }
+        return fingerprint(bytes, seed);
     }
-    
-private:
+
+    // Opens the result cache for the imported processor.py; the GIL must be held
+    void openResultCache(const StartupOptions& options) {
+        std::optional<std::uint64_t> version = processorVersion();
+        if (!version) {
+            LOG_F(WARNING, "Cannot tell which processor.py was imported; result cache disabled");
+            return;
+        }
+        try {
+            resultCache = std::make_unique<ResultCache>(options.resultCachePath, *version, options.resultCacheMaxBytes);
+            LOG_F(INFO, "Result cache %s holds %zu responses", options.resultCachePath.c_str(), resultCache->size());
+        } catch (const std::exception& e) {
+            LOG_F(WARNING, "Result cache disabled: %s", e.what());
+        }
+    }
+
+    // Bookkeeping after each Python request: samples the heap at most once per
+    // interval and checks the recycle thresholds. The GIL must be held.
+    void afterPythonRequest(Clock::time_point now) {
+        std::uint64_t requests = requestsSinceRecycle.fetch_add(1, std::memory_order_relaxed) + 1;
+        std::optional<std::uint64_t> heapBlocks;
+        if (now - lastHeapSample >= kHeapSampleInterval) {
+            lastHeapSample = now;
+            heapBlocks = bp::extract<std::uint64_t>(getAllocatedBlocks());
+            performance.setPythonHeapBlocks(*heapBlocks);
+        }
+        if (!recycleEnabled.load(std::memory_order_relaxed) || recycleDue.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(recycleMutex);
+        if (now - lastRecycle < recyclePolicy.minInterval) {
+            return;
+        }
+        if (recyclePolicy.maxRequests != 0 && requests >= recyclePolicy.maxRequests) {
+            recycleReason = "requests";
+        } else if (heapBlocks && recyclePolicy.maxHeapBlocks != 0 && *heapBlocks >= recyclePolicy.maxHeapBlocks) {
+            recycleReason = "heap";
+        } else if (heapBlocks && recyclePolicy.maxResidentBytes != 0 && residentBytes() >= recyclePolicy.maxResidentBytes) {
+            recycleReason = "resident";
+        } else {
+            return;
+        }
+        recycleDue.store(true);
+    }
+
+    // Recycles when a request crossed a threshold; call without holding the GIL
+    void recycleIfDue() {
+        if (!recycleDue.load(std::memory_order_relaxed)) {
+            return;
+        }
+        std::string reason;
+        {
+            std::lock_guard<std::mutex> lock(recycleMutex);
+            if (!recycleDue.exchange(false)) {
+                return;
+            }
+            reason = std::move(recycleReason);
+        }
+        recycle(reason);
+    }
+
+    // Imports processor.py again as a new module and switches to it. The old
+    // module goes once requests still running in it let go; modules and their
+    // functions reference each other, so that takes a full collection, with
+    // the startup heap thawed for it if freezeGc froze it. The request schemas
+    // are compiled again from the new module. Returns false, keeping the old
+    // module, if the import fails. The GIL must be held.
+    bool reimportProcessor() {
+        PyObject* modules = PyImport_GetModuleDict();
+        PyObject* registered = PyDict_GetItemString(modules, "processor");
+        Py_XINCREF(registered);
+        if (registered && PyDict_DelItemString(modules, "processor") != 0) {
+            PyErr_Clear();
+        }
+        bp::object fresh;
+        bp::object process;
+        try {
+            fresh = bp::import("processor");
+            process = fresh.attr("process_json");
+        } catch (const bp::error_already_set&) {
+            std::string error = fetchPythonError();
+            if (registered) {
+                PyDict_SetItemString(modules, "processor", registered);
+            }
+            Py_XDECREF(registered);
+            LOG_F(ERROR, "Could not import processor.py again, keeping the old module: %s", error.c_str());
+            return false;
+        }
+        Py_XDECREF(registered);
+
+        processorModule = fresh;
+        processFunction = process;
+        processStreamFunction = PyObject_HasAttrString(fresh.ptr(), "process_json_stream")
+            ? fresh.attr("process_json_stream") : bp::object();
+        if (validateRequests) {
+            compileRequestSchemas();
+        }
+        // A processor.py edited since it was last imported invalidates the cached responses
+        if (resultCache) {
+            std::optional<std::uint64_t> version = processorVersion();
+            if (version && *version != resultCache->version()) {
+                resultCache->reset(*version);
+            }
+        }
+
+        bp::object gc = bp::import("gc");
+        bool frozen = bp::extract<long>(gc.attr("get_freeze_count")()) > 0;
+        if (frozen) {
+            gc.attr("unfreeze")();
+        }
+        gc.attr("collect")();
+        if (frozen) {
+            gc.attr("freeze")();
+        }
+        PyType_ClearCache();
+        return true;
+    }
+
+    // Iterates process_json_stream(request, chunkSize), releasing the GIL
+    // while sink consumes each chunk so other requests can run meanwhile.
+    // Returns false with a Python error set on failure; the GIL must be held.
+    bool callProcessStreamFunction(std::string_view jsonInput, const ChunkSink& sink, std::size_t chunkSize,
+        const RequestSpans& spans) const {
+        PyObject* argument = PyUnicode_FromStringAndSize(jsonInput.data(), static_cast<Py_ssize_t>(jsonInput.size()));
+        PyObject* size = argument ? PyLong_FromSize_t(chunkSize) : nullptr;
+        bp::handle<> stages(bp::allow_null(size && spans ? PyList_New(0) : nullptr));
+        if (!size || (spans && !stages)) {
+            Py_XDECREF(argument);
+            Py_XDECREF(size);
+            return false;
+        }
+        PyObject* arguments[] = {nullptr, argument, size, stages.get()};
+        // A reference of our own, in case a recycle swaps the module meanwhile
+        bp::object function = processStreamFunction;
+        auto callStart = Clock::now();
+        bp::handle<> chunks(bp::allow_null(PyObject_Vectorcall(function.ptr(), arguments + 1,
+            (stages ? 3 : 2) | PY_VECTORCALL_ARGUMENTS_OFFSET, nullptr)));
+        Py_DECREF(argument);
+        Py_DECREF(size);
+        bool streamed = chunks && streamChunks(chunks.get(), sink);
+        spans.record("python_stream", callStart, Clock::now());
+        if (stages) {
+            drainPythonSpans(spans, stages.get());
+        }
+        return streamed;
+    }
+
+    // Hands the str chunks of a process_json_stream result to sink until
+    // either runs out. Returns false with a Python error set on failure; the
+    // GIL must be held.
+    static bool streamChunks(PyObject* chunks, const ChunkSink& sink) {
+        bp::handle<> iterator(bp::allow_null(PyObject_GetIter(chunks)));
+        if (!iterator) {
+            return false;
+        }
+
+        // Stopping early drops the generator, which closes it
+        while (bp::handle<> chunk{bp::allow_null(PyIter_Next(iterator.get()))}) {
+            Py_ssize_t length = 0;
+            const char* text = PyUnicode_Check(chunk.get()) ? PyUnicode_AsUTF8AndSize(chunk.get(), &length) : nullptr;
+            if (!text) {
+                if (!PyErr_Occurred()) {
+                    PyErr_Format(PyExc_TypeError, "process_json_stream yielded %s, expected str", Py_TYPE(chunk.get())->tp_name);
+                }
+                return false;
+            }
+            GilUnlock unlocked;
+            if (!sink(std::string_view(text, static_cast<std::size_t>(length)))) {
+                break;
+            }
+        }
+        return !PyErr_Occurred();
+    }
+
+    // Calls process_json through vectorcall with the request, and for a
+    // traced request a list for its stage spans, as arguments, skipping
+    // boost::python's argument conversion. The response is read through the
+    // UTF-8 buffer the str caches (its own data when it is ASCII) and either
+    // copied or kept alive in the handle. Returns nothing with a Python error
+    // set on failure; the GIL must be held.
+    std::optional<ResponseHandle> callProcessFunction(std::string_view jsonInput, bool borrow,
+        const RequestSpans& spans) const {
+        PyObject* argument = PyUnicode_FromStringAndSize(jsonInput.data(), static_cast<Py_ssize_t>(jsonInput.size()));
+        bp::handle<> stages(bp::allow_null(argument && spans ? PyList_New(0) : nullptr));
+        if (!argument || (spans && !stages)) {
+            Py_XDECREF(argument);
+            return std::nullopt;
+        }
+        // The slot before the arguments is scratch space for the callee
+        PyObject* arguments[] = {nullptr, argument, stages.get()};
+        // A reference of our own: the call can let go of the GIL, and a
+        // recycle on another thread would drop the module's
+        bp::object function = processFunction;
+        auto callStart = Clock::now();
+        PyObject* result = PyObject_Vectorcall(function.ptr(), arguments + 1,
+            (stages ? 2 : 1) | PY_VECTORCALL_ARGUMENTS_OFFSET, nullptr);
+        auto callEnd = Clock::now();
+        Py_DECREF(argument);
+        spans.record("python_call", callStart, callEnd);
+        if (stages) {
+            drainPythonSpans(spans, stages.get());
+        }
+        if (!result) {
+            return std::nullopt;
+        }
+
+        Py_ssize_t size = 0;
+        const char* text = PyUnicode_Check(result) ? PyUnicode_AsUTF8AndSize(result, &size) : nullptr;
+        if (!text) {
+            if (!PyErr_Occurred()) {
+                PyErr_Format(PyExc_TypeError, "process_json returned %s, expected str", Py_TYPE(result)->tp_name);
+            }
+            Py_DECREF(result);
+            return std::nullopt;
+        }
+        std::string_view body(text, static_cast<std::size_t>(size));
+        if (borrow) {
+            spans.record("extract", callEnd, Clock::now());
+            return ResponseHandle(body, ResponseHandle::Owner(result, releasePythonObject), false);
+        }
+        ResponseHandle copy(std::string(body), false);
+        Py_DECREF(result);
+        spans.record("extract", callEnd, Clock::now());
+        return copy;
+    }
+
+    // A request ID and the current writer while span tracing is on
+    RequestSpans beginSpans() {
+        if (!spanTracing.load(std::memory_order_relaxed)) {
+            return {};
+        }
+        std::lock_guard<std::mutex> lock(spanMutex);
+        return {spanWriter, spanWriter ? nextRequestId++ : 0};
+    }
+
+    // Moves the stage spans processor.py appended to one request's list into
+    // the trace, keeping a pending Python error; the GIL must be held
+    void drainPythonSpans(const RequestSpans& spans, PyObject* stages) const {
+        PyObject *type, *value, *traceback;
+        PyErr_Fetch(&type, &value, &traceback);
+        Py_ssize_t count = PyList_GET_SIZE(stages);
+        for (Py_ssize_t i = 0; i < count; ++i) {
+            const char* name = nullptr;
+            long long start = 0, end = 0;
+            if (!PyArg_ParseTuple(PyList_GET_ITEM(stages, i), "sLL", &name, &start, &end)) {
+                PyErr_Clear();
+                continue;
+            }
+            spans.record(name, fromPythonClock(start), fromPythonClock(end), "python");
+        }
+        PyErr_Restore(type, value, traceback);
+    }
+
+    Clock::time_point fromPythonClock(long long nanoseconds) const {
+        return Clock::time_point(std::chrono::duration_cast<Clock::duration>(
+            std::chrono::nanoseconds(nanoseconds) + pythonClockOffset));
+    }
+
+    // Takes the pending Python exception and returns its str(); the GIL must be held
+    static std::string fetchPythonError() {
+        std::string message = "Unknown Python error";
+        PyObject *ptype, *pvalue, *ptraceback;
+        PyErr_Fetch(&ptype, &pvalue, &ptraceback);
+        if (pvalue) {
+            if (PyObject* str = PyObject_Str(pvalue)) {
+                Py_ssize_t size = 0;
+                if (const char* text = PyUnicode_AsUTF8AndSize(str, &size)) {
+                    message.assign(text, static_cast<std::size_t>(size));
+                }
+                Py_DECREF(str);
+            }
+        }
+        Py_XDECREF(ptype);
+        Py_XDECREF(pvalue);
+        Py_XDECREF(ptraceback);
+        PyErr_Clear();
+        return message;
+    }
+
+    // Runs the request through a native handler if one is registered for its
+    // type and operation; returns nothing when it should go to Python instead
+    std::optional<std::expected<Response, ProcessError>> dispatchNative(std::string_view jsonInput) const {
+        auto type = peekTopLevelString(jsonInput, "type");
+        if (!type) {
+            return std::nullopt;
+        }
+        auto operation = peekTopLevelString(jsonInput, "operation").value_or("");
+        if (auto handled = dispatchPlugin(*type, operation, jsonInput)) {
+            return handled;
+        }
+        const native::Handler* handler = nativeHandlers.find(*type, operation);
+        if (!handler) {
+            return std::nullopt;
+        }
+
+        // Leave malformed documents to Python so the error message stays the same
+        native::json request = native::json::parse(jsonInput, nullptr, false);
+        if (request.is_discarded() || !request.is_object()) {
+            return std::nullopt;
+        }
+        if (AllocationScope::active()) {
+            countLibraryAllocation(native::heapBytes(request));
+        }
+
+        LOG_F(INFO, "Dispatching %.*s/%.*s to native handler", static_cast<int>(type->size()), type->data(),
+            static_cast<int>(operation.size()), operation.data());
+        try {
+            if (auto body = (*handler)(request)) {
+                return Response{std::move(*body), true};
+            }
+            return std::nullopt;
+        } catch (const std::exception& e) {
+            LOG_F(ERROR, "Native handler failed: %s", e.what());
+            return std::unexpected(ProcessError{ProcessErrorCode::NativeHandlerFailed, e.what()});
+        }
+    }
+
+    // Plugins see requests before the built-in handlers, so they can replace them
+    std::optional<std::expected<Response, ProcessError>> dispatchPlugin(std::string_view type, std::string_view operation,
+        std::string_view jsonInput) const {
+        if (!plugins.handles(type, operation)) {
+            return std::nullopt;
+        }
+        // Plugins only get well-formed objects; Python reports everything else
+        JsonValidation validation = validateJson(jsonInput);
+        if (validation.status != JsonValidation::Status::Valid || !validation.object) {
+            return std::nullopt;
+        }
+        auto handled = plugins.dispatch(type, operation, jsonInput);
+        if (!handled) {
+            return std::nullopt;
+        }
+        if (!*handled) {
+            LOG_F(ERROR, "Plugin handler failed: %s", handled->error().c_str());
+            return std::unexpected(ProcessError{ProcessErrorCode::NativeHandlerFailed, std::move(handled->error())});
+        }
+        return Response{std::move(**handled), true};
+    }
+
+    // Compiles processor.py's REQUEST_SCHEMAS into requestValidator. Without a
+    // usable table every request goes to Python. The GIL must be held.
+    void compileRequestSchemas() {
+        auto validator = std::make_shared<RequestValidator>();
+        if (!PyObject_HasAttrString(processorModule.ptr(), "REQUEST_SCHEMAS")) {
+            LOG_F(WARNING, "processor.py has no REQUEST_SCHEMAS; requests are not validated before Python");
+        } else {
+            try {
+                bp::object schemas = processorModule.attr("REQUEST_SCHEMAS");
+                bp::object table = bp::import("json").attr("dumps")(schemas);
+                *validator = RequestValidator::compile(native::json::parse(bp::extract<std::string>(table)()));
+                LOG_F(INFO, "Compiled request schemas");
+            } catch (const bp::error_already_set&) {
+                LOG_F(ERROR, "Could not read REQUEST_SCHEMAS: %s", fetchPythonError().c_str());
+            } catch (const std::exception& e) {
+                LOG_F(ERROR, "Could not compile REQUEST_SCHEMAS: %s", e.what());
+            }
+        }
+        requestValidator.store(std::move(validator));
+    }
+
+    // Only written by the constructor
     bool initialized;
-    std::string lastError;
+    std::string initError;
+    StartupTiming startupTiming;
+    native::HandlerRegistry nativeHandlers;
+    PluginRegistry plugins;
+    bool validateRequests = false;
+    // Read by every request without the GIL; swapped by recycling
+    std::atomic<std::shared_ptr<const RequestValidator>> requestValidator{std::make_shared<const RequestValidator>()};
+
+    // Opened by the constructor
+    std::unique_ptr<ResultCache> resultCache;
+
+    // Swapped by recycling; guarded by the GIL
     bp::object processorModule;
     bp::object processFunction;
+    bp::object processStreamFunction;
+
+    // The policy, stats, pending reason and lastRecycle are guarded by recycleMutex
+    mutable std::mutex recycleMutex;
+    RecyclePolicy recyclePolicy;
+    RecycleStats recycleStats;
+    std::string recycleReason;
+    Clock::time_point lastRecycle;
+    std::atomic<bool> recycleEnabled{false};
+    std::atomic<bool> recycleDue{false};
+    std::atomic<bool> recycling{false};
+    std::atomic<std::uint64_t> requestsSinceRecycle{0};
+
+    PerformanceCounters performance;
+    GcMonitor gcMonitor{performance};
+    // Python heap size is read while a request already holds the GIL, at most
+    // once per interval; lastHeapSample is guarded by the GIL
+    static constexpr auto kHeapSampleInterval = std::chrono::milliseconds(100);
+    Clock::time_point lastHeapSample;
+    bp::object getAllocatedBlocks;
+
+    std::atomic<bool> memoryAccounting{false};
+    bp::object getTracedMemory;
+    bp::object resetTracedPeak;
+    mutable std::mutex memoryStatsMutex;
+    std::map<std::string, RequestMemoryStats> memoryStats;
+    std::size_t memoryHighWaterMark = 0;
+
+    std::atomic<bool> traceRecording{false};
+    std::mutex traceMutex;
+    std::unique_ptr<RequestTraceWriter> traceWriter;
+
+    std::atomic<bool> spanTracing{false};
+    std::mutex spanMutex;
+    std::shared_ptr<SpanTraceWriter> spanWriter;
+    std::uint64_t nextRequestId = 1;
+    // Guarded by the GIL
+    std::chrono::nanoseconds pythonClockOffset{0};
 };
 
 // PythonProcessor implementation
-PythonProcessor::PythonProcessor() : pImpl(std::make_unique<Impl>()) {}
+PythonProcessor::PythonProcessor(const StartupOptions& options) : pImpl(std::make_unique<Impl>(options)) {}
 
 PythonProcessor::~PythonProcessor() = default;
 
+std::string_view describe(ProcessErrorCode code) {
+    switch (code) {
+        case ProcessErrorCode::NotInitialized: return "Python processor not initialized";
+        case ProcessErrorCode::PythonException: return "Python execution error";
+        case ProcessErrorCode::NativeHandlerFailed: return "Processing error";
+        case ProcessErrorCode::InternalError: return "C++ exception";
+    }
+    return "Unknown error";
+}
+
+Response ResponseHandle::toResponse() && {
+    if (owner) {
+        return Response{std::string(borrowed), native};
+    }
+    return Response{std::move(owned), native};
+}
+
+std::expected<Response, ProcessError> PythonProcessor::process(std::string_view jsonInput) {
+    auto result = pImpl->process(jsonInput, false);
+    if (!result) {
+        return std::unexpected(std::move(result.error()));
+    }
+    return std::move(*result).toResponse();
+}
+
+std::expected<ResponseHandle, ProcessError> PythonProcessor::processView(std::string_view jsonInput) {
+    return pImpl->process(jsonInput, true);
+}
+
+std::expected<void, ProcessError> PythonProcessor::processStream(std::string_view jsonInput, const ChunkSink& sink,
+    std::size_t chunkSize) {
+    return pImpl->processStream(jsonInput, sink, chunkSize);
+}
+
 std::string PythonProcessor::processJson(const std::string& jsonInput) {
-    return pImpl->processJson(jsonInput);
+    auto result = pImpl->process(jsonInput, false);
+    if (!result) {
+        std::string message(describe(result.error().code));
+        message += ": ";
+        message += result.error().message;
+        return native::errorResponse(message);
+    }
+    return std::move(*result).toResponse().body;
 }
 
 bool PythonProcessor::isInitialized() const {
@@ -250,3 +1420,79 @@ bool PythonProcessor::isInitialized() const {
 std::string PythonProcessor::getLastError() const {
     return pImpl->getLastError();
 }
+
+StartupTiming PythonProcessor::getStartupTiming() const {
+    return pImpl->getStartupTiming();
+}
+
+std::vector<std::string> PythonProcessor::getLoadedPlugins() const {
+    return pImpl->getLoadedPlugins();
+}
+
+PerformanceSample PythonProcessor::samplePerformance() const {
+    return pImpl->samplePerformance();
+}
+
+GcStats PythonProcessor::getGcStats() const {
+    return pImpl->getGcStats();
+}
+
+void PythonProcessor::setMemoryAccountingEnabled(bool enabled) {
+    pImpl->setMemoryAccountingEnabled(enabled);
+}
+
+bool PythonProcessor::isMemoryAccountingEnabled() const {
+    return pImpl->isMemoryAccountingEnabled();
+}
+
+std::map<std::string, RequestMemoryStats> PythonProcessor::getMemoryStats() const {
+    return pImpl->getMemoryStats();
+}
+
+std::size_t PythonProcessor::getMemoryHighWaterMark() const {
+    return pImpl->getMemoryHighWaterMark();
+}
+
+void PythonProcessor::resetMemoryStats() {
+    pImpl->resetMemoryStats();
+}
+
+void PythonProcessor::setRecyclePolicy(const RecyclePolicy& policy) {
+    pImpl->setRecyclePolicy(policy);
+}
+
+RecyclePolicy PythonProcessor::getRecyclePolicy() const {
+    return pImpl->getRecyclePolicy();
+}
+
+bool PythonProcessor::recycle() {
+    return pImpl->recycle("manual");
+}
+
+RecycleStats PythonProcessor::getRecycleStats() const {
+    return pImpl->getRecycleStats();
+}
+
+bool PythonProcessor::startTraceRecording(const std::string& path) {
+    return pImpl->startTraceRecording(path);
+}
+
+void PythonProcessor::stopTraceRecording() {
+    pImpl->stopTraceRecording();
+}
+
+bool PythonProcessor::isTraceRecording() const {
+    return pImpl->isTraceRecording();
+}
+
+bool PythonProcessor::startSpanTracing(const std::string& path) {
+    return pImpl->startSpanTracing(path);
+}
+
+void PythonProcessor::stopSpanTracing() {
+    pImpl->stopSpanTracing();
+}
+
+bool PythonProcessor::isSpanTracing() const {
+    return pImpl->isSpanTracing();
+}
@@ -0,0 +1,1081 @@
+#include "regex_engine.h"
+
+#include <algorithm>
+#include <fmt/format.h>
+#include <stdexcept>
+#include <tuple>
+
+namespace regex {
+
+namespace {
+
+constexpr std::size_t npos = std::string_view::npos;
+constexpr std::size_t kMaxRepeat = 1000;
+constexpr std::size_t kMaxProgram = 10000;
+constexpr std::size_t kMaxGroups = 100;
+constexpr char32_t kMaxCodePoint = 0x10FFFF;
+
+using Ranges = std::vector<std::pair<char32_t, char32_t>>;
+
+const Ranges kDigit{{'0', '9'}};
+const Ranges kWord{{'0', '9'}, {'A', 'Z'}, {'_', '_'}, {'a', 'z'}};
+const Ranges kSpace{{'\t', '\r'}, {' ', ' '}};
+
+// Decodes the code point starting at text[i] and stores its length in bytes
+char32_t decode(std::string_view text, std::size_t i, std::size_t& length) {
+    auto byte = static_cast<unsigned char>(text[i]);
+    length = byte < 0x80 ? 1 : byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : 2;
+    if (length == 1 || i + length > text.size()) {
+        length = 1;
+        return byte;
+    }
+    char32_t codePoint = byte & (0x3F >> (length - 1));
+    for (std::size_t j = 1; j < length; ++j) {
+        codePoint = (codePoint << 6) | (static_cast<unsigned char>(text[i + j]) & 0x3F);
+    }
+    return codePoint;
+}
+
+void encode(char32_t c, std::string& out) {
+    if (c < 0x80) {
+        out += static_cast<char>(c);
+    } else if (c < 0x800) {
+        out += static_cast<char>(0xC0 | (c >> 6));
+        out += static_cast<char>(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        out += static_cast<char>(0xE0 | (c >> 12));
+        out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (c & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (c >> 18));
+        out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (c & 0x3F));
+    }
+}
+
+bool isWordByte(char byte) {
+    return (byte >= '0' && byte <= '9') || (byte >= 'A' && byte <= 'Z') || (byte >= 'a' && byte <= 'z') || byte == '_';
+}
+
+bool isAsciiLetter(char32_t c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// Sorted with overlapping and adjacent ranges merged
+Ranges normalize(Ranges ranges) {
+    std::sort(ranges.begin(), ranges.end());
+    Ranges merged;
+    for (const auto& range : ranges) {
+        if (!merged.empty() && range.first <= merged.back().second + 1) {
+            merged.back().second = std::max(merged.back().second, range.second);
+        } else {
+            merged.push_back(range);
+        }
+    }
+    return merged;
+}
+
+Ranges complement(const Ranges& ranges) {
+    Ranges result;
+    char32_t next = 0;
+    for (const auto& [first, last] : ranges) {
+        if (first > next) {
+            result.emplace_back(next, first - 1);
+        }
+        next = last + 1;
+    }
+    if (next <= kMaxCodePoint) {
+        result.emplace_back(next, kMaxCodePoint);
+    }
+    return result;
+}
+
+// Adds the other case of every ASCII letter in the ranges
+Ranges foldCase(const Ranges& ranges) {
+    Ranges folded = ranges;
+    for (const auto& [first, last] : ranges) {
+        for (auto [low, high, shift] : {std::tuple<char32_t, char32_t, int>{'A', 'Z', 32}, {'a', 'z', -32}}) {
+            char32_t begin = std::max(first, low);
+            char32_t end = std::min(last, high);
+            if (begin <= end) {
+                folded.emplace_back(static_cast<char32_t>(static_cast<int>(begin) + shift),
+                                    static_cast<char32_t>(static_cast<int>(end) + shift));
+            }
+        }
+    }
+    return normalize(std::move(folded));
+}
+
+int hexValue(char c) {
+    if (isDigit(c)) {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool isOctal(char c) {
+    return c >= '0' && c <= '7';
+}
+
+// A replacement template split into literal text and group references
+struct TemplatePiece {
+    std::string literal;
+    std::size_t group = npos;
+};
+
+} // namespace
+
+bool Pattern::CharClass::contains(char32_t c) const {
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), c,
+        [](char32_t value, const std::pair<char32_t, char32_t>& range) { return value < range.first; });
+    return it != ranges.begin() && c <= std::prev(it)->second;
+}
+
+// Recursive descent over the pattern into a syntax tree, which is then
+// emitted as the VM program
+class Pattern::Parser {
+public:
+    Parser(std::string_view source, Pattern& pattern) : source(source), pattern(pattern) {}
+
+    void compile() {
+        Node root = parseAlternation();
+        if (pos < source.size()) {
+            fail("unbalanced parenthesis");
+        }
+        emit({Op::Save, Assertion::TextStart, 0, 0, 0});
+        emit(root);
+        emit({Op::Save, Assertion::TextStart, 0, 1, 0});
+        emit({Op::Match});
+
+        std::size_t pc = 0;
+        while (pattern.program[pc].op == Op::Save || pattern.program[pc].op == Op::Jump) {
+            pc = pattern.program[pc].op == Op::Save ? pc + 1 : pattern.program[pc].x;
+        }
+        if (pattern.program[pc].op == Op::Char) {
+            std::string encoded;
+            encode(pattern.program[pc].c, encoded);
+            pattern.firstByte = encoded[0];
+        }
+    }
+
+private:
+    enum class Kind { Empty, Literal, Any, Class, Assert, Group, Concat, Alternate, Repeat };
+
+    struct Node {
+        explicit Node(Kind kind = Kind::Empty) : kind(kind) {}
+
+        Kind kind;
+        char32_t c = 0;
+        std::size_t index = npos;           // class, or capture group (npos: non-capturing)
+        Assertion assertion = Assertion::TextStart;
+        std::size_t min = 0;
+        std::size_t max = 0;                // npos: unbounded
+        bool greedy = true;
+        std::vector<Node> children;
+    };
+
+    [[noreturn]] void fail(std::string_view what) const {
+        throw std::invalid_argument(fmt::format("{} at position {}", what, pos));
+    }
+
+    bool atEnd() const { return pos >= source.size(); }
+    char peek() const { return source[pos]; }
+
+    Node parseAlternation() {
+        Node alternate{Kind::Alternate};
+        alternate.children.push_back(parseConcat());
+        while (!atEnd() && peek() == '|') {
+            ++pos;
+            alternate.children.push_back(parseConcat());
+        }
+        return alternate.children.size() == 1 ? std::move(alternate.children[0]) : alternate;
+    }
+
+    Node parseConcat() {
+        Node concat{Kind::Concat};
+        while (!atEnd() && peek() != '|' && peek() != ')') {
+            concat.children.push_back(parseRepeat());
+        }
+        return concat;
+    }
+
+    Node parseRepeat() {
+        Node atom = parseAtom();
+        std::size_t start = pos;
+        std::size_t min = 0;
+        std::size_t max = 0;
+        if (!parseQuantifier(min, max)) {
+            return atom;
+        }
+        if (atom.kind == Kind::Assert || atom.kind == Kind::Empty) {
+            pos = start;
+            fail("nothing to repeat");
+        }
+        Node repeat{Kind::Repeat};
+        repeat.min = min;
+        repeat.max = max;
+        if (!atEnd() && peek() == '?') {
+            repeat.greedy = false;
+            ++pos;
+        } else if (!atEnd() && peek() == '+') {
+            fail("possessive repeats are not supported");
+        }
+        start = pos;
+        if (parseQuantifier(min, max)) {
+            pos = start;
+            fail("multiple repeat");
+        }
+        repeat.children.push_back(std::move(atom));
+        return repeat;
+    }
+
+    // *, +, ? or a well-formed {m,n}; anything else leaves pos alone
+    bool parseQuantifier(std::size_t& min, std::size_t& max) {
+        if (atEnd()) {
+            return false;
+        }
+        switch (peek()) {
+            case '*': ++pos; min = 0; max = npos; return true;
+            case '+': ++pos; min = 1; max = npos; return true;
+            case '?': ++pos; min = 0; max = 1; return true;
+            case '{': break;
+            default: return false;
+        }
+
+        std::size_t start = pos;
+        auto number = [&](std::size_t& value) {
+            std::size_t begin = pos;
+            value = 0;
+            while (!atEnd() && isDigit(peek())) {
+                value = std::min(value * 10 + static_cast<std::size_t>(peek() - '0'), kMaxRepeat + 1);
+                ++pos;
+            }
+            return pos > begin;
+        };
+        ++pos;
+        bool hasMin = number(min);
+        if (!hasMin) {
+            min = 0;
+        }
+        max = min;
+        bool comma = !atEnd() && peek() == ',';
+        if (comma) {
+            ++pos;
+            if (!number(max)) {
+                max = npos;
+            }
+        }
+        if (atEnd() || peek() != '}' || (!hasMin && !comma)) {
+            // Not a repeat: the brace is a literal, as in re
+            pos = start;
+            return false;
+        }
+        ++pos;
+        if (min > kMaxRepeat || (max != npos && max > kMaxRepeat)) {
+            fail("the repetition number is too large");
+        }
+        if (max != npos && min > max) {
+            fail("min repeat greater than max repeat");
+        }
+        return true;
+    }
+
+    Node parseAtom() {
+        char c = peek();
+        switch (c) {
+            case '(': return parseGroup();
+            case '[': return parseClass();
+            case '.': ++pos; return Node{Kind::Any};
+            case '^': ++pos; return assertion(Assertion::LineStart);
+            case '$': ++pos; return assertion(Assertion::LineEnd);
+            case '\\': return parseEscape();
+            case '*':
+            case '+':
+            case '?':
+                fail("nothing to repeat");
+            case '{': {
+                std::size_t start = pos;
+                std::size_t min = 0;
+                std::size_t max = 0;
+                if (parseQuantifier(min, max)) {
+                    pos = start;
+                    fail("nothing to repeat");
+                }
+                break;
+            }
+            default: break;
+        }
+        std::size_t length = 0;
+        char32_t codePoint = decode(source, pos, length);
+        pos += length;
+        return literal(codePoint);
+    }
+
+    Node parseGroup() {
+        std::size_t start = pos++;
+        std::size_t group = npos;
+        if (!atEnd() && peek() == '?') {
+            ++pos;
+            if (atEnd()) {
+                fail("unexpected end of pattern");
+            }
+            if (peek() == ':') {
+                ++pos;
+            } else if (peek() == '#') {
+                std::size_t close = source.find(')', pos);
+                if (close == npos) {
+                    fail("missing ), unterminated comment");
+                }
+                pos = close + 1;
+                return Node{Kind::Empty};
+            } else if (source.substr(pos).starts_with("P<")) {
+                pos += 2;
+                std::size_t close = source.find('>', pos);
+                if (close == npos) {
+                    fail("missing >, unterminated name");
+                }
+                std::string name(source.substr(pos, close - pos));
+                if (name.empty() || isDigit(name[0]) || !std::all_of(name.begin(), name.end(), isWordByte)) {
+                    fail(fmt::format("bad character in group name '{}'", name));
+                }
+                if (pattern.groupNames.contains(name)) {
+                    fail(fmt::format("redefinition of group name '{}'", name));
+                }
+                pos = close + 1;
+                group = newGroup();
+                pattern.groupNames.emplace(std::move(name), group);
+            } else if (source.substr(pos).starts_with("P=")) {
+                fail("backreferences are not supported by the linear engine");
+            } else if (peek() == '=' || peek() == '!' || source.substr(pos).starts_with("<=") || source.substr(pos).starts_with("<!")) {
+                fail("lookaround is not supported by the linear engine");
+            } else {
+                fail("inline flags and extensions are not supported by the linear engine");
+            }
+        } else {
+            group = newGroup();
+        }
+
+        Node node{Kind::Group};
+        node.index = group;
+        node.children.push_back(parseAlternation());
+        if (atEnd() || peek() != ')') {
+            pos = start;
+            fail("missing ), unterminated subpattern");
+        }
+        ++pos;
+        return node;
+    }
+
+    std::size_t newGroup() {
+        if (pattern.groups == kMaxGroups) {
+            fail("too many groups");
+        }
+        return ++pattern.groups;
+    }
+
+    Node parseClass() {
+        std::size_t start = pos++;
+        bool negated = !atEnd() && peek() == '^';
+        if (negated) {
+            ++pos;
+        }
+        Ranges ranges;
+        bool first = true;
+        while (true) {
+            if (atEnd()) {
+                pos = start;
+                fail("unterminated character set");
+            }
+            if (peek() == ']' && !first) {
+                ++pos;
+                break;
+            }
+            first = false;
+
+            std::size_t itemStart = pos;
+            char32_t low = 0;
+            if (const Ranges* builtin = classEscape()) {
+                ranges.insert(ranges.end(), builtin->begin(), builtin->end());
+                continue;
+            }
+            if (std::optional<Ranges> negatedBuiltin = negatedClassEscape()) {
+                ranges.insert(ranges.end(), negatedBuiltin->begin(), negatedBuiltin->end());
+                continue;
+            }
+            low = classCharacter();
+            if (pos + 1 < source.size() && peek() == '-' && source[pos + 1] != ']') {
+                ++pos;
+                if (classEscape() || negatedClassEscape()) {
+                    pos = itemStart;
+                    fail("bad character range");
+                }
+                char32_t high = classCharacter();
+                if (high < low) {
+                    pos = itemStart;
+                    fail("bad character range");
+                }
+                ranges.emplace_back(low, high);
+            } else {
+                ranges.emplace_back(low, low);
+            }
+        }
+
+        ranges = normalize(std::move(ranges));
+        if (pattern.flags.ignoreCase) {
+            ranges = foldCase(ranges);
+        }
+        if (negated) {
+            ranges = complement(ranges);
+        }
+        return classNode(std::move(ranges));
+    }
+
+    // \d, \w or \s at pos, consumed
+    const Ranges* classEscape() {
+        if (pos + 1 >= source.size() || peek() != '\\') {
+            return nullptr;
+        }
+        const Ranges* ranges = nullptr;
+        switch (source[pos + 1]) {
+            case 'd': ranges = &kDigit; break;
+            case 'w': ranges = &kWord; break;
+            case 's': ranges = &kSpace; break;
+            default: return nullptr;
+        }
+        pos += 2;
+        return ranges;
+    }
+
+    // \D, \W or \S at pos, consumed
+    std::optional<Ranges> negatedClassEscape() {
+        if (pos + 1 >= source.size() || peek() != '\\') {
+            return std::nullopt;
+        }
+        const Ranges* ranges = nullptr;
+        switch (source[pos + 1]) {
+            case 'D': ranges = &kDigit; break;
+            case 'W': ranges = &kWord; break;
+            case 'S': ranges = &kSpace; break;
+            default: return std::nullopt;
+        }
+        pos += 2;
+        return complement(*ranges);
+    }
+
+    // A single character inside a class, where \b is a backspace
+    char32_t classCharacter() {
+        if (peek() == '\\' && pos + 1 < source.size() && source[pos + 1] == 'b') {
+            pos += 2;
+            return '\b';
+        }
+        if (peek() == '\\') {
+            return escapedCharacter();
+        }
+        std::size_t length = 0;
+        char32_t c = decode(source, pos, length);
+        pos += length;
+        return c;
+    }
+
+    Node parseEscape() {
+        if (const Ranges* builtin = classEscape()) {
+            return classNode(pattern.flags.ignoreCase ? foldCase(*builtin) : *builtin);
+        }
+        if (std::optional<Ranges> negated = negatedClassEscape()) {
+            return classNode(std::move(*negated));
+        }
+        if (pos + 1 < source.size()) {
+            switch (source[pos + 1]) {
+                case 'b': pos += 2; return assertion(Assertion::WordBoundary);
+                case 'B': pos += 2; return assertion(Assertion::NotWordBoundary);
+                case 'A': pos += 2; return assertion(Assertion::TextStart);
+                case 'Z': pos += 2; return assertion(Assertion::TextEnd);
+                default: break;
+            }
+        }
+        return literal(escapedCharacter());
+    }
+
+    // The character a backslash escape at pos stands for, consumed
+    char32_t escapedCharacter() {
+        std::size_t start = pos++;
+        if (atEnd()) {
+            fail("bad escape (end of pattern)");
+        }
+        char c = source[pos++];
+        auto hex = [&](std::size_t digits) {
+            char32_t value = 0;
+            for (std::size_t i = 0; i < digits; ++i) {
+                int digit = atEnd() ? -1 : hexValue(peek());
+                if (digit < 0) {
+                    pos = start;
+                    fail(fmt::format("incomplete escape \\{}", c));
+                }
+                value = value * 16 + static_cast<char32_t>(digit);
+                ++pos;
+            }
+            if (value > kMaxCodePoint) {
+                pos = start;
+                fail("bad escape: code point out of range");
+            }
+            return value;
+        };
+        switch (c) {
+            case 'n': return '\n';
+            case 't': return '\t';
+            case 'r': return '\r';
+            case 'f': return '\f';
+            case 'v': return '\v';
+            case 'a': return '\a';
+            case 'x': return hex(2);
+            case 'u': return hex(4);
+            case 'U': return hex(8);
+            case '0': {
+                char32_t value = 0;
+                for (int i = 0; i < 2 && !atEnd() && isOctal(peek()); ++i) {
+                    value = value * 8 + static_cast<char32_t>(source[pos++] - '0');
+                }
+                return value;
+            }
+            default: break;
+        }
+        if (isDigit(c)) {
+            pos = start;
+            fail("backreferences are not supported by the linear engine");
+        }
+        if (isAsciiLetter(static_cast<unsigned char>(c))) {
+            pos = start;
+            fail(fmt::format("bad escape \\{}", c));
+        }
+        std::size_t length = 0;
+        char32_t escaped = decode(source, pos - 1, length);
+        pos += length - 1;
+        return escaped;
+    }
+
+    Node literal(char32_t c) {
+        if (pattern.flags.ignoreCase && isAsciiLetter(c)) {
+            return classNode(foldCase({{c, c}}));
+        }
+        Node node{Kind::Literal};
+        node.c = c;
+        return node;
+    }
+
+    Node classNode(Ranges ranges) {
+        pattern.classes.push_back(CharClass{std::move(ranges)});
+        Node node{Kind::Class};
+        node.index = pattern.classes.size() - 1;
+        return node;
+    }
+
+    static Node assertion(Assertion kind) {
+        Node node{Kind::Assert};
+        node.assertion = kind;
+        return node;
+    }
+
+    std::size_t emit(Instruction instruction) {
+        if (pattern.program.size() == kMaxProgram) {
+            throw std::invalid_argument("pattern is too large for the linear engine");
+        }
+        pattern.program.push_back(instruction);
+        return pattern.program.size() - 1;
+    }
+
+    std::uint32_t here() const {
+        return static_cast<std::uint32_t>(pattern.program.size());
+    }
+
+    void emit(const Node& node) {
+        switch (node.kind) {
+            case Kind::Empty:
+                break;
+            case Kind::Literal:
+                emit({Op::Char, Assertion::TextStart, node.c});
+                break;
+            case Kind::Any:
+                emit({pattern.flags.dotAll ? Op::Any : Op::AnyButNewline});
+                break;
+            case Kind::Class:
+                emit({Op::Class, Assertion::TextStart, 0, static_cast<std::uint32_t>(node.index)});
+                break;
+            case Kind::Assert:
+                emit({Op::Assert, node.assertion});
+                break;
+            case Kind::Group:
+                if (node.index == npos) {
+                    emit(node.children[0]);
+                    break;
+                }
+                emit({Op::Save, Assertion::TextStart, 0, static_cast<std::uint32_t>(2 * node.index)});
+                emit(node.children[0]);
+                emit({Op::Save, Assertion::TextStart, 0, static_cast<std::uint32_t>(2 * node.index + 1)});
+                break;
+            case Kind::Concat:
+                for (const auto& child : node.children) {
+                    emit(child);
+                }
+                break;
+            case Kind::Alternate: {
+                std::vector<std::size_t> exits;
+                for (std::size_t i = 0; i + 1 < node.children.size(); ++i) {
+                    std::size_t split = emit({Op::Split});
+                    pattern.program[split].x = here();
+                    emit(node.children[i]);
+                    exits.push_back(emit({Op::Jump}));
+                    pattern.program[split].y = here();
+                }
+                emit(node.children.back());
+                for (std::size_t exit : exits) {
+                    pattern.program[exit].x = here();
+                }
+                break;
+            }
+            case Kind::Repeat: {
+                const Node& child = node.children[0];
+                for (std::size_t i = 0; i < node.min; ++i) {
+                    emit(child);
+                }
+                if (node.max == npos) {
+                    std::size_t loop = emit({Op::Split});
+                    emit(child);
+                    emit({Op::Jump, Assertion::TextStart, 0, static_cast<std::uint32_t>(loop)});
+                    branch(loop, static_cast<std::uint32_t>(loop + 1), here(), node.greedy);
+                    break;
+                }
+                // Optional copies nested as (x(x)?)?, each able to skip to the end
+                std::vector<std::size_t> splits;
+                for (std::size_t i = node.min; i < node.max; ++i) {
+                    splits.push_back(emit({Op::Split}));
+                    emit(child);
+                }
+                for (std::size_t split : splits) {
+                    branch(split, static_cast<std::uint32_t>(split + 1), here(), node.greedy);
+                }
+                break;
+            }
+        }
+    }
+
+    // Points a Split at its repeat body and its exit, the body first if greedy
+    void branch(std::size_t split, std::uint32_t body, std::uint32_t exit, bool greedy) {
+        pattern.program[split].x = greedy ? body : exit;
+        pattern.program[split].y = greedy ? exit : body;
+    }
+
+    std::string_view source;
+    Pattern& pattern;
+    std::size_t pos = 0;
+};
+
+// Pike VM: the threads of one text position are kept in priority order in a
+// sparse set indexed by program counter, each with its own capture slots, and
+// stepped together to the next position
+class Pattern::Vm {
+public:
+    // slots: capture positions to track, 2 for the whole match only
+    Vm(const Pattern& pattern, std::size_t slots)
+        : pattern(pattern), slots(slots), lists{List(pattern.program.size(), slots), List(pattern.program.size(), slots)},
+          scratch(slots), best(slots) {}
+
+    // Makes search throw std::runtime_error once the threads stepped over the
+    // text, counted across calls, reach steps
+    void limitSteps(std::size_t steps) { maxSteps = steps; }
+
+    std::optional<Match> search(std::string_view text, std::size_t start, bool notEmptyAtStart) {
+        List* current = &lists[0];
+        List* next = &lists[1];
+        current->clear();
+        bool matched = false;
+        std::size_t pos = start;
+        while (true) {
+            if (!matched) {
+                if (current->size == 0 && pattern.firstByte) {
+                    pos = text.find(*pattern.firstByte, pos);
+                    if (pos == npos) {
+                        break;
+                    }
+                }
+                std::fill(scratch.begin(), scratch.end(), npos);
+                add(*current, 0, text, pos, scratch.data());
+            }
+            if (current->size == 0) {
+                break;
+            }
+            steps += current->size;
+            if (steps > maxSteps) {
+                throw std::runtime_error(fmt::format("pattern exceeded its budget of {} steps on this text", maxSteps));
+            }
+
+            bool atEnd = pos >= text.size();
+            std::size_t length = 0;
+            char32_t c = atEnd ? 0 : decode(text, pos, length);
+            next->clear();
+            for (std::size_t i = 0; i < current->size; ++i) {
+                std::uint32_t pc = current->dense[i];
+                const Instruction& instruction = pattern.program[pc];
+                std::size_t* caps = current->caps.data() + pc * slots;
+                bool advance = false;
+                switch (instruction.op) {
+                    case Op::Match:
+                        if (notEmptyAtStart && pos == start && caps[0] == start) {
+                            continue;
+                        }
+                        matched = true;
+                        std::copy_n(caps, slots, best.begin());
+                        // Threads after this one have lower priority
+                        i = current->size;
+                        continue;
+                    case Op::Char: advance = !atEnd && c == instruction.c; break;
+                    case Op::Any: advance = !atEnd; break;
+                    case Op::AnyButNewline: advance = !atEnd && c != '\n'; break;
+                    case Op::Class: advance = !atEnd && pattern.classes[instruction.x].contains(c); break;
+                    default: break;
+                }
+                if (advance) {
+                    add(*next, pc + 1, text, pos + length, caps);
+                }
+            }
+            if (atEnd) {
+                break;
+            }
+            std::swap(current, next);
+            pos += length;
+        }
+
+        if (!matched) {
+            return std::nullopt;
+        }
+        Match match;
+        for (std::size_t slot = 0; slot < slots; slot += 2) {
+            bool set = best[slot] != npos && best[slot + 1] != npos;
+            match.groups.emplace_back(set ? best[slot] : npos, set ? best[slot + 1] : npos);
+        }
+        return match;
+    }
+
+private:
+    struct List {
+        List(std::size_t programSize, std::size_t slots) : dense(programSize), sparse(programSize), caps(programSize * slots) {}
+
+        bool contains(std::uint32_t pc) const { return sparse[pc] < size && dense[sparse[pc]] == pc; }
+        void insert(std::uint32_t pc) { sparse[pc] = static_cast<std::uint32_t>(size); dense[size++] = pc; }
+        void clear() { size = 0; }
+
+        std::vector<std::uint32_t> dense;
+        std::vector<std::uint32_t> sparse;
+        std::size_t size = 0;
+        std::vector<std::size_t> caps;      // slots per program counter
+    };
+
+    // A program counter to follow, or a capture slot to restore once the
+    // threads reached through a Save have been added
+    struct Pending {
+        std::uint32_t pc;
+        std::uint32_t slot;
+        std::size_t value;
+    };
+    static constexpr std::uint32_t kNoSlot = UINT32_MAX;
+
+    // Adds the thread at pc and every thread reachable from it without
+    // consuming text, in priority order; caps is restored before returning
+    void add(List& list, std::uint32_t pc, std::string_view text, std::size_t pos, std::size_t* caps) {
+        stack.push_back({pc, kNoSlot, 0});
+        while (!stack.empty()) {
+            Pending item = stack.back();
+            stack.pop_back();
+            if (item.slot != kNoSlot) {
+                caps[item.slot] = item.value;
+                continue;
+            }
+            if (list.contains(item.pc)) {
+                continue;
+            }
+            list.insert(item.pc);
+            const Instruction& instruction = pattern.program[item.pc];
+            switch (instruction.op) {
+                case Op::Jump:
+                    stack.push_back({instruction.x, kNoSlot, 0});
+                    break;
+                case Op::Split:
+                    stack.push_back({instruction.y, kNoSlot, 0});
+                    stack.push_back({instruction.x, kNoSlot, 0});
+                    break;
+                case Op::Save:
+                    if (instruction.x < slots) {
+                        stack.push_back({0, instruction.x, caps[instruction.x]});
+                        caps[instruction.x] = pos;
+                    }
+                    stack.push_back({item.pc + 1, kNoSlot, 0});
+                    break;
+                case Op::Assert:
+                    if (pattern.holds(instruction.assertion, text, pos)) {
+                        stack.push_back({item.pc + 1, kNoSlot, 0});
+                    }
+                    break;
+                default:
+                    std::copy_n(caps, slots, list.caps.data() + item.pc * slots);
+                    break;
+            }
+        }
+    }
+
+    const Pattern& pattern;
+    std::size_t slots;
+    List lists[2];
+    std::vector<std::size_t> scratch;
+    std::vector<std::size_t> best;
+    std::vector<Pending> stack;
+    std::size_t steps = 0;
+    std::size_t maxSteps = SIZE_MAX;
+};
+
+Pattern::Pattern(std::string_view pattern, Flags flags) : flags(flags) {
+    Parser(pattern, *this).compile();
+}
+
+bool Pattern::holds(Assertion assertion, std::string_view text, std::size_t pos) const {
+    switch (assertion) {
+        case Assertion::LineStart:
+            return pos == 0 || (flags.multiline && text[pos - 1] == '\n');
+        case Assertion::LineEnd:
+            // Without MULTILINE, $ also matches before a newline ending the text
+            return pos == text.size() || (text[pos] == '\n' && (flags.multiline || pos + 1 == text.size()));
+        case Assertion::TextStart:
+            return pos == 0;
+        case Assertion::TextEnd:
+            return pos == text.size();
+        case Assertion::WordBoundary:
+        case Assertion::NotWordBoundary: {
+            if (text.empty()) {
+                return false;   // re matches neither \b nor \B in empty text
+            }
+            bool before = pos > 0 && isWordByte(text[pos - 1]);
+            bool after = pos < text.size() && isWordByte(text[pos]);
+            return (before != after) == (assertion == Assertion::WordBoundary);
+        }
+    }
+    return false;
+}
+
+std::optional<Match> Pattern::search(std::string_view text, std::size_t pos, bool notEmptyAtPos) const {
+    if (pos > text.size()) {
+        return std::nullopt;
+    }
+    return Vm(*this, 2 * (groups + 1)).search(text, pos, notEmptyAtPos);
+}
+
+std::size_t Pattern::stepBudget(std::string_view text) const {
+    std::size_t passes = kMaxPasses * program.size();
+    if (text.size() + 1 > SIZE_MAX / passes) {
+        return SIZE_MAX;
+    }
+    return std::max(kMinStepBudget, (text.size() + 1) * passes);
+}
+
+std::vector<Match> Pattern::findAll(std::string_view text, std::size_t limit) const {
+    Vm vm(*this, 2 * (groups + 1));
+    vm.limitSteps(stepBudget(text));
+    std::vector<Match> matches;
+    std::size_t pos = 0;
+    bool afterEmpty = false;
+    while (matches.size() < limit && pos <= text.size()) {
+        std::optional<Match> match = vm.search(text, pos, afterEmpty);
+        if (!match) {
+            break;
+        }
+        afterEmpty = match->begin() == match->end();
+        pos = match->end();
+        matches.push_back(std::move(*match));
+    }
+    return matches;
+}
+
+std::size_t Pattern::countMatches(std::string_view text) const {
+    Vm vm(*this, 2);
+    vm.limitSteps(stepBudget(text));
+    std::size_t count = 0;
+    std::size_t pos = 0;
+    bool afterEmpty = false;
+    while (pos <= text.size()) {
+        std::optional<Match> match = vm.search(text, pos, afterEmpty);
+        if (!match) {
+            break;
+        }
+        ++count;
+        afterEmpty = match->begin() == match->end();
+        pos = match->end();
+    }
+    return count;
+}
+
+std::string Pattern::replace(std::string_view text, std::string_view replacement, std::size_t count) const {
+    // Parse the template as re's parse_template does
+    std::vector<TemplatePiece> pieces(1);
+    std::size_t highestGroup = 0;
+    auto fail = [](std::string_view what, std::size_t pos) {
+        throw std::invalid_argument(fmt::format("{} at position {}", what, pos));
+    };
+    auto reference = [&](std::size_t group, std::size_t pos) {
+        if (group > groups) {
+            fail(fmt::format("invalid group reference {}", group), pos);
+        }
+        highestGroup = std::max(highestGroup, group);
+        pieces.push_back({"", group});
+        pieces.emplace_back();
+    };
+    for (std::size_t i = 0; i < replacement.size(); ++i) {
+        if (replacement[i] != '\\') {
+            pieces.back().literal += replacement[i];
+            continue;
+        }
+        std::size_t start = i++;
+        if (i == replacement.size()) {
+            fail("bad escape (end of pattern)", start);
+        }
+        char c = replacement[i];
+        if (c == 'g') {
+            std::size_t close = replacement.find('>', i);
+            if (i + 1 >= replacement.size() || replacement[i + 1] != '<' || close == npos) {
+                fail("missing group name", start);
+            }
+            std::string_view name = replacement.substr(i + 2, close - i - 2);
+            std::size_t group = 0;
+            if (!name.empty() && std::all_of(name.begin(), name.end(), isDigit)) {
+                for (char digit : name) {
+                    group = std::min(group * 10 + static_cast<std::size_t>(digit - '0'), kMaxGroups + 1);
+                }
+            } else if (auto named = groupNames.find(name); named != groupNames.end()) {
+                group = named->second;
+            } else {
+                throw std::invalid_argument(fmt::format("unknown group name '{}'", name));
+            }
+            reference(group, start);
+            i = close;
+        } else if (c == '0' || (isOctal(c) && i + 2 < replacement.size() && isOctal(replacement[i + 1]) && isOctal(replacement[i + 2]))) {
+            // Octal escape: \0 and up to two more digits, or three digits
+            std::size_t end = std::min(i + 3, replacement.size());
+            std::size_t value = 0;
+            for (; i < end && isOctal(replacement[i]); ++i) {
+                value = value * 8 + static_cast<std::size_t>(replacement[i] - '0');
+            }
+            if (value > 0377) {
+                fail("octal escape value outside of range 0-0o377", start);
+            }
+            encode(static_cast<char32_t>(value), pieces.back().literal);
+            --i;
+        } else if (isDigit(c)) {
+            std::size_t group = static_cast<std::size_t>(c - '0');
+            if (i + 1 < replacement.size() && isDigit(replacement[i + 1])) {
+                group = group * 10 + static_cast<std::size_t>(replacement[++i] - '0');
+            }
+            reference(group, start);
+        } else {
+            switch (c) {
+                case 'n': pieces.back().literal += '\n'; break;
+                case 't': pieces.back().literal += '\t'; break;
+                case 'r': pieces.back().literal += '\r'; break;
+                case 'f': pieces.back().literal += '\f'; break;
+                case 'v': pieces.back().literal += '\v'; break;
+                case 'a': pieces.back().literal += '\a'; break;
+                case 'b': pieces.back().literal += '\b'; break;
+                case '\\': pieces.back().literal += '\\'; break;
+                default:
+                    if (isAsciiLetter(static_cast<unsigned char>(c))) {
+                        fail(fmt::format("bad escape \\{}", c), start);
+                    }
+                    // Any other escape stays as written
+                    pieces.back().literal += '\\';
+                    pieces.back().literal += c;
+                    break;
+            }
+        }
+    }
+
+    Vm vm(*this, 2 * (highestGroup + 1));
+    vm.limitSteps(stepBudget(text));
+    std::string result;
+    std::size_t copied = 0;
+    std::size_t replaced = 0;
+    std::size_t pos = 0;
+    bool afterEmpty = false;
+    while ((count == 0 || replaced < count) && pos <= text.size()) {
+        std::optional<Match> match = vm.search(text, pos, afterEmpty);
+        if (!match) {
+            break;
+        }
+        result.append(text.substr(copied, match->begin() - copied));
+        for (const auto& piece : pieces) {
+            result += piece.literal;
+            if (piece.group != npos && match->groups[piece.group].first != npos) {
+                auto [begin, end] = match->groups[piece.group];
+                result.append(text.substr(begin, end - begin));
+            }
+        }
+        copied = match->end();
+        ++replaced;
+        afterEmpty = match->begin() == match->end();
+        pos = match->end();
+    }
+    result.append(text.substr(copied));
+    return result;
+}
+
+std::shared_ptr<const Pattern> PatternCache::get(std::string_view pattern, Flags flags) {
+    std::string key;
+    key.reserve(pattern.size() + 1);
+    key += static_cast<char>('0' + (flags.ignoreCase ? 1 : 0) + (flags.multiline ? 2 : 0) + (flags.dotAll ? 4 : 0));
+    key += pattern;
+    {
+        std::lock_guard lock(mutex);
+        if (auto it = index.find(key); it != index.end()) {
+            entries.splice(entries.begin(), entries, it->second);
+            ++hitCount;
+            return it->second->second;
+        }
+        ++missCount;
+    }
+
+    // Compile outside the lock; a thread that raced us here may insert first
+    auto compiled = std::make_shared<const Pattern>(pattern, flags);
+    std::lock_guard lock(mutex);
+    if (auto it = index.find(key); it != index.end()) {
+        return it->second->second;
+    }
+    entries.emplace_front(key, compiled);
+    index.emplace(std::move(key), entries.begin());
+    if (entries.size() > std::max<std::size_t>(capacity, 1)) {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+    return compiled;
+}
+
+std::size_t PatternCache::size() const {
+    std::lock_guard lock(mutex);
+    return entries.size();
+}
+
+std::uint64_t PatternCache::hits() const {
+    std::lock_guard lock(mutex);
+    return hitCount;
+}
+
+std::uint64_t PatternCache::misses() const {
+    std::lock_guard lock(mutex);
+    return missCount;
+}
+
+} // namespace regex
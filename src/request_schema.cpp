@@ -0,0 +1,277 @@
+#include "request_schema.h"
+#include "json_validation.h"
+#include "text_kernels.h"
+
+#include <algorithm>
+#include <fmt/format.h>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+// A top-level member of a validated object; both views point into the request
+struct Member {
+    std::string_view key;       // including the quotes
+    std::string_view value;
+};
+
+std::size_t skipWhitespace(std::string_view json, std::size_t pos) {
+    while (pos < json.size() && (json[pos] == ' ' || json[pos] == '\t' || json[pos] == '\n' || json[pos] == '\r')) {
+        ++pos;
+    }
+    return pos;
+}
+
+std::size_t skipString(std::string_view json, std::size_t pos) {
+    for (++pos; json[pos] != '"'; ++pos) {
+        pos += json[pos] == '\\';
+    }
+    return pos + 1;
+}
+
+// The document is known to be valid, so only strings and nesting need care
+std::size_t skipValue(std::string_view json, std::size_t pos) {
+    if (json[pos] == '"') {
+        return skipString(json, pos);
+    }
+    if (json[pos] != '{' && json[pos] != '[') {
+        while (pos < json.size() && json[pos] != ',' && json[pos] != '}' && json[pos] != ']' && json[pos] != ' '
+            && json[pos] != '\t' && json[pos] != '\n' && json[pos] != '\r') {
+            ++pos;
+        }
+        return pos;
+    }
+    std::size_t depth = 0;
+    while (true) {
+        char c = json[pos];
+        if (c == '"') {
+            pos = skipString(json, pos);
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            ++depth;
+        } else if ((c == '}' || c == ']') && --depth == 0) {
+            return pos + 1;
+        }
+        ++pos;
+    }
+}
+
+std::vector<Member> topLevelMembers(std::string_view json) {
+    std::vector<Member> members;
+    std::size_t pos = skipWhitespace(json, skipWhitespace(json, 0) + 1);
+    while (json[pos] == '"') {
+        std::size_t keyEnd = skipString(json, pos);
+        std::string_view key = json.substr(pos, keyEnd - pos);
+        pos = skipWhitespace(json, skipWhitespace(json, keyEnd) + 1);
+        std::size_t valueEnd = skipValue(json, pos);
+        members.push_back({key, json.substr(pos, valueEnd - pos)});
+        pos = skipWhitespace(json, valueEnd);
+        if (json[pos] != ',') {
+            break;
+        }
+        pos = skipWhitespace(json, pos + 1);
+    }
+    return members;
+}
+
+// The decoded contents of a JSON string token, or nothing when it holds lone
+// surrogate escapes that only Python can represent
+std::optional<std::string> decodeString(std::string_view token) {
+    if (token.find('\\') == std::string_view::npos) {
+        return std::string(token.substr(1, token.size() - 2));
+    }
+    native::json decoded = native::json::parse(token, nullptr, false);
+    if (decoded.is_discarded()) {
+        return std::nullopt;
+    }
+    return decoded.get<std::string>();
+}
+
+// Like Python's dict.get on the parsed request: the last member with the name
+// wins. Returns nothing when the member is missing or a key cannot be decoded.
+std::optional<std::string_view> findMember(const std::vector<Member>& members, std::string_view name, bool& undecidable) {
+    for (auto member = members.rbegin(); member != members.rend(); ++member) {
+        if (member->key.find('\\') == std::string_view::npos) {
+            if (member->key.substr(1, member->key.size() - 2) == name) {
+                return member->value;
+            }
+            continue;
+        }
+        auto key = decodeString(member->key);
+        if (!key) {
+            undecidable = true;
+            return std::nullopt;
+        }
+        if (*key == name) {
+            return member->value;
+        }
+    }
+    return std::nullopt;
+}
+
+bool isEmptyArray(std::string_view value) {
+    return value[skipWhitespace(value, 1)] == ']';
+}
+
+// The JSON type a member of each kind must have; a missing member reads as empty
+bool satisfies(std::optional<std::string_view> value, bool nonEmpty, char opening) {
+    if (!value) {
+        return !nonEmpty;
+    }
+    return value->front() == opening && !(nonEmpty && isEmptyArray(*value));
+}
+
+// Python's decoder recurses per nesting level; documents this deep may hit the
+// recursion limit instead, so they are left to it
+constexpr std::size_t kMaxNesting = 200;
+
+std::size_t nestingDepth(std::string_view json) {
+    std::size_t depth = 0, deepest = 0;
+    for (std::size_t pos = 0; pos < json.size(); ++pos) {
+        char c = json[pos];
+        if (c == '"') {
+            while (++pos < json.size() && json[pos] != '"') {
+                pos += json[pos] == '\\';
+            }
+        } else if (c == '{' || c == '[') {
+            deepest = std::max(deepest, ++depth);
+        } else if ((c == '}' || c == ']') && depth > 0) {
+            --depth;
+        }
+    }
+    return deepest;
+}
+
+// Whether processor.py would get as far as its own checks for the text up to
+// the failing one: it has to decode to a str first, and json.loads has to
+// reach that point without recursing too deep
+bool answerable(std::string_view request, std::size_t scanned) {
+    return utf8::isValid(request) && nestingDepth(request.substr(0, scanned)) < kMaxNesting;
+}
+
+std::string rejection(native::json body) {
+    body["timestamp"] = native::kTimestamp;
+    return native::dumpPythonStyle(body);
+}
+
+std::string stringField(const native::json& schema, const char* name, std::string_view type) {
+    auto found = schema.find(name);
+    if (found == schema.end() || !found->is_string()) {
+        throw std::invalid_argument(fmt::format("schema for \"{}\" needs a string \"{}\"", type, name));
+    }
+    return found->get<std::string>();
+}
+
+} // namespace
+
+RequestValidator RequestValidator::compile(const native::json& table) {
+    if (!table.is_object() || table.empty()) {
+        throw std::invalid_argument("REQUEST_SCHEMAS must be a non-empty object");
+    }
+    RequestValidator validator;
+    validator.availableTypes = native::json::array();
+    for (const auto& [type, entry] : table.items()) {
+        if (!entry.is_object()) {
+            throw std::invalid_argument(fmt::format("schema for \"{}\" must be an object", type));
+        }
+        Schema schema;
+        if (entry.contains("field")) {
+            schema.field = stringField(entry, "field", type);
+            schema.error = stringField(entry, "error", type);
+            std::string kind = stringField(entry, "kind", type);
+            if (kind == "array") {
+                schema.kind = Kind::Array;
+            } else if (kind == "non_empty_array") {
+                schema.kind = Kind::NonEmptyArray;
+            } else if (kind == "string") {
+                schema.kind = Kind::String;
+            } else {
+                throw std::invalid_argument(fmt::format("schema for \"{}\" has unknown kind \"{}\"", type, kind));
+            }
+        }
+        if (auto operations = entry.find("operations"); operations != entry.end()) {
+            if (!operations->is_array()) {
+                throw std::invalid_argument(fmt::format("operations of \"{}\" must be an array", type));
+            }
+            schema.checksOperation = true;
+            schema.operationList = *operations;
+            for (const auto& operation : *operations) {
+                if (!operation.is_string()) {
+                    throw std::invalid_argument(fmt::format("operations of \"{}\" must be strings", type));
+                }
+                schema.operations.push_back(operation.get<std::string>());
+            }
+        }
+        validator.availableTypes.push_back(type);
+        validator.schemas.emplace(type, std::move(schema));
+    }
+    return validator;
+}
+
+std::optional<std::string> RequestValidator::reject(std::string_view request) const {
+    if (schemas.empty()) {
+        return std::nullopt;
+    }
+
+    JsonValidation validation = validateJson(request);
+    if (validation.status != JsonValidation::Status::Valid || !validation.object) {
+        bool valid = validation.status == JsonValidation::Status::Valid;
+        if (!answerable(request, valid ? request.size() : validation.offset)) {
+            return std::nullopt;
+        }
+        if (valid) {
+            return native::errorResponse("Input must be a JSON object");
+        }
+        // JSONDecodeError's str(), whose char offset counts characters
+        return native::errorResponse(fmt::format("Invalid JSON: {}: line {} column {} (char {})", validation.message,
+            validation.line, validation.column, utf8::countCodePoints(request.substr(0, validation.offset))));
+    }
+
+    std::vector<Member> members = topLevelMembers(request);
+    bool undecidable = false;
+    std::optional<std::string> type = "unknown";
+    if (auto value = findMember(members, "type", undecidable)) {
+        type = value->front() == '"' ? decodeString(*value) : std::nullopt;
+    }
+    if (!type || undecidable) {
+        return std::nullopt;
+    }
+
+    auto schema = schemas.find(*type);
+    if (schema == schemas.end()) {
+        if (!answerable(request, request.size())) {
+            return std::nullopt;
+        }
+        return rejection({{"success", false}, {"error", "Unknown request type: " + *type}, {"available_types", availableTypes}});
+    }
+
+    const Schema& rules = schema->second;
+    if (rules.kind != Kind::Any) {
+        auto value = findMember(members, rules.field, undecidable);
+        bool passes = rules.kind == Kind::String ? satisfies(value, false, '"')
+                                                 : satisfies(value, rules.kind == Kind::NonEmptyArray, '[');
+        if (undecidable) {
+            return std::nullopt;
+        }
+        if (!passes) {
+            return answerable(request, request.size()) ? std::optional(native::errorResponse(rules.error)) : std::nullopt;
+        }
+    }
+
+    if (rules.checksOperation) {
+        std::optional<std::string> operation = "";
+        if (auto value = findMember(members, "operation", undecidable)) {
+            operation = value->front() == '"' ? decodeString(*value) : std::nullopt;
+        }
+        if (!operation || undecidable) {
+            return std::nullopt;
+        }
+        if (std::find(rules.operations.begin(), rules.operations.end(), *operation) == rules.operations.end()
+            && answerable(request, request.size())) {
+            return rejection({{"success", false}, {"error", fmt::format("Unknown {} operation: {}", *type, *operation)},
+                {"available_operations", rules.operationList}});
+        }
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,52 @@
+#include "request_trace.h"
+
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+
+RequestTraceWriter::RequestTraceWriter(const std::string& path)
+    : out(path, std::ios::out | std::ios::trunc)
+    , start(std::chrono::steady_clock::now()) {
+    if (!out) {
+        throw std::runtime_error("Could not open trace file for writing: " + path);
+    }
+}
+
+void RequestTraceWriter::record(std::string_view request) {
+    auto offset = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    nlohmann::json line = {
+        {"t_us", offset.count()},
+        {"request", request}
+    };
+
+    // Invalid UTF-8 is kept as U+FFFD rather than losing the request
+    std::string text = line.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+    std::lock_guard<std::mutex> lock(mutex);
+    out << text << '\n';
+}
+
+std::vector<TraceRecord> loadRequestTrace(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Could not open trace file: " + path);
+    }
+
+    std::vector<TraceRecord> records;
+    std::string line;
+    std::size_t lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        if (line.empty()) {
+            continue;
+        }
+        try {
+            auto entry = nlohmann::json::parse(line);
+            records.push_back({
+                std::chrono::microseconds(entry.at("t_us").get<std::int64_t>()),
+                entry.at("request").get<std::string>()
+            });
+        } catch (const nlohmann::json::exception& e) {
+            throw std::runtime_error("Malformed trace line " + std::to_string(lineNumber) + ": " + e.what());
+        }
+    }
+    return records;
+}
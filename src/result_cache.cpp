@@ -0,0 +1,296 @@
+#include "result_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'P', 'P', 'R', 'C', '0', '0', '1'};
+
+struct Header {
+    char magic[8];
+    std::uint64_t version;
+    std::uint64_t end;          // committed records end here
+    std::uint64_t reserved;
+};
+
+// A record is the key and value lengths, the key, the value, then padding to 8
+constexpr std::size_t kRecordHeader = 2 * sizeof(std::uint32_t);
+
+std::size_t recordSize(std::size_t keyLength, std::size_t valueLength) {
+    return (kRecordHeader + keyLength + valueLength + 7) & ~std::size_t{7};
+}
+
+std::pair<std::uint32_t, std::uint32_t> recordLengths(const char* record) {
+    std::uint32_t lengths[2];
+    std::memcpy(lengths, record, sizeof(lengths));
+    return {lengths[0], lengths[1]};
+}
+
+std::runtime_error systemError(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+ResultCache::ResultCache(const std::string& path, std::uint64_t version, std::size_t maxBytes)
+    : maxBytes(std::max(maxBytes, kMinMaxBytes)), currentVersion(version) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw systemError("Could not open result cache " + path);
+    }
+    try {
+        if (::flock(fd, LOCK_EX | LOCK_NB) != 0) {
+            throw systemError("Could not lock result cache " + path);
+        }
+        struct stat info {};
+        if (::fstat(fd, &info) != 0) {
+            throw systemError("Could not read result cache " + path);
+        }
+        auto existing = static_cast<std::size_t>(info.st_size);
+        map(std::max(existing, this->maxBytes));
+
+        Header header{};
+        if (existing >= sizeof(Header)) {
+            std::memcpy(&header, data, sizeof(Header));
+        }
+        if (existing < sizeof(Header) || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0
+            || header.version != version || header.end < sizeof(Header) || header.end > existing) {
+            header = Header{};
+            std::memcpy(header.magic, kMagic, sizeof(kMagic));
+            header.version = version;
+            header.end = sizeof(Header);
+            std::memcpy(data, &header, sizeof(Header));
+        }
+        loadIndex();
+
+        // Written with a larger cap: keep what fits and shrink the file
+        if (mapped > this->maxBytes) {
+            if (end > this->maxBytes) {
+                compact(this->maxBytes / 2);
+            }
+            unmap();
+            if (::ftruncate(fd, static_cast<off_t>(this->maxBytes)) != 0) {
+                throw systemError("Could not resize result cache " + path);
+            }
+            map(this->maxBytes);
+            loadIndex();
+        }
+    } catch (...) {
+        unmap();
+        ::close(fd);
+        throw;
+    }
+}
+
+ResultCache::~ResultCache() {
+    unmap();
+    // Also releases the lock
+    ::close(fd);
+}
+
+void ResultCache::map(std::size_t length) {
+    struct stat info {};
+    if (::fstat(fd, &info) != 0 || (static_cast<std::size_t>(info.st_size) < length
+                                    && ::ftruncate(fd, static_cast<off_t>(length)) != 0)) {
+        throw systemError("Could not size result cache");
+    }
+    void* address = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        throw systemError("Could not map result cache");
+    }
+    data = static_cast<char*>(address);
+    mapped = length;
+}
+
+void ResultCache::unmap() {
+    if (data) {
+        ::munmap(data, mapped);
+        data = nullptr;
+        mapped = 0;
+    }
+}
+
+void ResultCache::loadIndex() {
+    index.clear();
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+    std::size_t committed = std::min<std::size_t>(header.end, mapped);
+    std::size_t pos = sizeof(Header);
+    while (committed - pos >= kRecordHeader) {
+        auto [keyLength, valueLength] = recordLengths(data + pos);
+        std::size_t size = recordSize(keyLength, valueLength);
+        if (size > committed - pos) {
+            break;
+        }
+        index.insert_or_assign(std::string_view(data + pos + kRecordHeader, keyLength), pos);
+        pos += size;
+    }
+    end = pos;
+    if (end != header.end) {
+        setEnd(end);
+    }
+}
+
+void ResultCache::setEnd(std::size_t newEnd) {
+    // The records must be in place before the end moves past them
+    std::atomic_thread_fence(std::memory_order_release);
+    std::uint64_t value = newEnd;
+    std::memcpy(data + offsetof(Header, end), &value, sizeof(value));
+    end = newEnd;
+}
+
+std::optional<std::string> ResultCache::find(std::string_view key) const {
+    std::shared_lock lock(mutex);
+    auto it = index.find(key);
+    if (it == index.end()) {
+        ++missCount;
+        return std::nullopt;
+    }
+    ++hitCount;
+    auto [keyLength, valueLength] = recordLengths(data + it->second);
+    return std::string(data + it->second + kRecordHeader + keyLength, valueLength);
+}
+
+void ResultCache::insert(std::string_view key, std::string_view value, std::uint64_t version) {
+    std::size_t size = recordSize(key.size(), value.size());
+    if (size > maxBytes / 4 || key.size() > UINT32_MAX || value.size() > UINT32_MAX) {
+        return;
+    }
+
+    std::unique_lock lock(mutex);
+    if (version != currentVersion || index.contains(key)) {
+        return;
+    }
+    if (end + size > maxBytes) {
+        compact(maxBytes / 2);
+    }
+    std::uint32_t lengths[2] = {static_cast<std::uint32_t>(key.size()), static_cast<std::uint32_t>(value.size())};
+    char* record = data + end;
+    std::memcpy(record, lengths, sizeof(lengths));
+    std::memcpy(record + kRecordHeader, key.data(), key.size());
+    std::memcpy(record + kRecordHeader + key.size(), value.data(), value.size());
+    index.emplace(std::string_view(record + kRecordHeader, key.size()), end);
+    setEnd(end + size);
+}
+
+void ResultCache::compact(std::size_t limit) {
+    // Oldest first; the newest ones that fit are kept
+    std::vector<std::size_t> offsets;
+    offsets.reserve(index.size());
+    for (const auto& entry : index) {
+        offsets.push_back(entry.second);
+    }
+    std::sort(offsets.begin(), offsets.end());
+    std::size_t kept = sizeof(Header);
+    std::size_t first = offsets.size();
+    for (; first > 0; --first) {
+        auto [keyLength, valueLength] = recordLengths(data + offsets[first - 1]);
+        std::size_t size = recordSize(keyLength, valueLength);
+        if (kept + size > limit) {
+            break;
+        }
+        kept += size;
+    }
+
+    // Records only move toward the front. A crash from here on leaves an
+    // empty cache.
+    setEnd(sizeof(Header));
+    std::size_t pos = sizeof(Header);
+    for (std::size_t i = first; i < offsets.size(); ++i) {
+        auto [keyLength, valueLength] = recordLengths(data + offsets[i]);
+        std::size_t size = recordSize(keyLength, valueLength);
+        std::memmove(data + pos, data + offsets[i], size);
+        pos += size;
+    }
+    setEnd(pos);
+    loadIndex();
+    ++compactionCount;
+}
+
+std::uint64_t ResultCache::version() const {
+    std::shared_lock lock(mutex);
+    return currentVersion;
+}
+
+void ResultCache::reset(std::uint64_t version) {
+    std::unique_lock lock(mutex);
+    setEnd(sizeof(Header));
+    std::memcpy(data + offsetof(Header, version), &version, sizeof(version));
+    currentVersion = version;
+    index.clear();
+}
+
+std::size_t ResultCache::size() const {
+    std::shared_lock lock(mutex);
+    return index.size();
+}
+
+std::size_t ResultCache::bytes() const {
+    std::shared_lock lock(mutex);
+    return end;
+}
+
+std::uint64_t ResultCache::compactions() const {
+    std::shared_lock lock(mutex);
+    return compactionCount;
+}
+
+std::optional<std::string> canonicalRequest(std::string_view json) {
+    // Integers past 64 bits parse as doubles, which would merge requests
+    // Python tells apart; digits inside strings do not count
+    bool inString = false;
+    std::size_t digits = 0;
+    for (std::size_t i = 0; i < json.size(); ++i) {
+        char c = json[i];
+        if (inString) {
+            if (c == '\\') {
+                ++i;
+            } else if (c == '"') {
+                inString = false;
+            }
+        } else if (c == '"') {
+            inString = true;
+            digits = 0;
+        } else if (c >= '0' && c <= '9') {
+            if (++digits > 18) {
+                return std::nullopt;
+            }
+        } else {
+            digits = 0;
+        }
+    }
+
+    // Members keep the request's order: responses echo parts of the request,
+    // and json.loads keeps a repeated key where it first appeared, as
+    // ordered_json does
+    nlohmann::ordered_json document = nlohmann::ordered_json::parse(json, nullptr, false);
+    if (document.is_discarded() || !document.is_object()) {
+        return std::nullopt;
+    }
+    try {
+        return document.dump();
+    } catch (const nlohmann::ordered_json::exception&) {
+        return std::nullopt;
+    }
+}
+
+std::uint64_t fingerprint(std::string_view bytes, std::uint64_t seed) {
+    std::uint64_t hash = seed;
+    for (char byte : bytes) {
+        hash ^= static_cast<unsigned char>(byte);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
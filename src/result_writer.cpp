@@ -0,0 +1,135 @@
+#include "result_writer.h"
+
+#include <fstream>
+#include <optional>
+#include <vector>
+#include <zlib.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::size_t kChunkBytes = 1 << 20;
+
+// zlib deflate stream writing its output to a file
+class Deflater {
+public:
+    explicit Deflater(ResultCompression compression) : buffer(256 * 1024) {
+        // 15 is the largest window; +16 wraps the stream in a gzip header and trailer
+        int windowBits = compression == ResultCompression::Gzip ? 15 + 16 : 15;
+        initialized = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+
+    ~Deflater() {
+        if (initialized) {
+            deflateEnd(&stream);
+        }
+    }
+
+    Deflater(const Deflater&) = delete;
+    Deflater& operator=(const Deflater&) = delete;
+
+    bool ok() const { return initialized; }
+
+    // Compresses input, ending the stream if last; returns the bytes written
+    std::optional<std::size_t> write(std::string_view input, bool last, std::ofstream& out) {
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        stream.avail_in = static_cast<uInt>(input.size());
+        std::size_t written = 0;
+        do {
+            stream.next_out = buffer.data();
+            stream.avail_out = static_cast<uInt>(buffer.size());
+            if (deflate(&stream, last ? Z_FINISH : Z_NO_FLUSH) == Z_STREAM_ERROR) {
+                return std::nullopt;
+            }
+            std::size_t produced = buffer.size() - stream.avail_out;
+            out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(produced));
+            written += produced;
+        } while (stream.avail_out == 0);
+        if (!out) {
+            return std::nullopt;
+        }
+        return written;
+    }
+
+private:
+    z_stream stream{};
+    bool initialized = false;
+    std::vector<Bytef> buffer;
+};
+
+} // namespace
+
+ResultCompression compressionForPath(const fs::path& path) {
+    fs::path extension = path.extension();
+    if (extension == ".gz") {
+        return ResultCompression::Gzip;
+    }
+    if (extension == ".zz") {
+        return ResultCompression::Zlib;
+    }
+    return ResultCompression::None;
+}
+
+std::expected<SaveStats, std::string> saveResult(std::string_view data, const fs::path& path,
+    ResultCompression compression, const SaveProgress& progress, std::stop_token stop) {
+    fs::path temporary = path;
+    temporary += ".part";
+
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    auto fail = [&](std::string message) -> std::expected<SaveStats, std::string> {
+        out.close();
+        std::error_code ignored;
+        fs::remove(temporary, ignored);
+        return std::unexpected(std::move(message));
+    };
+    if (!out) {
+        return fail("Could not open " + temporary.string() + " for writing");
+    }
+
+    std::optional<Deflater> deflater;
+    if (compression != ResultCompression::None) {
+        deflater.emplace(compression);
+        if (!deflater->ok()) {
+            return fail("Could not initialize zlib");
+        }
+    }
+
+    SaveStats stats;
+    // At least one pass, so empty data still gets a complete compressed stream
+    do {
+        if (stop.stop_requested()) {
+            return fail("Save cancelled");
+        }
+        std::string_view chunk = data.substr(stats.inputBytes, kChunkBytes);
+        bool last = stats.inputBytes + chunk.size() == data.size();
+        if (deflater) {
+            std::optional<std::size_t> written = deflater->write(chunk, last, out);
+            if (!written) {
+                return fail("Could not write " + temporary.string());
+            }
+            stats.outputBytes += *written;
+        } else {
+            out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            if (!out) {
+                return fail("Could not write " + temporary.string());
+            }
+            stats.outputBytes += chunk.size();
+        }
+        stats.inputBytes += chunk.size();
+        if (progress) {
+            progress(stats.inputBytes, data.size());
+        }
+    } while (stats.inputBytes < data.size());
+
+    out.close();
+    if (!out) {
+        return fail("Could not write " + temporary.string());
+    }
+    std::error_code error;
+    fs::rename(temporary, path, error);
+    if (error) {
+        return fail("Could not replace " + path.string() + ": " + error.message());
+    }
+    return stats;
+}
@@ -0,0 +1,55 @@
+#include "span_trace.h"
+
+#include <atomic>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+
+namespace {
+
+// Small, stable thread numbers read better in trace viewers than native IDs
+std::uint32_t traceThreadId() {
+    static std::atomic<std::uint32_t> next{1};
+    thread_local std::uint32_t id = next.fetch_add(1);
+    return id;
+}
+
+double microseconds(SpanTraceWriter::Clock::duration duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+} // namespace
+
+SpanTraceWriter::SpanTraceWriter(const std::string& path)
+    : out(path, std::ios::out | std::ios::trunc)
+    , origin(Clock::now()) {
+    if (!out) {
+        throw std::runtime_error("Could not open span trace file for writing: " + path);
+    }
+    out << "[\n";
+}
+
+SpanTraceWriter::~SpanTraceWriter() {
+    out << "\n]\n";
+}
+
+void SpanTraceWriter::write(std::string_view name, std::string_view category, Clock::time_point start,
+    Clock::time_point end, std::uint64_t requestId) {
+    nlohmann::json event = {
+        {"name", name},
+        {"cat", category},
+        {"ph", "X"},
+        {"ts", microseconds(start - origin)},
+        {"dur", microseconds(end - start)},
+        {"pid", 1},
+        {"tid", traceThreadId()},
+        {"args", {{"request_id", requestId}}}
+    };
+    std::string line = event.dump();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!first) {
+        out << ",\n";
+    }
+    first = false;
+    out << line;
+}
@@ -0,0 +1,123 @@
+#include "startup_paths.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <loguru/loguru.hpp>
+#include <sstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::vector<std::string> splitFields(const std::string& line) {
+    std::vector<std::string> fields;
+    std::istringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, '\t')) {
+        fields.push_back(field);
+    }
+    return fields;
+}
+
+} // namespace
+
+std::vector<std::string> probePythonPaths(const fs::path& base) {
+    std::vector<std::string> paths;
+
+    // Add the python directory to Python path
+    fs::path pythonPath = base / "python";
+    if (fs::exists(pythonPath)) {
+        LOG_F(INFO, "Adding python path: %s", pythonPath.c_str());
+        paths.push_back(pythonPath.string());
+    } else {
+        LOG_F(INFO, "Adding relative paths...");
+        paths.push_back("./python");
+        paths.push_back(".");
+    }
+
+    // Add vcpkg Python paths for extension modules
+    fs::path vcpkgPath = base / ".vcpkg" / "installed" / "x64-linux";
+    fs::path libDynload = vcpkgPath / "lib" / "python3.12" / "lib-dynload";
+    fs::path libPath = vcpkgPath / "lib" / "python3.12";
+    if (fs::exists(libDynload)) {
+        LOG_F(INFO, "Adding vcpkg lib-dynload path: %s", libDynload.c_str());
+        paths.push_back(libDynload.string());
+    }
+    if (fs::exists(libPath)) {
+        LOG_F(INFO, "Adding vcpkg lib path: %s", libPath.c_str());
+        paths.push_back(libPath.string());
+    }
+
+    // Add venv site-packages if it exists
+    fs::path venvSitePackages = base / ".venv" / "lib" / "python3.12" / "site-packages";
+    if (fs::exists(venvSitePackages)) {
+        LOG_F(INFO, "Adding venv site-packages: %s", venvSitePackages.c_str());
+        paths.push_back(venvSitePackages.string());
+    } else {
+        LOG_F(WARNING, "Venv site-packages not found: %s", venvSitePackages.c_str());
+    }
+    return paths;
+}
+
+PythonPathCache::PythonPathCache(fs::path file) : file(std::move(file)) {}
+
+fs::path PythonPathCache::defaultLocation() {
+    if (const char* cacheHome = std::getenv("XDG_CACHE_HOME"); cacheHome && *cacheHome) {
+        return fs::path(cacheHome) / "cppideas" / "python_paths";
+    }
+    if (const char* home = std::getenv("HOME"); home && *home) {
+        return fs::path(home) / ".cache" / "cppideas" / "python_paths";
+    }
+    return fs::temp_directory_path() / "cppideas_python_paths";
+}
+
+std::optional<std::vector<std::string>> PythonPathCache::find(const fs::path& base) const {
+    std::ifstream input(file);
+    std::string line;
+    while (std::getline(input, line)) {
+        auto fields = splitFields(line);
+        if (!fields.empty() && fields.front() == base.string()) {
+            return std::vector<std::string>(fields.begin() + 1, fields.end());
+        }
+    }
+    return std::nullopt;
+}
+
+void PythonPathCache::store(const fs::path& base, const std::vector<std::string>& paths) const {
+    std::string content;
+    {
+        std::ifstream input(file);
+        std::string line;
+        while (std::getline(input, line)) {
+            auto fields = splitFields(line);
+            if (!fields.empty() && fields.front() != base.string()) {
+                content += line + '\n';
+            }
+        }
+    }
+    content += base.string();
+    for (const auto& path : paths) {
+        content += '\t' + path;
+    }
+    content += '\n';
+
+    // Write a sibling file and rename it over the cache so that concurrent
+    // starts never read a partial file
+    std::error_code error;
+    fs::create_directories(file.parent_path(), error);
+    fs::path temporary = file;
+    temporary += ".tmp";
+    {
+        std::ofstream output(temporary, std::ios::trunc);
+        output << content;
+        if (!output) {
+            LOG_F(WARNING, "Could not write Python path cache %s", temporary.c_str());
+            return;
+        }
+    }
+    fs::rename(temporary, file, error);
+    if (error) {
+        LOG_F(WARNING, "Could not update Python path cache %s: %s", file.c_str(), error.message().c_str());
+    }
+}
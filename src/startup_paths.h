@@ -0,0 +1,29 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Directories the processor appends to sys.path for a working directory: the
+// python/ scripts, the vcpkg Python's lib and lib-dynload, and the venv's
+// site-packages, whichever exist
+std::vector<std::string> probePythonPaths(const std::filesystem::path& base);
+
+// Remembers probePythonPaths results across runs so a start can skip the
+// filesystem probes. One line per working directory, fields separated by tabs.
+class PythonPathCache {
+public:
+    explicit PythonPathCache(std::filesystem::path file);
+
+    // $XDG_CACHE_HOME/cppideas/python_paths, or ~/.cache/... when unset
+    static std::filesystem::path defaultLocation();
+
+    std::optional<std::vector<std::string>> find(const std::filesystem::path& base) const;
+
+    // Replaces the entry for base; failures to write are ignored
+    void store(const std::filesystem::path& base, const std::vector<std::string>& paths) const;
+
+private:
+    std::filesystem::path file;
+};
@@ -0,0 +1,290 @@
+#include "streaming_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <stdexcept>
+
+void RunningStats::add(double value) {
+    ++n;
+    total += value;
+    double delta = value - runningMean;
+    runningMean += delta / static_cast<double>(n);
+    m2 += delta * (value - runningMean);
+    minimum = std::min(minimum, value);
+    maximum = std::max(maximum, value);
+}
+
+void RunningStats::merge(const RunningStats& other) {
+    if (other.n == 0) {
+        return;
+    }
+    if (n == 0) {
+        *this = other;
+        return;
+    }
+    // Chan et al. parallel combination of the second moments
+    double combined = static_cast<double>(n + other.n);
+    double delta = other.runningMean - runningMean;
+    runningMean += delta * static_cast<double>(other.n) / combined;
+    m2 += other.m2 + delta * delta * static_cast<double>(n) * static_cast<double>(other.n) / combined;
+    n += other.n;
+    total += other.total;
+    minimum = std::min(minimum, other.minimum);
+    maximum = std::max(maximum, other.maximum);
+}
+
+double RunningStats::variance() const {
+    return n ? m2 / static_cast<double>(n) : 0.0;
+}
+
+double RunningStats::sampleVariance() const {
+    return n > 1 ? m2 / static_cast<double>(n - 1) : 0.0;
+}
+
+double RunningStats::stddev() const {
+    return std::sqrt(variance());
+}
+
+KllSketch::KllSketch(std::size_t k) : k(std::max<std::size_t>(k, 8)), levels(1) {
+    updateCapacity();
+}
+
+std::size_t KllSketch::capacity(std::size_t level) const {
+    // Lower levels get geometrically smaller buffers: k * (2/3)^(depth)
+    std::size_t depth = levels.size() - 1 - level;
+    double scaled = std::ceil(static_cast<double>(k) * std::pow(2.0 / 3.0, static_cast<double>(depth)));
+    return std::max<std::size_t>(2, static_cast<std::size_t>(scaled));
+}
+
+std::size_t KllSketch::retained() const {
+    return retainedItems;
+}
+
+void KllSketch::updateCapacity() {
+    maxItems = 0;
+    for (std::size_t level = 0; level < levels.size(); ++level) {
+        maxItems += capacity(level);
+    }
+}
+
+void KllSketch::add(double value) {
+    levels[0].push_back(value);
+    ++n;
+    ++retainedItems;
+    if (retainedItems >= maxItems) {
+        compress();
+    }
+}
+
+void KllSketch::compress() {
+    // Compact the lowest level that is at capacity (there always is one once
+    // the sketch as a whole is full)
+    std::size_t level = 0;
+    while (level + 1 < levels.size() && levels[level].size() < capacity(level)) {
+        ++level;
+    }
+    if (level + 1 == levels.size()) {
+        levels.emplace_back();
+        updateCapacity();
+    }
+
+    // Sort, hold one item back if the count is odd, then promote a random half
+    // (every other item) to the next level with double weight
+    auto& items = levels[level];
+    std::sort(items.begin(), items.end());
+    std::optional<double> leftover;
+    if (items.size() % 2 == 1) {
+        leftover = items.back();
+        items.pop_back();
+    }
+    std::size_t offset = coin() & 1u;
+    auto& next = levels[level + 1];
+    for (std::size_t i = offset; i < items.size(); i += 2) {
+        next.push_back(items[i]);
+    }
+    retainedItems -= items.size() / 2;
+    items.clear();
+    if (leftover) {
+        items.push_back(*leftover);
+    }
+}
+
+void KllSketch::merge(const KllSketch& other) {
+    if (other.levels.size() > levels.size()) {
+        levels.resize(other.levels.size());
+        updateCapacity();
+    }
+    for (std::size_t level = 0; level < other.levels.size(); ++level) {
+        levels[level].insert(levels[level].end(), other.levels[level].begin(), other.levels[level].end());
+    }
+    n += other.n;
+    retainedItems += other.retainedItems;
+    while (retainedItems >= maxItems) {
+        compress();
+    }
+}
+
+std::vector<std::pair<double, std::uint64_t>> KllSketch::weightedItems() const {
+    std::vector<std::pair<double, std::uint64_t>> items;
+    items.reserve(retained());
+    for (std::size_t level = 0; level < levels.size(); ++level) {
+        std::uint64_t weight = std::uint64_t{1} << level;
+        for (double value : levels[level]) {
+            items.emplace_back(value, weight);
+        }
+    }
+    std::sort(items.begin(), items.end());
+    return items;
+}
+
+double KllSketch::quantile(double q) const {
+    if (n == 0) {
+        throw std::logic_error("quantile of an empty sketch");
+    }
+    q = std::clamp(q, 0.0, 1.0);
+    auto items = weightedItems();
+    double target = q * static_cast<double>(n - 1);
+    std::uint64_t cumulative = 0;
+    for (const auto& [value, weight] : items) {
+        cumulative += weight;
+        if (static_cast<double>(cumulative) > target) {
+            return value;
+        }
+    }
+    return items.back().first;
+}
+
+double KllSketch::rank(double value) const {
+    std::uint64_t below = 0;
+    for (std::size_t level = 0; level < levels.size(); ++level) {
+        for (double item : levels[level]) {
+            if (item <= value) {
+                below += std::uint64_t{1} << level;
+            }
+        }
+    }
+    return static_cast<double>(below);
+}
+
+FixedHistogram::FixedHistogram(double lower, double upper, std::size_t bins)
+    : lo(lower), hi(upper), binCounts(bins, 0) {
+    if (bins == 0) {
+        throw std::invalid_argument("Histogram needs at least one bin");
+    }
+    if (!(upper > lower)) {
+        throw std::invalid_argument("Histogram range must satisfy lower < upper");
+    }
+}
+
+void FixedHistogram::add(double value) {
+    if (std::isnan(value)) {
+        return;
+    }
+    if (value < lo) {
+        ++below;
+    } else if (value > hi) {
+        ++above;
+    } else {
+        // The upper edge is inclusive so that the maximum lands in the last bin
+        auto bins = binCounts.size();
+        auto index = static_cast<std::size_t>((value - lo) / (hi - lo) * static_cast<double>(bins));
+        ++binCounts[std::min(index, bins - 1)];
+    }
+}
+
+std::vector<std::uint64_t> approximateHistogram(const KllSketch& sketch, double lower, double upper, std::size_t bins) {
+    std::vector<std::uint64_t> counts(bins, 0);
+    if (bins == 0 || sketch.empty()) {
+        return counts;
+    }
+    if (!(upper > lower)) {
+        counts[0] = sketch.count();
+        return counts;
+    }
+
+    double width = (upper - lower) / static_cast<double>(bins);
+    double previous = sketch.rank(std::nextafter(lower, -std::numeric_limits<double>::infinity()));
+    std::uint64_t assigned = 0;
+    for (std::size_t bin = 0; bin < bins; ++bin) {
+        double edge = bin + 1 == bins ? upper : lower + width * static_cast<double>(bin + 1);
+        double current = bin + 1 == bins ? static_cast<double>(sketch.count()) : sketch.rank(std::nextafter(edge, lower));
+        counts[bin] = static_cast<std::uint64_t>(std::max(0.0, current - previous));
+        assigned += counts[bin];
+        previous = current;
+    }
+    // Rounding aside, every value falls in some bin
+    if (assigned < sketch.count()) {
+        counts[bins - 1] += sketch.count() - assigned;
+    }
+    return counts;
+}
+
+RollingStats::RollingStats(std::size_t window) : windowSize(window) {
+    if (window == 0) {
+        throw std::invalid_argument("window must be at least 1");
+    }
+}
+
+void RollingStats::add(double value) {
+    if (ring.size() < windowSize) {
+        ring.push_back(value);
+        double delta = value - runningMean;
+        runningMean += delta / static_cast<double>(ring.size());
+        m2 += delta * (value - runningMean);
+        return;
+    }
+
+    // Replace the oldest value: shift the mean by the difference and update the
+    // second moment with both deviations, as in a remove followed by an add
+    double expired = ring[next];
+    ring[next] = value;
+    next = (next + 1) % ring.size();
+    double previousMean = runningMean;
+    runningMean += (value - expired) / static_cast<double>(windowSize);
+    m2 += (value - expired) * (value - runningMean + expired - previousMean);
+    // Rounding can leave a constant window slightly negative
+    m2 = std::max(m2, 0.0);
+}
+
+double RollingStats::variance() const {
+    return ring.empty() ? 0.0 : m2 / static_cast<double>(ring.size());
+}
+
+double RollingStats::sampleVariance() const {
+    return ring.size() > 1 ? m2 / static_cast<double>(ring.size() - 1) : 0.0;
+}
+
+RollingExtremes::RollingExtremes(std::size_t window) : window(window) {
+    if (window == 0) {
+        throw std::invalid_argument("window must be at least 1");
+    }
+}
+
+void RollingExtremes::add(double value) {
+    std::uint64_t position = added++;
+    // A value is never the extreme again once a newer one is at least as extreme
+    while (!minima.empty() && minima.back().second >= value) {
+        minima.pop_back();
+    }
+    while (!maxima.empty() && maxima.back().second <= value) {
+        maxima.pop_back();
+    }
+    minima.emplace_back(position, value);
+    maxima.emplace_back(position, value);
+
+    if (minima.front().first + window <= position) {
+        minima.pop_front();
+    }
+    if (maxima.front().first + window <= position) {
+        maxima.pop_front();
+    }
+}
+
+double RollingExtremes::min() const {
+    return minima.empty() ? std::numeric_limits<double>::infinity() : minima.front().second;
+}
+
+double RollingExtremes::max() const {
+    return maxima.empty() ? -std::numeric_limits<double>::infinity() : maxima.front().second;
+}
@@ -0,0 +1,197 @@
+#include "term_counter.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace {
+
+constexpr std::size_t kInitialSlots = 1024;
+
+// MurmurHash64A
+std::uint64_t hashTerm(std::string_view term) {
+    constexpr std::uint64_t m = 0xc6a4a7935bd1e995ULL;
+    constexpr int r = 47;
+    std::uint64_t h = 0x9e3779b97f4a7c15ULL ^ (term.size() * m);
+    std::size_t i = 0;
+    for (; i + 8 <= term.size(); i += 8) {
+        std::uint64_t k = 0;
+        std::memcpy(&k, term.data() + i, 8);
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    if (i < term.size()) {
+        std::uint64_t tail = 0;
+        std::memcpy(&tail, term.data() + i, term.size() - i);
+        h ^= tail;
+        h *= m;
+    }
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+
+} // namespace
+
+std::size_t TermCounter::TermHash::operator()(std::string_view term) const {
+    return static_cast<std::size_t>(hashTerm(term));
+}
+
+TermCounter::TermCounter(std::size_t memoryBudget, std::size_t trackedTerms)
+    : memoryBudget(std::max(memoryBudget, kMinMemoryBudget)), trackedTerms(std::max<std::size_t>(trackedTerms, 1)),
+      slots(kInitialSlots) {}
+
+void TermCounter::add(std::string_view term) {
+    std::uint64_t hash = hashTerm(term);
+    std::uint64_t position = added++;
+    if (!sketching && insertExact(term, hash, position)) {
+        return;
+    }
+    if (!sketching) {
+        startSketching();
+    }
+    addSketched(term, hash, 1, position);
+}
+
+bool TermCounter::insertExact(std::string_view term, std::uint64_t hash, std::uint64_t position) {
+    std::size_t mask = slots.size() - 1;
+    std::size_t i = hash & mask;
+    for (; slots[i].count != 0; i = (i + 1) & mask) {
+        const Slot& slot = slots[i];
+        if (slot.hash == hash && slot.length == term.size() && arena.compare(slot.offset, slot.length, term) == 0) {
+            ++slots[i].count;
+            return true;
+        }
+    }
+
+    // A new term, if it fits; the table grows past 70% full
+    if (term.size() > UINT32_MAX) {
+        return false;
+    }
+    bool full = (used + 1) * 10 > slots.size() * 7;
+    if (exactBytes(full ? slots.size() * 2 : slots.size(), arena.size() + term.size()) > memoryBudget) {
+        return false;
+    }
+    if (full) {
+        grow();
+        mask = slots.size() - 1;
+        for (i = hash & mask; slots[i].count != 0; i = (i + 1) & mask) {
+        }
+    }
+    slots[i] = Slot{hash, 1, position, arena.size(), static_cast<std::uint32_t>(term.size())};
+    arena.append(term);
+    ++used;
+    return true;
+}
+
+void TermCounter::grow() {
+    std::vector<Slot> grown(slots.size() * 2);
+    std::size_t mask = grown.size() - 1;
+    for (const Slot& slot : slots) {
+        if (slot.count == 0) {
+            continue;
+        }
+        std::size_t i = slot.hash & mask;
+        while (grown[i].count != 0) {
+            i = (i + 1) & mask;
+        }
+        grown[i] = slot;
+    }
+    slots = std::move(grown);
+}
+
+std::size_t TermCounter::exactBytes(std::size_t slotCount, std::size_t arenaSize) const {
+    return slotCount * sizeof(Slot) + arenaSize;
+}
+
+void TermCounter::startSketching() {
+    sketching = true;
+    // Half the budget for the sketch, the rest for the candidates
+    sketchWidth = std::bit_floor(std::max<std::size_t>(memoryBudget / 2 / (kSketchDepth * sizeof(std::uint64_t)), 64));
+    sketch.assign(kSketchDepth * sketchWidth, 0);
+
+    // Replay the exact counts in order of first appearance
+    std::vector<const Slot*> counted;
+    counted.reserve(used);
+    for (const Slot& slot : slots) {
+        if (slot.count != 0) {
+            counted.push_back(&slot);
+        }
+    }
+    std::sort(counted.begin(), counted.end(), [](const Slot* a, const Slot* b) { return a->first < b->first; });
+    for (const Slot* slot : counted) {
+        addSketched(std::string_view(arena).substr(slot->offset, slot->length), slot->hash, slot->count, slot->first);
+    }
+    std::vector<Slot>().swap(slots);
+    std::string().swap(arena);
+    used = 0;
+}
+
+void TermCounter::addSketched(std::string_view term, std::uint64_t hash, std::uint64_t count, std::uint64_t first) {
+    // Row i hashes to hash + i * step (Kirsch-Mitzenmacher). Conservative
+    // update: only the cells below the new estimate are raised.
+    std::uint64_t step = (hash >> 32) | 1;
+    std::size_t mask = sketchWidth - 1;
+    std::uint64_t* cells[kSketchDepth];
+    std::uint64_t smallest = UINT64_MAX;
+    for (std::size_t row = 0; row < kSketchDepth; ++row) {
+        cells[row] = &sketch[row * sketchWidth + ((hash + row * step) & mask)];
+        smallest = std::min(smallest, *cells[row]);
+    }
+    std::uint64_t estimate = smallest + count;
+    for (std::uint64_t* cell : cells) {
+        *cell = std::max(*cell, estimate);
+    }
+
+    if (auto it = candidates.find(term); it != candidates.end()) {
+        auto node = byCount.extract(std::tuple(it->second.count, ~it->second.first, std::string_view(it->first)));
+        std::get<0>(node.value()) = estimate;
+        byCount.insert(std::move(node));
+        it->second.count = estimate;
+        return;
+    }
+    if (candidates.size() == trackedTerms) {
+        auto smallestCandidate = byCount.begin();
+        if (std::get<0>(*smallestCandidate) >= estimate) {
+            return;
+        }
+        auto evicted = candidates.find(std::get<2>(*smallestCandidate));
+        byCount.erase(smallestCandidate);
+        candidates.erase(evicted);
+    }
+    auto inserted = candidates.emplace(std::string(term), Candidate{estimate, first}).first;
+    byCount.emplace(estimate, ~first, inserted->first);
+}
+
+std::vector<std::pair<std::string, std::uint64_t>> TermCounter::top(std::size_t k) const {
+    // (count, first, term)
+    std::vector<std::tuple<std::uint64_t, std::uint64_t, std::string_view>> terms;
+    if (sketching) {
+        terms.reserve(candidates.size());
+        for (const auto& [term, candidate] : candidates) {
+            terms.emplace_back(candidate.count, candidate.first, term);
+        }
+    } else {
+        terms.reserve(used);
+        for (const Slot& slot : slots) {
+            if (slot.count != 0) {
+                terms.emplace_back(slot.count, slot.first, std::string_view(arena).substr(slot.offset, slot.length));
+            }
+        }
+    }
+
+    std::size_t n = std::min(k, terms.size());
+    std::partial_sort(terms.begin(), terms.begin() + static_cast<std::ptrdiff_t>(n), terms.end(), [](const auto& a, const auto& b) {
+        return std::get<0>(a) != std::get<0>(b) ? std::get<0>(a) > std::get<0>(b) : std::get<1>(a) < std::get<1>(b);
+    });
+    std::vector<std::pair<std::string, std::uint64_t>> result;
+    result.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        result.emplace_back(std::string(std::get<2>(terms[i])), std::get<0>(terms[i]));
+    }
+    return result;
+}
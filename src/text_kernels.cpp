@@ -0,0 +1,357 @@
+#include "text_kernels.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TEXT_KERNELS_SSE2 1
+#endif
+
+namespace utf8 {
+
+namespace {
+
+constexpr std::size_t kBlock = 16;
+
+bool isAsciiByte(unsigned char byte) {
+    return byte < 0x80;
+}
+
+// Decodes the code point starting at text[i] and stores its length in bytes
+std::uint32_t decode(std::string_view text, std::size_t i, std::size_t& length) {
+    auto byte = static_cast<unsigned char>(text[i]);
+    length = byte < 0x80 ? 1 : byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : 2;
+    if (i + length > text.size()) {
+        length = 1;
+        return byte;
+    }
+    if (length == 1) {
+        return byte;
+    }
+    std::uint32_t codePoint = byte & (0x3F >> (length - 1));
+    for (std::size_t j = 1; j < length; ++j) {
+        codePoint = (codePoint << 6) | (static_cast<unsigned char>(text[i + j]) & 0x3F);
+    }
+    return codePoint;
+}
+
+// Py_UNICODE_ISSPACE: bidirectional class WS, B or S, or category Zs
+bool isSpace(std::uint32_t c) {
+    if (c < 0x80) {
+        return c == ' ' || (c >= 0x09 && c <= 0x0D) || (c >= 0x1C && c <= 0x1F);
+    }
+    return c == 0x85 || c == 0xA0 || c == 0x1680 || (c >= 0x2000 && c <= 0x200A)
+        || c == 0x2028 || c == 0x2029 || c == 0x202F || c == 0x205F || c == 0x3000;
+}
+
+// Code points that extend the preceding grapheme cluster: combining marks in
+// the common blocks, variation selectors, emoji modifiers and tags
+bool isExtend(std::uint32_t c) {
+    return (c >= 0x0300 && c <= 0x036F)     // Combining Diacritical Marks
+        || (c >= 0x0483 && c <= 0x0489)     // Cyrillic combining marks
+        || (c >= 0x0591 && c <= 0x05BD)     // Hebrew points
+        || (c >= 0x0610 && c <= 0x061A) || (c >= 0x064B && c <= 0x065F) || c == 0x0670
+        || (c >= 0x06D6 && c <= 0x06DC) || (c >= 0x06DF && c <= 0x06E4)
+        || (c >= 0x0900 && c <= 0x0903) || (c >= 0x093A && c <= 0x093C) || (c >= 0x093E && c <= 0x094F)
+        || c == 0x0E31 || (c >= 0x0E34 && c <= 0x0E3A) || (c >= 0x0E47 && c <= 0x0E4E)  // Thai
+        || (c >= 0x1AB0 && c <= 0x1AFF)     // Combining Diacritical Marks Extended
+        || (c >= 0x1DC0 && c <= 0x1DFF)     // Combining Diacritical Marks Supplement
+        || c == 0x200C                      // Zero width non-joiner
+        || (c >= 0x20D0 && c <= 0x20FF)     // Combining Marks for Symbols
+        || (c >= 0x302A && c <= 0x302F) || c == 0x3099 || c == 0x309A
+        || (c >= 0xFE00 && c <= 0xFE0F)     // Variation Selectors
+        || (c >= 0xFE20 && c <= 0xFE2F)     // Combining Half Marks
+        || (c >= 0x1F3FB && c <= 0x1F3FF)   // Emoji skin tone modifiers
+        || (c >= 0xE0020 && c <= 0xE007F)   // Tags
+        || (c >= 0xE0100 && c <= 0xE01EF);  // Variation Selectors Supplement
+}
+
+constexpr std::uint32_t kZeroWidthJoiner = 0x200D;
+
+bool isRegionalIndicator(std::uint32_t c) {
+    return c >= 0x1F1E6 && c <= 0x1F1FF;
+}
+
+// Hangul_Syllable_Type, for the jamo and precomposed syllable rules
+enum class Hangul { None, L, V, T, LV, LVT };
+
+Hangul hangulType(std::uint32_t c) {
+    if ((c >= 0x1100 && c <= 0x115F) || (c >= 0xA960 && c <= 0xA97C)) {
+        return Hangul::L;
+    }
+    if ((c >= 0x1160 && c <= 0x11A7) || (c >= 0xD7B0 && c <= 0xD7C6)) {
+        return Hangul::V;
+    }
+    if ((c >= 0x11A8 && c <= 0x11FF) || (c >= 0xD7CB && c <= 0xD7FB)) {
+        return Hangul::T;
+    }
+    if (c >= 0xAC00 && c <= 0xD7A3) {
+        // Every 28th syllable has no trailing consonant
+        return (c - 0xAC00) % 28 == 0 ? Hangul::LV : Hangul::LVT;
+    }
+    return Hangul::None;
+}
+
+// UAX #29 rules GB6 to GB8: L joins L, V, LV and LVT; LV and V join V and T;
+// LVT and T join T
+bool joinsHangul(Hangul before, Hangul after) {
+    switch (before) {
+        case Hangul::L: return after == Hangul::L || after == Hangul::V || after == Hangul::LV || after == Hangul::LVT;
+        case Hangul::V:
+        case Hangul::LV: return after == Hangul::V || after == Hangul::T;
+        case Hangul::T:
+        case Hangul::LVT: return after == Hangul::T;
+        case Hangul::None: return false;
+    }
+    return false;
+}
+
+// Maps bytes in [first, first + 25] by flipping bit 0x20; returns false as soon
+// as a non-ASCII byte is seen
+bool flipAsciiCase(std::string_view text, std::string& out, char first) {
+    out.resize(text.size());
+    std::size_t i = 0;
+#ifdef TEXT_KERNELS_SSE2
+    // Shift the range to start at -128 so one signed compare tests both ends
+    const __m128i shift = _mm_set1_epi8(static_cast<char>(0x80 - first));
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(-128 + 26));
+    const __m128i flip = _mm_set1_epi8(0x20);
+    for (; i + kBlock <= text.size(); i += kBlock) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i));
+        if (_mm_movemask_epi8(block) != 0) {
+            return false;
+        }
+        __m128i inRange = _mm_cmplt_epi8(_mm_add_epi8(block, shift), limit);
+        block = _mm_xor_si128(block, _mm_and_si128(inRange, flip));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out.data() + i), block);
+    }
+#endif
+    for (; i < text.size(); ++i) {
+        auto byte = static_cast<unsigned char>(text[i]);
+        if (!isAsciiByte(byte)) {
+            return false;
+        }
+        bool inRange = byte >= static_cast<unsigned char>(first) && byte <= static_cast<unsigned char>(first + 25);
+        out[i] = static_cast<char>(inRange ? byte ^ 0x20 : byte);
+    }
+    return true;
+}
+
+#ifdef TEXT_KERNELS_SSE2
+// Bit i is set when byte i of an ASCII block is whitespace
+unsigned asciiSpaceMask(__m128i block) {
+    // ' ' and 0x1C-0x1F, then \t \n \v \f \r
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(0x1B)), _mm_cmplt_epi8(block, _mm_set1_epi8(0x21)));
+    __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(0x08)), _mm_cmplt_epi8(block, _mm_set1_epi8(0x0E)));
+    return static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(upper, lower)));
+}
+#endif
+
+} // namespace
+
+bool isAscii(std::string_view text) {
+    std::size_t i = 0;
+#ifdef TEXT_KERNELS_SSE2
+    for (; i + kBlock <= text.size(); i += kBlock) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i));
+        if (_mm_movemask_epi8(block) != 0) {
+            return false;
+        }
+    }
+#endif
+    for (; i < text.size(); ++i) {
+        if (!isAsciiByte(static_cast<unsigned char>(text[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::optional<std::string> toUpperAscii(std::string_view text) {
+    std::string out;
+    if (!flipAsciiCase(text, out, 'a')) {
+        return std::nullopt;
+    }
+    return out;
+}
+
+std::optional<std::string> toLowerAscii(std::string_view text) {
+    std::string out;
+    if (!flipAsciiCase(text, out, 'A')) {
+        return std::nullopt;
+    }
+    return out;
+}
+
+bool isValid(std::string_view text) {
+    std::size_t i = 0;
+    while (i < text.size()) {
+        auto byte = static_cast<unsigned char>(text[i]);
+        if (isAsciiByte(byte)) {
+            ++i;
+            continue;
+        }
+        // Allowed range of the second byte narrows for E0, ED, F0 and F4 to
+        // exclude overlong forms, surrogates and code points past U+10FFFF
+        std::size_t length = 0;
+        unsigned char low = 0x80, high = 0xBF;
+        if (byte >= 0xC2 && byte <= 0xDF) {
+            length = 2;
+        } else if (byte >= 0xE0 && byte <= 0xEF) {
+            length = 3;
+            low = byte == 0xE0 ? 0xA0 : 0x80;
+            high = byte == 0xED ? 0x9F : 0xBF;
+        } else if (byte >= 0xF0 && byte <= 0xF4) {
+            length = 4;
+            low = byte == 0xF0 ? 0x90 : 0x80;
+            high = byte == 0xF4 ? 0x8F : 0xBF;
+        } else {
+            return false;
+        }
+        if (i + length > text.size()) {
+            return false;
+        }
+        auto second = static_cast<unsigned char>(text[i + 1]);
+        if (second < low || second > high) {
+            return false;
+        }
+        for (std::size_t j = 2; j < length; ++j) {
+            if ((static_cast<unsigned char>(text[i + j]) & 0xC0) != 0x80) {
+                return false;
+            }
+        }
+        i += length;
+    }
+    return true;
+}
+
+std::size_t countCodePoints(std::string_view text) {
+    // Every byte except continuation bytes (10xxxxxx) starts a code point
+    std::size_t count = 0;
+    std::size_t i = 0;
+#ifdef TEXT_KERNELS_SSE2
+    // Continuation bytes are -128..-65 as signed chars
+    const __m128i lastContinuation = _mm_set1_epi8(static_cast<char>(0xBF));
+    for (; i + kBlock <= text.size(); i += kBlock) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i));
+        count += static_cast<std::size_t>(std::popcount(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpgt_epi8(block, lastContinuation)))));
+    }
+#endif
+    for (; i < text.size(); ++i) {
+        count += (static_cast<unsigned char>(text[i]) & 0xC0) != 0x80;
+    }
+    return count;
+}
+
+std::size_t countWords(std::string_view text) {
+    std::size_t count = 0;
+    bool previousSpace = true;
+    std::size_t i = 0;
+    while (i < text.size()) {
+#ifdef TEXT_KERNELS_SSE2
+        if (i + kBlock <= text.size()) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i));
+            if (_mm_movemask_epi8(block) == 0) {
+                // A word starts at every non-space byte that follows a space
+                unsigned spaces = asciiSpaceMask(block);
+                unsigned follows = ((spaces << 1) | (previousSpace ? 1u : 0u)) & 0xFFFF;
+                count += static_cast<std::size_t>(std::popcount(~spaces & follows & 0xFFFF));
+                previousSpace = (spaces >> 15) & 1;
+                i += kBlock;
+                continue;
+            }
+        }
+#endif
+        std::size_t length = 0;
+        bool space = isSpace(decode(text, i, length));
+        count += !space && previousSpace;
+        previousSpace = space;
+        i += length;
+    }
+    return count;
+}
+
+std::string_view nextWord(std::string_view text, std::size_t& pos) {
+    // Moves pos to the first character that is (or is not) a space
+    auto skipTo = [&](bool space) {
+        while (pos < text.size()) {
+#ifdef TEXT_KERNELS_SSE2
+            if (pos + kBlock <= text.size()) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + pos));
+                if (_mm_movemask_epi8(block) == 0) {
+                    unsigned spaces = asciiSpaceMask(block);
+                    unsigned found = space ? spaces : ~spaces & 0xFFFF;
+                    if (found == 0) {
+                        pos += kBlock;
+                        continue;
+                    }
+                    pos += static_cast<std::size_t>(std::countr_zero(found));
+                    return;
+                }
+            }
+#endif
+            std::size_t length = 0;
+            if (isSpace(decode(text, pos, length)) == space) {
+                return;
+            }
+            pos += length;
+        }
+    };
+    skipTo(false);
+    std::size_t start = pos;
+    skipTo(true);
+    return text.substr(start, pos - start);
+}
+
+std::string reverseGraphemes(std::string_view text) {
+    if (isAscii(text)) {
+        // Every byte is a cluster apart from CR LF, whose reversal is undone after
+        std::string out(text.rbegin(), text.rend());
+        for (std::size_t i = 0; i + 1 < out.size(); ++i) {
+            if (out[i] == '\n' && out[i + 1] == '\r') {
+                std::swap(out[i], out[i + 1]);
+                ++i;
+            }
+        }
+        return out;
+    }
+
+    // Cluster boundaries as byte offsets, then copy the clusters back to front
+    std::vector<std::size_t> starts;
+    std::uint32_t previous = 0;
+    bool joinNext = false;
+    bool pairedIndicator = false;
+    std::size_t i = 0;
+    while (i < text.size()) {
+        std::size_t length = 0;
+        std::uint32_t c = decode(text, i, length);
+        bool continues = !starts.empty()
+            && (joinNext || isExtend(c) || c == kZeroWidthJoiner
+                || (previous == '\r' && c == '\n')
+                || joinsHangul(hangulType(previous), hangulType(c))
+                || (isRegionalIndicator(previous) && isRegionalIndicator(c) && !pairedIndicator));
+        if (!continues) {
+            starts.push_back(i);
+            pairedIndicator = false;
+        } else if (isRegionalIndicator(c)) {
+            pairedIndicator = true;
+        }
+        joinNext = c == kZeroWidthJoiner;
+        previous = c;
+        i += length;
+    }
+
+    std::string out;
+    out.reserve(text.size());
+    std::size_t end = text.size();
+    for (auto it = starts.rbegin(); it != starts.rend(); ++it) {
+        out.append(text.substr(*it, end - *it));
+        end = *it;
+    }
+    return out;
+}
+
+} // namespace utf8
@@ -0,0 +1,45 @@
+// Native handler plugin used by the plugin tests, and the smallest example of
+// the ABI in cppideas_plugin.h
+#include "cppideas_plugin.h"
+
+#include <string>
+
+namespace {
+
+void (*append)(cppideas_response*, const char*, size_t) = nullptr;
+
+// {"type": "plugin", "operation": "byte_count"}: size of the request text
+cppideas_status byteCount(void*, const char*, size_t requestSize, cppideas_response* response) {
+    std::string body = R"({"success": true, "result": )" + std::to_string(requestSize) + R"(, "operation": "byte_count"})";
+    append(response, body.data(), body.size());
+    return CPPIDEAS_HANDLED;
+}
+
+cppideas_status fail(void*, const char*, size_t, cppideas_response* response) {
+    const std::string message = "sample failure";
+    append(response, message.data(), message.size());
+    return CPPIDEAS_FAILED;
+}
+
+// Sees every math/add request but leaves them all to processor.py
+cppideas_status deferAll(void*, const char*, size_t, cppideas_response*) {
+    return CPPIDEAS_DEFER;
+}
+
+} // namespace
+
+extern "C" uint32_t cppideas_plugin_abi_version(void) {
+    return CPPIDEAS_PLUGIN_ABI_VERSION;
+}
+
+extern "C" int cppideas_plugin_init(const cppideas_host* host) {
+    append = host->append;
+    if (host->register_handler(host->context, "plugin", "byte_count", byteCount, nullptr) != 0
+        || host->register_handler(host->context, "plugin", "fail", fail, nullptr) != 0
+        || host->register_handler(host->context, "math", "add", deferAll, nullptr) != 0) {
+        return 1;
+    }
+    // A pair can only be registered once
+    return host->register_handler(host->context, "plugin", "fail", fail, nullptr) != 0 ? 0 : 2;
+}
+
@@ -0,0 +1,129 @@
+#include <catch2/catch_test_macros.hpp>
+#include "json_validation.h"
+
+#include <string>
+
+namespace {
+
+// A request with a large dataset, pretty-printed so errors have lines
+std::string largeRequest(std::size_t values) {
+    std::string text = "{\n  \"type\": \"data\",\n  \"operation\": \"stats\",\n  \"dataset\": [\n";
+    for (std::size_t i = 0; i < values; ++i) {
+        text += "    " + std::to_string(i) + ".5" + (i + 1 < values ? ",\n" : "\n");
+    }
+    text += "  ]\n}\n";
+    return text;
+}
+
+} // namespace
+
+TEST_CASE("JSON validation", "[json_validation]")
+{
+    SECTION("Valid documents")
+    {
+        for (const char* text : {"{}", " {\"a\": [1, -2.5e+3, true, false, null]} ", "[]", "\"s\"", "0",
+                                 "{\"n\": NaN, \"i\": -Infinity, \"j\": Infinity}",
+                                 "{\"s\": \"\\ud800 \\u00e9 \\\" \\\\ \\/ \\b\\f\\n\\r\\t\"}"}) {
+            INFO(text);
+            CHECK(validateJson(text).status == JsonValidation::Status::Valid);
+        }
+    }
+
+    SECTION("Top-level objects are reported as such")
+    {
+        CHECK(validateJson("{\"type\": \"echo\"}").object);
+        CHECK_FALSE(validateJson("[{}]").object);
+        CHECK_FALSE(validateJson("42").object);
+    }
+
+    SECTION("Errors use json.loads wording and positions")
+    {
+        struct Case {
+            const char* text;
+            const char* message;
+            std::size_t offset;
+        };
+        for (const Case& c : {
+                 Case{"", "Expecting value", 0},
+                 Case{"{\"a\": }", "Expecting value", 6},
+                 Case{"{a: 1}", "Expecting property name enclosed in double quotes", 1},
+                 Case{"{\"a\": 1,}", "Expecting property name enclosed in double quotes", 8},
+                 Case{"{\"a\" 1}", "Expecting ':' delimiter", 5},
+                 Case{"[1 2]", "Expecting ',' delimiter", 3},
+                 Case{"{\"a\": [1}", "Expecting ',' delimiter", 8},
+                 Case{"{} {}", "Extra data", 3},
+                 Case{"{\"a\": \"abc", "Unterminated string starting at", 6},
+                 Case{"\"a\tb\"", "Invalid control character at", 2},
+                 Case{"\"\\x\"", "Invalid \\escape", 1},
+                 Case{"\"\\u12g4\"", "Invalid \\uXXXX escape", 2},
+                 Case{"[-]", "Expecting value", 1},
+                 Case{"[1.]", "Expecting ',' delimiter", 2},
+                 Case{"[01]", "Expecting ',' delimiter", 2},
+                 Case{"\xEF\xBB\xBF{}", "Unexpected UTF-8 BOM (decode using utf-8-sig)", 0},
+             }) {
+            INFO(c.text);
+            JsonValidation result = validateJson(c.text);
+            REQUIRE(result.status == JsonValidation::Status::Invalid);
+            CHECK(result.message == c.message);
+            CHECK(result.offset == c.offset);
+        }
+    }
+
+    SECTION("Line and column count characters")
+    {
+        JsonValidation result = validateJson("{\n  \"t\": \"\xc3\xa9\xc3\xa9\" x\n}");
+        REQUIRE(result.status == JsonValidation::Status::Invalid);
+        CHECK(result.line == 2);
+        CHECK(result.column == 13);
+    }
+}
+
+TEST_CASE("Incremental JSON validation", "[json_validation]")
+{
+    std::string text = largeRequest(100000);
+    REQUIRE(text.size() > 8 * IncrementalJsonValidator::kCheckpointBytes);
+
+    IncrementalJsonValidator validator;
+    REQUIRE(validator.validate(text).status == JsonValidation::Status::Valid);
+    CHECK(validator.lastScannedBytes() == text.size());
+
+    SECTION("An edit near the end only rescans the tail")
+    {
+        std::size_t edit = text.size() - 1000;
+        text.insert(edit, "x");
+        JsonValidation result = validator.validate(text, edit);
+        REQUIRE(result.status == JsonValidation::Status::Invalid);
+        CHECK(validator.lastScannedBytes() < 2 * IncrementalJsonValidator::kCheckpointBytes);
+
+        JsonValidation full = validateJson(text);
+        CHECK(result.message == full.message);
+        CHECK(result.offset == full.offset);
+        CHECK(result.line == full.line);
+        CHECK(result.object);
+
+        // Undoing the edit makes the document valid again
+        text.erase(edit, 1);
+        CHECK(validator.validate(text, edit).status == JsonValidation::Status::Valid);
+    }
+
+    SECTION("An edit at the start rescans everything")
+    {
+        text[0] = '[';
+        JsonValidation result = validator.validate(text, 0);
+        CHECK(result.status == JsonValidation::Status::Invalid);
+        CHECK(validator.lastScannedBytes() < text.size());
+        CHECK(result.message == validateJson(text).message);
+    }
+
+    SECTION("Cancellation stops at the next checkpoint")
+    {
+        std::stop_source stop;
+        stop.request_stop();
+        IncrementalJsonValidator fresh;
+        CHECK(fresh.validate(text, 0, stop.get_token()).status == JsonValidation::Status::Cancelled);
+        CHECK(fresh.lastScannedBytes() <= 2 * IncrementalJsonValidator::kCheckpointBytes);
+
+        // A cancelled run leaves usable state behind
+        CHECK(fresh.validate(text).status == JsonValidation::Status::Valid);
+    }
+}
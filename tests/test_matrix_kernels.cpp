@@ -0,0 +1,131 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include "matrix_kernels.h"
+
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace {
+
+matrix::Matrix randomMatrix(std::size_t rows, std::size_t cols, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> value(-1.0, 1.0);
+    matrix::Matrix m(rows, cols);
+    for (double& entry : m.values) {
+        entry = value(rng);
+    }
+    return m;
+}
+
+matrix::Matrix naiveMultiply(const matrix::Matrix& a, const matrix::Matrix& b) {
+    matrix::Matrix c(a.rows, b.cols);
+    for (std::size_t i = 0; i < a.rows; ++i) {
+        for (std::size_t j = 0; j < b.cols; ++j) {
+            double total = 0.0;
+            for (std::size_t k = 0; k < a.cols; ++k) {
+                total += a.at(i, k) * b.at(k, j);
+            }
+            c.at(i, j) = total;
+        }
+    }
+    return c;
+}
+
+void requireClose(const matrix::Matrix& actual, const matrix::Matrix& expected) {
+    REQUIRE(actual.rows == expected.rows);
+    REQUIRE(actual.cols == expected.cols);
+    for (std::size_t i = 0; i < actual.values.size(); ++i) {
+        REQUIRE_THAT(actual.values[i], Catch::Matchers::WithinAbs(expected.values[i], 1e-9));
+    }
+}
+
+} // namespace
+
+TEST_CASE("Matrix multiplication", "[matrix]")
+{
+    SECTION("Small products are exact")
+    {
+        matrix::Matrix a(2, 3);
+        a.values = {1, 2, 3, 4, 5, 6};
+        matrix::Matrix b(3, 2);
+        b.values = {7, 8, 9, 10, 11, 12};
+        matrix::Matrix c = matrix::multiply(a, b);
+        REQUIRE(c.rows == 2);
+        REQUIRE(c.cols == 2);
+        REQUIRE(c.values == std::vector<double>{58, 64, 139, 154});
+    }
+
+    SECTION("Shapes crossing tile boundaries match the naive product")
+    {
+        auto a = randomMatrix(70, 131, 1);
+        auto b = randomMatrix(131, 259, 2);
+        requireClose(matrix::multiply(a, b, 1), naiveMultiply(a, b));
+    }
+
+    SECTION("Threaded products match the single-threaded one")
+    {
+        auto a = randomMatrix(203, 160, 3);
+        auto b = randomMatrix(160, 97, 4);
+        auto single = matrix::multiply(a, b, 1);
+        for (std::size_t threads : std::initializer_list<std::size_t>{2, 3, 8, 0}) {
+            INFO(threads);
+            REQUIRE(matrix::multiply(a, b, threads).values == single.values);
+        }
+    }
+}
+
+TEST_CASE("Matrix transpose and dot", "[matrix]")
+{
+    auto m = randomMatrix(45, 77, 5);
+    auto t = matrix::transpose(m);
+    REQUIRE(t.rows == 77);
+    REQUIRE(t.cols == 45);
+    for (std::size_t i = 0; i < m.rows; ++i) {
+        for (std::size_t j = 0; j < m.cols; ++j) {
+            REQUIRE(t.at(j, i) == m.at(i, j));
+        }
+    }
+
+    std::vector<double> a = {1, 2, 3, 4, 5, 6, 7};
+    std::vector<double> b = {7, 6, 5, 4, 3, 2, 1};
+    REQUIRE(matrix::dot(a, b) == 84.0);
+    REQUIRE(matrix::dot(std::vector<double>{2.5}, std::vector<double>{4}) == 10.0);
+}
+
+TEST_CASE("Matrix reductions", "[matrix]")
+{
+    matrix::Matrix m(3, 5);
+    m.values = {
+        1, 2, 3, 4, 5,
+        -1, 0, 7, 2, 9,
+        4, 4, 4, 4, 4,
+    };
+
+    SECTION("Rows")
+    {
+        REQUIRE(matrix::reduce(m, matrix::Axis::Rows, matrix::Reduction::Sum) == std::vector<double>{15, 17, 20});
+        REQUIRE(matrix::reduce(m, matrix::Axis::Rows, matrix::Reduction::Mean) == std::vector<double>{3, 3.4, 4});
+        REQUIRE(matrix::reduce(m, matrix::Axis::Rows, matrix::Reduction::Min) == std::vector<double>{1, -1, 4});
+        REQUIRE(matrix::reduce(m, matrix::Axis::Rows, matrix::Reduction::Max) == std::vector<double>{5, 9, 4});
+    }
+
+    SECTION("Columns")
+    {
+        REQUIRE(matrix::reduce(m, matrix::Axis::Columns, matrix::Reduction::Sum) == std::vector<double>{4, 6, 14, 10, 18});
+        REQUIRE(matrix::reduce(m, matrix::Axis::Columns, matrix::Reduction::Min) == std::vector<double>{-1, 0, 3, 2, 4});
+        REQUIRE(matrix::reduce(m, matrix::Axis::Columns, matrix::Reduction::Max) == std::vector<double>{4, 4, 7, 4, 9});
+        auto mean = matrix::reduce(m, matrix::Axis::Columns, matrix::Reduction::Mean);
+        REQUIRE_THAT(mean[2], Catch::Matchers::WithinRel(14.0 / 3.0));
+    }
+
+    SECTION("A NaN after the first row never replaces a minimum or maximum")
+    {
+        m.at(1, 0) = std::numeric_limits<double>::quiet_NaN();
+        m.at(1, 4) = std::numeric_limits<double>::quiet_NaN();
+        auto minimum = matrix::reduce(m, matrix::Axis::Columns, matrix::Reduction::Min);
+        REQUIRE(minimum[0] == 1);
+        REQUIRE(minimum[4] == 4);
+        REQUIRE(std::isnan(matrix::reduce(m, matrix::Axis::Columns, matrix::Reduction::Sum)[4]));
+    }
+}
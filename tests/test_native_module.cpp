@@ -0,0 +1,127 @@
+#include <catch2/catch_test_macros.hpp>
+#include "python_processor.h"
+
+#include <boost/python.hpp>
+#include <atomic>
+#include <string>
+#include <thread>
+
+namespace bp = boost::python;
+
+namespace {
+
+// Evaluates a Python expression with cppideas_native imported; the GIL must be held
+bp::object evaluate(const std::string& expression) {
+    bp::object main = bp::import("__main__");
+    bp::dict scope;
+    scope["cppideas_native"] = bp::import("cppideas_native");
+    return bp::eval(bp::str(expression), main.attr("__dict__"), scope);
+}
+
+template <typename T>
+T value(const std::string& expression) {
+    return bp::extract<T>(evaluate(expression));
+}
+
+// Runs body with the GIL and reports any Python exception as a failure
+template <typename Body>
+void withGil(Body body) {
+    PyGILState_STATE state = PyGILState_Ensure();
+    try {
+        body();
+    } catch (const bp::error_already_set&) {
+        PyErr_Print();
+        PyGILState_Release(state);
+        FAIL("Python exception");
+    }
+    PyGILState_Release(state);
+}
+
+} // namespace
+
+TEST_CASE("Native module", "[python][native_module]")
+{
+    PythonProcessor processor;
+    REQUIRE(processor.isInitialized());
+
+    SECTION("Reductions and sorting")
+    {
+        withGil([] {
+            REQUIRE(value<double>("cppideas_native.sum([1, 2.5, True])") == 4.5);
+            REQUIRE(value<double>("cppideas_native.sum(())") == 0.0);
+            REQUIRE(value<double>("cppideas_native.mean(range(1, 101))") == 50.5);
+            REQUIRE(value<double>("cppideas_native.min([3, -2, 7, 1, 0])") == -2.0);
+            REQUIRE(value<double>("cppideas_native.max([3, -2, 7, 1, 0])") == 7.0);
+            REQUIRE(value<double>("cppideas_native.dot([1, 2, 3, 4, 5], [5, 4, 3, 2, 1])") == 35.0);
+            REQUIRE(value<bool>("cppideas_native.sort([3, 1.5, 2, 1.5, -1]) == [-1, 1.5, 1.5, 2, 3]"));
+            // The original objects come back, ints stay ints
+            REQUIRE(value<bool>("type(cppideas_native.sort([2, 1])[0]) is int"));
+            // One-shot iterators are read once
+            REQUIRE(value<bool>("cppideas_native.sort(x for x in [3.0, 1.0, 2.0]) == [1.0, 2.0, 3.0]"));
+            REQUIRE(value<bool>("cppideas_native.sort(iter([2, 1])) == [1, 2]"));
+        });
+    }
+
+    SECTION("Text kernels match str")
+    {
+        withGil([] {
+            REQUIRE(value<bool>("cppideas_native.upper('Hello, World') == 'HELLO, WORLD'"));
+            REQUIRE(value<bool>("cppideas_native.lower('Stra\\u00dfe') == 'Stra\\u00dfe'.lower()"));
+            REQUIRE(value<bool>("cppideas_native.upper('stra\\u00dfe') == 'STRASSE'"));
+            REQUIRE(value<int>("cppideas_native.word_count(' one\\ttwo\\u3000three ')") == 3);
+            REQUIRE(value<bool>("cppideas_native.reverse_graphemes('ae\\u0301') == 'e\\u0301a'"));
+        });
+    }
+
+    SECTION("Invalid arguments raise")
+    {
+        withGil([] {
+            bp::object main = bp::import("__main__");
+            bp::exec(bp::str(
+                "import cppideas_native\n"
+                "def raised(f):\n"
+                "    try:\n"
+                "        f()\n"
+                "    except Exception as e:\n"
+                "        return type(e).__name__\n"
+                "    return None\n"),
+                main.attr("__dict__"), main.attr("__dict__"));
+            auto raised = [&](const std::string& call) {
+                bp::object name = bp::eval(bp::str("raised(lambda: " + call + ")"), main.attr("__dict__"), main.attr("__dict__"));
+                return std::string(bp::extract<std::string>(name));
+            };
+            REQUIRE(raised("cppideas_native.sum(['a'])") == "TypeError");
+            REQUIRE(raised("cppideas_native.mean([])") == "ValueError");
+            REQUIRE(raised("cppideas_native.dot([1], [1, 2])") == "ValueError");
+            REQUIRE(raised("cppideas_native.upper(3)") == "TypeError");
+        });
+    }
+
+    SECTION("The GIL is released while a kernel runs")
+    {
+        // A Python thread keeps counting while the main thread sorts
+        withGil([] {
+            bp::object main = bp::import("__main__");
+            bp::exec(bp::str(
+                "import threading, random, cppideas_native\n"
+                "ticks = 0\n"
+                "running = True\n"
+                "def spin():\n"
+                "    global ticks\n"
+                "    while running:\n"
+                "        ticks += 1\n"
+                "values = [random.random() for _ in range(2000000)]\n"
+                "spinner = threading.Thread(target=spin)\n"
+                "spinner.start()\n"
+                "while ticks == 0:\n"
+                "    pass\n"
+                "before = ticks\n"
+                "cppideas_native.sort(values)\n"
+                "during = ticks - before\n"
+                "running = False\n"
+                "spinner.join()\n"),
+                main.attr("__dict__"), main.attr("__dict__"));
+            REQUIRE(bp::extract<long>(main.attr("during"))() > 0);
+        });
+    }
+}
@@ -1,7 +1,26 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/matchers/catch_matchers_string.hpp>
 #include <nlohmann/json.hpp>
+#include "batch_runner.h"
+#include "plugin_registry.h"
 #include "python_processor.h"
+#include "request_trace.h"
+#include "startup_paths.h"
+#include <Python.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <filesystem>
+#include <fmt/format.h>
+#include <fstream>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <loguru/loguru.hpp>
 
 using json = nlohmann::json;
@@ -128,6 +147,53 @@ TEST_CASE("Python Processor JSON Processing", "[python][processor][json]")
             REQUIRE(jsonResult["success"] == true);
             REQUIRE(jsonResult["result"] == "");
         }
+
+        SECTION("Word and character counts")
+        {
+            std::string request = R"({"type": "text", "operation": "word_count", "text": "  one\ttwo\u00a0three\u3000four  "})";
+            auto jsonResult = json::parse(processor.processJson(request));
+            REQUIRE(jsonResult["success"] == true);
+            REQUIRE(jsonResult["result"] == 4);
+
+            request = R"({"type": "text", "operation": "char_count", "text": "na\u00efve \ud83d\ude00"})";
+            jsonResult = json::parse(processor.processJson(request));
+            REQUIRE(jsonResult["result"] == 7);
+        }
+
+        SECTION("Reverse keeps combining characters and emoji sequences together")
+        {
+            std::string request = R"({"type": "text", "operation": "reverse", "text": "e\u0301a\ud83d\udc4d\ud83c\udffd"})";
+            auto jsonResult = json::parse(processor.processJson(request));
+            REQUIRE(jsonResult["success"] == true);
+            REQUIRE(jsonResult["result"] == "\U0001F44D\U0001F3FDae\u0301");
+
+            // processor.py reverses the same way when it serves the request
+            auto response = processor.process(R"({"type": "text", "operation": "reverse", "text": "e\u0301a\ud83d\udc4d\ud83c\udffd\u1100\u1161", "extra": NaN})");
+            REQUIRE(response);
+            REQUIRE_FALSE(response->native);
+            REQUIRE(json::parse(response->body)["result"] == "\u1100\u1161\U0001F44D\U0001F3FDae\u0301");
+
+            // Lone surrogates are clusters of their own
+            request = R"({"type": "text", "operation": "reverse", "text": "e\u0301\ud800a\u0301"})";
+            REQUIRE(processor.processJson(request) == R"({"success": true, "result": "a\u0301\ud800e\u0301", )"
+                                                      R"("operation": "reverse", "input_text": "e\u0301\ud800a\u0301", "timestamp": "2025-06-14T00:00:00"})");
+        }
+
+        SECTION("Non-ASCII case mapping matches Python")
+        {
+            std::string request = R"({"type": "text", "operation": "uppercase", "text": "stra\u00dfe \u00e9t\u00e9"})";
+            auto jsonResult = json::parse(processor.processJson(request));
+            REQUIRE(jsonResult["success"] == true);
+            REQUIRE(jsonResult["result"] == "STRASSE \u00c9T\u00c9");
+        }
+
+        SECTION("Invalid text field")
+        {
+            std::string request = R"({"type": "text", "operation": "word_count", "text": 42})";
+            auto jsonResult = json::parse(processor.processJson(request));
+            REQUIRE(jsonResult["success"] == false);
+            REQUIRE(jsonResult["error"] == "Text field is required for text operations");
+        }
     }
     
     SECTION("Data operations")
@@ -176,6 +242,105 @@ TEST_CASE("Python Processor JSON Processing", "[python][processor][json]")
             REQUIRE(jsonResult["success"] == false);
             REQUIRE_THAT(jsonResult["error"].get<std::string>(), ContainsSubstring("empty"));
         }
+
+        SECTION("Extended statistics")
+        {
+            std::string request = R"({"type": "data", "operation": "extended_stats", "dataset": [2, 4, 4, 4, 5, 5, 7, 9, "x"]})";
+            std::string result = processor.processJson(request);
+
+            auto jsonResult = json::parse(result);
+            REQUIRE(jsonResult["success"] == true);
+            REQUIRE(jsonResult["operation"] == "extended_stats");
+
+            auto stats = jsonResult["result"];
+            REQUIRE(stats["count"] == 8);
+            REQUIRE(stats["sum"] == 40);
+            REQUIRE(stats["mean"] == 5.0);
+            REQUIRE(stats["variance"] == 4.0);
+            REQUIRE(stats["stddev"] == 2.0);
+            REQUIRE(stats["p50"] == 4);
+            REQUIRE(stats["approximate"] == false);
+        }
+
+        SECTION("Quantiles and histogram")
+        {
+            std::string request = R"({"type": "data", "operation": "quantiles", "dataset": [1, 2, 3, 4, 5], "quantiles": [0, 0.5, 1]})";
+            auto jsonResult = json::parse(processor.processJson(request));
+            REQUIRE(jsonResult["success"] == true);
+            REQUIRE(jsonResult["result"]["quantiles"]["p0"] == 1);
+            REQUIRE(jsonResult["result"]["quantiles"]["p50"] == 3);
+            REQUIRE(jsonResult["result"]["quantiles"]["p100"] == 5);
+
+            request = R"({"type": "data", "operation": "quantiles", "dataset": [1, 2, 3], "quantiles": [0.07, 0.999, 0.123456]})";
+            jsonResult = json::parse(processor.processJson(request));
+            REQUIRE(jsonResult["result"]["quantiles"].contains("p7"));
+            REQUIRE(jsonResult["result"]["quantiles"].contains("p99.9"));
+            REQUIRE(jsonResult["result"]["quantiles"].contains("p12.3456"));
+
+            request = R"({"type": "data", "operation": "histogram", "dataset": [1, 2, 3, 4, 5, 20], "bins": 2, "range": [0, 10]})";
+            jsonResult = json::parse(processor.processJson(request));
+            REQUIRE(jsonResult["success"] == true);
+            REQUIRE(jsonResult["result"]["counts"] == json::array({4, 1}));
+            REQUIRE(jsonResult["result"]["overflow"] == 1);
+        }
+
+        SECTION("Rolling windows and smoothing")
+        {
+            std::string dataset = R"("dataset": [4, 2, "skip", 6, 8, 1, 5])";
+            auto run = [&](const std::string& options) {
+                return json::parse(processor.processJson(R"({"type": "data", )" + options + ", " + dataset + "}"));
+            };
+
+            auto average = run(R"("operation": "moving_average", "window": 3)");
+            REQUIRE(average["success"] == true);
+            REQUIRE(average["operation"] == "moving_average");
+            REQUIRE(average["result"]["window"] == 3);
+            REQUIRE(average["result"]["values"] == json::parse("[4.0, 5.333333333333333, 5.0, 4.666666666666667]"));
+
+            REQUIRE(run(R"("operation": "rolling_min", "window": 2)")["result"]["values"] == json::parse("[2, 2, 6, 1, 1]"));
+            REQUIRE(run(R"("operation": "rolling_max", "window": 4)")["result"]["values"] == json::parse("[8, 8, 8]"));
+            REQUIRE(run(R"("operation": "rolling_variance", "window": 2)")["result"]["values"] == json::parse("[1.0, 4.0, 1.0, 12.25, 4.0]"));
+            REQUIRE(run(R"("operation": "rolling_variance", "window": 2, "sample": true)")["result"]["values"][0] == 2.0);
+            REQUIRE(run(R"("operation": "exponential_smoothing", "alpha": 0.5)")["result"]["values"] == json::parse("[4.0, 3.0, 4.5, 6.25, 3.625, 4.3125]"));
+
+            // Windows longer than the data have no full window
+            REQUIRE(run(R"("operation": "moving_average", "window": 10)")["result"]["values"].empty());
+            auto invalid = run(R"("operation": "rolling_min", "window": 0)");
+            REQUIRE(invalid["error"] == "Data operation failed: window must be an integer between 1 and 16777216");
+            invalid = run(R"("operation": "exponential_smoothing", "alpha": 0)");
+            REQUIRE(invalid["error"] == "Data operation failed: alpha must be a number in (0, 1]");
+        }
+
+        SECTION("Floats are formatted like json.dumps")
+        {
+            std::string result = processor.processJson(R"({"type": "data", "operation": "exponential_smoothing", "alpha": 1, )"
+                R"("dataset": [-0.0, 1e15, 1e16, 1e-05, 0.0001, 0.1, 1e22, 123456789.125, 1.5e300, 5e-324, 2.5e-7]})");
+            REQUIRE(result.find(R"("values": [-0.0, 1000000000000000.0, 1e+16, 1e-05, 0.0001, 0.1, 1e+22, 123456789.125, )"
+                R"(1.5e+300, 5e-324, 2.5e-07])") != std::string::npos);
+        }
+
+        SECTION("Native-only operations reject what only Python can parse")
+        {
+            for (std::string request : {std::string(R"({"type": "data", "operation": "quantiles", "dataset": [1, NaN]})"),
+                                        std::string(R"({"type": "matrix", "operation": "transpose", "matrix": [[Infinity]]})"),
+                                        std::string(R"({"type": "pipeline", "stages": ["sort"], "dataset": [NaN]})")}) {
+                INFO(request);
+                auto jsonResult = json::parse(processor.processJson(request));
+                REQUIRE(jsonResult["success"] == false);
+                REQUIRE_THAT(jsonResult["error"].get<std::string>(), ContainsSubstring("requires standard JSON"));
+            }
+        }
+
+        SECTION("Extended statistics reject unusable datasets like stats")
+        {
+            auto jsonResult = json::parse(processor.processJson(R"({"type": "data", "operation": "extended_stats", "dataset": []})"));
+            REQUIRE(jsonResult["success"] == false);
+            REQUIRE(jsonResult["error"] == "Data operation failed: Dataset cannot be empty");
+
+            jsonResult = json::parse(processor.processJson(R"({"type": "data", "operation": "quantiles", "dataset": "nope"})"));
+            REQUIRE(jsonResult["success"] == false);
+            REQUIRE(jsonResult["error"] == "Dataset array is required for data operations");
+        }
     }
     
     SECTION("Echo operations")
@@ -266,6 +431,76 @@ TEST_CASE("Python Processor JSON Processing", "[python][processor][json]")
     }
 }
 
+TEST_CASE("Python Processor Aggregation Sessions", "[python][processor][session]")
+{
+    PythonProcessor processor;
+    REQUIRE(processor.isInitialized());
+
+    auto call = [&](const json& request) {
+        return json::parse(processor.processJson(request.dump()));
+    };
+
+    SECTION("Chunks are aggregated until the session is finalized")
+    {
+        auto opened = call({{"type", "data"}, {"operation", "session_open"}, {"track", {"stats", "unique", "sort"}}});
+        REQUIRE(opened["success"] == true);
+        std::string id = opened["result"]["session_id"];
+
+        auto appended = call({{"type", "data"}, {"operation", "session_append"}, {"session_id", id}, {"dataset", {5, 3, 5}}});
+        REQUIRE(appended["success"] == true);
+        REQUIRE(appended["result"]["count"] == 3);
+        appended = call({{"type", "data"}, {"operation", "session_append"}, {"session_id", id}, {"dataset", {1, 3}}});
+        REQUIRE(appended["result"]["count"] == 5);
+
+        auto finalized = call({{"type", "data"}, {"operation", "session_finalize"}, {"session_id", id}});
+        REQUIRE(finalized["success"] == true);
+        auto result = finalized["result"];
+        REQUIRE(result["stats"]["count"] == 5);
+        REQUIRE(result["stats"]["sum"] == 17);
+        REQUIRE(result["stats"]["min"] == 1);
+        REQUIRE(result["stats"]["max"] == 5);
+        REQUIRE(result["unique"] == json::array({1, 3, 5}));
+        REQUIRE(result["sort"] == json::array({1, 3, 3, 5, 5}));
+
+        // Finalizing closes the session
+        auto again = call({{"type", "data"}, {"operation", "session_finalize"}, {"session_id", id}});
+        REQUIRE(again["success"] == false);
+        REQUIRE_THAT(again["error"].get<std::string>(), ContainsSubstring("Unknown session"));
+    }
+
+    SECTION("Invalid chunks are rejected without changing the session")
+    {
+        auto opened = call({{"type", "data"}, {"operation", "session_open"}, {"track", {"sort"}}, {"dataset", {2, 1}}});
+        std::string id = opened["result"]["session_id"];
+
+        auto rejected = call({{"type", "data"}, {"operation", "session_append"}, {"session_id", id}, {"dataset", {3, nullptr}}});
+        REQUIRE(rejected["success"] == false);
+
+        auto finalized = call({{"type", "data"}, {"operation", "session_finalize"}, {"session_id", id}});
+        REQUIRE(finalized["result"]["sort"] == json::array({1, 2}));
+    }
+
+    SECTION("Sessions that cannot be finalized stay open")
+    {
+        auto opened = call({{"type", "data"}, {"operation", "session_open"}, {"dataset", {"a"}}});
+        std::string id = opened["result"]["session_id"];
+        auto finalized = call({{"type", "data"}, {"operation", "session_finalize"}, {"session_id", id}});
+        REQUIRE(finalized["error"] == "Data operation failed: Dataset must contain numeric values");
+
+        call({{"type", "data"}, {"operation", "session_append"}, {"session_id", id}, {"dataset", {4}}});
+        finalized = call({{"type", "data"}, {"operation", "session_finalize"}, {"session_id", id}});
+        REQUIRE(finalized["success"] == true);
+        REQUIRE(finalized["result"]["count"] == 2);
+
+        opened = call({{"type", "data"}, {"operation", "session_open"}, {"track", {"sort"}}, {"dataset", {1, "b"}}});
+        id = opened["result"]["session_id"];
+        for (int i = 0; i < 2; ++i) {
+            finalized = call({{"type", "data"}, {"operation", "session_finalize"}, {"session_id", id}});
+            REQUIRE_THAT(finalized["error"].get<std::string>(), ContainsSubstring("not supported between"));
+        }
+    }
+}
+
 TEST_CASE("Python Processor Performance", "[python][processor][performance]")
 {
     PythonProcessor processor;
@@ -306,4 +541,1259 @@ TEST_CASE("Python Processor Thread Safety", "[python][processor][threading]")
             REQUIRE(jsonResult["success"] == true);
         }
     }
+
+    SECTION("Concurrent callers share one processor")
+    {
+        std::vector<std::string> requests = {
+            R"({"type": "math", "operation": "add", "numbers": [1, 2]})",
+            R"({"type": "text", "operation": "word_count", "text": "one two three"})",
+            R"({"type": "data", "operation": "extended_stats", "dataset": [1, 2, 3, 4]})",
+            R"({"type": "math", "operation": "divide", "numbers": [1, 0]})"
+        };
+        std::vector<std::string> expected;
+        for (const auto& request : requests) {
+            expected.push_back(processor.process(request).value().body);
+        }
+
+        // Catch2 assertions are not thread-safe, so workers only count mismatches
+        std::atomic<int> mismatches{0};
+        std::vector<std::thread> workers;
+        for (int t = 0; t < 8; ++t) {
+            workers.emplace_back([&, t] {
+                for (std::size_t i = 0; i < 50; ++i) {
+                    std::size_t index = (i + static_cast<std::size_t>(t)) % requests.size();
+                    auto result = processor.process(requests[index]);
+                    if (!result || result->body != expected[index]) {
+                        ++mismatches;
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        REQUIRE(mismatches == 0);
+    }
+
+    SECTION("Failures come back as structured errors")
+    {
+        // Not valid UTF-8, so it cannot even be turned into a Python str
+        auto result = processor.process("{\"type\": \"echo\", \"message\": \"\xff\"}");
+        REQUIRE_FALSE(result.has_value());
+        REQUIRE(result.error().code == ProcessErrorCode::PythonException);
+        REQUIRE_FALSE(result.error().message.empty());
+
+        auto legacy = json::parse(processor.processJson("{\"type\": \"echo\", \"message\": \"\xff\"}"));
+        REQUIRE(legacy["success"] == false);
+        REQUIRE_THAT(legacy["error"].get<std::string>(), ContainsSubstring("Python execution error: "));
+
+        // Requests processor.py would reject are still responses, answered natively
+        auto rejected = processor.process(R"({"type": "nope"})");
+        REQUIRE(rejected.has_value());
+        REQUIRE(rejected->native);
+        REQUIRE_THAT(rejected->body, ContainsSubstring("Unknown request type"));
+
+        auto native = processor.process(R"({"type": "text", "operation": "char_count", "text": "abc"})");
+        REQUIRE(native.has_value());
+        REQUIRE(native->native);
+    }
+}
+
+TEST_CASE("Python Processor Memory Accounting", "[python][processor][memory]")
+{
+    PythonProcessor processor;
+    REQUIRE(processor.isInitialized());
+
+    SECTION("Accounting is disabled by default")
+    {
+        REQUIRE_FALSE(processor.isMemoryAccountingEnabled());
+        processor.processJson(R"({"type": "echo", "message": "test"})");
+        REQUIRE(processor.getMemoryStats().empty());
+        REQUIRE(processor.getMemoryHighWaterMark() == 0);
+    }
+
+    SECTION("Requests are accounted per type")
+    {
+        processor.setMemoryAccountingEnabled(true);
+        REQUIRE(processor.isMemoryAccountingEnabled());
+
+        std::string request = R"({"type": "data", "operation": "sort", "dataset": [5, 3, 9, 1, 7, 2, 8]})";
+        for (int i = 0; i < 3; ++i) {
+            auto jsonResult = json::parse(processor.processJson(request));
+            REQUIRE(jsonResult["success"] == true);
+        }
+        processor.processJson(R"({"type": "echo", "message": "test"})");
+
+        auto stats = processor.getMemoryStats();
+        REQUIRE(stats.size() == 2);
+        REQUIRE(stats["data"].requests == 3);
+        REQUIRE(stats["data"].pythonPeakBytes > 0);
+        REQUIRE(stats["data"].rawPeakBytes > 0);
+        REQUIRE(stats["data"].cppPeakBytes > 0);
+        REQUIRE(stats["echo"].requests == 1);
+        REQUIRE(processor.getMemoryHighWaterMark() >= stats["data"].pythonPeakBytes);
+
+        processor.resetMemoryStats();
+        REQUIRE(processor.getMemoryStats().empty());
+        REQUIRE(processor.getMemoryHighWaterMark() == 0);
+
+        processor.setMemoryAccountingEnabled(false);
+        REQUIRE_FALSE(processor.isMemoryAccountingEnabled());
+    }
+
+    SECTION("Native requests count their C++ buffers")
+    {
+        processor.setMemoryAccountingEnabled(true);
+        std::string request = R"({"type": "data", "operation": "quantiles", "dataset": [1, 2, 3, 4, 5, 6, 7, 8]})";
+        std::string response = processor.processJson(request);
+        REQUIRE_THAT(response, ContainsSubstring("\"success\": true"));
+
+        auto stats = processor.getMemoryStats();
+        REQUIRE(stats["data"].pythonPeakBytes == 0);
+        REQUIRE(stats["data"].cppPeakBytes > response.size());
+        REQUIRE(processor.getMemoryHighWaterMark() == stats["data"].cppPeakBytes);
+        processor.setMemoryAccountingEnabled(false);
+    }
+
+    SECTION("tracemalloc runs while any processor accounts")
+    {
+        PythonProcessor other;
+        REQUIRE(other.isInitialized());
+        processor.setMemoryAccountingEnabled(true);
+        other.setMemoryAccountingEnabled(true);
+        other.setMemoryAccountingEnabled(false);
+
+        processor.processJson(R"({"type": "data", "operation": "sort", "dataset": [5, 3, 9, 1]})");
+        auto stats = processor.getMemoryStats();
+        REQUIRE(stats["data"].pythonPeakBytes > 0);
+        // Python peaks include the raw allocations, which are not added again
+        REQUIRE(processor.getMemoryHighWaterMark() == stats["data"].pythonPeakBytes + stats["data"].cppPeakBytes);
+        processor.setMemoryAccountingEnabled(false);
+    }
+}
+
+TEST_CASE("Python Processor Trace Recording", "[python][processor][trace]")
+{
+    PythonProcessor processor;
+    REQUIRE(processor.isInitialized());
+
+    const std::string tracePath = "test-requests.trace.jsonl";
+    std::vector<std::string> requests = {
+        R"({"type": "math", "operation": "add", "numbers": [1, 2]})",
+        R"({"type": "text", "operation": "uppercase", "text": "quoted \"text\""})"
+    };
+
+    REQUIRE(processor.startTraceRecording(tracePath));
+    REQUIRE(processor.isTraceRecording());
+    for (const auto& request : requests) {
+        processor.processJson(request);
+    }
+    processor.stopTraceRecording();
+    REQUIRE_FALSE(processor.isTraceRecording());
+
+    // Requests after stopping are not recorded
+    processor.processJson(R"({"type": "echo", "message": "not recorded"})");
+
+    auto trace = loadRequestTrace(tracePath);
+    REQUIRE(trace.size() == requests.size());
+    REQUIRE(trace[0].request == requests[0]);
+    REQUIRE(trace[1].request == requests[1]);
+    REQUIRE(trace[0].offset <= trace[1].offset);
+
+    SECTION("Invalid UTF-8 does not fail the request")
+    {
+        REQUIRE(processor.startTraceRecording(tracePath));
+        std::string result;
+        REQUIRE_NOTHROW(result = processor.processJson("{\"type\": \"echo\", \"message\": \"\xff\"}"));
+        REQUIRE_FALSE(result.empty());
+        processor.stopTraceRecording();
+
+        auto invalidTrace = loadRequestTrace(tracePath);
+        REQUIRE(invalidTrace.size() == 1);
+        REQUIRE(invalidTrace[0].request == "{\"type\": \"echo\", \"message\": \"\xef\xbf\xbd\"}");
+    }
+
+    std::remove(tracePath.c_str());
+}
+
+TEST_CASE("Python Processor Span Tracing", "[python][processor][trace]")
+{
+    PythonProcessor processor;
+    REQUIRE(processor.isInitialized());
+
+    const std::string tracePath = "test-spans.trace.json";
+    REQUIRE(processor.startSpanTracing(tracePath));
+    REQUIRE(processor.isSpanTracing());
+    processor.processJson(R"({"type": "text", "operation": "capitalize", "text": "hello"})");
+    processor.processJson(R"({"type": "data", "operation": "quantiles", "dataset": [1, 2, 3]})");
+    processor.processJson(R"({"type": "nope"})");
+    processor.stopSpanTracing();
+    REQUIRE_FALSE(processor.isSpanTracing());
+    processor.processJson(R"({"type": "echo", "message": "not traced"})");
+
+    std::ifstream in(tracePath);
+    json events = json::parse(in);
+    REQUIRE(events.is_array());
+
+    std::map<std::uint64_t, std::map<std::string, json>> byRequest;
+    for (const auto& event : events) {
+        REQUIRE(event["ph"] == "X");
+        REQUIRE(event["dur"].get<double>() >= 0);
+        byRequest[event["args"]["request_id"].get<std::uint64_t>()][event["name"].get<std::string>()] = event;
+    }
+    REQUIRE(byRequest.size() == 3);
+
+    // Python request: every stage, with processor.py's inside the call
+    const auto& python = byRequest.begin()->second;
+    for (const char* stage : {"request", "validate", "gil_wait", "python_call", "json.loads", "handler", "json.dumps", "extract"}) {
+        INFO(stage);
+        REQUIRE(python.contains(stage));
+    }
+    REQUIRE(python.at("json.loads")["cat"] == "python");
+    double callStart = python.at("python_call")["ts"].get<double>();
+    double callEnd = callStart + python.at("python_call")["dur"].get<double>();
+    for (const char* stage : {"json.loads", "handler", "json.dumps"}) {
+        INFO(stage);
+        // Allow for the skew of mapping Python's clock onto the steady clock
+        REQUIRE(python.at(stage)["ts"].get<double>() >= callStart - 50);
+        REQUIRE(python.at(stage)["ts"].get<double>() + python.at(stage)["dur"].get<double>() <= callEnd + 50);
+    }
+
+    // Native request and schema rejection never reach Python
+    const auto& native = std::next(byRequest.begin())->second;
+    REQUIRE(native.contains("native_handler"));
+    REQUIRE_FALSE(native.contains("gil_wait"));
+    const auto& rejected = std::prev(byRequest.end())->second;
+    REQUIRE(rejected.contains("validate"));
+    REQUIRE_FALSE(rejected.contains("python_call"));
+
+    in.close();
+    std::remove(tracePath.c_str());
+
+    // A request running while a stream is paused in its sink keeps to its own spans
+    REQUIRE(processor.startSpanTracing(tracePath));
+    std::promise<void> streamPaused;
+    std::promise<void> requestDone;
+    std::jthread other([&] {
+        streamPaused.get_future().wait();
+        processor.processJson(R"({"type": "text", "operation": "capitalize", "text": "other"})");
+        requestDone.set_value();
+    });
+    bool waited = false;
+    auto streamed = processor.processStream(R"({"type": "text", "operation": "capitalize", "text": "streamed"})",
+        [&](std::string_view) {
+            if (!waited) {
+                waited = true;
+                streamPaused.set_value();
+                requestDone.get_future().wait();
+            }
+            return true;
+        }, 8);
+    other.join();
+    processor.stopSpanTracing();
+    REQUIRE(streamed);
+
+    in.open(tracePath);
+    events = json::parse(in);
+    std::map<std::uint64_t, std::map<std::string, int>> stages;
+    for (const auto& event : events) {
+        ++stages[event["args"]["request_id"].get<std::uint64_t>()][event["name"].get<std::string>()];
+    }
+    REQUIRE(stages.size() == 2);
+    for (const auto& [id, counts] : stages) {
+        INFO(id);
+        REQUIRE(counts.contains("request"));
+        REQUIRE(counts.at("json.loads") == 1);
+        REQUIRE(counts.at("handler") == 1);
+    }
+    in.close();
+    std::remove(tracePath.c_str());
+}
+
+TEST_CASE("Python Processor Startup Options", "[python][processor][startup]")
+{
+    SECTION("Fast startup processes requests")
+    {
+        PythonProcessor processor(StartupOptions::fast());
+        REQUIRE(processor.isInitialized());
+
+        auto timing = processor.getStartupTiming();
+        REQUIRE(timing.total > std::chrono::microseconds(0));
+        REQUIRE(timing.total >= timing.handlers + timing.interpreter + timing.paths + timing.import);
+
+        auto jsonResult = json::parse(processor.processJson(R"({"type": "math", "operation": "add", "numbers": [1, 2]})"));
+        REQUIRE(jsonResult["success"] == true);
+        REQUIRE(jsonResult["result"] == 3);
+    }
+
+    SECTION("Path cache keeps one entry per working directory")
+    {
+        const std::string cachePath = "test-python-paths.cache";
+        std::remove(cachePath.c_str());
+        PythonPathCache cache(cachePath);
+
+        REQUIRE_FALSE(cache.find("/project/a").has_value());
+        cache.store("/project/a", {"/project/a/python", "/project/a/.venv/site-packages"});
+        cache.store("/project/b", {"./python", "."});
+        cache.store("/project/a", {"/project/a/python"});
+
+        REQUIRE(cache.find("/project/a") == std::vector<std::string>{"/project/a/python"});
+        REQUIRE(cache.find("/project/b") == std::vector<std::string>{"./python", "."});
+        REQUIRE_FALSE(cache.find("/project/c").has_value());
+
+        std::remove(cachePath.c_str());
+    }
+}
+
+TEST_CASE("Python Processor Result Cache", "[python][processor][cache]")
+{
+    const std::string cachePath = "test-result-cache.bin";
+    std::remove(cachePath.c_str());
+    StartupOptions options;
+    options.resultCachePath = cachePath;
+
+    const std::string request = R"({"type": "math", "operation": "power", "numbers": [2, 10]})";
+    const std::string compact = R"({"type":"math","operation":"power","numbers":[2,10]})";
+    auto run = [](PythonProcessor& processor, const std::string& input) {
+        auto response = processor.process(input);
+        REQUIRE(response);
+        return *response;
+    };
+
+    std::string body;
+    {
+        PythonProcessor processor(options);
+        REQUIRE(processor.isInitialized());
+        Response first = run(processor, request);
+        REQUIRE_FALSE(first.native);
+        body = first.body;
+        Response repeated = run(processor, compact);
+        REQUIRE(repeated.native);
+        REQUIRE(repeated.body == body);
+
+        // Echoed members keep the order of the request they came from
+        run(processor, R"({"type": "data", "operation": "filter_numbers", "dataset": [{"b": 1, "a": 2}, 3]})");
+        Response swapped = run(processor, R"({"type": "data", "operation": "filter_numbers", "dataset": [{"a": 2, "b": 1}, 3]})");
+        REQUIRE_THAT(swapped.body, ContainsSubstring(R"("input_dataset": [{"a": 2, "b": 1}, 3])"));
+
+        // Failures, sessions and other types go to Python or native handlers every time
+        REQUIRE_FALSE(run(processor, R"({"type": "math", "operation": "sqrt", "numbers": [-1]})").native);
+        REQUIRE_FALSE(run(processor, R"({"type": "math", "operation": "sqrt", "numbers": [-1]})").native);
+        REQUIRE_FALSE(run(processor, R"({"type": "text", "operation": "capitalize", "text": "a"})").native);
+        REQUIRE_FALSE(run(processor, R"({"type": "text", "operation": "capitalize", "text": "a"})").native);
+    }
+
+    // A restarted processor answers from disk straight away
+    {
+        PythonProcessor processor(options);
+        REQUIRE(processor.isInitialized());
+        Response restarted = run(processor, request);
+        REQUIRE(restarted.native);
+        REQUIRE(restarted.body == body);
+        REQUIRE(processor.processJson(request) == body);
+    }
+
+    // Without the option nothing is cached
+    PythonProcessor uncached;
+    REQUIRE_FALSE(run(uncached, request).native);
+    REQUIRE_FALSE(run(uncached, request).native);
+    std::remove(cachePath.c_str());
+}
+
+TEST_CASE("Python Processor Performance Sampling", "[python][processor][performance]")
+{
+    SECTION("Latency buckets keep values within 12.5%")
+    {
+        for (std::uint64_t micros : {0ULL, 7ULL, 15ULL, 16ULL, 100ULL, 1234ULL, 99999ULL, 5000000ULL}) {
+            double value = PerformanceCounters::bucketValue(PerformanceCounters::bucketFor(micros));
+            REQUIRE(std::abs(value - static_cast<double>(micros)) <= static_cast<double>(micros) * 0.125 + 0.5);
+        }
+    }
+
+    SECTION("Intervals report rates and percentiles")
+    {
+        PerformanceCounters counters;
+        PerformanceSample before = counters.sample();
+        for (int i = 1; i <= 100; ++i) {
+            counters.recordRequest(std::chrono::milliseconds(i), i > 95);
+        }
+        counters.recordGilWait(std::chrono::milliseconds(5));
+        PerformanceSample after = counters.sample();
+        after.time = before.time + std::chrono::seconds(2);
+
+        PerformanceInterval interval = performanceBetween(before, after);
+        REQUIRE(interval.requestsPerSecond == 50.0);
+        REQUIRE(interval.errorsPerSecond == 2.5);
+        REQUIRE(std::abs(interval.p50Ms - 50.0) <= 50.0 * 0.125);
+        REQUIRE(std::abs(interval.p99Ms - 99.0) <= 99.0 * 0.125);
+        REQUIRE(interval.gilWaitFraction == 0.0025);
+    }
+
+    SECTION("The processor counts every request")
+    {
+        PythonProcessor processor;
+        REQUIRE(processor.isInitialized());
+
+        PerformanceSample before = processor.samplePerformance();
+        processor.processJson(R"({"type": "math", "operation": "add", "numbers": [1, 2]})");
+        processor.processJson(R"({"type": "text", "operation": "char_count", "text": "abc"})");
+        processor.processJson(R"({"type": "unknown"})");
+        PerformanceSample after = processor.samplePerformance();
+
+        REQUIRE(after.requests - before.requests == 3);
+        REQUIRE(after.errors - before.errors == 1);
+        REQUIRE(after.gilWait >= before.gilWait);
+        REQUIRE(after.pythonHeapBlocks > 0);
+    }
+}
+
+TEST_CASE("Python Processor Batch Runs", "[python][processor][batch]")
+{
+    namespace fs = std::filesystem;
+    PythonProcessor processor;
+    REQUIRE(processor.isInitialized());
+
+    fs::path directory = fs::temp_directory_path() / "cppideas_batch_test";
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+    auto write = [&](const std::string& name, const std::string& content) {
+        std::ofstream(directory / name, std::ios::binary) << content;
+    };
+    for (int i = 0; i < 40; ++i) {
+        write(fmt::format("math_{:02}.json", i),
+            fmt::format(R"({{"type": "math", "operation": "add", "numbers": [{}, 1]}})", i));
+    }
+    write("text.json", R"({"type": "text", "operation": "uppercase", "text": "batch"})");
+    write("broken.json", R"({"type": "math", "numbers": [1, 2})");
+    write("array.json", "[1, 2]");
+    write("unknown.json", R"({"type": "unknown"})");
+    // Python's response holds a NaN the strict parser rejects
+    write("nan.json", R"({"type": "echo", "value": NaN})");
+    write("notes.txt", "not a request");
+    write("old.result.json", "{}");
+
+    std::vector<fs::path> inputs = findBatchInputs(directory);
+    REQUIRE(inputs.size() == 45);
+    REQUIRE(std::is_sorted(inputs.begin(), inputs.end()));
+    REQUIRE(batchOutputPath(directory / "a.json") == directory / "a.result.json");
+
+    SECTION("Results are written next to the inputs")
+    {
+        std::mutex mutex;
+        std::vector<std::size_t> completed;
+        BatchSummary summary = runBatch(processor, inputs, {.workers = 4}, [&](const BatchProgress& progress) {
+            std::lock_guard lock(mutex);
+            completed.push_back(progress.completed);
+        });
+
+        REQUIRE_FALSE(summary.cancelled);
+        REQUIRE(summary.progress.completed == 45);
+        REQUIRE(summary.progress.failed == 3);
+        REQUIRE(summary.progress.inputBytes > 0);
+        REQUIRE(summary.progress.filesPerSecond() > 0);
+        REQUIRE(summary.failures.size() == 3);
+        REQUIRE(completed.size() == 45);
+        REQUIRE(std::is_sorted(completed.begin(), completed.end()));
+
+        for (const auto& input : inputs) {
+            std::string name = input.filename().string();
+            if (name == "nan.json") {
+                continue;
+            }
+            std::ifstream in(batchOutputPath(input));
+            json result = json::parse(in);
+            REQUIRE(result["success"] == !(name == "broken.json" || name == "array.json" || name == "unknown.json"));
+        }
+        std::ifstream math(directory / "math_07.result.json");
+        REQUIRE(json::parse(math)["result"] == 8);
+
+        for (const auto& failure : summary.failures) {
+            if (failure.input.filename() == "broken.json") {
+                REQUIRE_THAT(failure.error, ContainsSubstring("line 1, column"));
+            } else if (failure.input.filename() == "array.json") {
+                REQUIRE(failure.error == "Request must be a JSON object");
+            } else {
+                REQUIRE(failure.error == "Unknown request type: unknown");
+            }
+        }
+    }
+
+    SECTION("Stopping skips the remaining files")
+    {
+        std::stop_source stop;
+        BatchSummary summary = runBatch(processor, inputs, {.workers = 2},
+            [&](const BatchProgress&) { stop.request_stop(); }, stop.get_token());
+        REQUIRE(summary.cancelled);
+        REQUIRE(summary.progress.completed <= 2);
+    }
+
+    fs::remove_all(directory);
+}
+
+TEST_CASE("Python Processor Plugins", "[python][processor][plugins]")
+{
+    SECTION("Handlers from the plugin directory run before Python")
+    {
+        setenv("CPPIDEAS_PLUGIN_DIR", SAMPLE_PLUGIN_DIR, 1);
+        PythonProcessor processor;
+        unsetenv("CPPIDEAS_PLUGIN_DIR");
+        REQUIRE(processor.isInitialized());
+        REQUIRE(processor.getLoadedPlugins() == std::vector<std::string>{"sample_plugin.so"});
+
+        std::string request = R"({"type": "plugin", "operation": "byte_count"})";
+        auto counted = processor.process(request);
+        REQUIRE(counted);
+        REQUIRE(counted->native);
+        REQUIRE(json::parse(counted->body)["result"] == request.size());
+
+        auto failed = processor.process(R"({"type": "plugin", "operation": "fail"})");
+        REQUIRE_FALSE(failed);
+        REQUIRE(failed.error().code == ProcessErrorCode::NativeHandlerFailed);
+        REQUIRE(failed.error().message == "sample failure");
+
+        // The plugin defers math/add, so processor.py still answers
+        auto added = processor.process(R"({"type": "math", "operation": "add", "numbers": [1, 2]})");
+        REQUIRE(added);
+        REQUIRE_FALSE(added->native);
+        REQUIRE(json::parse(added->body)["result"] == 3);
+
+        // Malformed documents never reach plugins
+        auto malformed = processor.process(R"({"type": "plugin", "operation": "byte_count", })");
+        REQUIRE(malformed);
+        REQUIRE_THAT(malformed->body, ContainsSubstring("Invalid JSON"));
+    }
+
+    SECTION("Without a plugin directory nothing is loaded")
+    {
+        PythonProcessor processor;
+        REQUIRE(processor.getLoadedPlugins().empty());
+    }
+
+    SECTION("Libraries that are not plugins are refused")
+    {
+        PluginRegistry registry;
+        auto missing = registry.load("/nonexistent/plugin.so");
+        REQUIRE_FALSE(missing);
+
+        // Registering the sample's pairs a second time fails its init
+        REQUIRE(registry.load(std::filesystem::path(SAMPLE_PLUGIN_DIR) / "sample_plugin.so"));
+        auto again = registry.load(std::filesystem::path(SAMPLE_PLUGIN_DIR) / "sample_plugin.so");
+        REQUIRE_FALSE(again);
+        REQUIRE_THAT(again.error(), ContainsSubstring("cppideas_plugin_init returned"));
+        REQUIRE(registry.loaded().size() == 1);
+        REQUIRE(registry.handles("plugin", "byte_count"));
+        REQUIRE_FALSE(registry.handles("plugin", "other"));
+    }
+}
+
+TEST_CASE("Python Processor Zero-Copy Responses", "[python][processor][view]")
+{
+    PythonProcessor processor;
+    REQUIRE(processor.isInitialized());
+
+    SECTION("Views match the copied responses")
+    {
+        for (std::string request : {R"({"type": "math", "operation": "add", "numbers": [1, 2, 3]})",
+                                    "{\"type\": \"text\", \"operation\": \"uppercase\", \"text\": \"h\u00e9llo\"}",
+                                    "{\"type\": \"echo\", \"message\": \"\u4e2d\u6587\"}",
+                                    R"({"type": "unknown"})"}) {
+            INFO(request);
+            auto copied = processor.process(request);
+            auto viewed = processor.processView(request);
+            REQUIRE(copied);
+            REQUIRE(viewed);
+            REQUIRE(viewed->body() == copied->body);
+            REQUIRE(viewed->isNative() == copied->native);
+        }
+    }
+
+    SECTION("Handles keep their body alive when moved and released on any thread")
+    {
+        std::vector<ResponseHandle> handles;
+        for (int i = 0; i < 50; ++i) {
+            auto viewed = processor.processView(R"({"type": "echo", "message": "kept"})");
+            REQUIRE(viewed);
+            handles.push_back(std::move(*viewed));
+        }
+        for (const auto& handle : handles) {
+            REQUIRE_THAT(std::string(handle.body()), ContainsSubstring("\"kept\""));
+        }
+        std::thread([moved = std::move(handles)]() mutable { moved.clear(); }).join();
+
+        ResponseHandle owned(std::string(R"({"success": true})"), true);
+        ResponseHandle moved = std::move(owned);
+        REQUIRE(moved.body() == R"({"success": true})");
+        REQUIRE(std::move(moved).toResponse().body == R"({"success": true})");
+    }
+
+    SECTION("Undecodable input is a Python error")
+    {
+        auto viewed = processor.processView("{\"type\": \"echo\", \"message\": \"\xff\"}");
+        REQUIRE_FALSE(viewed);
+        REQUIRE(viewed.error().code == ProcessErrorCode::PythonException);
+    }
+}
+
+TEST_CASE("Python Processor Streaming Responses", "[python][processor][stream]")
+{
+    PythonProcessor processor;
+    REQUIRE(processor.isInitialized());
+
+    auto collect = [&](const std::string& request, std::size_t chunkSize, std::vector<std::string>& chunks) {
+        return processor.processStream(request, [&](std::string_view chunk) {
+            chunks.emplace_back(chunk);
+            return true;
+        }, chunkSize);
+    };
+
+    SECTION("Chunks join to the whole response")
+    {
+        json dataset = json::array();
+        for (int i = 20000; i > 0; --i) {
+            dataset.push_back(i);
+        }
+        json nested = {{"type", "echo"}, {"payload", {{"values", dataset}, {"empty", json::array()}}}};
+        for (std::string request : {json{{"type", "data"}, {"operation", "sort"}, {"dataset", dataset}}.dump(),
+                                    nested.dump(),
+                                    std::string(R"({"type": "math", "operation": "add", "numbers": [1, 2.5]})"),
+                                    // NaN keeps these in processor.py, whose results are iterators
+                                    std::string(R"({"type": "data", "operation": "filter_numbers", "dataset": [1, "a", NaN, 2.5, true]})"),
+                                    std::string(R"({"type": "data", "operation": "unique", "dataset": [3, 1, 3, NaN]})"),
+                                    std::string(R"({"type": "unknown"})")}) {
+            INFO(request.substr(0, 60));
+            std::vector<std::string> chunks;
+            REQUIRE(collect(request, 4096, chunks));
+            std::string joined;
+            for (const auto& chunk : chunks) {
+                joined += chunk;
+            }
+            REQUIRE(joined == processor.processJson(request));
+            if (joined.size() > 3 * 4096) {
+                REQUIRE(chunks.size() > 2);
+            }
+        }
+    }
+
+    SECTION("Native responses are chunked too")
+    {
+        const std::string request = R"({"type": "data", "operation": "quantiles", "dataset": [1, 2, 3]})";
+        std::vector<std::string> chunks;
+        REQUIRE(collect(request, 8, chunks));
+        REQUIRE(chunks.size() > 1);
+        for (const auto& chunk : chunks) {
+            REQUIRE(chunk.size() <= 8);
+        }
+        std::string joined;
+        for (const auto& chunk : chunks) {
+            joined += chunk;
+        }
+        REQUIRE(joined == processor.processJson(request));
+    }
+
+    SECTION("The sink can stop the stream")
+    {
+        json dataset = json::array();
+        for (int i = 0; i < 50000; ++i) {
+            dataset.push_back(i);
+        }
+        std::string request = json{{"type", "echo"}, {"values", dataset}}.dump();
+        int calls = 0;
+        auto result = processor.processStream(request, [&](std::string_view) { return ++calls < 2; }, 1024);
+        REQUIRE(result);
+        REQUIRE(calls == 2);
+        REQUIRE_THAT(processor.processJson(R"({"type": "echo", "message": "after"})"), ContainsSubstring("\"after\""));
+    }
+
+    SECTION("Streams count as requests and run alongside other threads")
+    {
+        auto before = processor.samplePerformance();
+        std::vector<std::jthread> threads;
+        std::atomic<int> failures{0};
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&] {
+                for (int i = 0; i < 10; ++i) {
+                    std::string body;
+                    auto result = processor.processStream(R"({"type": "echo", "message": "streamed"})",
+                        [&](std::string_view chunk) { body += chunk; return true; }, 16);
+                    if (!result || !body.starts_with(R"({"success": true)")) {
+                        ++failures;
+                    }
+                }
+            });
+        }
+        threads.clear();
+        REQUIRE(failures == 0);
+        auto after = processor.samplePerformance();
+        REQUIRE(after.requests - before.requests == 40);
+        REQUIRE(after.errors == before.errors);
+    }
+
+    SECTION("Undecodable input is a Python error")
+    {
+        std::vector<std::string> chunks;
+        auto result = collect("{\"type\": \"echo\", \"message\": \"\xff\"}", 1024, chunks);
+        REQUIRE_FALSE(result);
+        REQUIRE(result.error().code == ProcessErrorCode::PythonException);
+        REQUIRE(chunks.empty());
+    }
+}
+
+TEST_CASE("Python Processor Request Validation", "[python][processor][schema]")
+{
+    PythonProcessor processor;
+    StartupOptions unvalidatedOptions;
+    unvalidatedOptions.validateRequests = false;
+    PythonProcessor unvalidated(unvalidatedOptions);
+    REQUIRE(processor.isInitialized());
+    REQUIRE(unvalidated.isInitialized());
+
+    SECTION("Rejections match processor.py byte for byte")
+    {
+        std::string deep = R"({"type": "math", "x": )" + std::string(50, '[') + std::string(50, ']') + "}";
+        for (std::string request : {std::string(""),
+                                    std::string("{\"type\": \"math\",\n  \"numbers\": [1 2]}"),
+                                    std::string("{\"type\": \"text\", \"text\": \"\u00e9\u00e9\u00e9\" x}"),
+                                    std::string("\xEF\xBB\xBF{\"type\": \"echo\"}"),
+                                    std::string("{\"a\": \"\\u12g4\"}"),
+                                    std::string("{} {}"),
+                                    std::string("[1, 2]"),
+                                    std::string("\"math\""),
+                                    std::string(R"({})"),
+                                    std::string(R"({"type": "nope"})"),
+                                    std::string("{\"type\": \"caf\\u00e9\"}"),
+                                    std::string(R"({"type": "math", "type": "nope"})"),
+                                    std::string(R"({"type": "math", "operation": "add"})"),
+                                    std::string(R"({"type": "math", "operation": "add", "numbers": [ ]})"),
+                                    std::string(R"({"type": "math", "operation": "add", "numbers": {"a": 1}})"),
+                                    std::string(R"({"type": "math", "operation": "cube", "numbers": [2]})"),
+                                    std::string(R"({"type": "math", "numbers": [2]})"),
+                                    std::string(R"({"type": "text", "operation": "capitalize", "text": null})"),
+                                    std::string(R"({"type": "text", "operation": "shout", "text": "hi"})"),
+                                    std::string(R"({"type": "data", "operation": "stats", "dataset": "1,2"})"),
+                                    std::string(R"({"type": "data", "operation": "median", "dataset": [1]})"),
+                                    std::string(R"({"\u0074ype": "data", "operation": "median"})"),
+                                    std::string(R"({"type": "matrix", "operation": "invert", "matrix": [[1]]})"),
+                                    deep}) {
+            INFO(request);
+            auto expected = unvalidated.process(request);
+            auto rejected = processor.process(request);
+            REQUIRE(expected);
+            REQUIRE(rejected);
+            REQUIRE_FALSE(expected->native);
+            REQUIRE(rejected->native);
+            REQUIRE(rejected->body == expected->body);
+        }
+    }
+
+    SECTION("Requests passing the checks still reach Python")
+    {
+        for (std::string request : {std::string(R"({"type": "math", "operation": "add", "numbers": [1, 2]})"),
+                                    std::string(R"({"type": "text", "operation": "capitalize"})"),
+                                    std::string(R"({"type": "data", "operation": "sort"})"),
+                                    std::string(R"({"type": "echo", "anything": [1, {"type": "nope"}]})"),
+                                    std::string(R"({"type": "math", "operation": "sqrt", "numbers": [1, 2]})"),
+                                    // Non-string types are formatted by Python
+                                    std::string(R"({"type": 5})"),
+                                    std::string(R"({"type": "text", "operation": ["uppercase"], "text": "a"})"),
+                                    // Lone surrogates only Python can represent
+                                    std::string(R"({"type": "\ud800"})"),
+                                    // Deep enough that json.loads may run out of recursion instead
+                                    std::string(R"({"type": "nope", "x": )") + std::string(5000, '[') + std::string(5000, ']') + "}"}) {
+            INFO(request.substr(0, 100));
+            auto expected = unvalidated.process(request);
+            auto result = processor.process(request);
+            REQUIRE(expected);
+            REQUIRE(result);
+            REQUIRE_FALSE(result->native);
+            REQUIRE(result->body == expected->body);
+        }
+
+        // Text that is not UTF-8 still fails to decode in Python
+        auto undecodable = processor.process("{\"type\": \"nope\", \"x\": \"\xff\"}");
+        REQUIRE_FALSE(undecodable);
+        REQUIRE(undecodable.error().code == ProcessErrorCode::PythonException);
+    }
+}
+
+TEST_CASE("Python Processor Pipelines", "[python][processor][pipeline]")
+{
+    PythonProcessor processor;
+    REQUIRE(processor.isInitialized());
+
+    auto run = [&](const std::string& request) {
+        auto response = processor.process(request);
+        REQUIRE(response);
+        REQUIRE(response->native);
+        return json::parse(response->body);
+    };
+
+    SECTION("Stages match the separate data operations")
+    {
+        std::string dataset = R"([5, "x", 1, 2.5, null, 7, 3, 2.5, -4])";
+        auto piped = run(R"({"type": "pipeline", "dataset": )" + dataset + R"(, "stages": ["filter_numbers", "sort", "stats"]})");
+        auto direct = json::parse(processor.processJson(R"({"type": "data", "operation": "stats", "dataset": )" + dataset + "}"));
+        REQUIRE(piped["success"] == true);
+        REQUIRE(piped["operation"] == "pipeline");
+        REQUIRE(piped["result"] == direct["result"]);
+
+        piped = run(R"({"type": "pipeline", "dataset": )" + dataset
+            + R"(, "stages": ["sort", {"operation": "quantiles", "quantiles": [0.5]}]})");
+        REQUIRE(piped["success"] == false);
+        REQUIRE(piped["error"] == "Pipeline stage 1 (sort) failed: '<' not supported between instances of 'str' and 'int'");
+
+        piped = run(R"({"type": "pipeline", "dataset": )" + dataset
+            + R"(, "stages": ["filter_numbers", {"operation": "quantiles", "quantiles": [0, 0.5, 1]}]})");
+        direct = run(R"({"type": "data", "operation": "quantiles", "quantiles": [0, 0.5, 1], "dataset": )" + dataset + "}");
+        REQUIRE(piped["result"] == direct["result"]);
+    }
+
+    SECTION("Adjacent stages are fused and timed")
+    {
+        auto piped = run(R"({"type": "pipeline", "dataset": [3, "a", 1, 2.0, 2, true, null, 3],
+                             "stages": ["filter_numbers", "sort", "unique", "unique"]})");
+        REQUIRE(piped["result"] == json::parse("[1, 2.0, 3]"));
+        REQUIRE(piped["timings"].size() == 1);
+        REQUIRE(piped["timings"][0]["stages"] == json::parse(R"(["filter_numbers", "sort", "unique", "unique"])"));
+        REQUIRE(piped["timings"][0]["count"] == 3);
+        REQUIRE(piped["timings"][0]["microseconds"].get<double>() >= 0.0);
+
+        piped = run(R"({"type": "pipeline", "dataset": ["b", "a", "b", 1], "stages": ["unique", "filter_numbers", "stats"]})");
+        REQUIRE(piped["timings"].size() == 2);
+        REQUIRE(piped["timings"][0]["count"] == 3);
+        REQUIRE(piped["timings"][1]["stages"] == json::parse(R"(["filter_numbers", "stats"])"));
+        REQUIRE(piped["result"]["count"] == 1);
+
+        piped = run(R"({"type": "pipeline", "dataset": ["b", "a", "b"], "stages": ["unique", "sort"]})");
+        REQUIRE(piped["result"] == json::parse(R"(["a", "b"])"));
+        REQUIRE(piped["timings"].size() == 2);
+    }
+
+    SECTION("Invalid pipelines are reported")
+    {
+        auto piped = run(R"({"type": "pipeline", "dataset": [1], "stages": ["median"]})");
+        REQUIRE(piped["error"] == "Unknown pipeline stage: median");
+        piped = run(R"({"type": "pipeline", "dataset": [1], "stages": ["stats", "sort"]})");
+        REQUIRE(piped["error"] == "stats must be the last stage");
+        piped = run(R"({"type": "pipeline", "dataset": [1]})");
+        REQUIRE(piped["error"] == "Stages array is required for pipeline requests");
+        // Filtered first, stats sees an empty dataset even when fused
+        piped = run(R"({"type": "pipeline", "dataset": ["x"], "stages": ["filter_numbers", "stats"]})");
+        REQUIRE(piped["error"] == "Pipeline stage 2 (stats) failed: Dataset cannot be empty");
+        piped = run(R"({"type": "pipeline", "dataset": [[1], [1]], "stages": ["unique"]})");
+        REQUIRE(piped["error"] == "Pipeline stage 1 (unique) failed: unhashable type: 'list'");
+    }
+}
+
+TEST_CASE("Python Processor Matrix Requests", "[python][processor][matrix]")
+{
+    PythonProcessor processor;
+    REQUIRE(processor.isInitialized());
+
+    auto run = [&](const std::string& request) {
+        auto response = processor.process(request);
+        REQUIRE(response);
+        REQUIRE(response->native);
+        return json::parse(response->body);
+    };
+
+    SECTION("Operations")
+    {
+        auto product = run(R"({"type": "matrix", "operation": "multiply", "a": [[1, 2], [3, 4]], "b": [[5], [6]]})");
+        REQUIRE(product["success"] == true);
+        REQUIRE(product["operation"] == "multiply");
+        REQUIRE(product["result"] == json::parse("[[17], [39]]"));
+        REQUIRE(product["shape"] == json::parse("[2, 1]"));
+
+        auto transposed = run(R"({"type": "matrix", "operation": "transpose", "matrix": [[1.5, 2], [3, 4]]})");
+        REQUIRE(transposed["result"] == json::parse("[[1.5, 3.0], [2.0, 4.0]]"));
+        REQUIRE(transposed["result"][0][1].is_number_float());
+
+        auto dot = run(R"({"type": "matrix", "operation": "dot", "a": [1, 2, 3], "b": [4, 5, 6]})");
+        REQUIRE(dot["result"] == 32);
+        REQUIRE_FALSE(dot.contains("shape"));
+
+        auto sums = run(R"({"type": "matrix", "operation": "reduce", "matrix": [[1, 2], [3, 4]]})");
+        REQUIRE(sums["result"] == json::parse("[3, 7]"));
+        auto means = run(R"({"type": "matrix", "operation": "reduce", "axis": "columns", "reduction": "mean", "matrix": [[1, 2], [3, 4]]})");
+        REQUIRE(means["result"] == json::parse("[2.0, 3.0]"));
+    }
+
+    SECTION("Errors")
+    {
+        auto mismatch = run(R"({"type": "matrix", "operation": "multiply", "a": [[1, 2]], "b": [[1, 2]]})");
+        REQUIRE(mismatch["success"] == false);
+        REQUIRE(mismatch["error"] == "Matrix operation failed: Cannot multiply a 1x2 matrix by a 1x2 matrix");
+
+        auto ragged = run(R"({"type": "matrix", "operation": "transpose", "matrix": [[1, 2], [3]]})");
+        REQUIRE(ragged["error"] == "Matrix operation failed: matrix must be a non-empty array of equal-length numeric rows");
+
+        auto reduction = run(R"({"type": "matrix", "operation": "reduce", "reduction": "median", "matrix": [[1]]})");
+        REQUIRE(reduction["error"] == "Matrix operation failed: reduction must be one of sum, mean, min, max");
+
+        auto unknown = run(R"({"type": "matrix", "operation": "invert", "matrix": [[1]]})");
+        REQUIRE(unknown["error"] == "Unknown matrix operation: invert");
+        REQUIRE(unknown["available_operations"] == json::parse(R"(["multiply", "transpose", "dot", "reduce"])"));
+    }
+}
+
+TEST_CASE("Python Processor Regex Operations", "[python][processor][regex]")
+{
+    PythonProcessor processor;
+    REQUIRE(processor.isInitialized());
+
+    auto run = [&](json request, bool native) {
+        auto response = processor.process(request.dump());
+        REQUIRE(response);
+        REQUIRE(response->native == native);
+        return json::parse(response->body);
+    };
+
+    SECTION("Both engines give the same results")
+    {
+        const std::string text = "Call 555-1234 or 555-9876\nthen CALL again: call!";
+        json requests = json::array({
+            {{"operation", "find_all"}, {"pattern", "\\d{3}-\\d{4}"}},
+            {{"operation", "find_all"}, {"pattern", "^\\w+"}, {"flags", "m"}},
+            {{"operation", "find_all"}, {"pattern", "x*"}},
+            {{"operation", "count_matches"}, {"pattern", "call"}, {"flags", "i"}},
+            {{"operation", "count_matches"}, {"pattern", "(a|ab)(c|bcd)"}},
+            {{"operation", "replace"}, {"pattern", "(\\d{3})-(?P<line>\\d{4})"}, {"replacement", "\\g<line>/\\1"}},
+            {{"operation", "replace"}, {"pattern", "call"}, {"flags", "i"}, {"replacement", "dial"}, {"count", 2}},
+            {{"operation", "replace"}, {"pattern", "\\s+"}, {"replacement", " "}}
+        });
+        for (json request : requests) {
+            request["type"] = "text";
+            request["text"] = text;
+            INFO(request.dump());
+            json backtracking = run(request, false);
+            request["engine"] = "linear";
+            json linear = run(request, true);
+            REQUIRE(backtracking["success"] == true);
+            REQUIRE(linear == backtracking);
+        }
+    }
+
+    SECTION("Results")
+    {
+        json found = run({{"type", "text"}, {"operation", "find_all"}, {"text", "a1 b22 c333"}, {"pattern", "\\d+"}, {"engine", "linear"}}, true);
+        REQUIRE(found["result"] == json::parse(R"(["1", "22", "333"])"));
+        REQUIRE(found["operation"] == "find_all");
+        REQUIRE(found["input_text"] == "a1 b22 c333");
+
+        json replaced = run({{"type", "text"}, {"operation", "replace"}, {"text", "a-b-c"}, {"pattern", "-"}, {"replacement", "+"}, {"count", 1}}, false);
+        REQUIRE(replaced["result"] == "a+b-c");
+    }
+
+    SECTION("Errors")
+    {
+        json unsupported = run({{"type", "text"}, {"operation", "find_all"}, {"text", "aa"}, {"pattern", "(a)\\1"}, {"engine", "linear"}}, true);
+        REQUIRE(unsupported["success"] == false);
+        REQUIRE(unsupported["error"] == "Text operation failed: backreferences are not supported by the linear engine at position 3");
+        json backreference = run({{"type", "text"}, {"operation", "count_matches"}, {"text", "aa"}, {"pattern", "(a)\\1"}}, false);
+        REQUIRE(backreference["result"] == 1);
+
+        for (bool linear : {false, true}) {
+            INFO(linear);
+            json request = {{"type", "text"}, {"operation", "replace"}, {"text", "abc"}, {"pattern", "b"}};
+            if (linear) {
+                request["engine"] = "linear";
+            }
+            REQUIRE(run(request, linear)["error"] == "Text operation failed: replacement must be a string");
+            request["replacement"] = "x";
+            request["flags"] = "q";
+            REQUIRE(run(request, linear)["error"] == "Text operation failed: Unknown regex flag: q");
+            request.erase("flags");
+            request["count"] = -1;
+            REQUIRE(run(request, linear)["error"] == "Text operation failed: count must be an integer between 0 and 1073741824");
+            request["count"] = 0;
+            request.erase("pattern");
+            REQUIRE(run(request, linear)["error"] == "Text operation failed: pattern must be a string");
+        }
+
+        json engine = run({{"type", "text"}, {"operation", "find_all"}, {"text", "a"}, {"pattern", "a"}, {"engine", "dfa"}}, false);
+        REQUIRE(engine["error"] == "Text operation failed: engine must be \"backtracking\" or \"linear\"");
+    }
+
+    SECTION("Adversarial patterns do not stall the linear engine")
+    {
+        auto start = std::chrono::steady_clock::now();
+        json result = run({{"type", "text"}, {"operation", "count_matches"}, {"text", std::string(5000, 'a')},
+                           {"pattern", "(a*)*b"}, {"engine", "linear"}}, true);
+        REQUIRE(result["result"] == 0);
+        REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+    }
+
+    SECTION("Requests Python serves keep the linear engine")
+    {
+        // NaN is not JSON, so the native handler defers and processor.py runs the request
+        auto start = std::chrono::steady_clock::now();
+        auto response = processor.process(R"({"type": "text", "operation": "count_matches", "text": ")" + std::string(5000, 'a') +
+                                          R"(!", "pattern": "(a+)+$", "engine": "linear", "extra": NaN})");
+        REQUIRE(response);
+        REQUIRE_FALSE(response->native);
+        json slow = json::parse(response->body);
+        REQUIRE(slow["success"] == true);
+        REQUIRE(slow["result"] == 0);
+        REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+
+        response = processor.process(R"({"type": "text", "operation": "find_all", "text": "aa", "pattern": "(a)\\1", "engine": "linear", "extra": NaN})");
+        REQUIRE(response);
+        REQUIRE_FALSE(response->native);
+        json unsupported = json::parse(response->body);
+        REQUIRE(unsupported["error"] == "Text operation failed: backreferences are not supported by the linear engine at position 3");
+
+        response = processor.process(R"({"type": "text", "operation": "replace", "text": "a-b-c", "pattern": "-", "replacement": "+", "count": 1, "engine": "linear", "extra": NaN})");
+        REQUIRE(response);
+        REQUIRE_FALSE(response->native);
+        REQUIRE(json::parse(response->body)["result"] == "a+b-c");
+    }
+}
+
+TEST_CASE("Python Processor Term Frequencies", "[python][processor][terms]")
+{
+    PythonProcessor processor;
+    REQUIRE(processor.isInitialized());
+
+    auto run = [&](json request) {
+        request["type"] = "text";
+        auto response = processor.process(request.dump());
+        REQUIRE(response);
+        REQUIRE(response->native);
+        return response->body;
+    };
+    const std::string text = "the cat  the\u3000dog\tthe cat \u00e9";
+
+    SECTION("Responses match processor.py byte for byte")
+    {
+        REQUIRE(run({{"operation", "word_frequency"}, {"text", text}})
+                == R"({"success": true, "result": {"the": 3, "cat": 2, "dog": 1, "\u00e9": 1}, "operation": "word_frequency", )"
+                   R"("total_words": 7, "approximate": false, "timestamp": "2025-06-14T00:00:00"})");
+        REQUIRE(run({{"operation", "top_k_terms"}, {"text", text}, {"k", 2}})
+                == R"({"success": true, "result": [["the", 3], ["cat", 2]], "operation": "top_k_terms", )"
+                   R"("total_words": 7, "approximate": false, "timestamp": "2025-06-14T00:00:00"})");
+        REQUIRE(run({{"operation", "top_k_terms"}, {"text", ""}})
+                == R"({"success": true, "result": [], "operation": "top_k_terms", "total_words": 0, "approximate": false, )"
+                   R"("timestamp": "2025-06-14T00:00:00"})");
+        REQUIRE(run({{"operation", "top_k_terms"}, {"text", "a"}, {"k", 0}})
+                == R"({"success": false, "error": "Text operation failed: k must be an integer between 1 and 100000", )"
+                   R"("timestamp": "2025-06-14T00:00:00"})");
+        REQUIRE(run({{"operation", "word_frequency"}, {"text", "a"}, {"memory_budget", true}})
+                == R"({"success": false, "error": "Text operation failed: memory_budget must be an integer between 65536 and )"
+                   R"(1099511627776", "timestamp": "2025-06-14T00:00:00"})");
+    }
+
+    SECTION("A vocabulary past the memory budget is counted approximately")
+    {
+        std::string corpus;
+        for (int i = 0; i < 20000; ++i) {
+            corpus += i % 2 == 0 ? "common " : "w" + std::to_string(i) + " ";
+        }
+        json exact = json::parse(run({{"operation", "top_k_terms"}, {"text", corpus}, {"k", 1}}));
+        REQUIRE(exact["approximate"] == false);
+        REQUIRE(exact["result"] == json::parse(R"([["common", 10000]])"));
+
+        json approximate = json::parse(run({{"operation", "top_k_terms"}, {"text", corpus}, {"k", 1}, {"memory_budget", 65536}}));
+        REQUIRE(approximate["approximate"] == true);
+        REQUIRE(approximate["total_words"] == 20000);
+        REQUIRE(approximate["result"][0][0] == "common");
+        REQUIRE(approximate["result"][0][1] >= 10000);
+    }
+}
+
+TEST_CASE("Python Processor Recycling", "[python][processor][recycle]")
+{
+    const std::string request = R"({"type": "text", "operation": "capitalize", "text": "hello world"})";
+    const std::string expected = R"({"success": true, "result": "Hello world", "operation": "capitalize", )"
+                                 R"("input_text": "hello world", "timestamp": "2025-06-14T00:00:00"})";
+
+    SECTION("On request")
+    {
+        PythonProcessor processor;
+        REQUIRE(processor.isInitialized());
+        REQUIRE(processor.processJson(request) == expected);
+        REQUIRE_FALSE(processor.getRecyclePolicy().enabled());
+
+        REQUIRE(processor.recycle());
+        REQUIRE(processor.processJson(request) == expected);
+        RecycleStats stats = processor.getRecycleStats();
+        REQUIRE(stats.recycles == 1);
+        REQUIRE(stats.failures == 0);
+        REQUIRE(stats.lastReason == "manual");
+        REQUIRE(stats.requestsSinceRecycle == 1);
+    }
+
+    SECTION("The new module's request schemas are used")
+    {
+        PythonProcessor processor;
+        REQUIRE(processor.isInitialized());
+        const std::string shout = R"({"type": "shout", "text": "hi"})";
+        REQUIRE_THAT(processor.processJson(shout), Catch::Matchers::ContainsSubstring("Unknown request type: shout"));
+
+        // processor.py with one more request type, imported ahead of the frozen
+        // and source copies
+        auto runPython = [](const char* code) {
+            PyGILState_STATE state = PyGILState_Ensure();
+            int status = PyRun_SimpleString(code);
+            PyGILState_Release(state);
+            return status;
+        };
+        REQUIRE(runPython(R"(
+import importlib.machinery, importlib.util, os, sys, tempfile
+shout_dir = tempfile.mkdtemp()
+with open(importlib.machinery.PathFinder.find_spec("processor").origin) as original, \
+        open(os.path.join(shout_dir, "processor.py"), "w") as copy:
+    copy.write(original.read() + """
+REQUEST_SCHEMAS["shout"] = {"field": "text", "kind": "string", "error": "Text field is required for shout"}
+REQUEST_HANDLERS["shout"] = lambda data: {"success": True, "result": data["text"].upper()}
+""")
+
+class ShoutFinder:
+    @staticmethod
+    def find_spec(name, path=None, target=None):
+        if name == "processor":
+            return importlib.util.spec_from_file_location(name, os.path.join(shout_dir, "processor.py"))
+        return None
+
+sys.meta_path.insert(0, ShoutFinder)
+)") == 0);
+        REQUIRE(processor.recycle());
+        CHECK(processor.processJson(shout) == R"({"success": true, "result": "HI"})");
+        CHECK(processor.processJson(R"({"type": "shout", "text": 5})") ==
+              R"({"success": false, "error": "Text field is required for shout", "timestamp": "2025-06-14T00:00:00"})");
+
+        REQUIRE(runPython(R"(
+import shutil, sys
+sys.meta_path.remove(ShoutFinder)
+shutil.rmtree(shout_dir)
+)") == 0);
+        REQUIRE(processor.recycle());
+        REQUIRE_THAT(processor.processJson(shout), Catch::Matchers::ContainsSubstring("Unknown request type: shout"));
+    }
+
+    SECTION("Request and heap thresholds")
+    {
+        PythonProcessor processor;
+        REQUIRE(processor.isInitialized());
+        processor.setRecyclePolicy({.maxRequests = 5, .minInterval = std::chrono::milliseconds(0)});
+        for (int i = 0; i < 12; ++i) {
+            REQUIRE(processor.processJson(request) == expected);
+        }
+        RecycleStats stats = processor.getRecycleStats();
+        REQUIRE(stats.recycles == 2);
+        REQUIRE(stats.lastReason == "requests");
+        REQUIRE(stats.requestsSinceRecycle == 2);
+
+        // Native requests do not count
+        processor.processJson(R"({"type": "text", "operation": "uppercase", "text": "abc"})");
+        REQUIRE(processor.getRecycleStats().requestsSinceRecycle == 2);
+
+        // Any Python heap is over one block; minInterval holds off a second recycle
+        PythonProcessor bloated;
+        bloated.setRecyclePolicy({.maxHeapBlocks = 1, .minInterval = std::chrono::hours(1)});
+        for (int i = 0; i < 3; ++i) {
+            REQUIRE(bloated.processJson(request) == expected);
+        }
+        REQUIRE(bloated.getRecycleStats().recycles == 1);
+        REQUIRE(bloated.getRecycleStats().lastReason == "heap");
+    }
+
+    SECTION("Requests in flight are not failed")
+    {
+        PythonProcessor processor;
+        REQUIRE(processor.isInitialized());
+        processor.setRecyclePolicy({.maxRequests = 7, .minInterval = std::chrono::milliseconds(0)});
+        REQUIRE(processor.startSpanTracing("test_recycle_spans.json"));
+
+        std::atomic<int> wrong{0};
+        std::atomic<bool> done{false};
+        std::vector<std::jthread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&] {
+                for (int i = 0; i < 50; ++i) {
+                    if (processor.processJson(request) != expected) {
+                        ++wrong;
+                    }
+                    std::string streamed;
+                    auto result = processor.processStream(request, [&](std::string_view chunk) {
+                        streamed.append(chunk);
+                        return true;
+                    }, 8);
+                    if (!result || streamed != expected) {
+                        ++wrong;
+                    }
+                }
+            });
+        }
+        threads.emplace_back([&] {
+            while (!done) {
+                processor.recycle();
+            }
+        });
+        for (std::size_t t = 0; t < 4; ++t) {
+            threads[t].join();
+        }
+        done = true;
+        threads.clear();
+        processor.stopSpanTracing();
+
+        REQUIRE(wrong == 0);
+        RecycleStats stats = processor.getRecycleStats();
+        REQUIRE(stats.recycles > 0);
+        REQUIRE(stats.failures == 0);
+        std::filesystem::remove("test_recycle_spans.json");
+    }
+}
+
+TEST_CASE("Python Processor Garbage Collection", "[python][processor][gc]")
+{
+    // Enough containers per request for json.loads to trigger young collections
+    std::string nested = R"({"type": "echo", "items": [)";
+    for (int i = 0; i < 2000; ++i) {
+        nested += (i ? ", " : "") + std::string(R"({"a": [1, 2]})");
+    }
+    nested += "]}";
+
+    SECTION("Collections and their pauses are reported")
+    {
+        PythonProcessor processor;
+        REQUIRE(processor.isInitialized());
+        for (int i = 0; i < 5; ++i) {
+            REQUIRE(processor.process(nested));
+        }
+
+        GcStats stats = processor.getGcStats();
+        REQUIRE_FALSE(stats.deferred);
+        REQUIRE(stats.collections[0] > 0);
+        REQUIRE(stats.totalPause > std::chrono::nanoseconds(0));
+        REQUIRE(stats.maxPause >= stats.lastPause);
+        REQUIRE(stats.totalPause >= stats.maxPause);
+        REQUIRE(processor.samplePerformance().gcCollections == stats.totalCollections());
+    }
+
+    SECTION("Latency mode freezes startup objects and collects while idle")
+    {
+        StartupOptions options = StartupOptions::lowLatency();
+        options.gcIdleDelay = std::chrono::milliseconds(5);
+        PythonProcessor processor(options);
+        REQUIRE(processor.isInitialized());
+
+        GcStats stats = processor.getGcStats();
+        REQUIRE(stats.deferred);
+        REQUIRE(stats.frozenObjects > 0);
+        std::uint64_t before = stats.totalCollections();
+
+        for (int i = 0; i < 5; ++i) {
+            REQUIRE(processor.process(nested));
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (processor.getGcStats().idleCollections == 0 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+
+        stats = processor.getGcStats();
+        REQUIRE(stats.idleCollections > 0);
+        REQUIRE(stats.collections[2] > 0);
+        // Nothing but the idle collector ran a collection
+        REQUIRE(stats.totalCollections() - before == stats.idleCollections + stats.overdueCollections);
+    }
 }
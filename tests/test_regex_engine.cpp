@@ -0,0 +1,154 @@
+#include <catch2/catch_test_macros.hpp>
+#include "regex_engine.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> matchedText(const regex::Pattern& pattern, const std::string& text) {
+    std::vector<std::string> matches;
+    for (const auto& match : pattern.findAll(text)) {
+        matches.push_back(text.substr(match.begin(), match.end() - match.begin()));
+    }
+    return matches;
+}
+
+} // namespace
+
+TEST_CASE("Linear-time regex matching", "[regex]")
+{
+    SECTION("Matches are the ones re finds")
+    {
+        regex::Pattern alternation("(a|ab)(c|bcd)(d*)", {});
+        auto match = alternation.search("abcd");
+        REQUIRE(match);
+        REQUIRE(match->groups == std::vector<std::pair<std::size_t, std::size_t>>{{0, 4}, {0, 1}, {1, 4}, {4, 4}});
+
+        REQUIRE(matchedText(regex::Pattern("\\d+", {}), "123-4567 and 12.5") == std::vector<std::string>{"123", "4567", "12", "5"});
+        REQUIRE(matchedText(regex::Pattern("a{2,3}", {}), "aaaaaaa") == std::vector<std::string>{"aaa", "aaa"});
+        REQUIRE(matchedText(regex::Pattern("a{2,3}?", {}), "aaaaa") == std::vector<std::string>{"aa", "aa"});
+        REQUIRE(matchedText(regex::Pattern("\\bfoo\\b", {}), "foo foobar foo_ foo.") == std::vector<std::string>{"foo", "foo"});
+        REQUIRE(matchedText(regex::Pattern("[^a-c]+", {}), "abxyzcq") == std::vector<std::string>{"xyz", "q"});
+        REQUIRE(matchedText(regex::Pattern("a{", {}), "a{a") == std::vector<std::string>{"a{"});
+    }
+
+    SECTION("Empty matches advance as in re.finditer")
+    {
+        REQUIRE(matchedText(regex::Pattern("x*", {}), "abxd") == std::vector<std::string>{"", "", "x", "", ""});
+        REQUIRE(regex::Pattern("x*", {}).countMatches("abxd") == 5);
+        REQUIRE(regex::Pattern("", {}).countMatches("") == 1);
+    }
+
+    SECTION("Flags and anchors")
+    {
+        REQUIRE(matchedText(regex::Pattern("^x", {.multiline = true}), "x\nxy\nzx") == std::vector<std::string>{"x", "x"});
+        REQUIRE(matchedText(regex::Pattern("^x", {}), "x\nxy") == std::vector<std::string>{"x"});
+        REQUIRE(matchedText(regex::Pattern("\\w+$", {}), "one two\n") == std::vector<std::string>{"two"});
+        REQUIRE(matchedText(regex::Pattern("a.c", {}), "a\nc abc") == std::vector<std::string>{"abc"});
+        REQUIRE(matchedText(regex::Pattern("a.c", {.dotAll = true}), "a\nc") == std::vector<std::string>{"a\nc"});
+        REQUIRE(matchedText(regex::Pattern("[a-c]+", {.ignoreCase = true}), "xAbCx") == std::vector<std::string>{"AbC"});
+        REQUIRE(matchedText(regex::Pattern("[^a]", {.ignoreCase = true}), "aAb") == std::vector<std::string>{"b"});
+    }
+
+    SECTION("UTF-8 text is matched by code point")
+    {
+        std::string text = "na\u00efve \u4e2d\u6587!";
+        REQUIRE(matchedText(regex::Pattern(".", {}), "\u00e9\U0001F600").size() == 2);
+        REQUIRE(matchedText(regex::Pattern("[\u4e00-\u9fff]+", {}), text) == std::vector<std::string>{"\u4e2d\u6587"});
+        REQUIRE(matchedText(regex::Pattern("\\w+", {}), text) == std::vector<std::string>{"na", "ve"});
+        REQUIRE(matchedText(regex::Pattern("\\u00efv", {}), text) == std::vector<std::string>{"\u00efv"});
+    }
+
+    SECTION("Replacement templates follow re.sub")
+    {
+        regex::Pattern phone("(\\d{3})-(?P<line>\\d{4})", {});
+        REQUIRE(phone.replace("call 555-1234 or 555-9876", "\\2/\\g<1>") == "call 1234/555 or 9876/555");
+        REQUIRE(phone.replace("call 555-1234 or 555-9876", "<\\g<line>>", 1) == "call <1234> or 555-9876");
+        REQUIRE(regex::Pattern("x*", {}).replace("abxd", "-") == "-a-b--d-");
+        REQUIRE(regex::Pattern("(a)|(b)", {}).replace("ab", "[\\1\\2]") == "[a][b]");
+        REQUIRE(regex::Pattern("b", {}).replace("abc", "\\n\\\\\\&") == "a\n\\\\&c");
+        REQUIRE_THROWS_AS(phone.replace("555-1234", "\\3"), std::invalid_argument);
+        REQUIRE_THROWS_AS(phone.replace("555-1234", "\\q"), std::invalid_argument);
+        REQUIRE_THROWS_AS(phone.replace("555-1234", "\\g<nope>"), std::invalid_argument);
+    }
+
+    SECTION("Malformed and unsupported patterns are rejected")
+    {
+        for (const char* pattern : {"(a", "a)", "[a", "*a", "a**", "\\q", "a{3,2}", "(?P<x>a)(?P<x>b)",
+                                    "(a)\\1", "(?P<x>a)(?P=x)", "(?=a)", "(?<!a)b", "(?i)a", "a*+"}) {
+            INFO(pattern);
+            REQUIRE_THROWS_AS(regex::Pattern(pattern, {}), std::invalid_argument);
+        }
+    }
+
+    SECTION("Patterns that backtrack exponentially run in linear time")
+    {
+        std::string text(20000, 'a');
+        auto start = std::chrono::steady_clock::now();
+        REQUIRE(regex::Pattern("(a*)*b", {}).countMatches(text) == 0);
+        REQUIRE(regex::Pattern("(a|aa)+$", {}).countMatches(text + "!") == 0);
+        REQUIRE(regex::Pattern("(?:a+a+)+b", {}).countMatches(text) == 0);
+        REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+    }
+
+    SECTION("Rescanning past every match runs out of steps")
+    {
+        // Each match is one a, found only after scanning to the end for a b
+        regex::Pattern pattern("a(?:.*b)?", {});
+        REQUIRE(pattern.countMatches(std::string(100, 'a')) == 100);
+
+        std::string text(40000, 'a');
+        auto start = std::chrono::steady_clock::now();
+        REQUIRE_THROWS_AS(pattern.countMatches(text), std::runtime_error);
+        REQUIRE_THROWS_AS(pattern.findAll(text), std::runtime_error);
+        REQUIRE_THROWS_AS(pattern.replace(text, "x"), std::runtime_error);
+        REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+        // A single search is still linear
+        REQUIRE(pattern.search(text)->end() == 1);
+    }
+}
+
+TEST_CASE("Regex pattern cache", "[regex]")
+{
+    regex::PatternCache cache(2);
+
+    auto first = cache.get("a+", {});
+    REQUIRE(cache.get("a+", {}) == first);
+    REQUIRE(cache.get("a+", {.ignoreCase = true}) != first);
+    REQUIRE(cache.hits() == 1);
+    REQUIRE(cache.misses() == 2);
+
+    // The least recently used entry goes first
+    cache.get("a+", {});
+    cache.get("b+", {});
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.get("a+", {}) == first);
+    cache.get("a+", {.ignoreCase = true});
+    REQUIRE(cache.misses() == 4);
+
+    // Failures propagate and are not cached
+    REQUIRE_THROWS_AS(cache.get("(", {}), std::invalid_argument);
+    REQUIRE(cache.size() == 2);
+
+    std::atomic<int> wrong{0};
+    std::vector<std::jthread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, &wrong, t] {
+            for (int i = 0; i < 200; ++i) {
+                int digit = (i + t) % 4;
+                auto pattern = cache.get(std::to_string(digit) + "+", {});
+                if (pattern->countMatches("0112223333") != 1u) {
+                    ++wrong;
+                }
+            }
+        });
+    }
+    threads.clear();
+    REQUIRE(wrong == 0);
+    REQUIRE(cache.size() == 2);
+}
@@ -0,0 +1,109 @@
+#include <catch2/catch_test_macros.hpp>
+#include "result_cache.h"
+
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// A cache file in the temp directory, removed afterwards
+struct TemporaryFile {
+    fs::path path = fs::temp_directory_path() / ("test_result_cache_" + std::to_string(::getpid()));
+    ~TemporaryFile() { fs::remove(path); }
+};
+
+} // namespace
+
+TEST_CASE("Result cache", "[cache]")
+{
+    TemporaryFile file;
+
+    SECTION("Entries survive a reopen of the same version only")
+    {
+        {
+            ResultCache cache(file.path.string(), 1);
+            REQUIRE_FALSE(cache.find("a"));
+            cache.insert("a", "first", 1);
+            cache.insert("b", std::string(1000, 'x'), 1);
+            cache.insert("a", "ignored", 1);
+            cache.insert("c", "stale", 2);
+            REQUIRE(cache.find("a") == "first");
+            REQUIRE_FALSE(cache.find("c"));
+            REQUIRE(cache.size() == 2);
+            REQUIRE(cache.hits() == 1);
+            REQUIRE(cache.misses() == 2);
+
+            // One process at a time
+            REQUIRE_THROWS_AS(ResultCache(file.path.string(), 1), std::runtime_error);
+        }
+        {
+            ResultCache cache(file.path.string(), 1);
+            REQUIRE(cache.size() == 2);
+            REQUIRE(cache.find("a") == "first");
+            REQUIRE(cache.find("b") == std::string(1000, 'x'));
+        }
+        ResultCache other(file.path.string(), 2);
+        REQUIRE(other.size() == 0);
+        REQUIRE_FALSE(other.find("a"));
+
+        other.insert("d", "kept", 2);
+        other.reset(3);
+        REQUIRE_FALSE(other.find("d"));
+        other.insert("d", "late", 2);
+        REQUIRE(other.size() == 0);
+    }
+
+    SECTION("Compaction keeps the newest entries under the cap")
+    {
+        ResultCache cache(file.path.string(), 1, ResultCache::kMinMaxBytes);
+        std::string value(1000, 'v');
+        for (int i = 0; i < 200; ++i) {
+            cache.insert("key" + std::to_string(i), value, 1);
+            REQUIRE(cache.bytes() <= ResultCache::kMinMaxBytes);
+        }
+        REQUIRE(cache.compactions() > 0);
+        REQUIRE(cache.find("key199") == value);
+        REQUIRE_FALSE(cache.find("key0"));
+        REQUIRE(fs::file_size(file.path) == ResultCache::kMinMaxBytes);
+
+        // Too large for the cap
+        cache.insert("huge", std::string(ResultCache::kMinMaxBytes / 2, 'h'), 1);
+        REQUIRE_FALSE(cache.find("huge"));
+    }
+
+    SECTION("A smaller cap shrinks the file")
+    {
+        {
+            ResultCache cache(file.path.string(), 1, 4 * ResultCache::kMinMaxBytes);
+            for (int i = 0; i < 200; ++i) {
+                cache.insert("key" + std::to_string(i), std::string(1000, 'v'), 1);
+            }
+        }
+        ResultCache cache(file.path.string(), 1, ResultCache::kMinMaxBytes);
+        REQUIRE(fs::file_size(file.path) == ResultCache::kMinMaxBytes);
+        REQUIRE(cache.bytes() <= ResultCache::kMinMaxBytes / 2);
+        REQUIRE(cache.find("key199"));
+    }
+}
+
+TEST_CASE("Canonical request keys", "[cache]")
+{
+    REQUIRE(canonicalRequest(R"({"type": "math", "numbers": [1, 2.5], "operation": "add"})")
+            == R"({"type":"math","numbers":[1,2.5],"operation":"add"})");
+    REQUIRE(canonicalRequest("{\"b\": {\"y\": 1, \"x\": 2},\n \"a\": \"\\u00e9\"}") == canonicalRequest(R"({"b":{"y":1,"x":2},"a":"\u00e9"})"));
+    // Responses echo members in request order, so order is part of the key
+    REQUIRE(canonicalRequest(R"({"dataset": [{"b": 1, "a": 2}, 3]})") != canonicalRequest(R"({"dataset": [{"a": 2, "b": 1}, 3]})"));
+    REQUIRE(canonicalRequest(R"({"a": 1, "b": 2, "a": 3})") == R"({"a":3,"b":2})");
+    // Integers and floats stay apart, as they do in Python
+    REQUIRE(canonicalRequest(R"({"n": 1})") != canonicalRequest(R"({"n": 1.0})"));
+    // Long digit runs only count outside strings
+    REQUIRE(canonicalRequest(R"({"id": "12345678901234567890"})"));
+    REQUIRE_FALSE(canonicalRequest(R"({"n": 12345678901234567890})"));
+    REQUIRE_FALSE(canonicalRequest("[1]"));
+    REQUIRE_FALSE(canonicalRequest("{"));
+}
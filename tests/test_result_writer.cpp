@@ -0,0 +1,121 @@
+#include <catch2/catch_test_macros.hpp>
+#include "result_writer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string readFile(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+// Inflates a zlib (windowBits 15) or gzip (15 + 16) stream
+std::string inflateAll(const std::string& compressed, int windowBits) {
+    z_stream stream{};
+    REQUIRE(inflateInit2(&stream, windowBits) == Z_OK);
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+    stream.avail_in = static_cast<uInt>(compressed.size());
+    std::string output;
+    std::vector<char> buffer(64 * 1024);
+    int status = Z_OK;
+    while (status == Z_OK) {
+        stream.next_out = reinterpret_cast<Bytef*>(buffer.data());
+        stream.avail_out = static_cast<uInt>(buffer.size());
+        status = inflate(&stream, Z_NO_FLUSH);
+        output.append(buffer.data(), buffer.size() - stream.avail_out);
+    }
+    inflateEnd(&stream);
+    CHECK(status == Z_STREAM_END);
+    return output;
+}
+
+// Several chunks of a typical result
+std::string largeResult() {
+    std::string result = "{\"success\": true, \"result\": [";
+    for (int i = 0; i < 300000; ++i) {
+        result += (i ? ", " : "") + std::to_string(i * 7 % 1013);
+    }
+    return result + "]}";
+}
+
+} // namespace
+
+TEST_CASE("Result saving", "[result_writer]")
+{
+    fs::path directory = fs::temp_directory_path() / "cppideas_result_writer_test";
+    fs::create_directories(directory);
+    std::string data = largeResult();
+
+    SECTION("Compression follows the extension")
+    {
+        CHECK(compressionForPath("out.json") == ResultCompression::None);
+        CHECK(compressionForPath("out.json.gz") == ResultCompression::Gzip);
+        CHECK(compressionForPath("out.json.zz") == ResultCompression::Zlib);
+    }
+
+    SECTION("Uncompressed output is the data byte for byte")
+    {
+        std::vector<std::size_t> reported;
+        auto stats = saveResult(data, directory / "plain.json", ResultCompression::None,
+            [&](std::size_t done, std::size_t total) {
+                CHECK(total == data.size());
+                reported.push_back(done);
+            });
+        REQUIRE(stats);
+        CHECK(stats->inputBytes == data.size());
+        CHECK(stats->outputBytes == data.size());
+        CHECK(readFile(directory / "plain.json") == data);
+        REQUIRE(reported.size() > 1);
+        CHECK(reported.back() == data.size());
+        CHECK(std::is_sorted(reported.begin(), reported.end()));
+    }
+
+    SECTION("Compressed output inflates to the data")
+    {
+        auto gzip = saveResult(data, directory / "result.json.gz", ResultCompression::Gzip);
+        REQUIRE(gzip);
+        std::string compressed = readFile(directory / "result.json.gz");
+        CHECK(gzip->outputBytes == compressed.size());
+        CHECK(compressed.size() < data.size() / 2);
+        CHECK(inflateAll(compressed, 15 + 16) == data);
+
+        REQUIRE(saveResult(data, directory / "result.json.zz", ResultCompression::Zlib));
+        CHECK(inflateAll(readFile(directory / "result.json.zz"), 15) == data);
+
+        REQUIRE(saveResult("", directory / "empty.json.gz", ResultCompression::Gzip));
+        CHECK(inflateAll(readFile(directory / "empty.json.gz"), 15 + 16).empty());
+    }
+
+    SECTION("A cancelled save leaves the previous file alone")
+    {
+        fs::path target = directory / "kept.json";
+        REQUIRE(saveResult("previous", target, ResultCompression::None));
+
+        std::stop_source stop;
+        auto cancelled = saveResult(data, target, ResultCompression::Gzip,
+            [&](std::size_t, std::size_t) { stop.request_stop(); }, stop.get_token());
+        REQUIRE_FALSE(cancelled);
+        CHECK(cancelled.error() == "Save cancelled");
+        CHECK(readFile(target) == "previous");
+        CHECK_FALSE(fs::exists(directory / "kept.json.part"));
+    }
+
+    SECTION("Unwritable paths are reported")
+    {
+        auto failed = saveResult(data, directory / "missing" / "out.json", ResultCompression::None);
+        REQUIRE_FALSE(failed);
+        CHECK(failed.error().starts_with("Could not open"));
+    }
+
+    fs::remove_all(directory);
+}
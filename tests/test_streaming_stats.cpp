@@ -0,0 +1,181 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_approx.hpp>
+#include "streaming_stats.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using Catch::Approx;
+
+TEST_CASE("Running statistics", "[stats]")
+{
+    SECTION("Welford matches the two-pass formulas")
+    {
+        std::vector<double> values = {10, 20, 30, 40, 50, 25, 35, 45};
+        RunningStats stats;
+        for (double v : values) {
+            stats.add(v);
+        }
+
+        double mean = std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+        double squares = 0;
+        for (double v : values) {
+            squares += (v - mean) * (v - mean);
+        }
+
+        REQUIRE(stats.count() == values.size());
+        REQUIRE(stats.sum() == 255);
+        REQUIRE(stats.mean() == Approx(31.875));
+        REQUIRE(stats.variance() == Approx(squares / 8));
+        REQUIRE(stats.sampleVariance() == Approx(squares / 7));
+        REQUIRE(stats.min() == 10);
+        REQUIRE(stats.max() == 50);
+    }
+
+    SECTION("Merging equals adding everything to one accumulator")
+    {
+        RunningStats left, right, all;
+        for (int i = 0; i < 1000; ++i) {
+            double v = static_cast<double>((i * 37) % 101) + 1e6;
+            (i % 3 ? left : right).add(v);
+            all.add(v);
+        }
+        left.merge(right);
+
+        REQUIRE(left.count() == all.count());
+        REQUIRE(left.mean() == Approx(all.mean()));
+        REQUIRE(left.variance() == Approx(all.variance()));
+        REQUIRE(left.min() == all.min());
+        REQUIRE(left.max() == all.max());
+    }
+}
+
+TEST_CASE("KLL quantile sketch", "[stats][sketch]")
+{
+    SECTION("Small inputs are exact")
+    {
+        KllSketch sketch;
+        for (double v : {5.0, 1.0, 3.0, 2.0, 4.0}) {
+            sketch.add(v);
+        }
+        REQUIRE(sketch.quantile(0.0) == 1.0);
+        REQUIRE(sketch.quantile(0.5) == 3.0);
+        REQUIRE(sketch.quantile(1.0) == 5.0);
+        REQUIRE(sketch.rank(3.0) == 3.0);
+    }
+
+    SECTION("Large inputs stay within the error bound in bounded memory")
+    {
+        const int n = 200000;
+        std::vector<double> values(n);
+        std::iota(values.begin(), values.end(), 0.0);
+        std::shuffle(values.begin(), values.end(), std::mt19937(42));
+
+        KllSketch sketch(200);
+        for (double v : values) {
+            sketch.add(v);
+        }
+
+        REQUIRE(sketch.count() == n);
+        REQUIRE(sketch.retained() < 2000);
+        for (double q : {0.01, 0.25, 0.5, 0.9, 0.99}) {
+            double expected = q * (n - 1);
+            REQUIRE(std::abs(sketch.quantile(q) - expected) < 0.02 * n);
+        }
+    }
+
+    SECTION("Merged sketches cover both inputs")
+    {
+        KllSketch a, b;
+        for (int i = 0; i < 50000; ++i) {
+            a.add(i);
+            b.add(i + 50000);
+        }
+        a.merge(b);
+
+        REQUIRE(a.count() == 100000);
+        REQUIRE(std::abs(a.quantile(0.5) - 50000) < 2000);
+    }
+}
+
+TEST_CASE("Histograms", "[stats][histogram]")
+{
+    SECTION("Fixed range counts values and out-of-range entries")
+    {
+        FixedHistogram hist(0, 10, 5);
+        for (double v : {-1.0, 0.0, 1.9, 2.0, 5.5, 9.99, 10.0, 11.0}) {
+            hist.add(v);
+        }
+        REQUIRE(hist.counts() == std::vector<std::uint64_t>{2, 1, 1, 0, 2});
+        REQUIRE(hist.underflow() == 1);
+        REQUIRE(hist.overflow() == 1);
+    }
+
+    SECTION("Sketch-based histogram accounts for every value")
+    {
+        KllSketch sketch;
+        for (int i = 0; i < 100; ++i) {
+            sketch.add(i);
+        }
+        auto counts = approximateHistogram(sketch, 0, 99, 4);
+        REQUIRE(std::accumulate(counts.begin(), counts.end(), std::uint64_t{0}) == 100);
+        REQUIRE(counts[0] == 25);
+    }
+}
+
+TEST_CASE("Rolling windows", "[stats][rolling]")
+{
+    std::mt19937 rng(11);
+    std::normal_distribution<double> noise(100.0, 15.0);
+    std::vector<double> values(2000);
+    for (double& v : values) {
+        v = noise(rng);
+    }
+
+    for (std::size_t window : std::initializer_list<std::size_t>{1, 2, 7, 64}) {
+        INFO("window " << window);
+        RollingStats stats(window);
+        RollingExtremes extremes(window);
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            stats.add(values[i]);
+            extremes.add(values[i]);
+
+            std::size_t begin = i + 1 >= window ? i + 1 - window : 0;
+            auto first = values.begin() + static_cast<std::ptrdiff_t>(begin);
+            auto last = values.begin() + static_cast<std::ptrdiff_t>(i + 1);
+            REQUIRE(extremes.min() == *std::min_element(first, last));
+            REQUIRE(extremes.max() == *std::max_element(first, last));
+
+            RunningStats exact;
+            std::for_each(first, last, [&](double v) { exact.add(v); });
+            REQUIRE(stats.count() == exact.count());
+            REQUIRE(stats.full() == (i + 1 >= window));
+            REQUIRE(stats.mean() == Approx(exact.mean()));
+            REQUIRE(stats.variance() == Approx(exact.variance()).margin(1e-9));
+            REQUIRE(stats.sampleVariance() == Approx(exact.sampleVariance()).margin(1e-9));
+        }
+    }
+
+    SECTION("Constant windows have no variance")
+    {
+        RollingStats stats(3);
+        for (int i = 0; i < 10; ++i) {
+            stats.add(0.1);
+        }
+        REQUIRE(stats.variance() >= 0.0);
+        REQUIRE(stats.variance() == Approx(0.0).margin(1e-15));
+    }
+
+    SECTION("Windows longer than the data cost only the data")
+    {
+        RollingStats stats(std::size_t{1} << 40);
+        stats.add(1.0);
+        stats.add(3.0);
+        REQUIRE(stats.window() == std::size_t{1} << 40);
+        REQUIRE(stats.count() == 2);
+        REQUIRE_FALSE(stats.full());
+        REQUIRE(stats.mean() == 2.0);
+    }
+}
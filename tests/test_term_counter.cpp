@@ -0,0 +1,65 @@
+#include <catch2/catch_test_macros.hpp>
+#include "term_counter.h"
+
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using TermCounts = std::vector<std::pair<std::string, std::uint64_t>>;
+
+TEST_CASE("Exact term counting", "[terms]")
+{
+    TermCounter counter;
+    for (const char* term : {"b", "a", "c", "a", "b", "d", "a", "\u00e9", "\u00e9"}) {
+        counter.add(term);
+    }
+    REQUIRE(counter.total() == 9);
+    REQUIRE_FALSE(counter.approximate());
+    // Ties keep the order of first appearance, as Counter.most_common does
+    REQUIRE(counter.top(10) == TermCounts{{"a", 3}, {"b", 2}, {"\u00e9", 2}, {"c", 1}, {"d", 1}});
+    REQUIRE(counter.top(2) == TermCounts{{"a", 3}, {"b", 2}});
+    REQUIRE(TermCounter().top(5).empty());
+
+    // Enough distinct terms to grow the table several times
+    TermCounter many;
+    std::map<std::string, std::uint64_t> expected;
+    for (int i = 0; i < 50000; ++i) {
+        std::string term = "t" + std::to_string(i % 7919);
+        many.add(term);
+        ++expected[term];
+    }
+    REQUIRE_FALSE(many.approximate());
+    auto all = many.top(SIZE_MAX);
+    REQUIRE(all.size() == expected.size());
+    for (const auto& [term, count] : all) {
+        REQUIRE(expected[term] == count);
+    }
+}
+
+TEST_CASE("Approximate term counting past the memory budget", "[terms]")
+{
+    // A Zipf-like stream: a few heavy terms over a long tail of rare ones
+    TermCounter counter(TermCounter::kMinMemoryBudget, 50);
+    std::map<std::string, std::uint64_t> expected;
+    std::mt19937 rng(7);
+    for (int i = 0; i < 200000; ++i) {
+        std::string term = i % 2 == 0 ? "heavy" + std::to_string(rng() % 10) : "rare" + std::to_string(i);
+        counter.add(term);
+        ++expected[term];
+    }
+    REQUIRE(counter.total() == 200000);
+    REQUIRE(counter.approximate());
+
+    // The heavy hitters come first and are never undercounted
+    auto top = counter.top(10);
+    REQUIRE(top.size() == 10);
+    for (const auto& [term, count] : top) {
+        INFO(term);
+        REQUIRE(term.starts_with("heavy"));
+        REQUIRE(count >= expected[term]);
+        REQUIRE(count <= expected[term] + 200000 / 100);
+    }
+    REQUIRE(counter.top(1000).size() == 50);
+}
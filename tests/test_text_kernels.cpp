@@ -0,0 +1,165 @@
+#include <catch2/catch_test_macros.hpp>
+#include "text_kernels.h"
+
+#include <cctype>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+// Mixed text long enough to cross several 16-byte blocks, with multibyte
+// characters landing on block boundaries
+std::string sampleText(std::size_t words, unsigned seed) {
+    static const char* pieces[] = {"lorem", "ipsum", "d\u00f6lor", "\u4e2d\u6587", "sit", "\U0001F600", "amet"};
+    static const char* separators[] = {" ", "  ", "\t", "\n", " ", "\u3000", " \r\n "};
+    std::mt19937 rng(seed);
+    std::string text;
+    for (std::size_t i = 0; i < words; ++i) {
+        text += pieces[rng() % 7];
+        text += separators[rng() % 7];
+    }
+    return text;
+}
+
+} // namespace
+
+TEST_CASE("UTF-8 case mapping", "[text]")
+{
+    SECTION("ASCII text is mapped across block boundaries")
+    {
+        std::string text;
+        for (int c = 0; c < 128; ++c) {
+            text += static_cast<char>(c);
+        }
+        text += "The Quick Brown Fox @[`{";
+
+        auto upper = utf8::toUpperAscii(text);
+        auto lower = utf8::toLowerAscii(text);
+        REQUIRE(upper.has_value());
+        REQUIRE(lower.has_value());
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            REQUIRE((*upper)[i] == static_cast<char>(std::toupper(static_cast<unsigned char>(text[i]))));
+            REQUIRE((*lower)[i] == static_cast<char>(std::tolower(static_cast<unsigned char>(text[i]))));
+        }
+    }
+
+    SECTION("Non-ASCII text is declined")
+    {
+        REQUIRE_FALSE(utf8::toUpperAscii("plain ascii prefix then caf\u00e9").has_value());
+        REQUIRE_FALSE(utf8::toLowerAscii("\u00c9").has_value());
+        REQUIRE(utf8::toUpperAscii("").value().empty());
+    }
+}
+
+TEST_CASE("UTF-8 counting", "[text]")
+{
+    SECTION("Code points")
+    {
+        REQUIRE(utf8::countCodePoints("") == 0);
+        REQUIRE(utf8::countCodePoints("hello") == 5);
+        REQUIRE(utf8::countCodePoints("d\u00f6lor \u4e2d\u6587 \U0001F600") == 10);
+
+        std::string text = sampleText(500, 1);
+        std::size_t expected = 0;
+        for (char c : text) {
+            expected += (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+        }
+        REQUIRE(utf8::countCodePoints(text) == expected);
+    }
+
+    SECTION("Validity")
+    {
+        REQUIRE(utf8::isValid(""));
+        REQUIRE(utf8::isValid(sampleText(200, 3)));
+        REQUIRE(utf8::isValid("\xED\x9F\xBF\xF4\x8F\xBF\xBF"));
+        REQUIRE_FALSE(utf8::isValid("\xC0\xAF"));              // overlong '/'
+        REQUIRE_FALSE(utf8::isValid("\xE0\x80\xAF"));          // overlong '/'
+        REQUIRE_FALSE(utf8::isValid("\xED\xA0\x80"));          // U+D800
+        REQUIRE_FALSE(utf8::isValid("\xF4\x90\x80\x80"));      // past U+10FFFF
+        REQUIRE_FALSE(utf8::isValid("ok\xE4\xB8"));             // truncated
+        REQUIRE_FALSE(utf8::isValid("\x80"));
+    }
+
+    SECTION("Words split on Unicode whitespace")
+    {
+        REQUIRE(utf8::countWords("") == 0);
+        REQUIRE(utf8::countWords("   \t\n  ") == 0);
+        REQUIRE(utf8::countWords("one") == 1);
+        REQUIRE(utf8::countWords("  one two  three ") == 3);
+        REQUIRE(utf8::countWords("a b c\u3000d e\x1f" "f") == 6);
+        // Zero width space is not whitespace for str.split()
+        REQUIRE(utf8::countWords("a\u200B" "b") == 1);
+
+        REQUIRE(utf8::countWords(sampleText(1000, 2)) == 1000);
+        REQUIRE(utf8::countWords(std::string(1000, 'x') + " " + std::string(33, 'y')) == 2);
+    }
+
+    SECTION("Words come out one at a time as str.split() gives them")
+    {
+        auto words = [](std::string_view text) {
+            std::vector<std::string> split;
+            std::size_t pos = 0;
+            for (auto word = utf8::nextWord(text, pos); !word.empty(); word = utf8::nextWord(text, pos)) {
+                split.emplace_back(word);
+            }
+            return split;
+        };
+        REQUIRE(words("").empty());
+        REQUIRE(words(" \t\n ").empty());
+        REQUIRE(words("  one two\u3000three\x1c") == std::vector<std::string>{"one", "two", "three"});
+        REQUIRE(words(std::string(40, 'x') + "\u2028" + std::string(20, ' ') + "\u00e9") == std::vector<std::string>{std::string(40, 'x'), "\u00e9"});
+
+        std::string text = sampleText(1000, 3);
+        REQUIRE(words(text).size() == utf8::countWords(text));
+    }
+}
+
+TEST_CASE("Grapheme-aware reverse", "[text]")
+{
+    REQUIRE(utf8::reverseGraphemes("") == "");
+    REQUIRE(utf8::reverseGraphemes("hello") == "olleh");
+    REQUIRE(utf8::reverseGraphemes("a\r\nb\n\r") == "\r\nb\r\na");
+    REQUIRE(utf8::reverseGraphemes("\u4e2d\u6587") == "\u6587\u4e2d");
+
+    SECTION("Combining marks stay on their base character")
+    {
+        REQUIRE(utf8::reverseGraphemes("cafe\u0301!") == "!e\u0301" "fac");
+        REQUIRE(utf8::reverseGraphemes("a\u0323\u0308" "b") == "ba\u0323\u0308");
+    }
+
+    SECTION("Emoji sequences stay intact")
+    {
+        std::string family = "\U0001F468\u200D\U0001F469\u200D\U0001F467";
+        std::string thumbs = "\U0001F44D\U0001F3FD";
+        std::string heart = "\u2764\uFE0F";
+        REQUIRE(utf8::reverseGraphemes("x" + family + thumbs + heart) == heart + thumbs + family + "x");
+    }
+
+    SECTION("Flags are regional-indicator pairs")
+    {
+        std::string us = "\U0001F1FA\U0001F1F8";
+        std::string fr = "\U0001F1EB\U0001F1F7";
+        REQUIRE(utf8::reverseGraphemes(us + fr) == fr + us);
+        REQUIRE(utf8::reverseGraphemes(us + fr + "\U0001F1EF") == "\U0001F1EF" + fr + us);
+    }
+
+    SECTION("Hangul jamo and syllables follow GB6 to GB8")
+    {
+        // L V T jamo, then the LV syllable GA with a trailing T, then LVT GAK
+        std::string jamo = "\u1100\u1161\u11A8";
+        std::string gaWithT = "\uAC00\u11A8";
+        std::string gak = "\uAC01";
+        REQUIRE(utf8::reverseGraphemes(jamo + gaWithT + gak) == gak + gaWithT + jamo);
+        // T does not join a following L, nor LVT a following V
+        REQUIRE(utf8::reverseGraphemes("\u11A8\u1100") == "\u1100\u11A8");
+        REQUIRE(utf8::reverseGraphemes("\uAC01\u1161") == "\u1161\uAC01");
+    }
+
+    SECTION("Reversing twice restores the text")
+    {
+        std::string text = sampleText(300, 3);
+        REQUIRE(utf8::reverseGraphemes(utf8::reverseGraphemes(text)) == text);
+    }
+}